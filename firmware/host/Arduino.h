@@ -0,0 +1,93 @@
+/*
+ * File:        Arduino.h
+ * Author:      Marcus Lechner
+ * Created:     2025-10-18
+ * Description: The part of the Arduino core the firmware uses, for the host builds (native test env and simulator)
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <math.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define ADC_11db 3
+#define PI 3.1415926535897932384626433832795
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+// Time and pins are up to the binary: the simulator runs them on its virtual
+// clock and servo model (src/sim), a test only defines what it reaches
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void pinMode(int pin, int mode);
+void digitalWrite(int pin, int value);
+int analogRead(int pin);
+void analogSetPinAttenuation(int pin, int attenuation);
+bool setCpuFrequencyMhz(uint32_t mhz);
+
+// Output goes to stdout. Input is up to the binary as well, the simulator
+// reads it from stdin.
+class HostSerial
+{
+public:
+    void begin(unsigned long) {}
+    size_t setTxBufferSize(size_t size) { return size; }
+    void flush() { fflush(stdout); }
+
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)))
+    {
+        va_list args;
+        va_start(args, format);
+        const int written = vprintf(format, args);
+        va_end(args);
+        return written < 0 ? 0 : static_cast<size_t>(written);
+    }
+
+    size_t print(const char* text)
+    {
+        return static_cast<size_t>(fputs(text, stdout));
+    }
+
+    size_t println(const char* text = "")
+    {
+        return printf("%s\n", text);
+    }
+
+    size_t write(const uint8_t* data, size_t length)
+    {
+        return fwrite(data, 1, length, stdout);
+    }
+
+    int availableForWrite() { return 0x7FFF; } // stdout never drops a line
+    int available();
+    int read();
+};
+
+extern HostSerial Serial;
+
+// Heap figures for APP_MEMORY's report, up to the binary like the clock
+class HostEsp
+{
+public:
+    uint32_t getFreeHeap();
+    uint32_t getMinFreeHeap();
+    uint32_t getMaxAllocHeap();
+};
+
+extern HostEsp ESP;
+
+#endif // HOST_ARDUINO_H
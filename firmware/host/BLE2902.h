@@ -0,0 +1,18 @@
+/*
+ * File:        BLE2902.h
+ * Author:      Marcus Lechner
+ * Created:     2025-10-18
+ * Description: Notify descriptor stand-in for the host builds, see BLEDevice.h
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#ifndef HOST_BLE2902_H
+#define HOST_BLE2902_H
+
+#include "BLEDevice.h"
+
+class BLE2902 : public BLEDescriptor
+{
+};
+
+#endif // HOST_BLE2902_H
@@ -0,0 +1,114 @@
+/*
+ * File:        BLEDevice.h
+ * Author:      Marcus Lechner
+ * Created:     2025-10-18
+ * Description: BLE stack stand-in for the host builds, the GATT server exists but nothing connects to it
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#ifndef HOST_BLEDEVICE_H
+#define HOST_BLEDEVICE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <vector>
+
+// On the host the app's writes come in through the serial console, which
+// hands them to APP_BLE::receive() like the characteristic callbacks do.
+// These classes only have to let APP_BLE::init() build its service.
+
+class BLECharacteristic;
+class BLEServer;
+
+typedef uint16_t esp_gatt_perm_t;
+#define ESP_GATT_PERM_WRITE_ENC_MITM (1 << 6)
+
+class BLEDescriptor
+{
+};
+
+class BLECharacteristicCallbacks
+{
+public:
+    virtual ~BLECharacteristicCallbacks() {}
+    virtual void onWrite(BLECharacteristic*) {}
+};
+
+class BLECharacteristic
+{
+public:
+    static const uint32_t PROPERTY_READ     = 1 << 0;
+    static const uint32_t PROPERTY_WRITE    = 1 << 1;
+    static const uint32_t PROPERTY_NOTIFY   = 1 << 2;
+    static const uint32_t PROPERTY_WRITE_NR = 1 << 5;
+
+    void setCallbacks(BLECharacteristicCallbacks*) {}
+    void setAccessPermissions(esp_gatt_perm_t) {}
+    void addDescriptor(BLEDescriptor*) {}
+
+    void setValue(const uint8_t* data, size_t length) { _value.assign(data, data + length); }
+    uint8_t* getData() { return _value.empty() ? nullptr : _value.data(); }
+    size_t getLength() const { return _value.size(); }
+    void notify() {}
+
+private:
+    std::vector<uint8_t> _value;
+};
+
+class BLEService
+{
+public:
+    BLECharacteristic* createCharacteristic(const char*, uint32_t)
+    {
+        _characteristics.push_back(new BLECharacteristic()); // lives as long as the process, like on the lamp
+        return _characteristics.back();
+    }
+
+    void start() {}
+
+private:
+    std::vector<BLECharacteristic*> _characteristics;
+};
+
+class BLEServerCallbacks
+{
+public:
+    virtual ~BLEServerCallbacks() {}
+    virtual void onConnect(BLEServer*) {}
+    virtual void onDisconnect(BLEServer*) {}
+};
+
+class BLEServer
+{
+public:
+    void setCallbacks(BLEServerCallbacks*) {}
+    BLEService* createService(const char*) { return new BLEService(); }
+    void startAdvertising() {}
+};
+
+class BLEAdvertising
+{
+public:
+    void addServiceUUID(const char*) {}
+    void setScanResponse(bool) {}
+    void setMinPreferred(uint16_t) {}
+};
+
+class BLEDevice
+{
+public:
+    static void init(const char*) {}
+    static void setMTU(uint16_t) {}
+    static BLEServer* createServer() { return new BLEServer(); }
+
+    static BLEAdvertising* getAdvertising()
+    {
+        static BLEAdvertising advertising;
+        return &advertising;
+    }
+
+    static void startAdvertising() {}
+};
+
+#endif // HOST_BLEDEVICE_H
@@ -0,0 +1,25 @@
+/*
+ * File:        BLESecurity.h
+ * Author:      Marcus Lechner
+ * Created:     2025-10-18
+ * Description: Part of the BLE stack stand-in for the host builds, see BLEDevice.h
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#ifndef HOST_BLESECURITY_H
+#define HOST_BLESECURITY_H
+
+#include "BLEDevice.h"
+
+typedef uint8_t esp_ble_auth_req_t;
+#define ESP_LE_AUTH_REQ_SC_MITM_BOND 0x0D
+
+// Nothing pairs on the host, and firmware writes never reach the simulator
+class BLESecurity
+{
+public:
+    void setStaticPIN(uint32_t) {}
+    void setAuthenticationMode(esp_ble_auth_req_t) {}
+};
+
+#endif // HOST_BLESECURITY_H
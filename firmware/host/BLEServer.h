@@ -0,0 +1,9 @@
+/*
+ * File:        BLEServer.h
+ * Author:      Marcus Lechner
+ * Created:     2025-10-18
+ * Description: Part of the BLE stack stand-in for the host builds, see BLEDevice.h
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#include "BLEDevice.h"
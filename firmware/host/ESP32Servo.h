@@ -0,0 +1,42 @@
+/*
+ * File:        ESP32Servo.h
+ * Author:      Marcus Lechner
+ * Created:     2025-10-18
+ * Description: Servo output for the host builds, the simulator drives its shutter model with it, the tests log it
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#ifndef HOST_ESP32SERVO_H
+#define HOST_ESP32SERVO_H
+
+class ESP32PWM
+{
+public:
+    static void allocateTimer(int) {}
+};
+
+// One write to a Servo. The native tests log every pulse width with the time
+// it was written (test/hal/HOST_HAL.hpp) and check moves against the log.
+struct ServoPulse
+{
+    unsigned long ms;   // millis() at the write
+    int pin;
+    int us;             // 0 where the pulses were stopped
+};
+
+// Defined by the binary: the simulator turns the pulse width into shaft
+// travel and a pot reading (see SIM_HAL.hpp), HOST_HAL logs it
+class Servo
+{
+public:
+    void setPeriodHertz(int) {}
+    int attach(int pin, int minUs, int maxUs);
+    void writeMicroseconds(int us);
+    void release(); // stops the pulses, the shaft stays where it is
+    bool attached() const { return _pin >= 0; }
+
+private:
+    int _pin = -1;
+};
+
+#endif // HOST_ESP32SERVO_H
@@ -0,0 +1,284 @@
+/*
+ * File:        Preferences.h
+ * Author:      Marcus Lechner
+ * Created:     2025-10-18
+ * Description: NVS key-value store for the host builds, a flash-like log in an mmap'd file
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#ifndef HOST_PREFERENCES_H
+#define HOST_PREFERENCES_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// The store is laid out the way NVS uses its partition: entries are appended,
+// a changed or removed entry is only marked erased, and a full partition is
+// compacted in one erase. Every byte that lands in the file is counted, so a
+// test sees what a settings commit really costs the flash.
+//
+// The file is $HOST_NVS if that is set, so a simulator run can keep the lamp's
+// settings for the next one. Otherwise it is an unlinked temporary file and
+// every run starts as a lamp fresh from the factory.
+namespace HOST_NVS
+{
+    constexpr size_t SIZE = 0x5000;     // the default nvs partition
+    constexpr size_t MAX_NAME = 15;     // namespace and key length, as NVS allows
+
+    constexpr uint8_t STATE_FREE = 0xFF;    // erased flash
+    constexpr uint8_t STATE_WRITTEN = 0xFE;
+    constexpr uint8_t STATE_ERASED = 0x00;
+
+    struct Entry
+    {
+        uint8_t state;
+        uint8_t nameLength;
+        uint8_t keyLength;
+        uint8_t reserved;
+        uint32_t valueLength;           // followed by name, key and value
+    };
+
+    struct Stats
+    {
+        size_t bytesWritten;            // entries, state changes and compactions
+        uint32_t entriesWritten;
+        uint32_t compactions;
+    };
+
+    inline Stats& stats()
+    {
+        static Stats s = {};
+        return s;
+    }
+
+    inline uint8_t* partition()
+    {
+        static uint8_t* mapped = nullptr;
+        if (mapped)
+        {
+            return mapped;
+        }
+
+        const char* path = getenv("HOST_NVS");
+        const int fd = path ? open(path, O_RDWR | O_CREAT, 0644) : dup(fileno(tmpfile()));
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0 || (st.st_size < static_cast<off_t>(SIZE) && ftruncate(fd, SIZE) != 0))
+        {
+            fprintf(stderr, "[NVS] cannot open %s\n", path ? path : "a temporary file");
+            abort();
+        }
+
+        void* memory = mmap(nullptr, SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (memory == MAP_FAILED)
+        {
+            fprintf(stderr, "[NVS] cannot map %s\n", path ? path : "a temporary file");
+            abort();
+        }
+
+        mapped = static_cast<uint8_t*>(memory);
+        if (st.st_size < static_cast<off_t>(SIZE))
+        {
+            memset(mapped, STATE_FREE, SIZE);
+        }
+        return mapped;
+    }
+
+    inline size_t entrySize(const Entry& e)
+    {
+        return sizeof(Entry) + e.nameLength + e.keyLength + e.valueLength;
+    }
+
+    inline Entry entryAt(size_t offset)
+    {
+        Entry e;
+        memcpy(&e, partition() + offset, sizeof(e));
+        return e;
+    }
+
+    // Offset of the first free byte, where the next entry goes
+    inline size_t end()
+    {
+        size_t offset = 0;
+        while (offset + sizeof(Entry) <= SIZE && entryAt(offset).state != STATE_FREE)
+        {
+            offset += entrySize(entryAt(offset));
+        }
+        return offset;
+    }
+
+    // Offset of the live entry for name/key, SIZE if there is none
+    inline size_t find(const char* name, const char* key)
+    {
+        const size_t nameLength = strlen(name);
+        const size_t keyLength = strlen(key);
+
+        for (size_t offset = 0; offset + sizeof(Entry) <= SIZE; )
+        {
+            const Entry e = entryAt(offset);
+            if (e.state == STATE_FREE)
+            {
+                break;
+            }
+
+            const uint8_t* text = partition() + offset + sizeof(Entry);
+            if (e.state == STATE_WRITTEN && e.nameLength == nameLength && e.keyLength == keyLength &&
+                memcmp(text, name, nameLength) == 0 && memcmp(text + nameLength, key, keyLength) == 0)
+            {
+                return offset;
+            }
+            offset += entrySize(e);
+        }
+        return SIZE;
+    }
+
+    inline void erase(size_t offset)
+    {
+        partition()[offset] = STATE_ERASED;
+        stats().bytesWritten++;
+    }
+
+    // Moves the live entries to the front and erases the rest, as NVS does
+    // when it runs out of free pages
+    inline void compact()
+    {
+        static uint8_t live[SIZE];
+        size_t used = 0;
+
+        for (size_t offset = 0; offset + sizeof(Entry) <= SIZE; )
+        {
+            const Entry e = entryAt(offset);
+            if (e.state == STATE_FREE)
+            {
+                break;
+            }
+            if (e.state == STATE_WRITTEN)
+            {
+                memcpy(live + used, partition() + offset, entrySize(e));
+                used += entrySize(e);
+            }
+            offset += entrySize(e);
+        }
+
+        memset(partition(), STATE_FREE, SIZE);
+        memcpy(partition(), live, used);
+        stats().bytesWritten += used;
+        stats().compactions++;
+    }
+
+    // Writes a new entry, the state byte last so a cut write is never live
+    inline bool append(const char* name, const char* key, const void* value, size_t length)
+    {
+        Entry e = {};
+        e.state = STATE_FREE;
+        e.nameLength = static_cast<uint8_t>(strlen(name));
+        e.keyLength = static_cast<uint8_t>(strlen(key));
+        e.valueLength = static_cast<uint32_t>(length);
+
+        size_t offset = end();
+        if (offset + entrySize(e) + sizeof(Entry) > SIZE)
+        {
+            compact();
+            offset = end();
+            if (offset + entrySize(e) + sizeof(Entry) > SIZE)
+            {
+                return false;
+            }
+        }
+
+        uint8_t* at = partition() + offset;
+        memcpy(at, &e, sizeof(e));
+        memcpy(at + sizeof(e), name, e.nameLength);
+        memcpy(at + sizeof(e) + e.nameLength, key, e.keyLength);
+        memcpy(at + sizeof(e) + e.nameLength + e.keyLength, value, length);
+        at[0] = STATE_WRITTEN;
+
+        stats().bytesWritten += entrySize(e);
+        stats().entriesWritten++;
+        return true;
+    }
+}
+
+class Preferences
+{
+public:
+    bool begin(const char* name, bool readOnly = false)
+    {
+        if (strlen(name) > HOST_NVS::MAX_NAME)
+        {
+            return false;
+        }
+        strcpy(_name, name);
+        _readOnly = readOnly;
+        return true;
+    }
+
+    void end() {}
+
+    // A new entry first, then the old one erased, so a cut write keeps the old value
+    size_t putBytes(const char* key, const void* value, size_t length)
+    {
+        if (_readOnly || !_name[0] || strlen(key) > HOST_NVS::MAX_NAME)
+        {
+            return 0;
+        }
+
+        const bool replacing = HOST_NVS::find(_name, key) < HOST_NVS::SIZE;
+        if (!HOST_NVS::append(_name, key, value, length))
+        {
+            return 0;
+        }
+        if (replacing)
+        {
+            HOST_NVS::erase(HOST_NVS::find(_name, key)); // the old entry, it comes before the new one
+        }
+        return length;
+    }
+
+    size_t getBytesLength(const char* key)
+    {
+        const size_t offset = HOST_NVS::find(_name, key);
+        return offset < HOST_NVS::SIZE ? HOST_NVS::entryAt(offset).valueLength : 0;
+    }
+
+    size_t getBytes(const char* key, void* buffer, size_t length)
+    {
+        const size_t offset = HOST_NVS::find(_name, key);
+        if (offset == HOST_NVS::SIZE)
+        {
+            return 0;
+        }
+
+        const HOST_NVS::Entry e = HOST_NVS::entryAt(offset);
+        if (e.valueLength > length)
+        {
+            return 0;
+        }
+        memcpy(buffer, HOST_NVS::partition() + offset + sizeof(e) + e.nameLength + e.keyLength, e.valueLength);
+        return e.valueLength;
+    }
+
+    bool remove(const char* key)
+    {
+        const size_t offset = _readOnly ? HOST_NVS::SIZE : HOST_NVS::find(_name, key);
+        if (offset == HOST_NVS::SIZE)
+        {
+            return false;
+        }
+        HOST_NVS::erase(offset);
+        return true;
+    }
+
+private:
+    char _name[HOST_NVS::MAX_NAME + 1] = {};
+    bool _readOnly = false;
+};
+
+#endif // HOST_PREFERENCES_H
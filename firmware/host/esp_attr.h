@@ -0,0 +1,17 @@
+/*
+ * File:        esp_attr.h
+ * Author:      Marcus Lechner
+ * Created:     2025-10-18
+ * Description: ESP-IDF memory placement attributes for the host builds
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#ifndef HOST_ESP_ATTR_H
+#define HOST_ESP_ATTR_H
+
+// RAM that keeps its contents through a software restart. On the host it is
+// one section, the simulator carries it over when it restarts itself (see
+// esp_restart() in SIM_HAL.cpp).
+#define __NOINIT_ATTR __attribute__((section("host_noinit")))
+
+#endif // HOST_ESP_ATTR_H
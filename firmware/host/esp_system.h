@@ -0,0 +1,27 @@
+/*
+ * File:        esp_system.h
+ * Author:      Marcus Lechner
+ * Created:     2025-10-18
+ * Description: ESP-IDF restart, reset reason and random numbers for the host builds
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#ifndef HOST_ESP_SYSTEM_H
+#define HOST_ESP_SYSTEM_H
+
+#include <stdint.h>
+
+typedef enum
+{
+    ESP_RST_UNKNOWN,
+    ESP_RST_POWERON,
+    ESP_RST_SW,
+} esp_reset_reason_t;
+
+// Defined by the binary: the simulator restarts by running itself again with
+// the __NOINIT_ATTR section carried over (SIM_HAL.cpp)
+esp_reset_reason_t esp_reset_reason();
+void esp_restart() __attribute__((noreturn));
+uint32_t esp_random();
+
+#endif // HOST_ESP_SYSTEM_H
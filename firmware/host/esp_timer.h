@@ -0,0 +1,19 @@
+/*
+ * File:        esp_timer.h
+ * Author:      Marcus Lechner
+ * Created:     2025-10-18
+ * Description: The ESP-IDF high resolution timer for the host builds
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#ifndef HOST_ESP_TIMER_H
+#define HOST_ESP_TIMER_H
+
+#include <stdint.h>
+
+// Microseconds since the binary started, on the host's own monotonic clock
+// rather than the simulator's virtual one, which stands still through
+// setup(). APP_BOOT times the start-up with it. Defined by the binary.
+int64_t esp_timer_get_time();
+
+#endif // HOST_ESP_TIMER_H
@@ -0,0 +1,36 @@
+/*
+ * File:        task.h
+ * Author:      Marcus Lechner
+ * Created:     2025-10-18
+ * Description: FreeRTOS task calls for the host builds, defined by the simulator on its virtual clock
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#ifndef HOST_TASK_H
+#define HOST_TASK_H
+
+#include "FreeRTOS.h"
+
+typedef void (*TaskFunction_t)(void*);
+
+// The simulator runs every task on one core of the virtual clock: a task runs
+// from its creation until it waits, then the loop task carries on and hands it
+// the core again between two passes once its wait is over. Tasks are started
+// from the loop task, a task that ends deletes itself as its last call.
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task, const char* name, uint32_t stackDepth,
+                                   void* parameters, UBaseType_t priority, TaskHandle_t* created, BaseType_t core);
+void vTaskDelete(TaskHandle_t task);
+void vTaskSuspend(TaskHandle_t task);
+void vTaskResume(TaskHandle_t task);
+TaskHandle_t xTaskGetHandle(const char* name);
+TaskHandle_t xTaskGetCurrentTaskHandle();
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
+TickType_t xTaskGetTickCount();
+void vTaskDelay(TickType_t ticks);
+void vTaskDelayUntil(TickType_t* previousWake, TickType_t ticks);
+
+// Waiting moves the virtual clock on instead of blocking
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticksToWait);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+
+#endif // HOST_TASK_H
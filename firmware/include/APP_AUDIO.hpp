@@ -0,0 +1,40 @@
+/*
+ * File:        APP_AUDIO.hpp
+ * Author:      Marcus Lechner
+ * Created:     2025-08-02
+ * Description: I2S microphone capture, fixed-point FFT band analysis and beat detection
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#ifndef APP_AUDIO_HPP
+#define APP_AUDIO_HPP
+
+#include <stdint.h>
+
+// The FFT, bands and beat detector are APP_AUDIO_ANALYSIS::Analyser, this
+// module is the microphone and the analysis task around it.
+namespace APP_AUDIO
+{
+    constexpr uint8_t NUM_BANDS = 8;
+
+    // Latest analysis result, copied out as a whole so readers never see a
+    // half-updated set of bands
+    struct Bands
+    {
+        uint8_t  band[NUM_BANDS];   // 0-255 per band, low to high, auto-gained
+        uint8_t  level;             // overall loudness 0-255
+        uint16_t beatCount;         // increments on every detected beat
+        uint32_t captureMicros;     // micros() when the newest samples arrived
+    };
+
+    void init();    // installs the I2S driver and starts the analysis task on core 0
+    void process(); // periodic latency/throughput report
+
+    // Disabled stops the I2S clock and DMA and suspends the analysis task, so an
+    // idle lamp spends nothing on the microphone. get() keeps the last bands.
+    void setEnabled(bool enabled);
+
+    Bands get();    // snapshot for the pattern engine, cheap enough to call every frame
+}
+
+#endif // APP_AUDIO_HPP
@@ -0,0 +1,234 @@
+/*
+ * File:        APP_AUDIO_ANALYSIS.hpp
+ * Author:      Marcus Lechner
+ * Created:     2025-10-18
+ * Description: Fixed-point FFT band analysis and beat detection on microphone sample blocks
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#ifndef APP_AUDIO_ANALYSIS_HPP
+#define APP_AUDIO_ANALYSIS_HPP
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <Arduino.h>
+#include "APP_AUDIO.hpp"
+
+// What the audio task does with every hop of samples, without I2S or the
+// task: DC removal, the windowed FFT, band energies with auto gain and the
+// beat detector. APP_AUDIO feeds it from the microphone, the native test
+// from WAV data, so both run the same numbers.
+namespace APP_AUDIO_ANALYSIS
+{
+    // 256 point FFT at 16 kHz is 62.5 Hz per bin. A new FFT runs every 128
+    // samples (8 ms, 50% overlap), so together with one 8 ms LED frame a sound
+    // reaches the strip in under 20 ms.
+    constexpr uint32_t SAMPLE_RATE = 16000;
+    constexpr uint16_t FFT_SIZE = 256;
+    constexpr uint8_t FFT_LOG2 = 8;
+    constexpr uint16_t HOP_SIZE = FFT_SIZE / 2;
+
+    // first FFT bin of every band (roughly logarithmic), last entry is the end
+    constexpr uint8_t BAND_EDGES[APP_AUDIO::NUM_BANDS + 1] = { 1, 2, 4, 7, 12, 20, 34, 58, 128 };
+
+    constexpr uint8_t NOISE_FLOOR = 60;          // log energy below this reads as silence
+    constexpr uint8_t BEAT_BANDS = 2;            // bass bands that drive beat detection
+    constexpr uint8_t BEAT_REFRACTORY_HOPS = 25; // ~200 ms between beats at most
+
+    // The microphone sends 24-bit samples left aligned in 32 bits. Shifting by
+    // 14 keeps the top 18 bits, 4x the int16 range: quiet rooms come out above
+    // the FFT's rounding, and anything within 12 dB of the microphone's full
+    // scale is clipped to int16 after DC removal.
+    constexpr uint8_t SAMPLE_SHIFT = 14;
+
+    // log2 in 1/8 steps, maps any 32-bit energy onto 0-255
+    inline uint8_t logEnergy(uint32_t energy)
+    {
+        if (energy == 0)
+        {
+            return 0;
+        }
+
+        const uint8_t msb = 31 - __builtin_clz(energy);
+        const uint8_t fraction = msb >= 3 ? (energy >> (msb - 3)) & 0x07 : (energy << (3 - msb)) & 0x07;
+        return static_cast<uint8_t>(msb * 8 + fraction);
+    }
+
+    class Analyser
+    {
+    public:
+        // Builds the twiddles, window and bit reversal and starts from silence
+        void begin()
+        {
+            for (uint16_t k = 0; k < FFT_SIZE / 2; ++k)
+            {
+                const float angle = 2.0f * PI * k / FFT_SIZE;
+                _cos[k] = static_cast<int16_t>(cosf(angle) * 32767.0f);
+                _sin[k] = static_cast<int16_t>(sinf(angle) * 32767.0f);
+            }
+
+            for (uint16_t n = 0; n < FFT_SIZE; ++n)
+            {
+                _window[n] = static_cast<int16_t>(16383.5f * (1.0f - cosf(2.0f * PI * n / (FFT_SIZE - 1))));
+
+                uint8_t r = 0;
+                for (uint8_t bit = 0; bit < FFT_LOG2; ++bit)
+                {
+                    r |= ((n >> bit) & 1) << (FFT_LOG2 - 1 - bit);
+                }
+                _bitReverse[n] = r;
+            }
+
+            memset(_history, 0, sizeof(_history));
+            memset(_bandPeak, 0, sizeof(_bandPeak));
+            memset(&_result, 0, sizeof(_result));
+            _dcEstimate = 0;
+            _beatAverage = 0;
+            _hopsSinceBeat = 0;
+        }
+
+        // One hop of raw microphone words (HOP_SIZE, missing ones read as 0),
+        // returns the bands of the newest FFT_SIZE samples
+        const APP_AUDIO::Bands& hop(const int32_t* raw, uint16_t samples, uint32_t captureMicros)
+        {
+            // slide the history and append the new hop, removing DC on the way
+            memmove(_history, _history + HOP_SIZE, (FFT_SIZE - HOP_SIZE) * sizeof(_history[0]));
+            for (uint16_t n = 0; n < HOP_SIZE; ++n)
+            {
+                int32_t x = n < samples ? (raw[n] >> SAMPLE_SHIFT) : 0;
+                _dcEstimate += (x - _dcEstimate) >> 8;
+                x -= _dcEstimate;
+                _history[FFT_SIZE - HOP_SIZE + n] = static_cast<int16_t>(constrain(x, -32768, 32767));
+            }
+
+            analyse(captureMicros);
+            return _result;
+        }
+
+    private:
+        // In-place radix-2 decimation-in-time FFT on Q15 data. Every stage halves
+        // the values so nothing can overflow; the output is scaled by 1/FFT_SIZE.
+        void fft()
+        {
+            for (uint16_t i = 0; i < FFT_SIZE; ++i)
+            {
+                const uint8_t j = _bitReverse[i];
+                if (j > i)
+                {
+                    int16_t t = _re[i]; _re[i] = _re[j]; _re[j] = t;
+                    t = _im[i]; _im[i] = _im[j]; _im[j] = t;
+                }
+            }
+
+            for (uint16_t size = 2; size <= FFT_SIZE; size <<= 1)
+            {
+                const uint16_t half = size >> 1;
+                const uint16_t step = FFT_SIZE / size;
+
+                for (uint16_t start = 0; start < FFT_SIZE; start += size)
+                {
+                    for (uint16_t k = 0; k < half; ++k)
+                    {
+                        const int32_t wr = _cos[k * step];
+                        const int32_t wi = -_sin[k * step];
+                        const uint16_t a = start + k;
+                        const uint16_t b = a + half;
+
+                        const int32_t tr = (wr * _re[b] - wi * _im[b]) >> 15;
+                        const int32_t ti = (wr * _im[b] + wi * _re[b]) >> 15;
+
+                        _re[b] = static_cast<int16_t>((_re[a] - tr) >> 1);
+                        _im[b] = static_cast<int16_t>((_im[a] - ti) >> 1);
+                        _re[a] = static_cast<int16_t>((_re[a] + tr) >> 1);
+                        _im[a] = static_cast<int16_t>((_im[a] + ti) >> 1);
+                    }
+                }
+            }
+        }
+
+        void analyse(uint32_t captureMicros)
+        {
+            // window the newest FFT_SIZE samples
+            for (uint16_t n = 0; n < FFT_SIZE; ++n)
+            {
+                _re[n] = static_cast<int16_t>((static_cast<int32_t>(_history[n]) * _window[n]) >> 15);
+                _im[n] = 0;
+            }
+
+            fft();
+
+            uint32_t total = 0;
+            uint32_t bass = 0;
+
+            for (uint8_t band = 0; band < APP_AUDIO::NUM_BANDS; ++band)
+            {
+                uint32_t energy = 0;
+                for (uint8_t bin = BAND_EDGES[band]; bin < BAND_EDGES[band + 1]; ++bin)
+                {
+                    energy += static_cast<uint32_t>(_re[bin] * _re[bin] + _im[bin] * _im[bin]);
+                }
+
+                total += energy;
+                if (band < BEAT_BANDS)
+                {
+                    bass += energy;
+                }
+
+                // per band auto gain, the peak decays slowly so quiet passages still move.
+                // A band at its peak keeps it, a decayed peak under e would read over 255.
+                const uint8_t e = logEnergy(energy);
+                if (e >= _bandPeak[band])
+                {
+                    _bandPeak[band] = e;
+                }
+                else if (_bandPeak[band] > NOISE_FLOOR + 8)
+                {
+                    _bandPeak[band]--;
+                }
+
+                _result.band[band] = e <= NOISE_FLOOR ? 0 :
+                    static_cast<uint8_t>((static_cast<uint16_t>(e - NOISE_FLOOR) * 255) / (_bandPeak[band] - NOISE_FLOOR));
+            }
+
+            const uint8_t level = logEnergy(total);
+            _result.level = level <= NOISE_FLOOR ? 0 : static_cast<uint8_t>(((level - NOISE_FLOOR) * 255) / (255 - NOISE_FLOOR));
+
+            // beat = bass energy jumps well above its running average
+            if (_hopsSinceBeat < 255)
+            {
+                _hopsSinceBeat++;
+            }
+
+            const bool beat = bass > _beatAverage + (_beatAverage >> 1) &&
+                              logEnergy(bass) > NOISE_FLOOR &&
+                              _hopsSinceBeat >= BEAT_REFRACTORY_HOPS;
+            _beatAverage = _beatAverage - (_beatAverage >> 4) + (bass >> 4);
+
+            if (beat)
+            {
+                _hopsSinceBeat = 0;
+                _result.beatCount++;
+            }
+
+            _result.captureMicros = captureMicros;
+        }
+
+        int16_t _cos[FFT_SIZE / 2];
+        int16_t _sin[FFT_SIZE / 2];
+        int16_t _window[FFT_SIZE];
+        uint8_t _bitReverse[FFT_SIZE];
+
+        int16_t _history[FFT_SIZE];  // last FFT_SIZE samples, oldest first
+        int16_t _re[FFT_SIZE];
+        int16_t _im[FFT_SIZE];
+
+        int32_t _dcEstimate;
+        uint8_t _bandPeak[APP_AUDIO::NUM_BANDS];
+        uint32_t _beatAverage;
+        uint8_t _hopsSinceBeat;
+        APP_AUDIO::Bands _result;
+    };
+}
+
+#endif // APP_AUDIO_ANALYSIS_HPP
@@ -8,11 +8,36 @@
 #ifndef APP_BLE_HPP
 #define APP_BLE_HPP
 
+#include <stdint.h>
+#include <stddef.h>
 
 namespace APP_BLE
 {
     void init();
     void process();
+
+    // What carried a write to the characteristic layer. The GATT server is one
+    // transport, the serial console and the latency load generator are others,
+    // they all deliver the same (channel, bytes) writes. TRANSPORT_SOCKET is the
+    // simulator's stand-in for the GATT server, see src/sim/SIM_SOCKET.hpp.
+    enum Transport : uint8_t
+    {
+        TRANSPORT_GATT = 0,
+        TRANSPORT_SERIAL,
+        TRANSPORT_LOAD,
+        TRANSPORT_SOCKET,
+        NUM_TRANSPORTS
+    };
+
+    // Live write from any transport, channel is an APP_RECORD::Channel. The write
+    // is recorded, timed by APP_LATENCY and applied. Load generator writes are
+    // not recorded, a storm would only flush the replay log. Returns false when
+    // the write was dropped because it was empty or a replay is running.
+    bool receive(Transport transport, uint8_t channel, const uint8_t* data, size_t length);
+
+    // Applies a write as if it arrived on a characteristic without recording or
+    // timing it, for writes coming back out of a replay
+    void handleWrite(uint8_t channel, const uint8_t* data, size_t length);
 }
 
 #endif // APP_BLE_HPP
\ No newline at end of file
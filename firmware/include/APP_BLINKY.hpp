@@ -13,6 +13,7 @@ namespace APP_BLINKY
 {
     void init();
     void process();
+    void setEnabled(bool enabled); // disabled keeps the LED off
 }
 
 #endif // APP_BLINKY_HPP
\ No newline at end of file
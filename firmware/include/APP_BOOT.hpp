@@ -0,0 +1,36 @@
+/*
+ * File:        APP_BOOT.hpp
+ * Author:      Marcus Lechner
+ * Created:     2025-06-28
+ * Description: Boot stage timestamps so slow start-up steps are easy to spot
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#ifndef APP_BOOT_HPP
+#define APP_BOOT_HPP
+
+#include <stdint.h>
+
+namespace APP_BOOT
+{
+    // One entry per stage, each stage is marked exactly once so stages
+    // finishing on different tasks never race for the same slot
+    enum Stage : uint8_t
+    {
+        STAGE_SERIAL,
+        STAGE_SETTINGS,
+        STAGE_LED,          // LED driver up and the restored scene shown
+        STAGE_LOOP,         // first pass through loop()
+        STAGE_SERVO,
+        STAGE_NETWORK,      // Wi-Fi started, if credentials are stored
+        STAGE_BLE,
+        NUM_STAGES
+    };
+
+    void mark(Stage stage);     // records esp_timer_get_time() since reset for this stage
+    bool isDone(Stage stage);
+    bool isComplete();          // every stage has been marked
+    void process();             // prints the trace once, after the last stage
+}
+
+#endif // APP_BOOT_HPP
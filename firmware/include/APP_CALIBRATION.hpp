@@ -0,0 +1,62 @@
+/*
+ * File:        APP_CALIBRATION.hpp
+ * Author:      Marcus Lechner
+ * Created:     2025-09-06
+ * Description: Per-fixture colour calibration baked into output lookup tables
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#ifndef APP_CALIBRATION_HPP
+#define APP_CALIBRATION_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include "APP_LED.hpp"
+#include "APP_MAP.hpp"
+
+// LEDs from different batches differ in white point, in how their channels
+// respond to low values and in overall output along the strip. Each fixture
+// stores its own calibration in NVS:
+//
+//   white[3]     gain per channel at full drive, the white point
+//   gamma[3]     per channel response, in tenths (10 = linear, 22 = 2.2)
+//   gain[n]      output per segment (one helix turn), 255 = unchanged
+//
+// The white point is normalised so its strongest channel stays at 255, a
+// calibrated lamp gets no dimmer than an uncalibrated one at full white.
+//
+// All of it is baked into one 3 x 256 byte table per segment when the
+// calibration changes, into a spare set that then replaces the one in use
+// (see APP_CALIBRATION.cpp). The output stage then does exactly one table lookup
+// per channel and pixel, the same pass that copies the frame for APP_OUTPUT. The
+// uncalibrated default is FastLED's TypicalLEDStrip correction, so a fixture
+// without calibration looks as it always did.
+//
+// Written over BLE as white[3], gamma[3], gain[NUM_SEGMENTS]. A single 0x00
+// byte goes back to the default.
+namespace APP_CALIBRATION
+{
+    constexpr uint8_t NUM_SEGMENTS = (APP_LED::NUM_LEDS + APP_MAP::LEDS_PER_TURN - 1) / APP_MAP::LEDS_PER_TURN;
+    constexpr uint8_t GAMMA_LINEAR = 10;
+    constexpr uint8_t GAMMA_MIN = 5;
+    constexpr uint8_t GAMMA_MAX = 40;
+    constexpr size_t WRITE_SIZE = 3 + 3 + NUM_SEGMENTS;
+
+    struct Table
+    {
+        uint8_t r[256];
+        uint8_t g[256];
+        uint8_t b[256];
+    };
+
+    void init(); // loads the fixture's calibration and builds the tables
+
+    // Applies, stores and reports a calibration write, false if it was malformed
+    bool set(const uint8_t* data, size_t length);
+
+    // One table pointer per pixel, for the output stage. Take it once per frame,
+    // the tables behind it stay as they are until the next call.
+    const Table* const* pixelTables();
+}
+
+#endif // APP_CALIBRATION_HPP
@@ -0,0 +1,61 @@
+/*
+ * File:        APP_CONSOLE.hpp
+ * Author:      Marcus Lechner
+ * Created:     2025-08-23
+ * Description: USB serial console that drives the BLE protocol and streams rendered frames
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#ifndef APP_CONSOLE_HPP
+#define APP_CONSOLE_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Lets a script on the PC drive the lamp like the app does and watch what it
+// renders, without a phone or a camera. One command per line, answered with
+// "OK" or "ERR <reason>":
+//
+//   W <channel> <hex>   write bytes to a characteristic, channel is one of
+//                       rx, shutter, rgb, anim, pattern, scene, calibration
+//   RX <text>           write text to the RX characteristic, e.g. "RX REPLAY"
+//   STREAM <n>          stream every n-th rendered frame, 0 stops streaming
+//   LOAD <rate> <s> [rgb|shutter]
+//                       slider storm of <rate> writes/s, see APP_LATENCY.hpp
+//   LATENCY [RESET]     print or clear the command-to-frame latency histograms
+//   MEM                 heap, per-module allocation and stack report
+//   SETTINGS            setter changes against flash writes, see APP_SETTINGS.hpp
+//   WIFI <ssid> [pw]    store Wi-Fi credentials for pixel streams, WIFI OFF forgets them
+//   NET [LOAD <fps> <s>]
+//                       pixel stream report, or a loopback DDP load, see APP_PIXELNET.hpp
+//
+// Writes take exactly the same path as BLE writes, so they are recorded and
+// replayed by APP_RECORD like any other input.
+//
+// The simulator (env:sim, src/sim) runs this console on stdin/stdout, so the
+// same scripts drive the firmware on a PC without a lamp.
+//
+// A streamed frame is one line:
+//
+//   F <now ms> <brightness> <shutter %> <rrggbb per pixel>
+//
+// The shutter is where it is, not where it was sent: the pot reading once
+// calibrated, otherwise the command ramping towards the target.
+//
+// The strip is 30 pixels, so a line is about 200 characters and 115200 baud
+// carries some 55 frames a second. Live, a frame that does not fit into the
+// TX buffer is dropped rather than stall the render loop, raise the stream
+// divider if lines go missing. During a replay every streamed frame is sent,
+// the loop waits for the UART instead, which only stretches real time.
+namespace APP_CONSOLE
+{
+    constexpr size_t TX_BUFFER = 1024; // passed to Serial.setTxBufferSize() before Serial.begin()
+
+    void process(); // reads and runs pending commands, call from loop()
+    bool isStreaming();
+
+    // Every frame sent to the strip, streamed when asked to
+    void frameRendered(const uint8_t* pixels, size_t length, uint8_t brightness);
+}
+
+#endif // APP_CONSOLE_HPP
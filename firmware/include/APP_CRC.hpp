@@ -0,0 +1,34 @@
+/*
+ * File:        APP_CRC.hpp
+ * Author:      Marcus Lechner
+ * Created:     2025-08-23
+ * Description: CRC-32 shared by the settings records, the replay log and the golden frames
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#ifndef APP_CRC_HPP
+#define APP_CRC_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace APP_CRC
+{
+    // Standard CRC-32 (zlib/Ethernet). Bitwise, the inputs are small and rare enough
+    // that a 1 KB table isn't worth it. Pass the previous result to continue a checksum.
+    inline uint32_t crc32(const uint8_t* data, size_t length, uint32_t crc = 0)
+    {
+        crc = ~crc;
+        for (size_t i = 0; i < length; ++i)
+        {
+            crc ^= data[i];
+            for (uint8_t bit = 0; bit < 8; ++bit)
+            {
+                crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+            }
+        }
+        return ~crc;
+    }
+}
+
+#endif // APP_CRC_HPP
@@ -0,0 +1,83 @@
+/*
+ * File:        APP_FRAMESTREAM.hpp
+ * Author:      Marcus Lechner
+ * Created:     2025-09-27
+ * Description: Compressed per-pixel frame stream over BLE, keyframes plus RLE deltas
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#ifndef APP_FRAMESTREAM_HPP
+#define APP_FRAMESTREAM_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Lets the app paint every pixel itself instead of picking a pattern. Frames
+// arrive on the frame characteristic as write-without-response, each split
+// into fragments that fit the negotiated MTU:
+//
+//   flags8, sequence8, fragment8, ops...
+//
+//   flags     FLAG_KEY: a keyframe, starts from black
+//             FLAG_LAST: the last fragment of this frame
+//   sequence  frame number, a delta must follow the frame before it
+//   fragment  0, 1, 2, ... within the frame
+//
+// The ops run from pixel 0 and may be split anywhere across fragments:
+//
+//   00nnnnnn  n+1 pixels follow as R, G, B each     (literal)
+//   01nnnnnn  the next R, G, B for n+1 pixels       (run)
+//   1nnnnnnn  leave n+1 pixels as they were         (skip)
+//
+// A delta only sends what changed since the previous frame. Effects that move
+// a few pixels or fill large areas with one colour get by with a few bytes.
+// Pixels past the end of this strip are decoded and dropped, so one stream can
+// drive lamps of different lengths.
+//
+// Fragments are decoded as they arrive into a working frame on the BLE task.
+// A finished frame is handed to the render loop, which shows the newest one on
+// its next tick. Frames that arrive faster than the frame rate are never seen.
+// A lost fragment or a delta without the frame before it is answered with a
+// notify of STATUS_NEED_KEYFRAME and the sequence number. Deltas are then
+// ignored until a keyframe arrives. Without a frame for TIMEOUT_MS the lamp
+// goes back to its patterns.
+//
+// Like firmware chunks, frames are not lamp input for APP_RECORD, a stream
+// would only flush the replay log.
+namespace APP_FRAMESTREAM
+{
+    constexpr uint32_t TIMEOUT_MS = 2500;
+    constexpr uint32_t REPORT_MS = 10000;      // while a stream is running
+    constexpr size_t HEADER_SIZE = 3;
+
+    enum Flags : uint8_t
+    {
+        FLAG_KEY  = 0x01,
+        FLAG_LAST = 0x80
+    };
+
+    enum Status : uint8_t
+    {
+        STATUS_NEED_KEYFRAME = 0x01,
+        STATUS_BAD_FRAME     = 0x10  // ops ran out mid-pixel or the header was short
+    };
+
+    constexpr size_t REPLY_SIZE = 2; // status8, sequence8
+
+    void init();
+    void process(); // timeout and reports, call from loop()
+
+    // Handles one write to the frame characteristic. Returns the length of the
+    // reply put into reply[REPLY_SIZE], 0 for none.
+    size_t handle(const uint8_t* data, size_t length, uint8_t* reply);
+
+    bool isActive(); // a stream is driving the strip
+
+    // Render loop: writes the newest finished frame into rgb (NUM_LEDS x RGB),
+    // leaves it alone when there is none
+    void render(uint8_t* rgb);
+
+    void report();
+}
+
+#endif // APP_FRAMESTREAM_HPP
@@ -0,0 +1,174 @@
+/*
+ * File:        APP_FRAMESTREAM_CODEC.hpp
+ * Author:      Marcus Lechner
+ * Created:     2025-10-18
+ * Description: Skip/run/literal pixel ops of the frame stream, the lamp's decoder and the reference encoder
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#ifndef APP_FRAMESTREAM_CODEC_HPP
+#define APP_FRAMESTREAM_CODEC_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// The op format of APP_FRAMESTREAM.hpp without the BLE side: Decoder is what
+// the lamp runs on every fragment, encodeFrame() what the app has to do. Both
+// are here so the native test and FRAMESTREAM_BENCHMARK run the same code as
+// the stream.
+namespace APP_FRAMESTREAM_CODEC
+{
+    constexpr uint8_t OP_SKIP = 0x80;
+    constexpr uint8_t OP_RUN = 0x40;
+    constexpr uint8_t OP_COUNT = 0x3F;
+    constexpr uint8_t SKIP_COUNT = 0x7F;
+
+    // Greedy: unchanged pixels are skipped, 2 or more equal ones are a run,
+    // everything else goes out literally. A keyframe is a delta against black.
+    // out needs pixels * 4 bytes for the worst case, returns the bytes written.
+    inline size_t encodeFrame(const uint8_t* previous, const uint8_t* current, uint16_t pixels, uint8_t* out)
+    {
+        auto same = [](const uint8_t* a, const uint8_t* b) { return a[0] == b[0] && a[1] == b[1] && a[2] == b[2]; };
+        uint8_t* o = out;
+        uint16_t i = 0;
+
+        while (i < pixels)
+        {
+            const uint8_t* c = current + i * 3;
+
+            if (same(c, previous + i * 3))
+            {
+                uint16_t n = 1;
+                while (i + n < pixels && same(current + (i + n) * 3, previous + (i + n) * 3))
+                {
+                    n++;
+                }
+                if (i + n == pixels)
+                {
+                    break; // unchanged to the end needs no op at all
+                }
+                while (n > 0)
+                {
+                    const uint16_t skip = n <= SKIP_COUNT ? n : SKIP_COUNT + 1;
+                    *o++ = OP_SKIP | (skip - 1);
+                    i += skip;
+                    n -= skip;
+                }
+                continue;
+            }
+
+            uint16_t run = 1;
+            while (i + run < pixels && run <= OP_COUNT && same(current + (i + run) * 3, c))
+            {
+                run++;
+            }
+            if (run >= 2)
+            {
+                *o++ = OP_RUN | (run - 1);
+                memcpy(o, c, 3);
+                o += 3;
+                i += run;
+                continue;
+            }
+
+            uint16_t n = 1;
+            while (i + n < pixels && n <= OP_COUNT)
+            {
+                const uint8_t* p = current + (i + n) * 3;
+                if (same(p, previous + (i + n) * 3) || (i + n + 1 < pixels && same(p, p + 3)))
+                {
+                    break;
+                }
+                n++;
+            }
+            *o++ = n - 1;
+            memcpy(o, c, n * 3);
+            o += n * 3;
+            i += n;
+        }
+        return o - out;
+    }
+
+    // Runs the ops of one frame into a NUM_PIXELS x RGB buffer. The ops may be
+    // split anywhere, decode() picks up mid-op. Pixels past NUM_PIXELS are
+    // decoded and dropped.
+    template <uint16_t NUM_PIXELS>
+    class Decoder
+    {
+    public:
+        Decoder() { reset(); }
+
+        // Back to pixel 0 for the next frame
+        void reset()
+        {
+            _pixel = 0;
+            _op = 0;
+            _remaining = 0;
+            _channel = 0;
+        }
+
+        void decode(const uint8_t* data, size_t length, uint8_t* frame)
+        {
+            for (size_t i = 0; i < length; ++i)
+            {
+                const uint8_t b = data[i];
+
+                if (_remaining == 0)
+                {
+                    if (b & OP_SKIP)
+                    {
+                        _pixel += (b & SKIP_COUNT) + 1U;
+                    }
+                    else
+                    {
+                        _op = b & OP_RUN;
+                        _remaining = (b & OP_COUNT) + 1;
+                        _channel = 0;
+                    }
+                    continue;
+                }
+
+                _rgb[_channel++] = b;
+                if (_channel < 3)
+                {
+                    continue;
+                }
+                _channel = 0;
+
+                if (_op == OP_RUN)
+                {
+                    for (; _remaining > 0; --_remaining)
+                    {
+                        put(frame, _pixel++);
+                    }
+                }
+                else
+                {
+                    put(frame, _pixel++);
+                    _remaining--;
+                }
+            }
+        }
+
+        // False while an op is waiting for pixel bytes, a frame must not end there
+        bool isBetweenOps() const { return _remaining == 0; }
+
+    private:
+        inline void put(uint8_t* frame, uint32_t pixel)
+        {
+            if (pixel < NUM_PIXELS)
+            {
+                memcpy(frame + pixel * 3, _rgb, 3);
+            }
+        }
+
+        uint32_t _pixel;
+        uint8_t _op;         // literal or run in progress
+        uint8_t _remaining;  // pixels left in it, 0 = next byte is an op
+        uint8_t _channel;    // bytes of the current colour seen
+        uint8_t _rgb[3];
+    };
+}
+
+#endif // APP_FRAMESTREAM_CODEC_HPP
@@ -0,0 +1,48 @@
+/*
+ * File:        APP_GOLDEN.hpp
+ * Author:      Marcus Lechner
+ * Created:     2025-08-23
+ * Description: Golden-frame checksums of every built-in pattern, checked on the lamp and on the host
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#ifndef APP_GOLDEN_HPP
+#define APP_GOLDEN_HPP
+
+#include <stdint.h>
+
+// Renders every built-in pattern for FRAMES frames from a clean state with a
+// fixed clock and seed (see APP_LED::beginReference) and hashes the frames
+// into one checksum per pattern.
+//
+// The reference checksums are part of the source, TABLE in APP_GOLDEN_TABLE.cpp.
+// The native test env checks them on every run (pio test -e native), so a
+// change to a pattern or to the FastLED math shows up without a lamp. When a
+// look changes on purpose, the failing test prints the new table to paste in.
+// An entry of NOT_RECORDED is skipped.
+//
+// "GOLDEN" on the BLE RX characteristic runs the same check on the lamp:
+// every pattern that no longer matches is reported and dumped as a PPM image
+// over serial, one row per frame, so the two looks can be compared. Copy the
+// lines between the begin/end markers into a .ppm file to view it.
+// "GOLDEN:PRINT" prints the table as the lamp renders it.
+
+namespace APP_GOLDEN
+{
+    constexpr uint16_t FRAMES = 64;       // about half a second of animation each
+    constexpr uint16_t SEED = 1337;
+    constexpr uint32_t NOT_RECORDED = 0;
+
+    extern const uint32_t TABLE[];
+    extern const uint8_t TABLE_SIZE;
+
+    void process(); // runs a requested check or print pass, blocks the loop for about a second
+
+    void requestCheck();
+    void requestPrint();
+
+    uint32_t checksum(uint8_t animId); // FRAMES reference frames of one built-in pattern
+    void printTable();                 // C source for APP_GOLDEN_TABLE.cpp
+}
+
+#endif // APP_GOLDEN_HPP
@@ -0,0 +1,55 @@
+/*
+ * File:        APP_IDLE.hpp
+ * Author:      Marcus Lechner
+ * Created:     2025-08-30
+ * Description: Idle manager that slows the lamp down while its output is static
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#ifndef APP_IDLE_HPP
+#define APP_IDLE_HPP
+
+#include <stdint.h>
+
+// Most of the time the lamp shows one solid colour with the shutter still, yet
+// the loop polls its timers flat out and renders the same frame 125 times a
+// second. Once the output has been static for IDLE_AFTER_MS (solid colour, no
+// crossfade, servo released, no scene, stream, replay or update running) and
+// no write arrived in that time, the lamp goes idle:
+//
+//  - the CPU drops to IDLE_CPU_MHZ, the lowest clock the radio still runs at
+//  - frames are no longer rendered, the strip latches the last one
+//  - the blink LED is switched off
+//  - the microphone is stopped and the audio analysis task suspended
+//  - the loop blocks for up to IDLE_POLL_MS per pass, so the idle task can
+//    clock-gate the cores. Module timers and the pot are still serviced on
+//    every pass.
+//
+// Any write (BLE, serial, load generator, OTA) wakes the loop at once. It
+// goes back to full speed and renders on the next pass.
+//
+// Light sleep would cut the current further but drops the BLE link on this
+// board, which has no 32 kHz crystal to keep the controller's clock.
+//
+// Every REPORT_MS with idle time, a report prints the share of time spent
+// idle, loop passes per second in each state, and the wake-to-first-frame
+// latency. Read the supply current off a USB meter over the same window to
+// get the idle draw.
+namespace APP_IDLE
+{
+    constexpr uint32_t IDLE_AFTER_MS = 3000;
+    constexpr uint32_t IDLE_POLL_MS = 100;
+    constexpr uint32_t IDLE_CPU_MHZ = 80;
+    constexpr uint32_t ACTIVE_CPU_MHZ = 240;
+    constexpr uint32_t REPORT_MS = 60000;
+
+    void init();    // from setup(), remembers the loop task to wake it
+    void process(); // last in loop(), blocks there while idle
+
+    void activity(); // a write arrived, any task
+    void frameShown(); // render loop, right after APP_OUTPUT::show()
+
+    bool isIdle();
+}
+
+#endif // APP_IDLE_HPP
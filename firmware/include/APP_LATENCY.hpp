@@ -0,0 +1,60 @@
+/*
+ * File:        APP_LATENCY.hpp
+ * Author:      Marcus Lechner
+ * Created:     2025-08-24
+ * Description: Command-to-frame latency histograms and a slider storm load generator
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#ifndef APP_LATENCY_HPP
+#define APP_LATENCY_HPP
+
+#include <stdint.h>
+#include "APP_BLE.hpp"
+
+// Measures how long a write takes to reach the LEDs: from the moment a
+// transport hands it to APP_BLE until APP_OUTPUT::show() returns for the first
+// frame that started rendering after the write was applied. Writes that land
+// while a frame is being rendered wait for the next one, as they would on screen.
+//
+// Every transport keeps its own histogram, so BLE writes from the phone can be
+// compared with the serial console. The BLE figure starts when the stack hands
+// over the write, the air time before that is not included.
+//
+// The load generator plays a slider storm from its own task on core 0, like the
+// BLE host: a colour or shutter slider dragged back and forth at a fixed write
+// rate. The writes take the normal route (echoed and applied, but not recorded
+// for replay), and the histogram for TRANSPORT_LOAD is printed once the storm
+// is over.
+//
+// The simulator runs the storm on its virtual clock, and takes writes from
+// outside over a Unix socket (TRANSPORT_SOCKET, see src/sim/SIM_SOCKET.hpp).
+// Its figures show how writes line up with frames, not what the ESP32 spends.
+namespace APP_LATENCY
+{
+    constexpr uint16_t BUCKET_US = 250;   // histogram resolution
+    constexpr uint16_t NUM_BUCKETS = 128; // up to 32 ms, slower ones land in the last bucket
+    constexpr uint8_t MAX_PENDING = 32;   // writes that may be waiting for a frame
+
+    enum Slider : uint8_t
+    {
+        SLIDER_RGB = 0,     // colour picker, hue sweep on the RGB characteristic
+        SLIDER_SHUTTER      // shutter slider, 0-100 % sweep
+    };
+
+    // A write was applied, arrived is micros() when the transport received it. Any task.
+    void commandApplied(APP_BLE::Transport transport, uint32_t arrived);
+
+    void frameStarted(); // render loop, before the pattern runs
+    void frameShown();   // render loop, right after APP_OUTPUT::show()
+
+    // Starts a storm of rateHz writes for the given time, returns false if one is running
+    bool startLoad(uint16_t rateHz, uint16_t seconds, Slider slider);
+
+    void report(); // prints every histogram that has samples
+    void reset();
+
+    void process(); // reports a finished storm, call from loop()
+}
+
+#endif // APP_LATENCY_HPP
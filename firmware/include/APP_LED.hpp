@@ -13,10 +13,40 @@
 
 namespace APP_LED
 {
+    // Animation IDs from USER_PATTERN_BASE upwards select bytecode patterns
+    // uploaded over BLE (APP_PATTERN slot = animId - USER_PATTERN_BASE)
+    constexpr uint8_t USER_PATTERN_BASE = 0x80;
+
+    constexpr uint8_t NUM_LEDS = 30;
+
+    // Supply budgets below this leave nothing for the strip while the servo moves
+    constexpr uint16_t MIN_POWER_BUDGET_MA = 1000;
+
     void init();
     void process();
     void setSolidColor(uint8_t r, uint8_t g, uint8_t b);
     void setAnimation(uint8_t animId);
+    void setBrightness(uint8_t brightness);
+    void setPowerBudget(uint16_t milliamps); // strip + servo share this supply budget, 0 = built-in default
+    uint16_t getPowerBudget();
+    void startCrossfade(uint16_t durationMs); // call before changing colour/pattern/brightness
+
+    void getSolidColor(uint8_t& r, uint8_t& g, uint8_t& b);
+    uint8_t getAnimation();
+    uint8_t getBrightness();
+    uint8_t getHue(); // shared hue clock, kept in APP_RECORD checkpoints
+    bool isStatic(); // solid colour and no crossfade, every frame is the same
+
+    // Reference rendering for APP_GOLDEN. Runs a built-in pattern from a clean
+    // state on a fixed clock and seed, bypassing pixel streams, crossfade, power
+    // limit and output. It draws into a strip of its own, the live strip and its
+    // trails are left alone. Arena and particles are shared, so the live pattern
+    // starts those over afterwards.
+    uint8_t patternCount();
+    bool isDeterministic(uint8_t animId); // false for patterns driven by live input
+    void beginReference(uint8_t animId, uint16_t seed);
+    const uint8_t* renderReference(uint16_t frame); // NUM_LEDS x RGB
+    void endReference();
 }
 
 #endif // APP_LED_HPP
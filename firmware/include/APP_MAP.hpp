@@ -0,0 +1,63 @@
+/*
+ * File:        APP_MAP.hpp
+ * Author:      Marcus Lechner
+ * Created:     2025-07-26
+ * Description: Per-fixture pixel coordinates and spatial fields sampled over them
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#ifndef APP_MAP_HPP
+#define APP_MAP_HPP
+
+#include <stdint.h>
+#include "APP_LED.hpp"
+
+// Every pixel gets a position in a 0-255 cube, computed once at boot so patterns
+// only ever read small tables. The strip runs from the bottom of the lamp upwards.
+//
+//  x, y   : horizontal position, 128 is the axis of the lamp
+//  z      : height, 0 = bottom, 255 = top
+//  angle  : position around the axis, 0-255 = one full turn
+//
+// A field fills one byte per pixel (e.g. a wave value) that a pattern then feeds
+// into a palette or CHSV in a single pass over the tables. Noise over the map
+// comes from APP_NOISE, which samples the same angle and height tables.
+
+namespace APP_MAP
+{
+    enum Geometry : uint8_t
+    {
+        GEOMETRY_LINE,  // straight strip, x, z and angle all run along it
+        GEOMETRY_HELIX  // strip wound around a tube, LEDS_PER_TURN pixels per turn
+    };
+
+    // Fixture description, change these to match how the strip is mounted
+    constexpr Geometry GEOMETRY = GEOMETRY_HELIX;
+    constexpr uint8_t LEDS_PER_TURN = 10;
+
+    // Tables and fields walk the pixels with uint8_t indices
+    static_assert(APP_LED::NUM_LEDS <= 255, "APP_MAP indexes pixels with uint8_t, 255 pixels at most");
+    constexpr uint8_t NUM_PIXELS = APP_LED::NUM_LEDS;
+
+    // Stored as separate arrays, a field only touches the coordinates it needs
+    struct Map
+    {
+        uint8_t x[NUM_PIXELS];
+        uint8_t y[NUM_PIXELS];
+        uint8_t z[NUM_PIXELS];
+        uint8_t angle[NUM_PIXELS];
+    };
+
+    void init(); // builds the tables for the configured geometry
+    const Map& get();
+
+    // Plane wave: phase + distance along (kx, ky, kz). A factor of 64 advances
+    // the output by one per coordinate step, 128 by two and so on.
+    void linearField(uint8_t* out, int8_t kx, int8_t ky, int8_t kz, uint8_t phase);
+
+    // Distance from (cx, cy, cz), scaled by scale/64, plus phase. Feeding it
+    // through sin8() gives rings expanding from that point.
+    void radialField(uint8_t* out, uint8_t cx, uint8_t cy, uint8_t cz, uint8_t scale, uint8_t phase);
+}
+
+#endif // APP_MAP_HPP
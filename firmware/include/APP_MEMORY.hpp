@@ -0,0 +1,75 @@
+/*
+ * File:        APP_MEMORY.hpp
+ * Author:      Marcus Lechner
+ * Created:     2025-08-31
+ * Description: Heap accounting per module, steady-state allocation audit and task stack watermarks
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#ifndef APP_MEMORY_HPP
+#define APP_MEMORY_HPP
+
+#include <stdint.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// A lamp runs for months, so after start-up nothing may allocate: every
+// allocation in steady state is a chance to fragment the heap.
+//
+// The global operator new/delete are replaced to count every C++ allocation
+// against the module whose Scope is active on the calling task, with live
+// bytes, peak bytes and allocation counts per module. STEADY_AFTER_MS after the
+// last boot stage, the lamp counts as being in steady state. From then on any
+// allocation is counted, and the first one is reported with its size, module
+// and caller address (decode it with addr2line). Setting MEMORY_AUDIT in
+// APP_MEMORY.cpp aborts on that allocation instead, so the panic backtrace
+// shows exactly where it came from.
+//
+// Sized delete (C++14) goes through the same replacement, so blocks freed
+// with a size are taken off the books like any other.
+//
+// Plain malloc() from C code (the BLE stack, printf into long lines) bypasses
+// operator new. It shows up only in the heap totals, which are reported too.
+//
+// Tasks registered with watchTask() are reported with the least stack they
+// ever had free.
+namespace APP_MEMORY
+{
+    constexpr uint32_t STEADY_AFTER_MS = 10000;
+    constexpr uint32_t REPORT_MS = 300000;
+
+    enum Module : uint8_t
+    {
+        MODULE_OTHER = 0,  // anything outside a Scope
+        MODULE_BLE,
+        MODULE_LED,
+        MODULE_SETTINGS,
+        MODULE_SCENE,
+        MODULE_AUDIO,
+        MODULE_OTA,
+        MODULE_NET,
+        NUM_MODULES
+    };
+
+    // Charges allocations on this task to a module until it goes out of scope
+    class Scope
+    {
+    public:
+        explicit Scope(Module module);
+        ~Scope();
+
+    private:
+        uint8_t _previous;
+    };
+
+    void init();    // in setup() behind the first frame, watches the loop task
+    void process(); // enters steady state after boot, reports, call from loop()
+
+    bool isSteady();
+    uint32_t steadyAllocations(); // C++ allocations since steady state, should stay 0
+
+    void watchTask(TaskHandle_t task, const char* name);
+    void report();
+}
+
+#endif // APP_MEMORY_HPP
@@ -0,0 +1,133 @@
+/*
+ * File:        APP_MOTION.hpp
+ * Author:      Marcus Lechner
+ * Created:     2025-07-19
+ * Description: Fixed-point motion planner shared by all actuator axes
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#ifndef APP_MOTION_HPP
+#define APP_MOTION_HPP
+
+#include <stdint.h>
+
+// Every axis moves linearly from where it is to its target over a whole number
+// of ticks. Each tick covers 1/ticksLeft of the remaining distance, so an axis
+// lands exactly on its target on the last tick without accumulating rounding
+// error. Axes given the same tick count therefore arrive together.
+//
+// The axis count is a template parameter so a single-axis build compiles down
+// to plain scalar code with no loops or lookup overhead.
+template <uint8_t NUM_AXES>
+class MotionEngine
+{
+public:
+    // defaultStep: distance covered per tick when no duration is given
+    // tickMs: how often step() is called
+    MotionEngine(int32_t defaultStep, uint16_t tickMs)
+        : _defaultStep(defaultStep),
+          _tickMs(tickMs)
+    {
+        for (uint8_t i = 0; i < NUM_AXES; ++i)
+        {
+            _position[i] = 0;
+            _target[i] = 0;
+            _ticksLeft[i] = 0;
+        }
+    }
+
+    // Jumps an axis to a position without moving, e.g. after calibration
+    void reset(uint8_t axis, int32_t position)
+    {
+        _position[axis] = position;
+        _target[axis] = position;
+        _ticksLeft[axis] = 0;
+    }
+
+    // Moves one axis, over durationMs or at the default speed when it is 0
+    void moveTo(uint8_t axis, int32_t target, uint16_t durationMs)
+    {
+        _target[axis] = target;
+        if (distance(axis) == 0)
+        {
+            _ticksLeft[axis] = 0; // already there, no tick to wait for
+            return;
+        }
+        _ticksLeft[axis] = durationMs ? ticksForDuration(durationMs) : ticksForTravel(distance(axis));
+    }
+
+    // Moves every axis so they all arrive on the same tick. Without a duration
+    // the axis with the longest travel sets the pace at the default speed.
+    void moveAll(const int32_t (&targets)[NUM_AXES], uint16_t durationMs)
+    {
+        uint32_t ticks = 0;
+
+        for (uint8_t i = 0; i < NUM_AXES; ++i)
+        {
+            _target[i] = targets[i];
+            uint32_t t = ticksForTravel(distance(i));
+            if (t > ticks) ticks = t;
+        }
+
+        if (durationMs)
+        {
+            ticks = ticksForDuration(durationMs);
+        }
+
+        for (uint8_t i = 0; i < NUM_AXES; ++i)
+        {
+            _ticksLeft[i] = distance(i) ? ticks : 0; // axes already there stay idle
+        }
+    }
+
+    // Advances every axis by one tick, returns true while any axis is still moving
+    bool step()
+    {
+        bool moving = false;
+
+        for (uint8_t i = 0; i < NUM_AXES; ++i)
+        {
+            if (_ticksLeft[i] == 0)
+            {
+                continue;
+            }
+
+            _position[i] += (_target[i] - _position[i]) / static_cast<int32_t>(_ticksLeft[i]);
+            --_ticksLeft[i];
+            moving = moving || _ticksLeft[i] != 0;
+        }
+
+        return moving;
+    }
+
+    int32_t position(uint8_t axis) const { return _position[axis]; }
+    int32_t target(uint8_t axis) const { return _target[axis]; }
+    bool isMoving(uint8_t axis) const { return _ticksLeft[axis] != 0; }
+
+private:
+    uint32_t distance(uint8_t axis) const
+    {
+        int32_t d = _target[axis] - _position[axis];
+        return static_cast<uint32_t>(d < 0 ? -d : d);
+    }
+
+    uint32_t ticksForDuration(uint16_t durationMs) const
+    {
+        uint32_t ticks = durationMs / _tickMs;
+        return ticks ? ticks : 1;
+    }
+
+    uint32_t ticksForTravel(uint32_t travel) const
+    {
+        uint32_t ticks = (travel + _defaultStep - 1) / _defaultStep;
+        return ticks ? ticks : 1;
+    }
+
+    int32_t _defaultStep;
+    uint16_t _tickMs;
+    int32_t _position[NUM_AXES];
+    int32_t _target[NUM_AXES];
+    uint32_t _ticksLeft[NUM_AXES];
+};
+
+#endif // APP_MOTION_HPP
@@ -0,0 +1,243 @@
+/*
+ * File:        APP_NOISE.hpp
+ * Author:      Marcus Lechner
+ * Created:     2025-08-02
+ * Description: Multi-octave fixed-point value noise evaluated incrementally over the pixel map
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#ifndef APP_NOISE_HPP
+#define APP_NOISE_HPP
+
+#include <stdint.h>
+
+// The noise lives on a lattice wrapped around the lamp (columns = angle, rows =
+// height) that drifts through time. Pixels never move, so everything that only
+// depends on their position is worked out once in init(): which lattice cell each
+// pixel sits in and its smoothed weights inside that cell. Per frame and octave:
+//
+//  - lattice values are hashed for whole time slices only. When time crosses into
+//    the next slice the newer one is kept and only one fresh slice is hashed.
+//  - the two slices around the current time are blended once per lattice point,
+//    which is shared by every pixel in the neighbouring cells.
+//  - each pixel then does a plain bilinear lookup, three 8-bit lerps.
+//
+// Columns wrap around, so the field is seamless all the way round the lamp. All
+// arithmetic is 8/16-bit integer, no floats and no per-pixel hashing.
+namespace APP_NOISE
+{
+    constexpr uint8_t MAX_BASE_CELLS = 4; // lattice cells around/up at the coarsest octave
+
+    constexpr uint16_t octaveSize(uint8_t octave)
+    {
+        return (MAX_BASE_CELLS << octave) * ((MAX_BASE_CELLS << octave) + 1);
+    }
+
+    constexpr uint16_t latticeSize(uint8_t octaves)
+    {
+        return octaves == 0 ? 0 : octaveSize(octaves - 1) + latticeSize(octaves - 1);
+    }
+
+    template <uint16_t NUM_PIXELS, uint8_t OCTAVES>
+    class NoiseField
+    {
+    public:
+        // cellsAround/cellsUp: lattice cells at the coarsest octave (1..MAX_BASE_CELLS),
+        // every further octave doubles both and adds half the amplitude
+        NoiseField(uint8_t seed, uint8_t cellsAround, uint8_t cellsUp)
+            : _seed(seed),
+              _around(clampCells(cellsAround)),
+              _up(clampCells(cellsUp)),
+              _primed(false)
+        {
+            static_assert(OCTAVES > 0 && OCTAVES <= 4, "1 to 4 octaves");
+
+            uint16_t offset = 0;
+            uint16_t amplitudeSum = 0;
+
+            for (uint8_t o = 0; o < OCTAVES; ++o)
+            {
+                _offset[o] = offset;
+                offset += columns(o) * (rows(o) + 1);
+                amplitudeSum += 128 >> o;
+            }
+
+            // weights sum to at most 256, so the octaves add up without overflowing 8 bits
+            for (uint8_t o = 0; o < OCTAVES; ++o)
+            {
+                _weight[o] = static_cast<uint8_t>(((128 >> o) * 256UL) / amplitudeSum - 1);
+                _timeCell[o] = 0;
+                _older[o] = 0;
+            }
+        }
+
+        // Places every pixel on the lattice. angle: 0-255 = one turn, height: 0-255 = bottom to top
+        void init(const uint8_t* angle, const uint8_t* height)
+        {
+            for (uint8_t o = 0; o < OCTAVES; ++o)
+            {
+                const uint16_t cols = columns(o);
+                const uint16_t rowsO = rows(o);
+
+                for (uint16_t i = 0; i < NUM_PIXELS; ++i)
+                {
+                    const uint16_t a = angle[i] * cols;  // cell in the high byte, position in the low
+                    const uint16_t h = height[i] * rowsO;
+                    const uint16_t col = a >> 8;
+                    const uint16_t row = h >> 8;
+
+                    Sample& s = _sample[o][i];
+                    s.cell = _offset[o] + row * cols + col;
+                    s.right = (col + 1 == cols) ? s.cell - col : s.cell + 1; // wraps round the lamp
+                    s.fa = smooth8(a & 0xFF);
+                    s.fh = smooth8(h & 0xFF);
+                }
+            }
+
+            _primed = false;
+        }
+
+        // Writes one 0-255 value per pixel. time is in 1/256 of a coarse lattice
+        // cell, finer octaves drift proportionally faster. It may wrap freely.
+        void render(uint8_t* out, uint16_t time)
+        {
+            for (uint8_t o = 0; o < OCTAVES; ++o)
+            {
+                const uint32_t t = static_cast<uint32_t>(time) << o;
+                advance(o, static_cast<uint16_t>(t >> 8));
+                blendSlices(o, smooth8(t & 0xFF));
+
+                const uint8_t cols = columns(o);
+                const uint8_t weight = _weight[o];
+                const Sample* s = _sample[o];
+
+                for (uint16_t i = 0; i < NUM_PIXELS; ++i, ++s)
+                {
+                    const uint8_t bottom = lerp(_now[s->cell], _now[s->right], s->fa);
+                    const uint8_t top = lerp(_now[s->cell + cols], _now[s->right + cols], s->fa);
+                    const uint8_t v = scale(lerp(bottom, top, s->fh), weight);
+                    out[i] = (o == 0) ? v : out[i] + v;
+                }
+            }
+        }
+
+    private:
+        struct Sample
+        {
+            uint16_t cell;  // lattice index of the lower left corner
+            uint16_t right; // lattice index of the lower right corner
+            uint8_t  fa;    // smoothed position inside the cell, around
+            uint8_t  fh;    // smoothed position inside the cell, up
+        };
+
+        static uint8_t clampCells(uint8_t cells)
+        {
+            return cells == 0 ? 1 : (cells > MAX_BASE_CELLS ? MAX_BASE_CELLS : cells);
+        }
+
+        // 3f^2 - 2f^3, hides the lattice grid
+        static uint8_t smooth8(uint8_t f)
+        {
+            const uint32_t f2 = static_cast<uint32_t>(f) * f;
+            return static_cast<uint8_t>((f2 * (3 * 256 - 2 * static_cast<uint32_t>(f))) >> 16);
+        }
+
+        static uint8_t lerp(uint8_t a, uint8_t b, uint8_t f)
+        {
+            return static_cast<uint8_t>(a + (((static_cast<int16_t>(b) - a) * f) >> 8));
+        }
+
+        static uint8_t scale(uint8_t v, uint8_t weight)
+        {
+            return static_cast<uint8_t>((static_cast<uint16_t>(v) * (weight + 1)) >> 8);
+        }
+
+        uint8_t columns(uint8_t octave) const { return _around << octave; }
+        uint8_t rows(uint8_t octave) const { return _up << octave; }
+
+        // Time slices repeat after 256 coarse cells so the field survives time wrapping
+        uint16_t timeMask(uint8_t octave) const { return (256U << octave) - 1; }
+
+        uint8_t hash(uint8_t octave, uint16_t col, uint16_t row, uint16_t slice) const
+        {
+            uint32_t x = (static_cast<uint32_t>(_seed) << 24) ^ (static_cast<uint32_t>(octave) << 16) ^ slice;
+            x ^= (static_cast<uint32_t>(col) * 0x85EBCA6BUL) ^ (static_cast<uint32_t>(row) * 0xC2B2AE35UL);
+            x ^= x >> 15;
+            x *= 0x2C1B3C6DUL;
+            x ^= x >> 12;
+            x *= 0x297A2D39UL;
+            x ^= x >> 15;
+            return static_cast<uint8_t>(x >> 24);
+        }
+
+        void fillSlice(uint8_t octave, uint8_t which, uint16_t slice)
+        {
+            const uint8_t cols = columns(octave);
+            const uint8_t rowsO = rows(octave);
+            uint8_t* dst = _slice[which] + _offset[octave];
+
+            for (uint16_t row = 0; row <= rowsO; ++row)
+            {
+                for (uint16_t col = 0; col < cols; ++col)
+                {
+                    *dst++ = hash(octave, col, row, slice & timeMask(octave));
+                }
+            }
+        }
+
+        // Makes sure the two slices around timeCell are hashed, reusing the newer one when time steps forward by one
+        void advance(uint8_t octave, uint16_t timeCell)
+        {
+            timeCell &= timeMask(octave);
+
+            if (_primed && timeCell == _timeCell[octave])
+            {
+                return;
+            }
+
+            if (_primed && timeCell == ((_timeCell[octave] + 1) & timeMask(octave)))
+            {
+                _older[octave] ^= 1; // the newer slice becomes the older one, refill the other
+                fillSlice(octave, _older[octave] ^ 1, timeCell + 1);
+            }
+            else
+            {
+                fillSlice(octave, _older[octave], timeCell);
+                fillSlice(octave, _older[octave] ^ 1, timeCell + 1);
+            }
+
+            _timeCell[octave] = timeCell;
+            if (octave == OCTAVES - 1)
+            {
+                _primed = true;
+            }
+        }
+
+        void blendSlices(uint8_t octave, uint8_t ft)
+        {
+            const uint16_t begin = _offset[octave];
+            const uint16_t end = begin + columns(octave) * (rows(octave) + 1);
+            const uint8_t* older = _slice[_older[octave]];
+            const uint8_t* newer = _slice[_older[octave] ^ 1];
+
+            for (uint16_t i = begin; i < end; ++i)
+            {
+                _now[i] = lerp(older[i], newer[i], ft);
+            }
+        }
+
+        uint8_t _seed;
+        uint8_t _around;
+        uint8_t _up;
+        bool _primed;
+        uint16_t _offset[OCTAVES];
+        uint8_t _weight[OCTAVES];
+        uint16_t _timeCell[OCTAVES];
+        uint8_t _older[OCTAVES];                        // which _slice holds the earlier time slice
+        uint8_t _slice[2][latticeSize(OCTAVES)];
+        uint8_t _now[latticeSize(OCTAVES)];             // slices blended to the current time
+        Sample _sample[OCTAVES][NUM_PIXELS];
+    };
+}
+
+#endif // APP_NOISE_HPP
@@ -0,0 +1,80 @@
+/*
+ * File:        APP_OTA.hpp
+ * Author:      Marcus Lechner
+ * Created:     2025-08-25
+ * Description: Firmware updates over BLE into the inactive OTA slot with rollback
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#ifndef APP_OTA_HPP
+#define APP_OTA_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+
+// The partition table has two app slots. An update is streamed over the OTA
+// characteristic straight into the slot that is not running, one chunk per
+// write, and hashed with SHA-256 as it goes. Nothing is buffered beyond the
+// chunk in flight. Every write starts with an opcode, numbers are little endian:
+//
+//   0x01 BEGIN  size32, sha256[32]   start, or resume the same image
+//   0x02 DATA   offset32, bytes      next chunk, must continue at the offset
+//   0x03 END                         verify, switch slots and restart
+//   0x04 ABORT
+//
+// The lamp answers on the same characteristic with status8 and offset32. DATA
+// is only answered every ACK_BYTES and on errors, so a client can stream with
+// write-without-response and still see where it got to. After a disconnect
+// the session stays open until the lamp restarts, a BEGIN with the same size
+// and hash answers with the offset to continue from. The session, and the hash
+// state with it, only lives in RAM: after a restart or power cut the upload
+// starts again from 0.
+//
+// The characteristic only takes writes over an encrypted link from a central
+// that bonded with the lamp's passkey (see APP_BLE.cpp), the stack turns the
+// rest away before they reach handle().
+//
+// A new image boots in a pending state. Once it has run a healthy main loop
+// (every boot stage done, then HEALTHY_MS of looping) it is marked valid. If it
+// crashes or resets before that, the bootloader goes back to the previous slot,
+// and if it never gets its boot stages done it rolls itself back.
+namespace APP_OTA
+{
+    constexpr uint32_t ACK_BYTES = 4096;      // DATA is acknowledged once per flash sector
+    constexpr uint32_t HEALTHY_MS = 10000;    // loop time after boot before a new image counts as good
+    constexpr uint32_t BOOT_DEADLINE_MS = 60000;
+
+    enum Opcode : uint8_t
+    {
+        OP_BEGIN = 0x01,
+        OP_DATA  = 0x02,
+        OP_END   = 0x03,
+        OP_ABORT = 0x04
+    };
+
+    enum Status : uint8_t
+    {
+        STATUS_READY       = 0x00, // offset = where to continue
+        STATUS_PROGRESS    = 0x01, // offset = bytes written so far
+        STATUS_DONE        = 0x02, // verified, restarting
+        STATUS_BAD_REQUEST = 0x10,
+        STATUS_BAD_OFFSET  = 0x11, // offset = the one expected
+        STATUS_NO_SESSION  = 0x12,
+        STATUS_TOO_BIG     = 0x13,
+        STATUS_FLASH_ERROR = 0x14,
+        STATUS_BAD_HASH    = 0x15
+    };
+
+    constexpr size_t REPLY_SIZE = 5; // status8, offset32
+
+    void init();    // in setup() behind the first frame, notes whether this boot is a pending update
+    void process(); // confirms or rolls back a pending update, call from loop()
+
+    // Handles one write to the OTA characteristic. Returns the length of the
+    // reply put into reply[REPLY_SIZE], 0 for none.
+    size_t handle(const uint8_t* data, size_t length, uint8_t* reply);
+
+    bool isUpdating(); // a session is open
+}
+
+#endif // APP_OTA_HPP
@@ -0,0 +1,281 @@
+/*
+ * File:        APP_OTA_SESSION.hpp
+ * Author:      Marcus Lechner
+ * Created:     2025-10-18
+ * Description: OTA chunk protocol (BEGIN/DATA/END, resume, SHA-256) over a pluggable flash slot
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#ifndef APP_OTA_SESSION_HPP
+#define APP_OTA_SESSION_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <Arduino.h>
+#include "APP_OTA.hpp"
+
+// Everything APP_OTA does with a write to the OTA characteristic except the
+// flash itself: the opcodes, the offset checks, resume after a disconnect,
+// the running SHA-256 and the replies (see APP_OTA.hpp for the protocol). The
+// lamp plugs in the esp_ota_* calls and mbedtls, the native test a file and a
+// plain SHA-256, so the pipeline is the same code on both.
+//
+// Flash is the slot the image goes into:
+//   uint32_t capacity()                      bytes the slot holds, 0 if there is none
+//   bool begin()                             start a sequential write from offset 0
+//   bool write(const uint8_t*, size_t)       append, erasing as it goes
+//   bool end()                               check the image and make it the boot slot
+//   void abort()                             drop what was written
+//   const char* label()
+//
+// Digest is SHA-256:
+//   void begin(), void update(const uint8_t*, size_t), void finish(uint8_t* hash), void discard()
+namespace APP_OTA_SESSION
+{
+    constexpr size_t HASH_SIZE = 32;
+    constexpr size_t BEGIN_SIZE = 1 + 4 + HASH_SIZE;
+    constexpr size_t DATA_HEADER = 1 + 4;
+    constexpr uint32_t PAUSE_MS = 2000; // a gap this long is a disconnect, not slow flash
+
+    template <class Flash, class Digest>
+    class Session
+    {
+    public:
+        Session(Flash& flash, Digest& digest)
+            : _flash(flash),
+              _digest(digest),
+              _open(false),
+              _done(false),
+              _size(0),
+              _written(0),
+              _nextAck(0),
+              _activeMs(0),
+              _lastChunkMs(0)
+        {
+        }
+
+        // One write to the characteristic, returns the reply length put into
+        // reply[APP_OTA::REPLY_SIZE], 0 for none
+        size_t handle(const uint8_t* data, size_t length, uint8_t* out, uint32_t nowMs)
+        {
+            if (length == 0)
+            {
+                return reply(out, APP_OTA::STATUS_BAD_REQUEST, 0);
+            }
+
+            switch (data[0])
+            {
+                case APP_OTA::OP_BEGIN: return begin(data, length, out, nowMs);
+                case APP_OTA::OP_DATA:  return chunk(data, length, out, nowMs);
+                case APP_OTA::OP_END:   return finish(out);
+                case APP_OTA::OP_ABORT:
+                    if (_open)
+                    {
+                        printThroughput("Aborted after");
+                    }
+                    close(true);
+                    return reply(out, APP_OTA::STATUS_READY, 0);
+                default:
+                    return reply(out, APP_OTA::STATUS_BAD_REQUEST, 0);
+            }
+        }
+
+        bool isOpen() const { return _open; }
+        bool isDone() const { return _done; }  // verified and set to boot, restart due
+        uint32_t written() const { return _written; }
+
+    private:
+        static uint32_t readU32(const uint8_t* p)
+        {
+            return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+        }
+
+        static size_t reply(uint8_t* out, APP_OTA::Status status, uint32_t offset)
+        {
+            out[0] = status;
+            out[1] = static_cast<uint8_t>(offset);
+            out[2] = static_cast<uint8_t>(offset >> 8);
+            out[3] = static_cast<uint8_t>(offset >> 16);
+            out[4] = static_cast<uint8_t>(offset >> 24);
+            return APP_OTA::REPLY_SIZE;
+        }
+
+        // KB/s over the time data was actually flowing
+        void printThroughput(const char* what)
+        {
+            const uint32_t ms = _activeMs ? _activeMs : 1;
+            const uint32_t bytesPerS = static_cast<uint32_t>((static_cast<uint64_t>(_written) * 1000) / ms);
+            Serial.printf("[OTA] %s %lu/%lu bytes, %lu.%lu KB/s\n", what,
+                          static_cast<unsigned long>(_written), static_cast<unsigned long>(_size),
+                          static_cast<unsigned long>(bytesPerS / 1024), static_cast<unsigned long>((bytesPerS % 1024) * 10 / 1024));
+        }
+
+        void close(bool abortFlash)
+        {
+            if (!_open)
+            {
+                return;
+            }
+
+            if (abortFlash)
+            {
+                _flash.abort();
+            }
+            _digest.discard();
+            _open = false;
+        }
+
+        size_t begin(const uint8_t* data, size_t length, uint8_t* out, uint32_t nowMs)
+        {
+            if (length < BEGIN_SIZE)
+            {
+                return reply(out, APP_OTA::STATUS_BAD_REQUEST, 0);
+            }
+
+            const uint32_t size = readU32(data + 1);
+            const uint8_t* hash = data + 5;
+
+            // Same image as the open session: pick up where the last connection stopped
+            if (_open && _size == size && memcmp(_expected, hash, HASH_SIZE) == 0)
+            {
+                Serial.printf("[OTA] Resuming at %lu\n", static_cast<unsigned long>(_written));
+                return reply(out, APP_OTA::STATUS_READY, _written);
+            }
+
+            close(true);
+
+            if (size == 0 || size > _flash.capacity())
+            {
+                Serial.printf("[OTA] Image of %lu bytes does not fit\n", static_cast<unsigned long>(size));
+                return reply(out, APP_OTA::STATUS_TOO_BIG, 0);
+            }
+
+            if (!_flash.begin())
+            {
+                return reply(out, APP_OTA::STATUS_FLASH_ERROR, 0);
+            }
+
+            _open = true;
+            _done = false;
+            _size = size;
+            _written = 0;
+            _nextAck = APP_OTA::ACK_BYTES;
+            memcpy(_expected, hash, HASH_SIZE);
+            _digest.begin();
+            _activeMs = 0;
+            _lastChunkMs = nowMs;
+
+            Serial.printf("[OTA] Receiving %lu bytes into %s\n", static_cast<unsigned long>(size), _flash.label());
+            return reply(out, APP_OTA::STATUS_READY, 0);
+        }
+
+        size_t chunk(const uint8_t* data, size_t length, uint8_t* out, uint32_t nowMs)
+        {
+            if (!_open)
+            {
+                return reply(out, APP_OTA::STATUS_NO_SESSION, 0);
+            }
+
+            if (length < DATA_HEADER)
+            {
+                return reply(out, APP_OTA::STATUS_BAD_REQUEST, _written);
+            }
+
+            const uint32_t offset = readU32(data + 1);
+            const uint8_t* bytes = data + DATA_HEADER;
+            const size_t count = length - DATA_HEADER;
+
+            // Repeats and gaps are both refused, the client restarts from the offset we expect
+            if (offset != _written)
+            {
+                return reply(out, APP_OTA::STATUS_BAD_OFFSET, _written);
+            }
+
+            if (count > _size - _written)
+            {
+                return reply(out, APP_OTA::STATUS_TOO_BIG, _written);
+            }
+
+            if (!_flash.write(bytes, count))
+            {
+                Serial.printf("[OTA] Flash write failed at %lu\n", static_cast<unsigned long>(offset));
+                close(true);
+                return reply(out, APP_OTA::STATUS_FLASH_ERROR, offset);
+            }
+
+            _digest.update(bytes, count);
+            _written += count;
+
+            if (nowMs - _lastChunkMs < PAUSE_MS)
+            {
+                _activeMs += nowMs - _lastChunkMs;
+            }
+            _lastChunkMs = nowMs;
+
+            if (_written >= _nextAck)
+            {
+                _nextAck += APP_OTA::ACK_BYTES;
+                if ((_written & 0xFFFF) < APP_OTA::ACK_BYTES)
+                {
+                    printThroughput("Received"); // every 64 KB
+                }
+                return reply(out, APP_OTA::STATUS_PROGRESS, _written);
+            }
+            return 0;
+        }
+
+        size_t finish(uint8_t* out)
+        {
+            if (!_open)
+            {
+                return reply(out, APP_OTA::STATUS_NO_SESSION, 0);
+            }
+
+            if (_written != _size)
+            {
+                return reply(out, APP_OTA::STATUS_BAD_OFFSET, _written);
+            }
+
+            uint8_t hash[HASH_SIZE];
+            _digest.finish(hash);
+            printThroughput("Received");
+
+            if (memcmp(hash, _expected, HASH_SIZE) != 0)
+            {
+                Serial.println("[OTA] SHA-256 mismatch, image discarded");
+                close(true);
+                return reply(out, APP_OTA::STATUS_BAD_HASH, 0);
+            }
+
+            // end() checks the image header and its own checksum on top, and
+            // releases the write either way
+            const bool ended = _flash.end();
+            close(false);
+
+            if (!ended)
+            {
+                Serial.println("[OTA] Image rejected by the bootloader checks");
+                return reply(out, APP_OTA::STATUS_FLASH_ERROR, 0);
+            }
+
+            Serial.printf("[OTA] Verified, booting %s\n", _flash.label());
+            _done = true;
+            return reply(out, APP_OTA::STATUS_DONE, 0);
+        }
+
+        Flash& _flash;
+        Digest& _digest;
+
+        bool _open;
+        bool _done;
+        uint32_t _size;
+        uint32_t _written;
+        uint32_t _nextAck;
+        uint8_t _expected[HASH_SIZE];
+        uint32_t _activeMs;     // time spent receiving, pauses between connections excluded
+        uint32_t _lastChunkMs;
+    };
+}
+
+#endif // APP_OTA_SESSION_HPP
@@ -0,0 +1,82 @@
+/*
+ * File:        APP_OUTPUT.hpp
+ * Author:      Marcus Lechner
+ * Created:     2025-09-13
+ * Description: Converts the rendered frame to the fixture's pixel format and sends it to the strip
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#ifndef APP_OUTPUT_HPP
+#define APP_OUTPUT_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include "APP_LED.hpp"
+
+// Everything up to the output stage works on one neutral format: calibrated
+// RGB, 3 bytes per pixel in R, G, B order, plus one global brightness. Only
+// here is it turned into what the strip on this fixture wants, in one pass per
+// frame into a packed transmit buffer:
+//
+//   FORMAT_GRB     WS2812, 3 bytes G R B, brightness scaled into the colour
+//   FORMAT_RGBW    SK6812 RGBW, 4 bytes G R B W, the part all three colour
+//                  channels share is moved to the white LED
+//   FORMAT_APA102  SPI, brightness goes into the 5 bit per-pixel current, so
+//                  dimming keeps the 8 bits of colour resolution
+//   FORMAT_HD108   SPI, 16 bits per channel, colour times brightness keeps
+//                  every bit of both
+//
+// The format is picked once per frame and each one has its own tight loop,
+// swapping strips costs no frame time. One-wire strips are clocked out by the
+// RMT peripheral while the next frame renders, SPI strips in one burst on VSPI.
+// FastLED only renders now, its temporal dithering is gone with its show().
+namespace APP_OUTPUT
+{
+    enum PixelFormat : uint8_t
+    {
+        FORMAT_GRB = 0,
+        FORMAT_RGBW,
+        FORMAT_APA102,
+        FORMAT_HD108,
+        NUM_FORMATS
+    };
+
+    constexpr PixelFormat FORMAT = FORMAT_GRB; // the strip fitted to this fixture variant
+
+    constexpr uint8_t DATA_PIN = 4;
+    constexpr uint8_t CLOCK_PIN = 5;           // APA102 and HD108 only
+    constexpr uint32_t SPI_HZ = 8000000;
+
+    constexpr size_t bytesPerPixel(PixelFormat format)
+    {
+        return format == FORMAT_GRB ? 3 : format == FORMAT_HD108 ? 8 : 4;
+    }
+
+    // Zero bytes in front of the pixels, for the SPI formats
+    constexpr size_t startBytes(PixelFormat format)
+    {
+        return format == FORMAT_APA102 ? 4 : format == FORMAT_HD108 ? 16 : 0;
+    }
+
+    // Extra clock edges after the pixels so the data reaches the last pixel
+    constexpr size_t endBytes(PixelFormat format, uint16_t count)
+    {
+        return (format == FORMAT_APA102 || format == FORMAT_HD108) ? (count + 15) / 16 : 0;
+    }
+
+    constexpr size_t frameBytes(PixelFormat format, uint16_t count)
+    {
+        return startBytes(format) + count * bytesPerPixel(format) + endBytes(format, count);
+    }
+
+    void init();
+
+    // Converts and sends one frame, NUM_LEDS x RGB. Waits for the previous
+    // frame to be out first, the transmit buffer is reused.
+    void show(const uint8_t* rgb, uint8_t brightness);
+
+    // The conversion alone, into out (frameBytes() long), returns the bytes written
+    size_t encode(PixelFormat format, const uint8_t* rgb, uint16_t count, uint8_t brightness, uint8_t* out);
+}
+
+#endif // APP_OUTPUT_HPP
@@ -0,0 +1,171 @@
+/*
+ * File:        APP_PARTICLE.hpp
+ * Author:      Marcus Lechner
+ * Created:     2025-08-09
+ * Description: Fixed-capacity particle pool with emitters and additive splatting
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#ifndef APP_PARTICLE_HPP
+#define APP_PARTICLE_HPP
+
+#include <stdint.h>
+#include <FastLED.h>
+
+// Particles live along the strip. Positions are in 1/256 of a pixel so slow
+// particles glide smoothly between pixels instead of jumping.
+//
+// Every attribute is its own array (position, velocity, colour, life) and the
+// live particles are always packed at the front, a dead one is replaced by the
+// last live one. update() and render() are therefore straight loops over dense
+// arrays with no branches on dead slots, and nothing is ever allocated.
+//
+// A particle's colour is converted to RGB once when it spawns. Its life is the
+// brightness it is drawn with, multiplied by keep/256 every frame, so particles
+// fade out exponentially like a fadeToBlackBy() trail.
+namespace APP_PARTICLE
+{
+    constexpr uint8_t POS_SHIFT = 8;              // fixed point position, 1 pixel = 256
+    constexpr int32_t PIXEL = 1L << POS_SHIFT;
+    constexpr uint8_t MIN_LIFE = 4;               // dimmer than this is dropped
+
+    // Describes a burst of particles, see ParticlePool::emit()
+    struct Emitter
+    {
+        int32_t  position;   // first possible position, 1/256 pixel
+        int32_t  spread;     // particles land in [position, position + spread)
+        int16_t  velocity;   // 1/256 pixel per frame
+        uint8_t  jitter;     // random velocity in [-jitter, +jitter] added to each particle
+        uint8_t  hue;
+        uint8_t  hueSpread;  // random hue in [hue, hue + hueSpread)
+        uint8_t  saturation;
+        uint8_t  life;       // starting brightness
+        uint8_t  keep;       // fraction of life kept every frame, out of 256
+    };
+
+    template <uint16_t CAPACITY>
+    class ParticlePool
+    {
+    public:
+        ParticlePool() : _count(0) {}
+
+        void clear() { _count = 0; }
+        uint16_t size() const { return _count; }
+        static uint16_t capacity() { return CAPACITY; }
+
+        // Adds one particle, returns false when the pool is full
+        bool spawn(int32_t position, int16_t velocity, const CRGB& color, uint8_t life, uint8_t keep)
+        {
+            if (_count >= CAPACITY)
+            {
+                return false;
+            }
+
+            const uint16_t i = _count++;
+            _position[i] = position;
+            _velocity[i] = velocity;
+            _r[i] = color.r;
+            _g[i] = color.g;
+            _b[i] = color.b;
+            _life[i] = life;
+            _keep[i] = keep;
+            return true;
+        }
+
+        // Spawns count particles from an emitter, returns how many fitted
+        uint16_t emit(const Emitter& e, uint16_t count)
+        {
+            uint16_t spawned = 0;
+
+            for (; spawned < count; ++spawned)
+            {
+                const int32_t position = e.position + static_cast<int32_t>((static_cast<uint64_t>(random16()) * e.spread) >> 16);
+                const int16_t velocity = e.velocity + (e.jitter ? static_cast<int16_t>(random16(2 * e.jitter + 1)) - e.jitter : 0);
+                const uint8_t hue = e.hue + (e.hueSpread ? random8(e.hueSpread) : 0);
+
+                if (!spawn(position, velocity, CHSV(hue, e.saturation, 255), e.life, e.keep))
+                {
+                    break;
+                }
+            }
+
+            return spawned;
+        }
+
+        // Moves and fades every particle by one frame and drops those that
+        // faded out or left [0, length) pixels
+        void update(uint16_t length)
+        {
+            const int32_t end = static_cast<int32_t>(length) << POS_SHIFT;
+            uint16_t i = 0;
+
+            while (i < _count)
+            {
+                const int32_t position = _position[i] + _velocity[i];
+                const uint8_t life = scale8(_life[i], _keep[i]);
+
+                if (life < MIN_LIFE || position < 0 || position >= end)
+                {
+                    remove(i); // the last particle moves into i and is updated next
+                    continue;
+                }
+
+                _position[i] = position;
+                _life[i] = life;
+                ++i;
+            }
+        }
+
+        // Adds every particle onto leds[], split between the two pixels it sits
+        // between. Particles spawned off the strip and not yet dropped by
+        // update() are skipped.
+        void render(CRGB* leds, uint16_t length) const
+        {
+            const int32_t end = static_cast<int32_t>(length) << POS_SHIFT;
+
+            for (uint16_t i = 0; i < _count; ++i)
+            {
+                if (_position[i] < 0 || _position[i] >= end)
+                {
+                    continue;
+                }
+
+                const uint16_t pixel = static_cast<uint16_t>(_position[i] >> POS_SHIFT);
+                const uint8_t frac = static_cast<uint8_t>(_position[i] & (PIXEL - 1));
+                const uint8_t lower = scale8(_life[i], 255 - frac);
+                const uint8_t upper = scale8(_life[i], frac);
+
+                leds[pixel] += CRGB(scale8(_r[i], lower), scale8(_g[i], lower), scale8(_b[i], lower));
+
+                if (upper && pixel + 1 < length)
+                {
+                    leds[pixel + 1] += CRGB(scale8(_r[i], upper), scale8(_g[i], upper), scale8(_b[i], upper));
+                }
+            }
+        }
+
+    private:
+        void remove(uint16_t i)
+        {
+            const uint16_t last = --_count;
+            _position[i] = _position[last];
+            _velocity[i] = _velocity[last];
+            _r[i] = _r[last];
+            _g[i] = _g[last];
+            _b[i] = _b[last];
+            _life[i] = _life[last];
+            _keep[i] = _keep[last];
+        }
+
+        uint16_t _count;
+        int32_t _position[CAPACITY];
+        int16_t _velocity[CAPACITY];
+        uint8_t _r[CAPACITY];
+        uint8_t _g[CAPACITY];
+        uint8_t _b[CAPACITY];
+        uint8_t _life[CAPACITY];
+        uint8_t _keep[CAPACITY];
+    };
+}
+
+#endif // APP_PARTICLE_HPP
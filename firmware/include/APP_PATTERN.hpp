@@ -0,0 +1,105 @@
+/*
+ * File:        APP_PATTERN.hpp
+ * Author:      Marcus Lechner
+ * Created:     2025-06-14
+ * Description: Bytecode interpreter for user patterns uploaded over BLE
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#ifndef APP_PATTERN_HPP
+#define APP_PATTERN_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include <FastLED.h>
+
+// A pattern program is a small header followed by a per-pixel expression.
+//
+//  byte 0 : format version (FORMAT_VERSION)
+//  byte 1 : palette id (PaletteId), or PALETTE_NONE when the program outputs HSV/RGB
+//  byte 2 : fade applied to the previous frame before drawing. 0 overwrites every
+//           pixel, anything else adds the output on top of the faded frame
+//  byte 3 : phase step, added to the program phase P once per frame
+//  byte 4 : beats per minute for the B register (0 = B stays 0)
+//  byte 5+: per-pixel code, evaluated once for every LED
+//
+// The per-pixel code runs on a uint8_t stack machine. It has no jumps, so the
+// stack depth of every instruction is known when the program is loaded and the
+// interpreter itself never has to check for under/overflow. All arithmetic wraps
+// at 8 bits unless the opcode says otherwise. The code must end with exactly one
+// output opcode (OP_PAL, OP_HSV or OP_RGB), which writes the current pixel.
+//
+// Example, the native colorWaves() pattern as bytecode:
+//   01 00 00 00 00                     version 1, rainbow palette, no fade
+//   02 01 08 0A 03 01 02 0A 08 10      index = sin8(i * 8 + T * 2)
+//   02 01 10 0A 03 01 03 0A 08 10      bright = sin8(i * 16 + T * 3)
+//   20                                 PAL(index, bright)
+
+namespace APP_PATTERN
+{
+    constexpr uint8_t FORMAT_VERSION = 1;
+    constexpr uint8_t NUM_SLOTS = 4;           // user patterns held in RAM
+    constexpr uint8_t MAX_PROGRAM_SIZE = 64;   // header + code, fits one long BLE write
+    constexpr uint8_t MAX_STACK = 8;
+
+    enum PaletteId : uint8_t
+    {
+        PALETTE_RAINBOW = 0,
+        PALETTE_PARTY,
+        PALETTE_OCEAN,
+        PALETTE_FOREST,
+        PALETTE_LAVA,
+        PALETTE_CLOUD,
+        PALETTE_HEAT,
+        NUM_PALETTES,
+        PALETTE_NONE = 0xFF
+    };
+
+    enum Opcode : uint8_t
+    {
+        OP_END   = 0x00, // reserved, never valid inside code
+
+        // push (stack +1)
+        OP_K     = 0x01, // push the next code byte
+        OP_I     = 0x02, // push pixel index (low 8 bits)
+        OP_T     = 0x03, // push shared hue clock (gHue)
+        OP_P     = 0x04, // push program phase
+        OP_B     = 0x05, // push beatsin8(bpm) for this frame
+        OP_RND   = 0x06, // push random8()
+        OP_DUP   = 0x07, // duplicate top of stack
+
+        // binary (stack -1)
+        OP_ADD   = 0x08, // a + b
+        OP_SUB   = 0x09, // a - b
+        OP_MUL   = 0x0A, // a * b
+        OP_SCALE = 0x0B, // scale8(a, b)
+        OP_QADD  = 0x0C, // saturating add
+        OP_QSUB  = 0x0D, // saturating subtract
+        OP_NOISE = 0x0E, // inoise8(a * 32, b * 4)
+        OP_MAX   = 0x0F, // max(a, b)
+
+        // unary (stack +0)
+        OP_SIN   = 0x10, // sin8(a)
+        OP_COS   = 0x11, // cos8(a)
+        OP_TRI   = 0x12, // triwave8(a)
+        OP_QUAD  = 0x13, // quadwave8(a)
+        OP_INV   = 0x14, // 255 - a
+        OP_BAND  = 0x15, // microphone band (a % APP_AUDIO::NUM_BANDS), 0-255
+
+        // output, must be the last opcode
+        OP_PAL   = 0x20, // pop bright, index -> ColorFromPalette
+        OP_HSV   = 0x21, // pop v, s, h -> CHSV
+        OP_RGB   = 0x22, // pop b, g, r -> CRGB
+    };
+
+    // Validates and copies a program into a slot, returns false if it is rejected.
+    // Safe from the BLE task: the upload is taken over by render() on its next frame.
+    bool load(uint8_t slot, const uint8_t* program, size_t length);
+    bool clear(uint8_t slot); // false if there is no such slot
+    bool isLoaded(uint8_t slot);
+
+    // Runs one frame of the program in slot over leds[0..count).
+    void render(uint8_t slot, CRGB* leds, uint16_t count, uint8_t hue);
+}
+
+#endif // APP_PATTERN_HPP
@@ -0,0 +1,82 @@
+/*
+ * File:        APP_PIXELNET.hpp
+ * Author:      Marcus Lechner
+ * Created:     2025-09-20
+ * Description: Optional DDP and E1.31 (sACN) pixel stream receiver over Wi-Fi with a jitter buffer
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#ifndef APP_PIXELNET_HPP
+#define APP_PIXELNET_HPP
+
+#include <stdint.h>
+#include "APP_LED.hpp"
+
+// BLE is far too slow to feed whole frames at the frame rate, Wi-Fi is not.
+// With Wi-Fi credentials stored (console: WIFI <ssid> [password]) the lamp
+// joins the network and takes pixel data from lighting software:
+//
+//   DDP     UDP 4048, RGB data at a byte offset, the PUSH flag ends a frame
+//   E1.31   UDP 5568, unicast or multicast, 170 pixels per universe from
+//           START_UNIVERSE on, a frame is complete with its last universe
+//
+// Without credentials Wi-Fi stays off and nothing here costs anything.
+//
+// Packets are read in the loop into an assembly buffer. A finished frame is
+// copied into a small ring with its arrival time. The render loop takes at
+// most one frame per tick, once it has waited JITTER_US. Frames that arrive in
+// a burst therefore come out evenly on the frame clock. Wi-Fi has to stay in
+// modem sleep next to BLE, so bursts are common. When the ring is full the
+// oldest frame is dropped. A frame older than MAX_AGE_US is skipped so the
+// delay cannot build up.
+//
+// A DDP sequence gap (4 bit) or E1.31 gap (8 bit) is counted, and the frame
+// still goes out with the pixels it missed left as they were. E1.31 packets
+// up to 20 behind the last sequence number are late duplicates and dropped,
+// as the standard asks. E1.31 preview data is ignored. Its stream-terminated
+// option ends the stream right away.
+//
+// From the first complete frame on, the stream replaces the pattern. Without
+// a new frame for TIMEOUT_MS (2.5 s, the E1.31 data loss timeout) the lamp
+// falls back to its own patterns.
+//
+// The packet handling and the ring are APP_PIXELNET_STREAM::Receiver, this
+// module is the Wi-Fi and socket side around it.
+//
+// NET LOAD on the console sends DDP frames to the lamp itself over loopback,
+// so the receive path can be measured without a network. The report has
+// packets/s and the arrival-to-frame latency. Without credentials Wi-Fi is
+// switched on for the load and off again once it is done.
+namespace APP_PIXELNET
+{
+    constexpr uint16_t DDP_PORT = 4048;
+    constexpr uint16_t E131_PORT = 5568;
+    constexpr uint16_t START_UNIVERSE = 1;
+    constexpr uint16_t UNIVERSE_CHANNELS = 510; // 170 RGB pixels
+    constexpr uint16_t NUM_UNIVERSES = (APP_LED::NUM_LEDS * 3 + UNIVERSE_CHANNELS - 1) / UNIVERSE_CHANNELS;
+
+    constexpr uint8_t JITTER_SLOTS = 8;
+    constexpr uint32_t JITTER_US = 10000;   // a bit over one frame at 120 FPS
+    constexpr uint32_t MAX_AGE_US = 100000;
+    constexpr uint32_t TIMEOUT_MS = 2500;
+
+    void init();    // loads the stored credentials, the radio stays off
+    void connect(); // joins Wi-Fi and opens the ports if credentials are stored, behind the first frame
+    void process(); // reads pending packets, call from loop()
+
+    bool isActive(); // a stream is driving the strip
+
+    // Render loop: writes the next due frame into rgb (NUM_LEDS x RGB), leaves
+    // it alone when none is due
+    void render(uint8_t* rgb);
+
+    // Stores the credentials and (re)connects, a null ssid switches Wi-Fi off
+    void setCredentials(const char* ssid, const char* password);
+
+    // Sends frameRate DDP frames/s over loopback for the given time, false if one is running
+    bool startLoad(uint16_t frameRate, uint16_t seconds);
+
+    void report(); // packets, frames, drops and latency since the last report
+}
+
+#endif // APP_PIXELNET_HPP
@@ -0,0 +1,326 @@
+/*
+ * File:        APP_PIXELNET_STREAM.hpp
+ * Author:      Marcus Lechner
+ * Created:     2025-10-18
+ * Description: DDP and E1.31 packet parsing, frame assembly and jitter ring, without the network
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#ifndef APP_PIXELNET_STREAM_HPP
+#define APP_PIXELNET_STREAM_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "APP_PIXELNET.hpp"
+
+// Everything APP_PIXELNET does with a received UDP payload: the DDP and E1.31
+// checks, sequence gaps and late packets, frame assembly, the jitter ring and
+// the stream timeout (see APP_PIXELNET.hpp for the behaviour). Wi-Fi, the
+// sockets and the console stay in APP_PIXELNET.cpp, so the native test feeds
+// the same code from loopback sockets on the host. Times are passed in as
+// micros(), nothing here reads a clock.
+namespace APP_PIXELNET_STREAM
+{
+    // DDP, see http://www.3waylabs.com/ddp/
+    constexpr size_t DDP_HEADER = 10;
+    constexpr size_t DDP_TIMECODE_SIZE = 4;
+    constexpr uint8_t DDP_VERSION_MASK = 0xC0;
+    constexpr uint8_t DDP_VERSION_1 = 0x40;
+    constexpr uint8_t DDP_TIMECODE = 0x10;
+    constexpr uint8_t DDP_REPLY = 0x04;
+    constexpr uint8_t DDP_QUERY = 0x02;
+    constexpr uint8_t DDP_PUSH = 0x01;
+    constexpr uint8_t DDP_TYPE_RGB8 = 0x0B;
+    constexpr uint8_t DDP_ID_DISPLAY = 1;
+    constexpr uint8_t DDP_ID_ALL = 255;
+
+    // E1.31 data packet, offsets from ANSI E1.31-2018
+    constexpr uint8_t E131_PACKET_ID[12] = { 'A', 'S', 'C', '-', 'E', '1', '.', '1', '7', 0, 0, 0 };
+    constexpr size_t E131_ID_OFFSET = 4;
+    constexpr size_t E131_ROOT_VECTOR = 18;
+    constexpr size_t E131_FRAME_VECTOR = 40;
+    constexpr size_t E131_SEQUENCE = 111;
+    constexpr size_t E131_OPTIONS = 112;
+    constexpr size_t E131_UNIVERSE = 113;
+    constexpr size_t E131_DMP_VECTOR = 117;
+    constexpr size_t E131_VALUE_COUNT = 123;
+    constexpr size_t E131_START_CODE = 125;
+    constexpr size_t E131_DATA = 126;
+    constexpr uint32_t E131_VECTOR_ROOT_DATA = 0x00000004;
+    constexpr uint32_t E131_VECTOR_FRAME_DATA = 0x00000002;
+    constexpr uint8_t E131_VECTOR_DMP_SET = 0x02;
+    constexpr uint8_t E131_OPT_PREVIEW = 0x80;
+    constexpr uint8_t E131_OPT_TERMINATED = 0x40;
+    constexpr int8_t E131_LATE_WINDOW = -20;
+
+    // What a packet did to the stream, for the caller's log and idle timer
+    enum Event : uint8_t
+    {
+        EVENT_NONE = 0,
+        EVENT_STARTED,      // first complete frame, the stream takes over
+        EVENT_FRAME,        // another complete frame queued
+        EVENT_TERMINATED    // E1.31 stream-terminated, the stream has ended
+    };
+
+    struct Stats
+    {
+        uint32_t packets;
+        uint32_t frames;     // complete frames received
+        uint32_t presented;
+        uint32_t gaps;       // sequence numbers missing
+        uint32_t late;       // E1.31 packets behind the sequence
+        uint32_t overruns;   // frames dropped from a full ring
+        uint32_t skipped;    // frames too old to show
+        uint32_t malformed;
+        uint32_t latencyMaxUs;
+        uint64_t latencySumUs;
+    };
+
+    inline uint16_t readU16(const uint8_t* p)
+    {
+        return static_cast<uint16_t>((p[0] << 8) | p[1]);
+    }
+
+    inline uint32_t readU32(const uint8_t* p)
+    {
+        return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+               (static_cast<uint32_t>(p[2]) << 8) | p[3];
+    }
+
+    template <uint16_t NUM_PIXELS>
+    class Receiver
+    {
+    public:
+        static constexpr size_t FRAME_BYTES = static_cast<size_t>(NUM_PIXELS) * 3;
+        static constexpr uint16_t NUM_UNIVERSES =
+            (FRAME_BYTES + APP_PIXELNET::UNIVERSE_CHANNELS - 1) / APP_PIXELNET::UNIVERSE_CHANNELS;
+
+        Receiver()
+            : _ddpSequence(0),
+              _head(0),
+              _count(0),
+              _active(false),
+              _lastFrameUs(0)
+        {
+            memset(_assembly, 0, sizeof(_assembly));
+            memset(_e131SequenceValid, 0, sizeof(_e131SequenceValid));
+            resetStats();
+        }
+
+        Event ddp(const uint8_t* p, size_t length, uint32_t arrivedUs)
+        {
+            _stats.packets++;
+            if (length < DDP_HEADER || (p[0] & DDP_VERSION_MASK) != DDP_VERSION_1)
+            {
+                _stats.malformed++;
+                return EVENT_NONE;
+            }
+
+            const uint8_t flags = p[0];
+            const uint8_t id = p[3];
+            if ((flags & (DDP_QUERY | DDP_REPLY)) || (id != DDP_ID_DISPLAY && id != DDP_ID_ALL))
+            {
+                return EVENT_NONE; // status and config requests, or for another output
+            }
+
+            const uint8_t sequence = p[1] & 0x0F;
+            if (sequence && _ddpSequence && sequence != _ddpSequence % 15 + 1)
+            {
+                _stats.gaps++;
+            }
+            if (sequence)
+            {
+                _ddpSequence = sequence;
+            }
+
+            const size_t header = DDP_HEADER + ((flags & DDP_TIMECODE) ? DDP_TIMECODE_SIZE : 0);
+            const uint32_t offset = readU32(p + 4);
+            const uint16_t count = readU16(p + 8);
+            if (header + count > length)
+            {
+                _stats.malformed++;
+                return EVENT_NONE;
+            }
+
+            if (offset < FRAME_BYTES)
+            {
+                const size_t n = count < FRAME_BYTES - offset ? count : FRAME_BYTES - offset;
+                memcpy(_assembly + offset, p + header, n);
+            }
+
+            return (flags & DDP_PUSH) ? frameComplete(arrivedUs) : EVENT_NONE;
+        }
+
+        Event e131(const uint8_t* p, size_t length, uint32_t arrivedUs)
+        {
+            _stats.packets++;
+            if (length < E131_DATA ||
+                memcmp(p + E131_ID_OFFSET, E131_PACKET_ID, sizeof(E131_PACKET_ID)) != 0 ||
+                readU32(p + E131_ROOT_VECTOR) != E131_VECTOR_ROOT_DATA ||
+                readU32(p + E131_FRAME_VECTOR) != E131_VECTOR_FRAME_DATA ||
+                p[E131_DMP_VECTOR] != E131_VECTOR_DMP_SET)
+            {
+                _stats.malformed++;
+                return EVENT_NONE;
+            }
+
+            const uint8_t options = p[E131_OPTIONS];
+            const uint16_t universe = readU16(p + E131_UNIVERSE);
+            if ((options & E131_OPT_PREVIEW) ||
+                universe < APP_PIXELNET::START_UNIVERSE ||
+                universe >= APP_PIXELNET::START_UNIVERSE + NUM_UNIVERSES)
+            {
+                return EVENT_NONE;
+            }
+
+            const uint16_t index = universe - APP_PIXELNET::START_UNIVERSE;
+            const uint8_t sequence = p[E131_SEQUENCE];
+            if (_e131SequenceValid[index])
+            {
+                const int8_t step = static_cast<int8_t>(sequence - _e131Sequence[index]);
+                if (step <= 0 && step > E131_LATE_WINDOW)
+                {
+                    _stats.late++;
+                    return EVENT_NONE;
+                }
+                if (step != 1)
+                {
+                    _stats.gaps++;
+                }
+            }
+            _e131Sequence[index] = sequence;
+            _e131SequenceValid[index] = true;
+
+            if (options & E131_OPT_TERMINATED)
+            {
+                memset(_e131SequenceValid, 0, sizeof(_e131SequenceValid));
+                return stop() ? EVENT_TERMINATED : EVENT_NONE;
+            }
+
+            const uint16_t values = readU16(p + E131_VALUE_COUNT);
+            if (values < 1 || E131_DATA + values - 1 > length)
+            {
+                _stats.malformed++;
+                return EVENT_NONE;
+            }
+            if (p[E131_START_CODE] != 0)
+            {
+                return EVENT_NONE; // not dimmer data
+            }
+
+            const size_t offset = static_cast<size_t>(index) * APP_PIXELNET::UNIVERSE_CHANNELS;
+            size_t n = values - 1;
+            if (n > APP_PIXELNET::UNIVERSE_CHANNELS) n = APP_PIXELNET::UNIVERSE_CHANNELS;
+            if (n > FRAME_BYTES - offset) n = FRAME_BYTES - offset;
+            memcpy(_assembly + offset, p + E131_DATA, n);
+
+            return (index == NUM_UNIVERSES - 1) ? frameComplete(arrivedUs) : EVENT_NONE;
+        }
+
+        // Writes the next due frame into rgb (NUM_PIXELS x RGB), false and rgb
+        // left alone when none is due
+        bool render(uint8_t* rgb, uint32_t nowUs)
+        {
+            // Too old to be worth showing, unless it is the only one left
+            while (_count > 1 && nowUs - _slots[_head].arrivedUs > APP_PIXELNET::MAX_AGE_US)
+            {
+                _head = (_head + 1) % APP_PIXELNET::JITTER_SLOTS;
+                _count--;
+                _stats.skipped++;
+            }
+
+            if (_count == 0 || nowUs - _slots[_head].arrivedUs < APP_PIXELNET::JITTER_US)
+            {
+                return false;
+            }
+
+            const Slot& slot = _slots[_head];
+            memcpy(rgb, slot.rgb, FRAME_BYTES);
+
+            const uint32_t latency = nowUs - slot.arrivedUs;
+            _stats.latencySumUs += latency;
+            if (latency > _stats.latencyMaxUs)
+            {
+                _stats.latencyMaxUs = latency;
+            }
+            _stats.presented++;
+
+            _head = (_head + 1) % APP_PIXELNET::JITTER_SLOTS;
+            _count--;
+            return true;
+        }
+
+        // Ends the stream when no frame came for TIMEOUT_MS, true if it did
+        bool expire(uint32_t nowUs)
+        {
+            if (!_active || nowUs - _lastFrameUs <= APP_PIXELNET::TIMEOUT_MS * 1000UL)
+            {
+                return false;
+            }
+            return stop();
+        }
+
+        // Back to the patterns with the ring emptied, true if a stream was running
+        bool stop()
+        {
+            const bool wasActive = _active;
+            _active = false;
+            _count = 0;
+            return wasActive;
+        }
+
+        bool isActive() const { return _active; }
+        uint8_t queued() const { return _count; }
+        const Stats& stats() const { return _stats; }
+        void resetStats() { memset(&_stats, 0, sizeof(_stats)); }
+
+    private:
+        struct Slot
+        {
+            uint8_t rgb[FRAME_BYTES];
+            uint32_t arrivedUs;
+        };
+
+        Event frameComplete(uint32_t arrivedUs)
+        {
+            if (_count == APP_PIXELNET::JITTER_SLOTS)
+            {
+                _head = (_head + 1) % APP_PIXELNET::JITTER_SLOTS;
+                _count--;
+                _stats.overruns++;
+            }
+
+            Slot& slot = _slots[(_head + _count) % APP_PIXELNET::JITTER_SLOTS];
+            memcpy(slot.rgb, _assembly, FRAME_BYTES);
+            slot.arrivedUs = arrivedUs;
+            _count++;
+            _stats.frames++;
+            _lastFrameUs = arrivedUs;
+
+            if (_active)
+            {
+                return EVENT_FRAME;
+            }
+            _active = true;
+            return EVENT_STARTED;
+        }
+
+        // Frame being assembled, packets only change the pixels they carry
+        uint8_t _assembly[FRAME_BYTES];
+        uint8_t _ddpSequence; // 0 = none seen yet, DDP counts 1-15
+        uint8_t _e131Sequence[NUM_UNIVERSES];
+        bool _e131SequenceValid[NUM_UNIVERSES];
+
+        // Jitter buffer, oldest first
+        Slot _slots[APP_PIXELNET::JITTER_SLOTS];
+        uint8_t _head;
+        uint8_t _count;
+
+        bool _active;
+        uint32_t _lastFrameUs;
+        Stats _stats;
+    };
+}
+
+#endif // APP_PIXELNET_STREAM_HPP
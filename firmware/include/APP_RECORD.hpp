@@ -0,0 +1,104 @@
+/*
+ * File:        APP_RECORD.hpp
+ * Author:      Marcus Lechner
+ * Created:     2025-08-16
+ * Description: Input event recorder and deterministic replay with a virtual clock
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#ifndef APP_RECORD_HPP
+#define APP_RECORD_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include "APP_SETTINGS.hpp"
+
+// Everything that makes a run unique goes through this module: the clock, the
+// random seed, BLE writes, pot readings and the moments frames were rendered.
+// From boot these are logged into a compact ring buffer in RAM that survives a
+// software restart.
+//
+// To reproduce a bug, trigger it on the lamp and send "REPLAY" to the BLE RX
+// characteristic. The lamp restarts, boots with the recorded settings and seed,
+// and feeds the log back at the recorded times on a virtual clock, running as
+// fast as the loop allows. Afterwards it prints a timing report and whether the
+// replayed frames hash to the same checksum as the recorded ones. Recording
+// then carries on from where the replay left the lamp. The simulator does the
+// same on the host, its restart runs the binary again (see SIM_HAL.hpp), so a
+// scripted session can be recorded and replayed without a lamp.
+//
+// Once the log wraps, the boot state is gone. Every LOG_SIZE / 2 bytes the
+// loop therefore takes a checkpoint: a Snapshot of the live state and the log
+// position it belongs to. Two are kept, so at least half a log is always
+// replayable. A replay starts from the boot state while the log has not
+// wrapped, otherwise from the oldest checkpoint still in the log. A snapshot
+// holds what the app controls, not the inner state of every pattern. Patterns
+// with history (fire, particles, noise drift) may therefore not hash the same
+// when replayed from a checkpoint.
+//
+// "DUMP" prints the log as hex.
+
+namespace APP_RECORD
+{
+    // Sources of BLE writes, APP_BLE maps its characteristics onto these
+    enum Channel : uint8_t
+    {
+        CHANNEL_RX = 0,
+        CHANNEL_SHUTTER,
+        CHANNEL_RGB,
+        CHANNEL_ANIM,
+        CHANNEL_PATTERN,
+        CHANNEL_SCENE,
+        CHANNEL_CALIBRATION
+    };
+
+    // Live state at a checkpoint, put back by the modules' init() in replay
+    struct Snapshot
+    {
+        APP_SETTINGS::Settings settings; // colour, pattern and shutter as shown, the rest as stored
+        uint16_t seed;                   // random16 state
+        uint8_t  brightness;
+        uint8_t  hue;                    // APP_LED's shared hue clock
+        uint8_t  scenePlaying;
+        uint8_t  sceneCue;
+        uint32_t sceneCueDue;
+    };
+
+    void init();    // first thing in setup(), picks record or replay mode and seeds the RNG
+    void process(); // delivers replayed events, call at the top of loop()
+
+    // Milliseconds since boot, virtual while replaying. Use instead of millis()
+    // for anything that affects what the lamp does.
+    uint32_t now();
+
+    // Holds now() at a fixed time until unpinClock(), for rendering reference frames
+    void pinClock(uint32_t ms);
+    void unpinClock();
+
+    bool isReplaying();
+
+    // Settings the recording started from, APP_SETTINGS logs them at boot and takes them back in replay
+    void setStartSettings(const APP_SETTINGS::Settings& settings);
+    const APP_SETTINGS::Settings& startSettings();
+
+    // The checkpoint a replay started from, nullptr otherwise or when it started from boot
+    const Snapshot* snapshot();
+
+    // Logs a BLE write. Returns false while replaying, live writes are then ignored.
+    bool bleWrite(Channel channel, const uint8_t* data, size_t length);
+
+    // Pass a fresh pot reading through. Logged when recording, replaced by the
+    // recorded value when replaying.
+    int adcSample(uint8_t axis, int value);
+
+    // Replay only: true when the log says a frame was rendered at this time
+    bool frameDue();
+
+    // Every frame sent to the strip, hashed for the replay comparison
+    void frameRendered(const uint8_t* pixels, size_t length, uint8_t brightness);
+
+    void requestReplay(); // restarts into replay from the loop
+    void requestDump();   // prints the log from the loop
+}
+
+#endif // APP_RECORD_HPP
@@ -0,0 +1,57 @@
+/*
+ * File:        APP_SCENE.hpp
+ * Author:      Marcus Lechner
+ * Created:     2025-07-05
+ * Description: Scene presets and timed cue lists played back on the lamp
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#ifndef APP_SCENE_HPP
+#define APP_SCENE_HPP
+
+#include <stdint.h>
+
+namespace APP_SCENE
+{
+    constexpr uint8_t NUM_SCENES = 16;
+    constexpr uint8_t MAX_CUES = 32;
+
+    struct Scene
+    {
+        uint8_t red;
+        uint8_t green;
+        uint8_t blue;
+        uint8_t pattern;
+        uint8_t shutter;    // percent open 0-100
+        uint8_t brightness;
+        uint8_t valid;      // slot has been stored or defined
+        uint8_t reserved;
+    };
+
+    struct Cue
+    {
+        uint8_t  scene;
+        uint16_t fadeMs;    // crossfade into the scene
+        uint16_t holdMs;    // time spent on the scene after the fade
+    };
+
+    void init();    // loads scenes and the cue list from NVS
+    void process(); // runs queued commands, advances the cue list
+
+    // The commands may be called from any task, they are queued and run by
+    // process() in order. false means bad arguments or a full queue.
+    bool store(uint8_t slot);                   // captures what the lamp shows now
+    bool define(uint8_t slot, const Scene& scene);
+    bool recall(uint8_t slot, uint16_t fadeMs);
+    bool setCues(const Cue* cues, uint8_t count, bool loop);
+    bool play();
+    void stop();
+    bool isPlaying();
+
+    const Scene* get(uint8_t slot);             // loop only, nullptr for empty/invalid slots
+
+    // Cue list position for APP_RECORD checkpoints, due is the APP_RECORD::now() of the next cue
+    void getPlayback(bool& playing, uint8_t& cue, uint32_t& due);
+}
+
+#endif // APP_SCENE_HPP
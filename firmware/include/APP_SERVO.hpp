@@ -2,17 +2,29 @@
  * File:        APP_SERVO.hpp
  * Author:      Marcus Lechner
  * Created:     2025-03-22
- * Description: Interface for servo motor control using potentiometer input
+ * Description: Interface for servo motor control using potentiometer feedback
  * License:     Custom MIT License (Non-Commercial + Beerware)
  */
 
 #ifndef APP_SERVO_HPP
 #define APP_SERVO_HPP
 
+#include <stdint.h>
+
 namespace APP_SERVO //public namespace named APP_SERVO, allows unambiguous calls of begin and update, can have multiple function of init() accross multiple header files
 { //alternative to a name space would be APP_SERVO_init(), instead we call the namespace function APP_SERVO::init()
     //adds structure to the state machine
-    void setPosition(int position); //position in percent open 0-100
+    constexpr uint8_t NUM_AXES = 1; //actuators on this fixture variant, must match AXES[] in APP_SERVO.cpp
+
+    // The moves may be called from any task, they start on the next servo tick in process()
+    void setPosition(int position, uint16_t fadeMs = 0); //shutter (axis 0) position in percent open 0-100, optionally faded over fadeMs
+    void setAxisPosition(uint8_t axis, int position, uint16_t fadeMs = 0);
+    void moveAll(const int (&positions)[NUM_AXES], uint16_t fadeMs = 0); //coordinated move, every axis arrives together
+    int getPosition(uint8_t axis = 0); //desired position in percent open 0-100
+    int getActualPosition(uint8_t axis = 0); //where the axis is now: the pot when calibrated, else the ramping command
+    bool isMoving(); //true while any servo is driving towards its desired position
+    bool hasFeedback(uint8_t axis = 0); //pot is calibrated, moves are closed loop
+    void calibrate(); //sweep every axis with a pot to both endpoints and record the readings, runs from process()
     void init();
     void process();
 }
@@ -0,0 +1,51 @@
+/*
+ * File:        APP_SETTINGS.hpp
+ * Author:      Marcus Lechner
+ * Created:     2025-06-21
+ * Description: Persistent settings store in NVS with CRC, versioning and debounced writes
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#ifndef APP_SETTINGS_HPP
+#define APP_SETTINGS_HPP
+
+#include <stdint.h>
+
+namespace APP_SETTINGS
+{
+    constexpr uint8_t LAYOUT_VERSION = 1;
+
+    // Stored verbatim, so only ever append fields by taking them out of reserved[]
+    // and bump LAYOUT_VERSION when the meaning of existing bytes changes
+    struct Settings
+    {
+        uint8_t  version;
+        uint8_t  red;
+        uint8_t  green;
+        uint8_t  blue;
+        uint8_t  pattern;
+        uint8_t  shutter;       // percent open 0-100
+        uint16_t powerBudget;   // supply budget in mA, 0 = APP_LED default
+        uint8_t  reserved[8];
+        uint32_t sequence;      // incremented on every commit, newest valid record wins
+        uint32_t crc;           // CRC-32 over all bytes above
+    };
+
+    static_assert(sizeof(Settings) == 24, "Settings layout must stay fixed");
+
+    void init();    // loads the newest valid record and applies it to LED and servo
+    void process(); // commits pending changes once the debounce window has passed
+
+    void setSolidColor(uint8_t r, uint8_t g, uint8_t b);
+    void setPattern(uint8_t pattern);
+    void setShutter(uint8_t percent);
+    void setPowerBudget(uint16_t milliamps);
+
+    // The setters may be called from the BLE task, everything is guarded
+    Settings get();          // a copy, the BLE task may change it meanwhile
+    uint32_t changeCount();  // setter calls that changed a value
+    uint32_t commitCount();  // actual flash writes
+    void report();           // both counts on the console
+}
+
+#endif // APP_SETTINGS_HPP
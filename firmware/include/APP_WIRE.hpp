@@ -0,0 +1,112 @@
+/*
+ * File:        APP_WIRE.hpp
+ * Author:      Marcus Lechner
+ * Created:     2025-09-14
+ * Description: Lookup-table encoder from packed pixel bytes to one-wire RMT pulse symbols
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#ifndef APP_WIRE_HPP
+#define APP_WIRE_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// WS2812 and SK6812 strips take every bit as one high pulse and one low pulse,
+// long-short for a 1 and short-long for a 0. The RMT peripheral plays back a
+// list of such symbols, 32 bits each:
+//
+//   bits  0-14  high time in ticks    bit 15  level 1
+//   bits 16-30  low time in ticks     bit 31  level 0
+//
+// so a transmit byte becomes 8 symbols. The encoder keeps the 4 symbols of
+// every nibble in a 256 byte table built once from the strip's timing, and
+// expands a byte with two table copies instead of testing 8 bits. The symbol
+// buffer belongs to the encoder and is reused for every frame, nothing is
+// allocated. One encoder per strip, each with its own timing and buffer, so
+// several strips can be encoded independently.
+//
+// encodeReference() is the plain bit-by-bit version the table must match
+// exactly. It is what the RMT translator callback did before.
+namespace APP_WIRE
+{
+    constexpr uint8_t RMT_CLK_DIV = 2;      // 80 MHz APB clock / 2, one tick is 25 ns
+    constexpr uint8_t SYMBOLS_PER_BYTE = 8;
+
+    struct BitTiming
+    {
+        uint16_t t0h, t0l, t1h, t1l; // in ticks
+    };
+
+    constexpr BitTiming WS2812_TIMING = { 16, 34, 32, 18 }; // 400/850 ns and 800/450 ns
+    constexpr BitTiming SK6812_TIMING = { 12, 36, 24, 24 }; // 300/900 ns and 600/600 ns
+
+    inline uint32_t symbol(uint16_t high, uint16_t low)
+    {
+        return (high & 0x7FFFU) | 0x8000U | (static_cast<uint32_t>(low & 0x7FFFU) << 16);
+    }
+
+    // Returns the number of symbols written to out (length x 8)
+    inline size_t encodeReference(const BitTiming& t, const uint8_t* bytes, size_t length, uint32_t* out)
+    {
+        const uint32_t bit0 = symbol(t.t0h, t.t0l);
+        const uint32_t bit1 = symbol(t.t1h, t.t1l);
+        size_t n = 0;
+
+        for (size_t i = 0; i < length; ++i)
+        {
+            for (uint8_t mask = 0x80; mask; mask >>= 1)
+            {
+                out[n++] = (bytes[i] & mask) ? bit1 : bit0;
+            }
+        }
+        return n;
+    }
+
+    template <size_t MAX_BYTES>
+    class Encoder
+    {
+    public:
+        explicit Encoder(const BitTiming& timing)
+        {
+            const uint32_t bit0 = symbol(timing.t0h, timing.t0l);
+            const uint32_t bit1 = symbol(timing.t1h, timing.t1l);
+
+            for (uint8_t nibble = 0; nibble < 16; ++nibble)
+            {
+                for (uint8_t bit = 0; bit < 4; ++bit)
+                {
+                    _nibble[nibble][bit] = (nibble & (0x08 >> bit)) ? bit1 : bit0;
+                }
+            }
+        }
+
+        // Encodes up to MAX_BYTES into the symbol buffer, returns the symbol count
+        size_t encode(const uint8_t* bytes, size_t length)
+        {
+            if (length > MAX_BYTES)
+            {
+                length = MAX_BYTES;
+            }
+
+            uint32_t* out = _symbols;
+            for (size_t i = 0; i < length; ++i)
+            {
+                memcpy(out, _nibble[bytes[i] >> 4], sizeof(_nibble[0]));
+                memcpy(out + 4, _nibble[bytes[i] & 0x0F], sizeof(_nibble[0]));
+                out += SYMBOLS_PER_BYTE;
+            }
+            return length * SYMBOLS_PER_BYTE;
+        }
+
+        const uint32_t* symbols() const { return _symbols; }
+        static size_t capacity() { return MAX_BYTES; }
+
+    private:
+        uint32_t _nibble[16][4];
+        uint32_t _symbols[MAX_BYTES * SYMBOLS_PER_BYTE];
+    };
+}
+
+#endif // APP_WIRE_HPP
@@ -0,0 +1,177 @@
+/*
+ * File:        APP_AUDIO.cpp
+ * Author:      Marcus Lechner
+ * Created:     2025-08-02
+ * Description: Streaming audio analysis for the audio-reactive patterns
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#include "APP_AUDIO.hpp"
+#include "APP_AUDIO_ANALYSIS.hpp"
+#include "APP_TIMER.hpp"
+#include "APP_MEMORY.hpp"
+#include <Arduino.h>
+#include <driver/i2s.h>
+
+namespace
+{
+    using namespace APP_AUDIO_ANALYSIS;
+
+    // INMP441 style I2S MEMS microphone, L/R pin tied low
+    constexpr int I2S_BCK_PIN = 26;
+    constexpr int I2S_WS_PIN = 25;
+    constexpr int I2S_SD_PIN = 33;
+    constexpr i2s_port_t I2S_PORT = I2S_NUM_0;
+
+    constexpr unsigned long REPORT_MS = 10000;
+
+    constexpr uint32_t TASK_STACK = 4096;
+    constexpr UBaseType_t TASK_PRIORITY = 2;
+    constexpr BaseType_t TASK_CORE = 0;        // loop() and rendering stay on core 1
+
+    Analyser gAnalyser;
+    int32_t rawBlock[HOP_SIZE];
+
+    // Bands and task side statistics, the task writes both under the lock
+    // and process() reads and clears the statistics under it
+    portMUX_TYPE gLock = portMUX_INITIALIZER_UNLOCKED;
+    APP_AUDIO::Bands gShared = {};
+    uint32_t gHops = 0;
+    uint32_t gBusyMicros = 0;
+    uint32_t gMaxBusyMicros = 0;
+    uint32_t gMaxAgeMicros = 0;   // loop side, oldest snapshot handed to a pattern
+
+    TaskHandle_t audioTask = nullptr;
+    bool gEnabled = true;
+    Timer report_timer(REPORT_MS, true);
+
+    void audioTaskLoop(void*)
+    {
+        for (;;)
+        {
+            size_t bytesRead = 0;
+            i2s_read(I2S_PORT, rawBlock, sizeof(rawBlock), &bytesRead, portMAX_DELAY);
+            const uint32_t captured = micros();
+
+            const APP_AUDIO::Bands& result = gAnalyser.hop(rawBlock, bytesRead / sizeof(rawBlock[0]), captured);
+
+            portENTER_CRITICAL(&gLock);
+            gShared = result;
+            portEXIT_CRITICAL(&gLock);
+
+            const uint32_t busy = micros() - captured;
+
+            portENTER_CRITICAL(&gLock);
+            gBusyMicros += busy;
+            if (busy > gMaxBusyMicros)
+            {
+                gMaxBusyMicros = busy;
+            }
+            gHops++;
+            portEXIT_CRITICAL(&gLock);
+        }
+    }
+}
+
+void APP_AUDIO::init()
+{
+    APP_MEMORY::Scope memory(APP_MEMORY::MODULE_AUDIO);
+    gAnalyser.begin();
+
+    i2s_config_t config = {};
+    config.mode = static_cast<i2s_mode_t>(I2S_MODE_MASTER | I2S_MODE_RX);
+    config.sample_rate = SAMPLE_RATE;
+    config.bits_per_sample = I2S_BITS_PER_SAMPLE_32BIT;
+    config.channel_format = I2S_CHANNEL_FMT_ONLY_LEFT;
+    config.communication_format = I2S_COMM_FORMAT_STAND_I2S;
+    config.intr_alloc_flags = ESP_INTR_FLAG_LEVEL1;
+    config.dma_buf_count = 4;
+    config.dma_buf_len = HOP_SIZE;  // one DMA buffer per hop keeps capture latency at 8 ms
+
+    i2s_pin_config_t pins = {};
+    pins.mck_io_num = I2S_PIN_NO_CHANGE;
+    pins.bck_io_num = I2S_BCK_PIN;
+    pins.ws_io_num = I2S_WS_PIN;
+    pins.data_out_num = I2S_PIN_NO_CHANGE;
+    pins.data_in_num = I2S_SD_PIN;
+
+    if (i2s_driver_install(I2S_PORT, &config, 0, nullptr) != ESP_OK ||
+        i2s_set_pin(I2S_PORT, &pins) != ESP_OK)
+    {
+        Serial.println("[AUDIO] I2S init failed, audio patterns will stay silent");
+        return;
+    }
+
+    xTaskCreatePinnedToCore(audioTaskLoop, "audio", TASK_STACK, nullptr, TASK_PRIORITY, &audioTask, TASK_CORE);
+    APP_MEMORY::watchTask(audioTask, "audio");
+}
+
+void APP_AUDIO::process()
+{
+    if (!audioTask || !report_timer.expired())
+    {
+        return;
+    }
+
+    // Copied and cleared in one go, the task must not add a hop in between
+    portENTER_CRITICAL(&gLock);
+    const uint32_t hops = gHops;
+    const uint32_t busyMicros = gBusyMicros;
+    const uint32_t maxBusyMicros = gMaxBusyMicros;
+    gHops = 0;
+    gBusyMicros = 0;
+    gMaxBusyMicros = 0;
+    portEXIT_CRITICAL(&gLock);
+
+    if (hops)
+    {
+        Serial.printf("[AUDIO] %lu FFTs, avg %lu us, max %lu us, oldest frame input %lu us\n",
+                      static_cast<unsigned long>(hops),
+                      static_cast<unsigned long>(busyMicros / hops),
+                      static_cast<unsigned long>(maxBusyMicros),
+                      static_cast<unsigned long>(gMaxAgeMicros));
+    }
+
+    gMaxAgeMicros = 0;
+}
+
+void APP_AUDIO::setEnabled(bool enabled)
+{
+    if (!audioTask || enabled == gEnabled)
+    {
+        return;
+    }
+    gEnabled = enabled;
+
+    if (enabled)
+    {
+        i2s_start(I2S_PORT);
+        vTaskResume(audioTask);
+    }
+    else
+    {
+        // Suspended first, it is then parked in i2s_read() or between two hops
+        vTaskSuspend(audioTask);
+        i2s_stop(I2S_PORT);
+    }
+}
+
+APP_AUDIO::Bands APP_AUDIO::get()
+{
+    Bands copy;
+
+    portENTER_CRITICAL(&gLock);
+    copy = gShared;
+    portEXIT_CRITICAL(&gLock);
+
+    if (copy.captureMicros)
+    {
+        const uint32_t age = micros() - copy.captureMicros;
+        if (age > gMaxAgeMicros)
+        {
+            gMaxAgeMicros = age;
+        }
+    }
+
+    return copy;
+}
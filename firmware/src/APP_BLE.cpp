@@ -5,19 +5,33 @@
 
 #include "APP_BLE.hpp"
 #include <Arduino.h>
+#include <string.h>
 #include <BLEDevice.h>
 #include <BLEServer.h>
 #include <BLEUtils.h>
 #include <BLE2902.h>
+#include <BLESecurity.h>
 
 #include "APP_SERVO.hpp"
 #include "APP_LED.hpp"
+#include "APP_PATTERN.hpp"
+#include "APP_SETTINGS.hpp"
+#include "APP_SCENE.hpp"
+#include "APP_CALIBRATION.hpp"
+#include "APP_RECORD.hpp"
+#include "APP_LATENCY.hpp"
+#include "APP_GOLDEN.hpp"
+#include "APP_OTA.hpp"
+#include "APP_IDLE.hpp"
+#include "APP_MEMORY.hpp"
+#include "APP_FRAMESTREAM.hpp"
 
 namespace APP_BLE
 {
     namespace  //TODO: come back and comment code to lock in ble knowledge and understanding
     {
         constexpr char DEVICE_NAME[]  = "HackableLamp";
+        constexpr size_t RX_TEXT_SIZE = 64; // longest RX text command kept
 
         // Keep your existing service UUID (Nordic UART style)
         constexpr char SERVICE_UUID[] = "6E400001-B5A3-F393-E0A9-E50E24DCCA9E";
@@ -30,6 +44,21 @@ namespace APP_BLE
         constexpr char SHUTTER_CHAR_UUID[] = "f6c2b240-1b0a-46d5-9c5a-9b4a22d7e301"; // 1 byte 0-100
         constexpr char ANIM_CHAR_UUID[]    = "f6c2b240-1b0a-46d5-9c5a-9b4a22d7e303"; // 1 byte animId
         constexpr char RGB_CHAR_UUID[]     = "f6c2b240-1b0a-46d5-9c5a-9b4a22d7e302"; // 3 bytes R,G,B
+        constexpr char PATTERN_CHAR_UUID[] = "f6c2b240-1b0a-46d5-9c5a-9b4a22d7e304"; // slot + bytecode program
+        constexpr char SCENE_CHAR_UUID[]   = "f6c2b240-1b0a-46d5-9c5a-9b4a22d7e305"; // scene/cue command, see SceneCommand
+        constexpr char OTA_CHAR_UUID[]     = "f6c2b240-1b0a-46d5-9c5a-9b4a22d7e306"; // firmware update, see APP_OTA.hpp
+        constexpr char CALIB_CHAR_UUID[]   = "f6c2b240-1b0a-46d5-9c5a-9b4a22d7e307"; // fixture calibration, see APP_CALIBRATION.hpp
+        constexpr char FRAME_CHAR_UUID[]   = "f6c2b240-1b0a-46d5-9c5a-9b4a22d7e308"; // pixel frame stream, see APP_FRAMESTREAM.hpp
+
+        constexpr uint16_t LOCAL_MTU = 517; // offered to the central, frame fragments fill whatever it agrees to
+
+        // Writing firmware needs an encrypted link with a bonded central that
+        // paired with this passkey, anyone in range could otherwise flash the
+        // lamp. The lamp has no display, so the passkey is fixed: set your own
+        // six digits before flashing. The app asks for it once, then the bond
+        // (kept in NVS by the stack) is enough. The other characteristics stay
+        // open, so the app works without pairing.
+        constexpr uint32_t OTA_PASSKEY = 246810;
 
 
 
@@ -39,94 +68,373 @@ namespace APP_BLE
         BLECharacteristic* shutterChar = nullptr;
         BLECharacteristic* rgbChar     = nullptr;
         BLECharacteristic* animChar    = nullptr;
+        BLECharacteristic* patternChar = nullptr;
+        BLECharacteristic* sceneChar   = nullptr;
+        BLECharacteristic* otaChar     = nullptr;
+        BLECharacteristic* calibChar   = nullptr;
+        BLECharacteristic* frameChar   = nullptr;
+
+        // First byte of a scene characteristic write, 16-bit values are little endian
+        enum SceneCommand : uint8_t
+        {
+            SCENE_STORE  = 0x01, // slot                      capture the current look
+            SCENE_RECALL = 0x02, // slot, fadeMs16            crossfade to a scene
+            SCENE_DEFINE = 0x03, // slot, r, g, b, pattern, shutter, brightness
+            SCENE_CUES   = 0x04, // loop, n, n x (scene, fadeMs16, holdMs16)
+            SCENE_PLAY   = 0x05,
+            SCENE_STOP   = 0x06
+        };
 
-       
-        class My_Characteristic_Callbacks : public BLECharacteristicCallbacks
+        // Sliders write as fast as the app can drag them. A line per write would
+        // cost more than applying it and skew APP_LATENCY, so they are logged at
+        // most every SLIDER_LOG_MS with a count of the writes in between.
+        constexpr uint32_t SLIDER_LOG_MS = 500;
+
+        portMUX_TYPE gSliderLogLock = portMUX_INITIALIZER_UNLOCKED;
+        uint32_t gSliderLoggedMs = 0;
+        uint32_t gSliderUnlogged = 0;
+
+        // True when this slider write gets a log line, skipped is set to the writes not logged since the last one
+        bool sliderLogDue(uint32_t& skipped)
         {
-            void onWrite(BLECharacteristic* pChar) override
+            const uint32_t now = millis();
+            bool due = false;
+
+            portENTER_CRITICAL(&gSliderLogLock);
+            if (now - gSliderLoggedMs >= SLIDER_LOG_MS)
+            {
+                skipped = gSliderUnlogged;
+                gSliderUnlogged = 0;
+                gSliderLoggedMs = now;
+                due = true;
+            }
+            else
+            {
+                gSliderUnlogged++;
+            }
+            portEXIT_CRITICAL(&gSliderLogLock);
+
+            return due;
+        }
+
+        uint16_t readU16(const uint8_t* value, size_t offset)
+        {
+            return value[offset] | (value[offset + 1] << 8);
+        }
+
+        void handleSceneCommand(const uint8_t* value, size_t size)
+        {
+            const uint8_t command = value[0];
+            bool ok = false;
+
+            switch (command)
+            {
+                case SCENE_STORE:
+                    ok = size >= 2 && APP_SCENE::store(value[1]);
+                    break;
+
+                case SCENE_RECALL:
+                    if (size >= 4)
+                    {
+                        APP_SCENE::stop(); // manual recall takes over from a running show
+                        ok = APP_SCENE::recall(value[1], readU16(value, 2));
+                    }
+                    break;
+
+                case SCENE_DEFINE:
+                    if (size >= 8)
+                    {
+                        APP_SCENE::Scene scene = {};
+                        scene.red        = value[2];
+                        scene.green      = value[3];
+                        scene.blue       = value[4];
+                        scene.pattern    = value[5];
+                        scene.shutter    = value[6] > 100 ? 100 : value[6];
+                        scene.brightness = value[7];
+                        ok = APP_SCENE::define(value[1], scene);
+                    }
+                    break;
+
+                case SCENE_CUES:
+                    if (size >= 3)
+                    {
+                        const bool loop = value[1] != 0;
+                        const uint8_t count = value[2];
+                        constexpr size_t CUE_BYTES = 5;
+
+                        if (count <= APP_SCENE::MAX_CUES && size >= 3 + count * CUE_BYTES)
+                        {
+                            APP_SCENE::Cue cues[APP_SCENE::MAX_CUES];
+                            for (uint8_t i = 0; i < count; ++i)
+                            {
+                                const size_t at = 3 + i * CUE_BYTES;
+                                cues[i].scene  = value[at];
+                                cues[i].fadeMs = readU16(value, at + 1);
+                                cues[i].holdMs = readU16(value, at + 3);
+                            }
+                            ok = APP_SCENE::setCues(cues, count, loop);
+                        }
+                    }
+                    break;
+
+                case SCENE_PLAY:
+                    ok = APP_SCENE::play();
+                    break;
+
+                case SCENE_STOP:
+                    APP_SCENE::stop();
+                    ok = true;
+                    break;
+
+                default:
+                    break;
+            }
+
+            Serial.printf("[BLE] Scene command 0x%02X %s\n", command, ok ? "queued" : "failed");
+        }
+
+        bool channelOf(const BLECharacteristic* pChar, APP_RECORD::Channel& channel)
+        {
+            if (pChar == rxChar)           channel = APP_RECORD::CHANNEL_RX;
+            else if (pChar == shutterChar) channel = APP_RECORD::CHANNEL_SHUTTER;
+            else if (pChar == rgbChar)     channel = APP_RECORD::CHANNEL_RGB;
+            else if (pChar == animChar)    channel = APP_RECORD::CHANNEL_ANIM;
+            else if (pChar == patternChar) channel = APP_RECORD::CHANNEL_PATTERN;
+            else if (pChar == sceneChar)   channel = APP_RECORD::CHANNEL_SCENE;
+            else if (pChar == calibChar)   channel = APP_RECORD::CHANNEL_CALIBRATION;
+            else return false;
+            return true;
+        }
+
+        // Tells the central on TX whether a write took, after the echo of the write itself
+        void notifyStatus(const char* status)
+        {
+            if (txChar)
             {
-                std::string value = pChar->getValue();
+                txChar->setValue(reinterpret_cast<uint8_t*>(const_cast<char*>(status)), strlen(status));
+                txChar->notify();
+            }
+        }
+
+        // Everything a write does, shared by live writes and replayed ones
+        void dispatch(uint8_t channel, const uint8_t* value, size_t size)
+        {
+            // ----------- Typed Characteristics -----------
+
+            if (channel == APP_RECORD::CHANNEL_SHUTTER)
+            {
+                // Expect 1 byte: percent 0-100
+                uint8_t percent = value[0];
+                if (percent > 100) percent = 100;
 
-                if (value.empty())
+                uint32_t skipped;
+                if (sliderLogDue(skipped))
                 {
-                    Serial.println("[BLE] Empty value received");
-                    return;
+                    Serial.printf("[BLE] Shutter percent: %u (+%lu unlogged)\n", percent, static_cast<unsigned long>(skipped));
                 }
 
-                // Echo any write to TX notify (optional, nice for debugging)
-                if (txChar)
+                APP_SCENE::stop(); // live control takes over from a running show
+                APP_SERVO::setPosition(percent);
+                APP_SETTINGS::setShutter(percent);
+
+                // TODO: APP_SERVO / shutters
+                // APP_SHUTTER::setPercent(percent);
+                return;
+            }
+
+            if (channel == APP_RECORD::CHANNEL_ANIM)
+            {
+                // Expect 1 byte anim ID
+                uint8_t animId = value[0];
+
+                Serial.printf("[BLE] Animation ID: %u\n", animId);
+
+                // TODO: switch FastLED pattern
+                APP_SCENE::stop();
+                APP_LED::setAnimation(animId);
+                APP_SETTINGS::setPattern(animId);
+                return;
+            }
+
+            if (channel == APP_RECORD::CHANNEL_RGB)
+            {
+                // Expect 3 bytes: R,G,B
+                if (size < 3)
                 {
-                    txChar->setValue(value);
-                    txChar->notify();
+                    Serial.println("[BLE] RGB write too short");
+                    return;
                 }
 
-                // ----------- Typed Characteristics -----------
+                uint8_t r = value[0];
+                uint8_t g = value[1];
+                uint8_t b = value[2];
 
-                if (pChar == shutterChar)
+                uint32_t skipped;
+                if (sliderLogDue(skipped))
                 {
-                    // Expect 1 byte: percent 0-100
-                    uint8_t percent = static_cast<uint8_t>(value[0]);
-                    if (percent > 100) percent = 100;
+                    Serial.printf("[BLE] RGB: %u, %u, %u (+%lu unlogged)\n", r, g, b, static_cast<unsigned long>(skipped));
+                }
 
-                    Serial.printf("[BLE] Shutter percent: %u\n", percent);
+                // TODO: FastLED set color
+                APP_SCENE::stop();
+                APP_LED::setSolidColor(r, g, b);
+                APP_SETTINGS::setSolidColor(r, g, b);
+                return;
+            }
 
-                    APP_SERVO::setPosition(percent);
+            if (channel == APP_RECORD::CHANNEL_SCENE)
+            {
+                handleSceneCommand(value, size);
+                return;
+            }
 
-                    // TODO: APP_SERVO / shutters
-                    // APP_SHUTTER::setPercent(percent);
-                    return;
+            if (channel == APP_RECORD::CHANNEL_CALIBRATION)
+            {
+                if (!APP_CALIBRATION::set(value, size))
+                {
+                    Serial.printf("[BLE] Calibration rejected (%u bytes)\n", static_cast<unsigned>(size));
                 }
+                return;
+            }
 
-                if (pChar == animChar)
-                {
-                    // Expect 1 byte anim ID
-                    uint8_t animId = static_cast<uint8_t>(value[0]);
+            if (channel == APP_RECORD::CHANNEL_PATTERN)
+            {
+                // Expect slot byte followed by an APP_PATTERN program,
+                // a lone slot byte clears that slot
+                uint8_t slot = value[0];
+                bool ok;
 
-                    Serial.printf("[BLE] Animation ID: %u\n", animId);
+                if (size == 1)
+                {
+                    ok = APP_PATTERN::clear(slot);
+                    Serial.printf("[BLE] Pattern slot %u %s\n", slot, ok ? "cleared" : "rejected, no such slot");
+                }
+                else
+                {
+                    const uint8_t* program = value + 1;
+                    ok = APP_PATTERN::load(slot, program, size - 1);
 
-                    // TODO: switch FastLED pattern
-                    APP_LED::setAnimation(animId);
-                    return;
+                    Serial.printf("[BLE] Pattern slot %u: %s (%u bytes)\n",
+                                  slot, ok ? "loaded" : "rejected", static_cast<unsigned>(size - 1));
                 }
 
-                if (pChar == rgbChar)
+                notifyStatus(ok ? "PATTERN OK" : "PATTERN ERR");
+                return;
+            }
+
+            // ----------- Optional UART-style RX parsing -----------
+
+            if (channel == APP_RECORD::CHANNEL_RX)
+            {
+                // Text commands, copied out so they can be compared as a C string
+                char text[RX_TEXT_SIZE];
+                const size_t textLength = size < sizeof(text) - 1 ? size : sizeof(text) - 1;
+                memcpy(text, value, textLength);
+                text[textLength] = '\0';
+
+                Serial.printf("[BLE] RX: %s\n", text);
+
+                if (strncmp(text, "SERVO:", 6) == 0)
                 {
-                    // Expect 3 bytes: R,G,B
-                    if (value.size() < 3)
+                    const char* arg = text + 6;
+                    Serial.printf("[BLE] Servo set to: %s\n", arg);
+                    // APP_SERVO::setAngle(atoi(arg));
+                }
+                else if (strncmp(text, "LED:", 4) == 0)
+                {
+                    const char* arg = text + 4;
+                    Serial.printf("[BLE] LED pattern set to: %s\n", arg);
+                    // APP_LED::setPattern(arg);
+                }
+                else if (strncmp(text, "POWER:", 6) == 0)
+                {
+                    // supply budget in mA for the strip and servo, 0 restores the default
+                    const unsigned long milliamps = strtoul(text + 6, nullptr, 10);
+                    if (milliamps <= 0xFFFF)
                     {
-                        Serial.println("[BLE] RGB write too short");
-                        return;
+                        APP_LED::setPowerBudget(static_cast<uint16_t>(milliamps));
+                        APP_SETTINGS::setPowerBudget(static_cast<uint16_t>(milliamps));
+                        Serial.printf("[BLE] Power budget %u mA\n", APP_LED::getPowerBudget());
                     }
+                }
+                else if (strcmp(text, "CALIBRATE") == 0)
+                {
+                    APP_SERVO::calibrate(); // sweeps the shutter, also retries an axis stored without feedback
+                }
+                else if (strcmp(text, "REPLAY") == 0)
+                {
+                    APP_RECORD::requestReplay();
+                }
+                else if (strcmp(text, "DUMP") == 0)
+                {
+                    APP_RECORD::requestDump();
+                }
+                else if (strcmp(text, "GOLDEN") == 0)
+                {
+                    APP_GOLDEN::requestCheck();
+                }
+                else if (strcmp(text, "GOLDEN:PRINT") == 0)
+                {
+                    APP_GOLDEN::requestPrint();
+                }
+            }
+        }
 
-                    uint8_t r = static_cast<uint8_t>(value[0]);
-                    uint8_t g = static_cast<uint8_t>(value[1]);
-                    uint8_t b = static_cast<uint8_t>(value[2]);
+        class My_Characteristic_Callbacks : public BLECharacteristicCallbacks
+        {
+            void onWrite(BLECharacteristic* pChar) override
+            {
+                // Straight from the characteristic's buffer, no copy per write
+                const uint8_t* data = pChar->getData();
+                const size_t length = pChar->getLength();
+                APP_RECORD::Channel channel;
 
-                    Serial.printf("[BLE] RGB: %u, %u, %u\n", r, g, b);
+                if (length == 0)
+                {
+                    Serial.println("[BLE] Empty value received");
+                    return;
+                }
 
-                    // TODO: FastLED set color
-                    APP_LED::setSolidColor(r, g, b);
+                if (!channelOf(pChar, channel))
+                {
                     return;
                 }
 
-                // ----------- Optional UART-style RX parsing -----------
+                receive(TRANSPORT_GATT, channel, data, length);
+            }
+        };
+
+        // Firmware chunks bypass receive(): they are not lamp input, recording
+        // them would only flush the replay log
+        class Ota_Callbacks : public BLECharacteristicCallbacks
+        {
+            void onWrite(BLECharacteristic* pChar) override
+            {
+                uint8_t reply[APP_OTA::REPLY_SIZE];
+                APP_IDLE::activity();
+                const size_t length = APP_OTA::handle(pChar->getData(), pChar->getLength(), reply);
 
-                if (pChar == rxChar)
+                if (length > 0)
                 {
-                    Serial.printf("[BLE] RX: %s\n", value.c_str());
+                    pChar->setValue(reply, length);
+                    pChar->notify();
+                }
+            }
+        };
 
-                    if (value.rfind("SERVO:", 0) == 0)
-                    {
-                        const char* arg = value.c_str() + 6;
-                        Serial.printf("[BLE] Servo set to: %s\n", arg);
-                        // APP_SERVO::setAngle(atoi(arg));
-                    }
-                    else if (value.rfind("LED:", 0) == 0)
-                    {
-                        const char* arg = value.c_str() + 4;
-                        Serial.printf("[BLE] LED pattern set to: %s\n", arg);
-                        // APP_LED::setPattern(arg);
-                    }
+        // Frames bypass receive() for the same reason, and there are far more of them
+        class Frame_Callbacks : public BLECharacteristicCallbacks
+        {
+            void onWrite(BLECharacteristic* pChar) override
+            {
+                uint8_t reply[APP_FRAMESTREAM::REPLY_SIZE];
+                APP_IDLE::activity();
+                const size_t length = APP_FRAMESTREAM::handle(pChar->getData(), pChar->getLength(), reply);
+
+                if (length > 0)
+                {
+                    pChar->setValue(reply, length);
+                    pChar->notify();
                 }
             }
         };
@@ -149,10 +457,29 @@ namespace APP_BLE
 
     void init()
     {
+        APP_MEMORY::Scope memory(APP_MEMORY::MODULE_BLE);
         BLEDevice::init(DEVICE_NAME);
+        BLEDevice::setMTU(LOCAL_MTU);
+
+        // Callbacks and descriptors live as long as the server, so they are
+        // statics instead of heap objects. Constructed here, after the BLE
+        // stack is up, since a descriptor sets up stack resources.
+        static My_Characteristic_Callbacks charCallbacks;
+        static Ota_Callbacks otaCallbacks;
+        static Frame_Callbacks frameCallbacks;
+        static My_ServerCallbacks serverCallbacks;
+        static BLE2902 txNotifyDescriptor;
+        static BLE2902 otaNotifyDescriptor;
+        static BLE2902 frameNotifyDescriptor;
 
         BLEServer* server = BLEDevice::createServer();
-        server->setCallbacks(new My_ServerCallbacks());
+        server->setCallbacks(&serverCallbacks);
+
+        // Static passkey pairing with MITM protection and bonding, asked for
+        // by the stack when the central first writes to the OTA characteristic
+        static BLESecurity security;
+        security.setStaticPIN(OTA_PASSKEY);
+        security.setAuthenticationMode(ESP_LE_AUTH_REQ_SC_MITM_BOND);
 
         BLEService* service = server->createService(SERVICE_UUID);
 
@@ -161,13 +488,13 @@ namespace APP_BLE
             RX_CHAR_UUID,
             BLECharacteristic::PROPERTY_WRITE | BLECharacteristic::PROPERTY_WRITE_NR
         );
-        rxChar->setCallbacks(new My_Characteristic_Callbacks());
+        rxChar->setCallbacks(&charCallbacks);
 
         txChar = service->createCharacteristic(
             TX_CHAR_UUID,
             BLECharacteristic::PROPERTY_NOTIFY
         );
-        txChar->addDescriptor(new BLE2902());
+        txChar->addDescriptor(&txNotifyDescriptor);
 
         // ---------- Typed control characteristics ----------
 
@@ -175,19 +502,52 @@ namespace APP_BLE
             SHUTTER_CHAR_UUID,
             BLECharacteristic::PROPERTY_WRITE_NR
         );
-        shutterChar->setCallbacks(new My_Characteristic_Callbacks());
+        shutterChar->setCallbacks(&charCallbacks);
 
         rgbChar = service->createCharacteristic(
             RGB_CHAR_UUID,
             BLECharacteristic::PROPERTY_WRITE_NR
         );
-        rgbChar->setCallbacks(new My_Characteristic_Callbacks());
+        rgbChar->setCallbacks(&charCallbacks);
 
         animChar = service->createCharacteristic(
             ANIM_CHAR_UUID,
             BLECharacteristic::PROPERTY_WRITE // with response
         );
-        animChar->setCallbacks(new My_Characteristic_Callbacks());
+        animChar->setCallbacks(&charCallbacks);
+
+        patternChar = service->createCharacteristic(
+            PATTERN_CHAR_UUID,
+            BLECharacteristic::PROPERTY_WRITE // with response, programs can exceed one MTU (long write)
+        );
+        patternChar->setCallbacks(&charCallbacks);
+
+        sceneChar = service->createCharacteristic(
+            SCENE_CHAR_UUID,
+            BLECharacteristic::PROPERTY_WRITE // with response, cue lists need a long write
+        );
+        sceneChar->setCallbacks(&charCallbacks);
+
+        calibChar = service->createCharacteristic(
+            CALIB_CHAR_UUID,
+            BLECharacteristic::PROPERTY_WRITE // with response, the app should know it was taken
+        );
+        calibChar->setCallbacks(&charCallbacks);
+
+        otaChar = service->createCharacteristic(
+            OTA_CHAR_UUID,
+            BLECharacteristic::PROPERTY_WRITE | BLECharacteristic::PROPERTY_WRITE_NR | BLECharacteristic::PROPERTY_NOTIFY
+        );
+        otaChar->setAccessPermissions(ESP_GATT_PERM_WRITE_ENC_MITM); // the stack rejects writes until bonded
+        otaChar->addDescriptor(&otaNotifyDescriptor);
+        otaChar->setCallbacks(&otaCallbacks);
+
+        frameChar = service->createCharacteristic(
+            FRAME_CHAR_UUID,
+            BLECharacteristic::PROPERTY_WRITE_NR | BLECharacteristic::PROPERTY_NOTIFY // notifies only ask for a keyframe
+        );
+        frameChar->addDescriptor(&frameNotifyDescriptor);
+        frameChar->setCallbacks(&frameCallbacks);
 
         service->start();
 
@@ -205,4 +565,54 @@ namespace APP_BLE
     {
         // Optional: handle connection state or streaming here
     }
+
+    bool receive(Transport transport, uint8_t channel, const uint8_t* data, size_t length)
+    {
+        APP_MEMORY::Scope memory(APP_MEMORY::MODULE_BLE);
+        const uint32_t arrived = micros();
+
+        if (length == 0)
+        {
+            return false;
+        }
+
+        // Logged for replay, and dropped while a replay is running so it stays deterministic.
+        // A storm is a benchmark, not lamp input, and is kept out of the log like frames.
+        if (transport == TRANSPORT_LOAD)
+        {
+            if (APP_RECORD::isReplaying())
+            {
+                return false;
+            }
+        }
+        else if (!APP_RECORD::bleWrite(static_cast<APP_RECORD::Channel>(channel), data, length))
+        {
+            return false;
+        }
+
+        APP_IDLE::activity(); // back to full speed before the write changes anything
+
+        // Echo any write to TX notify (optional, nice for debugging)
+        if (txChar)
+        {
+            txChar->setValue(const_cast<uint8_t*>(data), length);
+            txChar->notify();
+        }
+
+        dispatch(channel, data, length);
+
+        // Counted only once applied, so the next frame to start is one that can show it
+        APP_LATENCY::commandApplied(transport, arrived);
+        return true;
+    }
+
+    void handleWrite(uint8_t channel, const uint8_t* data, size_t length)
+    {
+        APP_MEMORY::Scope memory(APP_MEMORY::MODULE_BLE);
+        if (length == 0)
+        {
+            return;
+        }
+        dispatch(channel, data, length);
+    }
 }
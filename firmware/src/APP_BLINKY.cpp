@@ -16,6 +16,7 @@ namespace
     const int BLINK_INTERVAL = 500; // in milliseconds
     unsigned long previousMillis = 0;
     bool ledState = false;
+    bool enabled = true;
     Timer blink_timer(500,true);
 }
 
@@ -27,10 +28,20 @@ void APP_BLINKY::init()
 
 void APP_BLINKY::process()
 {
-    if (blink_timer.expired())
+    if (enabled && blink_timer.expired())
     {
         ledState = !ledState;
         digitalWrite(LED_PIN, ledState ? HIGH : LOW);
         // Serial.printf("LED is now %s\n", ledState ? "ON" : "OFF");
     }
-}
\ No newline at end of file
+}
+
+void APP_BLINKY::setEnabled(bool enable)
+{
+    enabled = enable;
+    if (!enabled)
+    {
+        ledState = false;
+        digitalWrite(LED_PIN, LOW);
+    }
+}
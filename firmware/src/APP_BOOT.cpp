@@ -0,0 +1,87 @@
+/*
+ * File:        APP_BOOT.cpp
+ * Author:      Marcus Lechner
+ * Created:     2025-06-28
+ * Description: Boot trace recording and report
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#include "APP_BOOT.hpp"
+#include <Arduino.h>
+#include <esp_timer.h>
+
+namespace
+{
+    const char* const STAGE_NAMES[APP_BOOT::NUM_STAGES] =
+    {
+        "serial",
+        "settings",
+        "first frame",
+        "loop start",
+        "servo",
+        "wi-fi",
+        "ble"
+    };
+
+    volatile uint32_t gStageMicros[APP_BOOT::NUM_STAGES] = {};
+    volatile bool gStageDone[APP_BOOT::NUM_STAGES] = {};
+    bool gReported = false;
+}
+
+void APP_BOOT::mark(Stage stage)
+{
+    gStageMicros[stage] = static_cast<uint32_t>(esp_timer_get_time());
+    gStageDone[stage] = true;
+}
+
+bool APP_BOOT::isDone(Stage stage)
+{
+    return gStageDone[stage];
+}
+
+bool APP_BOOT::isComplete()
+{
+    for (uint8_t i = 0; i < NUM_STAGES; ++i)
+    {
+        if (!gStageDone[i])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void APP_BOOT::process()
+{
+    if (gReported || !isComplete())
+    {
+        return;
+    }
+
+    gReported = true;
+
+    // stages finish out of order (BLE runs on its own task), so print them
+    // in time order with the gap to the previous finished stage
+    bool printed[NUM_STAGES] = {};
+    uint32_t previous = 0;
+
+    Serial.println("[BOOT] stage          done at    took");
+    for (uint8_t n = 0; n < NUM_STAGES; ++n)
+    {
+        uint8_t next = 0;
+        bool found = false;
+        for (uint8_t i = 0; i < NUM_STAGES; ++i)
+        {
+            if (!printed[i] && (!found || gStageMicros[i] < gStageMicros[next]))
+            {
+                next = i;
+                found = true;
+            }
+        }
+
+        printed[next] = true;
+        const uint32_t at = gStageMicros[next];
+        Serial.printf("[BOOT] %-12s %8.1f ms %7.1f ms\n", STAGE_NAMES[next], at / 1000.0f, (at - previous) / 1000.0f);
+        previous = at;
+    }
+}
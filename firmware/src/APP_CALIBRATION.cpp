@@ -0,0 +1,247 @@
+/*
+ * File:        APP_CALIBRATION.cpp
+ * Author:      Marcus Lechner
+ * Created:     2025-09-06
+ * Description: Per-fixture colour calibration baked into output lookup tables
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#include "APP_CALIBRATION.hpp"
+#include "APP_CRC.hpp"
+#include "APP_RECORD.hpp"
+#include <Arduino.h>
+#include <Preferences.h>
+#include <math.h>
+#include <string.h>
+
+namespace
+{
+    constexpr char NVS_NAMESPACE[] = "lamp";
+    constexpr char CALIBRATION_KEY[] = "calib";
+    constexpr uint8_t LAYOUT_VERSION = 1;
+
+    // TypicalLEDStrip, what setCorrection() applied before calibration existed
+    constexpr uint8_t DEFAULT_WHITE[3] = { 0xFF, 0xB0, 0xF0 };
+
+    struct Calibration
+    {
+        uint8_t version;
+        uint8_t white[3];
+        uint8_t gamma[3];
+        uint8_t gain[APP_CALIBRATION::NUM_SEGMENTS];
+        uint32_t crc;
+    };
+
+    Preferences prefs;
+
+    Calibration gCalibration;
+
+    // A write builds a fresh set of tables while the render loop keeps reading
+    // the set it took at the start of its frame, then the new set is published
+    // by swapping one pointer. With three sets there is always one that is
+    // neither published nor still being read, so a write never waits for the
+    // loop. Writes come one at a time, like the rest of dispatch().
+    constexpr uint8_t NUM_SETS = 3;
+
+    struct TableSet
+    {
+        APP_CALIBRATION::Table tables[APP_CALIBRATION::NUM_SEGMENTS];
+        const APP_CALIBRATION::Table* pixel[APP_LED::NUM_LEDS];
+    };
+
+    TableSet gSets[NUM_SETS];
+    portMUX_TYPE gSetLock = portMUX_INITIALIZER_UNLOCKED;
+    const APP_CALIBRATION::Table* const* gPixelTables = gSets[0].pixel; // published
+    const APP_CALIBRATION::Table* const* gReading = gSets[0].pixel;     // taken by the render loop last
+
+    uint32_t calibrationCrc(const Calibration& c)
+    {
+        return APP_CRC::crc32(reinterpret_cast<const uint8_t*>(&c), offsetof(Calibration, crc));
+    }
+
+    void setDefaults(Calibration& c)
+    {
+        memset(&c, 0, sizeof(c));
+        c.version = LAYOUT_VERSION;
+        for (uint8_t ch = 0; ch < 3; ++ch)
+        {
+            c.white[ch] = DEFAULT_WHITE[ch];
+            c.gamma[ch] = APP_CALIBRATION::GAMMA_LINEAR;
+        }
+        memset(c.gain, 255, sizeof(c.gain));
+        c.crc = calibrationCrc(c);
+    }
+
+    bool isValid(const Calibration& c)
+    {
+        if (c.version != LAYOUT_VERSION || c.crc != calibrationCrc(c))
+        {
+            return false;
+        }
+
+        for (uint8_t ch = 0; ch < 3; ++ch)
+        {
+            if (c.gamma[ch] < APP_CALIBRATION::GAMMA_MIN || c.gamma[ch] > APP_CALIBRATION::GAMMA_MAX)
+            {
+                return false;
+            }
+        }
+        return c.white[0] || c.white[1] || c.white[2];
+    }
+
+    // Gamma curve scaled to the white point, 0 stays 0 so black stays black
+    void buildCurve(uint8_t* curve, uint8_t gamma, uint8_t white)
+    {
+        const float exponent = gamma / 10.0f;
+
+        for (uint16_t v = 0; v < 256; ++v)
+        {
+            const float shaped = powf(v / 255.0f, exponent) * white;
+            curve[v] = static_cast<uint8_t>(shaped + 0.5f);
+        }
+    }
+
+    TableSet& spareSet()
+    {
+        uint8_t s = 0;
+
+        portENTER_CRITICAL(&gSetLock);
+        while (gSets[s].pixel == gPixelTables || gSets[s].pixel == gReading)
+        {
+            ++s;
+        }
+        portEXIT_CRITICAL(&gSetLock);
+
+        return gSets[s];
+    }
+
+    // Builds the tables into a spare set and publishes it
+    void buildTables()
+    {
+        TableSet& set = spareSet();
+        uint8_t white[3];
+        uint8_t strongest = gCalibration.white[0];
+        if (gCalibration.white[1] > strongest) strongest = gCalibration.white[1];
+        if (gCalibration.white[2] > strongest) strongest = gCalibration.white[2];
+
+        for (uint8_t ch = 0; ch < 3; ++ch)
+        {
+            white[ch] = static_cast<uint8_t>((gCalibration.white[ch] * 255U + strongest / 2) / strongest);
+        }
+
+        APP_CALIBRATION::Table& base = set.tables[0];
+        buildCurve(base.r, gCalibration.gamma[0], white[0]);
+        buildCurve(base.g, gCalibration.gamma[1], white[1]);
+        buildCurve(base.b, gCalibration.gamma[2], white[2]);
+
+        // Every segment is the shared curve times its gain, built from the top
+        // so segment 0 is scaled last and still holds the base curve until then
+        for (int8_t s = APP_CALIBRATION::NUM_SEGMENTS - 1; s >= 0; --s)
+        {
+            APP_CALIBRATION::Table& t = set.tables[s];
+            const uint16_t gain = gCalibration.gain[s] + 1;
+
+            for (uint16_t v = 0; v < 256; ++v)
+            {
+                t.r[v] = static_cast<uint8_t>((base.r[v] * gain) >> 8);
+                t.g[v] = static_cast<uint8_t>((base.g[v] * gain) >> 8);
+                t.b[v] = static_cast<uint8_t>((base.b[v] * gain) >> 8);
+            }
+        }
+
+        for (uint8_t i = 0; i < APP_LED::NUM_LEDS; ++i)
+        {
+            set.pixel[i] = &set.tables[i / APP_MAP::LEDS_PER_TURN];
+        }
+
+        portENTER_CRITICAL(&gSetLock);
+        gPixelTables = set.pixel;
+        portEXIT_CRITICAL(&gSetLock);
+    }
+
+    void printCalibration(const char* what)
+    {
+        Serial.printf("[CAL] %s: white %u/%u/%u, gamma %u.%u/%u.%u/%u.%u, gain", what,
+                      gCalibration.white[0], gCalibration.white[1], gCalibration.white[2],
+                      gCalibration.gamma[0] / 10, gCalibration.gamma[0] % 10,
+                      gCalibration.gamma[1] / 10, gCalibration.gamma[1] % 10,
+                      gCalibration.gamma[2] / 10, gCalibration.gamma[2] % 10);
+        for (uint8_t s = 0; s < APP_CALIBRATION::NUM_SEGMENTS; ++s)
+        {
+            Serial.printf(" %u", gCalibration.gain[s]);
+        }
+        Serial.println();
+    }
+}
+
+void APP_CALIBRATION::init()
+{
+    prefs.begin(NVS_NAMESPACE, false);
+
+    Calibration stored;
+    if (prefs.getBytesLength(CALIBRATION_KEY) == sizeof(stored) &&
+        prefs.getBytes(CALIBRATION_KEY, &stored, sizeof(stored)) == sizeof(stored) &&
+        isValid(stored))
+    {
+        gCalibration = stored;
+        printCalibration("Fixture calibration");
+    }
+    else
+    {
+        setDefaults(gCalibration);
+    }
+
+    buildTables();
+}
+
+bool APP_CALIBRATION::set(const uint8_t* data, size_t length)
+{
+    Calibration c;
+
+    if (length == 1 && data[0] == 0)
+    {
+        setDefaults(c);
+        if (!APP_RECORD::isReplaying())
+        {
+            prefs.remove(CALIBRATION_KEY);
+        }
+    }
+    else
+    {
+        if (length < WRITE_SIZE)
+        {
+            return false;
+        }
+
+        memset(&c, 0, sizeof(c));
+        c.version = LAYOUT_VERSION;
+        memcpy(c.white, data, 3);
+        memcpy(c.gamma, data + 3, 3);
+        memcpy(c.gain, data + 6, NUM_SEGMENTS);
+        c.crc = calibrationCrc(c);
+
+        if (!isValid(c))
+        {
+            return false;
+        }
+        if (!APP_RECORD::isReplaying()) // a replay must not change the fixture
+        {
+            prefs.putBytes(CALIBRATION_KEY, &c, sizeof(c));
+        }
+    }
+
+    gCalibration = c;
+    buildTables();
+    printCalibration("Calibration set");
+    return true;
+}
+
+const APP_CALIBRATION::Table* const* APP_CALIBRATION::pixelTables()
+{
+    portENTER_CRITICAL(&gSetLock);
+    const APP_CALIBRATION::Table* const* tables = gPixelTables;
+    gReading = tables;
+    portEXIT_CRITICAL(&gSetLock);
+
+    return tables;
+}
@@ -0,0 +1,380 @@
+/*
+ * File:        APP_CONSOLE.cpp
+ * Author:      Marcus Lechner
+ * Created:     2025-08-23
+ * Description: USB serial console that drives the BLE protocol and streams rendered frames
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#include "APP_CONSOLE.hpp"
+#include <Arduino.h>
+#include <string.h>
+#include "APP_BLE.hpp"
+#include "APP_IDLE.hpp"
+#include "APP_LATENCY.hpp"
+#include "APP_LED.hpp"
+#include "APP_MEMORY.hpp"
+#include "APP_PIXELNET.hpp"
+#include "APP_RECORD.hpp"
+#include "APP_SERVO.hpp"
+#include "APP_SETTINGS.hpp"
+
+namespace
+{
+    // Long enough for the largest write, a full scene cue list as hex
+    constexpr size_t LINE_SIZE = 360;
+    constexpr size_t MAX_WRITE = (LINE_SIZE - 12) / 2;
+
+    // "F <now> <brightness> <shutter> " ahead of the pixels
+    constexpr size_t FRAME_HEADER = 32;
+    constexpr size_t FRAME_LINE = FRAME_HEADER + 2 * 3 * APP_LED::NUM_LEDS + 1; // hex pixels and the newline
+
+    char gLine[LINE_SIZE];
+    size_t gLineLength = 0;
+    bool gLineTooLong = false;
+
+    uint16_t gStreamEvery = 0; // 0 = not streaming
+    uint16_t gStreamCountdown = 0;
+    uint32_t gStreamDropped = 0;
+
+    struct ChannelName
+    {
+        const char* name;
+        APP_RECORD::Channel channel;
+    };
+
+    const ChannelName CHANNELS[] =
+    {
+        { "rx",      APP_RECORD::CHANNEL_RX },
+        { "shutter", APP_RECORD::CHANNEL_SHUTTER },
+        { "rgb",     APP_RECORD::CHANNEL_RGB },
+        { "anim",    APP_RECORD::CHANNEL_ANIM },
+        { "pattern", APP_RECORD::CHANNEL_PATTERN },
+        { "scene",   APP_RECORD::CHANNEL_SCENE },
+        { "calibration", APP_RECORD::CHANNEL_CALIBRATION }
+    };
+
+    int hexDigit(char c)
+    {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    // Returns the number of bytes decoded, or -1 when the text is not whole hex bytes
+    int parseHex(const char* text, uint8_t* out, size_t capacity)
+    {
+        size_t count = 0;
+
+        while (*text)
+        {
+            const int high = hexDigit(text[0]);
+            const int low = high < 0 ? -1 : hexDigit(text[1]);
+
+            if (low < 0 || count >= capacity)
+            {
+                return -1;
+            }
+
+            out[count++] = static_cast<uint8_t>((high << 4) | low);
+            text += 2;
+        }
+
+        return static_cast<int>(count);
+    }
+
+    bool channelByName(const char* name, APP_RECORD::Channel& channel)
+    {
+        for (const ChannelName& c : CHANNELS)
+        {
+            if (strcmp(name, c.name) == 0)
+            {
+                channel = c.channel;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Same route as a BLE write: recorded first, ignored while a replay runs
+    void write(APP_RECORD::Channel channel, const uint8_t* data, size_t length)
+    {
+        if (length == 0)
+        {
+            Serial.println("ERR empty write");
+            return;
+        }
+
+        if (!APP_BLE::receive(APP_BLE::TRANSPORT_SERIAL, channel, data, length))
+        {
+            Serial.println("ERR replaying");
+            return;
+        }
+
+        Serial.println("OK");
+    }
+
+    void commandWrite(char* args)
+    {
+        char* hex = strchr(args, ' ');
+        APP_RECORD::Channel channel;
+        uint8_t data[MAX_WRITE];
+
+        if (hex == nullptr)
+        {
+            Serial.println("ERR usage: W <channel> <hex>");
+            return;
+        }
+        *hex++ = '\0';
+
+        if (!channelByName(args, channel))
+        {
+            Serial.println("ERR unknown channel");
+            return;
+        }
+
+        const int length = parseHex(hex, data, sizeof(data));
+        if (length < 0)
+        {
+            Serial.println("ERR bad hex");
+            return;
+        }
+
+        write(channel, data, static_cast<size_t>(length));
+    }
+
+    void commandStream(const char* args)
+    {
+        const long every = strtol(args, nullptr, 10);
+
+        if (every < 0 || every > 0xFFFF)
+        {
+            Serial.println("ERR usage: STREAM <n>");
+            return;
+        }
+
+        if (gStreamEvery && gStreamDropped)
+        {
+            Serial.printf("[CONSOLE] %lu frames dropped while streaming\n", static_cast<unsigned long>(gStreamDropped));
+        }
+
+        gStreamEvery = static_cast<uint16_t>(every);
+        gStreamCountdown = 0;
+        gStreamDropped = 0;
+        Serial.println("OK");
+    }
+
+    void commandLoad(char* args)
+    {
+        char* end = nullptr;
+        const long rate = strtol(args, &end, 10);
+        const long seconds = strtol(end, &end, 10);
+
+        while (*end == ' ')
+        {
+            ++end;
+        }
+
+        if (rate <= 0 || seconds <= 0 || (*end && strcmp(end, "rgb") != 0 && strcmp(end, "shutter") != 0))
+        {
+            Serial.println("ERR usage: LOAD <writes/s> <seconds> [rgb|shutter]");
+            return;
+        }
+
+        const APP_LATENCY::Slider slider = strcmp(end, "shutter") == 0 ? APP_LATENCY::SLIDER_SHUTTER : APP_LATENCY::SLIDER_RGB;
+        Serial.println(APP_LATENCY::startLoad(rate, seconds, slider) ? "OK" : "ERR storm running");
+    }
+
+    // WIFI <ssid> [password], the SSID can't contain spaces
+    void commandWifi(char* args)
+    {
+        if (strcmp(args, "OFF") == 0)
+        {
+            APP_PIXELNET::setCredentials(nullptr, nullptr);
+            Serial.println("OK");
+            return;
+        }
+
+        char* password = strchr(args, ' ');
+        if (password)
+        {
+            *password++ = '\0';
+        }
+
+        if (*args == '\0')
+        {
+            Serial.println("ERR usage: WIFI <ssid> [password] | WIFI OFF");
+            return;
+        }
+
+        APP_PIXELNET::setCredentials(args, password);
+        Serial.println("OK");
+    }
+
+    void commandNetLoad(char* args)
+    {
+        char* end = nullptr;
+        const long rate = strtol(args, &end, 10);
+        const long seconds = strtol(end, &end, 10);
+
+        if (rate <= 0 || seconds <= 0)
+        {
+            Serial.println("ERR usage: NET LOAD <frames/s> <seconds>");
+            return;
+        }
+
+        Serial.println(APP_PIXELNET::startLoad(rate, seconds) ? "OK" : "ERR load running or no network stack");
+    }
+
+    void runLine(char* line)
+    {
+        if (strncmp(line, "W ", 2) == 0)
+        {
+            commandWrite(line + 2);
+        }
+        else if (strncmp(line, "RX ", 3) == 0)
+        {
+            write(APP_RECORD::CHANNEL_RX, reinterpret_cast<const uint8_t*>(line + 3), strlen(line + 3));
+        }
+        else if (strncmp(line, "STREAM ", 7) == 0)
+        {
+            commandStream(line + 7);
+        }
+        else if (strncmp(line, "LOAD ", 5) == 0)
+        {
+            commandLoad(line + 5);
+        }
+        else if (strncmp(line, "WIFI ", 5) == 0)
+        {
+            commandWifi(line + 5);
+        }
+        else if (strncmp(line, "NET LOAD ", 9) == 0)
+        {
+            commandNetLoad(line + 9);
+        }
+        else if (strcmp(line, "NET") == 0)
+        {
+            APP_PIXELNET::report();
+            Serial.println("OK");
+        }
+        else if (strcmp(line, "SETTINGS") == 0)
+        {
+            APP_SETTINGS::report();
+            Serial.println("OK");
+        }
+        else if (strcmp(line, "MEM") == 0)
+        {
+            APP_MEMORY::report();
+            Serial.println("OK");
+        }
+        else if (strcmp(line, "LATENCY") == 0)
+        {
+            APP_LATENCY::report();
+            Serial.println("OK");
+        }
+        else if (strcmp(line, "LATENCY RESET") == 0)
+        {
+            APP_LATENCY::reset();
+            Serial.println("OK");
+        }
+        else
+        {
+            Serial.println("ERR unknown command");
+        }
+    }
+
+    void appendHex(char*& out, uint8_t value)
+    {
+        static const char DIGITS[] = "0123456789abcdef";
+        *out++ = DIGITS[value >> 4];
+        *out++ = DIGITS[value & 0x0F];
+    }
+}
+
+void APP_CONSOLE::process()
+{
+    while (Serial.available() > 0)
+    {
+        const char c = static_cast<char>(Serial.read());
+
+        if (c == '\r')
+        {
+            continue;
+        }
+
+        if (c != '\n')
+        {
+            if (gLineLength + 1 < LINE_SIZE)
+            {
+                gLine[gLineLength++] = c;
+            }
+            else
+            {
+                gLineTooLong = true;
+            }
+            continue;
+        }
+
+        gLine[gLineLength] = '\0';
+        APP_IDLE::activity();
+
+        if (gLineTooLong)
+        {
+            Serial.println("ERR line too long");
+        }
+        else if (gLineLength > 0)
+        {
+            runLine(gLine);
+        }
+
+        gLineLength = 0;
+        gLineTooLong = false;
+    }
+}
+
+bool APP_CONSOLE::isStreaming()
+{
+    return gStreamEvery != 0;
+}
+
+void APP_CONSOLE::frameRendered(const uint8_t* pixels, size_t length, uint8_t brightness)
+{
+    if (gStreamEvery == 0)
+    {
+        return;
+    }
+
+    if (gStreamCountdown > 0)
+    {
+        --gStreamCountdown;
+        return;
+    }
+    gStreamCountdown = gStreamEvery - 1;
+
+    static char line[FRAME_LINE];
+    if (FRAME_HEADER + 2 * length + 1 > sizeof(line))
+    {
+        return;
+    }
+
+    char* out = line + snprintf(line, FRAME_HEADER, "F %lu %u %d ",
+                                static_cast<unsigned long>(APP_RECORD::now()), brightness, APP_SERVO::getActualPosition());
+
+    for (size_t i = 0; i < length; ++i)
+    {
+        appendHex(out, pixels[i]);
+    }
+    *out++ = '\n';
+
+    const size_t size = static_cast<size_t>(out - line);
+
+    // Live the loop must not wait for the UART, a replay may
+    if (!APP_RECORD::isReplaying() && static_cast<size_t>(Serial.availableForWrite()) < size)
+    {
+        ++gStreamDropped;
+        return;
+    }
+
+    Serial.write(reinterpret_cast<const uint8_t*>(line), size);
+}
@@ -0,0 +1,406 @@
+/*
+ * File:        APP_FRAMESTREAM.cpp
+ * Author:      Marcus Lechner
+ * Created:     2025-09-27
+ * Description: Compressed per-pixel frame stream over BLE, keyframes plus RLE deltas
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#include "APP_FRAMESTREAM.hpp"
+#include "APP_FRAMESTREAM_CODEC.hpp"
+#include "APP_LED.hpp"
+#include "APP_TIMER.hpp"
+#include <Arduino.h>
+#include <string.h>
+
+#define FRAMESTREAM_BENCHMARK 0  // Set to 1 to measure compression and decoding at boot
+
+#if FRAMESTREAM_BENCHMARK
+#include <FastLED.h>
+#endif
+
+namespace
+{
+    using APP_LED::NUM_LEDS;
+
+    constexpr size_t FRAME_BYTES = NUM_LEDS * 3;
+    constexpr uint32_t KEYFRAME_ASK_MS = 500; // asked again if the app missed the notify
+
+    enum State : uint8_t
+    {
+        STATE_WAITING_FOR_KEY = 0,
+        STATE_DECODING
+    };
+
+    // Only written on the BLE task, reports work on differences
+    struct Stats
+    {
+        uint32_t writes;
+        uint32_t bytes;
+        uint32_t frames;
+        uint32_t keyframes;
+        uint32_t dropped;       // frames given up on, lost fragments or no base
+        uint32_t keyRequests;
+        uint32_t superseded;    // finished but replaced before the render loop got to them
+    };
+
+    // BLE task state
+    State gState = STATE_WAITING_FOR_KEY;
+    APP_FRAMESTREAM_CODEC::Decoder<NUM_LEDS> gDecoder; // ops can be split across fragments
+    uint8_t gSequence = 0;
+    uint8_t gFragment = 0;
+    uint8_t gWork[FRAME_BYTES];
+    uint8_t gBase[FRAME_BYTES];     // last finished frame, what deltas build on
+    uint8_t gBaseSequence = 0;
+    bool gHaveBase = false;
+    uint32_t gAskedAtMs = 0;
+    bool gAsked = false;
+    Stats gStats;
+
+    // Handed from the BLE task to the render loop
+    portMUX_TYPE gLock = portMUX_INITIALIZER_UNLOCKED;
+    uint8_t gReady[FRAME_BYTES];
+    bool gReadyPending = false;
+    uint32_t gLastFrameMs = 0;
+    volatile bool gActive = false;
+
+    // Loop state
+    bool gAnnounced = false;
+    Stats gReported;
+    uint32_t gReportedAtMs = 0;
+    Timer report_timer(APP_FRAMESTREAM::REPORT_MS, true);
+
+    size_t answer(uint8_t* reply, APP_FRAMESTREAM::Status status, uint8_t sequence)
+    {
+        reply[0] = status;
+        reply[1] = sequence;
+        return APP_FRAMESTREAM::REPLY_SIZE;
+    }
+
+    // Gives up on the frame and everything built on it
+    size_t askForKeyframe(uint8_t* reply, uint8_t sequence)
+    {
+        gState = STATE_WAITING_FOR_KEY;
+        gHaveBase = false;
+
+        if (gAsked && millis() - gAskedAtMs < KEYFRAME_ASK_MS)
+        {
+            return 0;
+        }
+
+        gAsked = true;
+        gAskedAtMs = millis();
+        gStats.keyRequests++;
+        return answer(reply, APP_FRAMESTREAM::STATUS_NEED_KEYFRAME, sequence);
+    }
+
+    void finishFrame(uint8_t sequence, bool key)
+    {
+        memcpy(gBase, gWork, FRAME_BYTES);
+        gBaseSequence = sequence;
+        gHaveBase = true;
+        gState = STATE_WAITING_FOR_KEY; // until the next fragment 0
+        gStats.frames++;
+        if (key)
+        {
+            gStats.keyframes++;
+        }
+
+        portENTER_CRITICAL(&gLock);
+        if (gReadyPending)
+        {
+            gStats.superseded++;
+        }
+        memcpy(gReady, gWork, FRAME_BYTES);
+        gReadyPending = true;
+        gLastFrameMs = millis();
+        portEXIT_CRITICAL(&gLock);
+
+        gActive = true;
+    }
+
+#if FRAMESTREAM_BENCHMARK
+    constexpr uint16_t BENCH_PIXELS = 300;
+    constexpr uint16_t BENCH_FRAMES = 600;
+    constexpr uint8_t BENCH_KEY_EVERY = 60;
+    constexpr uint16_t BENCH_MTU = 247;   // what most phones negotiate with data length extension
+    constexpr size_t BENCH_PAYLOAD = BENCH_MTU - 3 - APP_FRAMESTREAM::HEADER_SIZE; // ATT header, frame header
+
+    enum BenchEffect : uint8_t
+    {
+        BENCH_COMET = 0,
+        BENCH_SPARKLE,
+        BENCH_FADE,
+        BENCH_RAINBOW,
+        NUM_BENCH_EFFECTS
+    };
+
+    const char* const BENCH_NAMES[NUM_BENCH_EFFECTS] = { "comet", "sparkle", "fade", "rainbow" };
+
+    void benchFrame(BenchEffect effect, uint16_t f, uint8_t* rgb)
+    {
+        memset(rgb, 0, BENCH_PIXELS * 3);
+
+        for (uint16_t i = 0; i < BENCH_PIXELS; ++i)
+        {
+            CRGB c = CRGB::Black;
+
+            switch (effect)
+            {
+                case BENCH_COMET:
+                {
+                    const uint16_t head = (f * 2) % BENCH_PIXELS;
+                    const uint16_t behind = (head + BENCH_PIXELS - i) % BENCH_PIXELS;
+                    if (behind < 12)
+                    {
+                        c = CHSV(160, 255, 255 - behind * 20);
+                    }
+                    break;
+                }
+                case BENCH_SPARKLE:
+                    if (((i * 7919U + f * 104729U) % 97) < 3)
+                    {
+                        c = CRGB::White;
+                    }
+                    break;
+                case BENCH_FADE:
+                    c = CHSV(static_cast<uint8_t>(f), 255, 255);
+                    break;
+                case BENCH_RAINBOW:
+                default:
+                    hsv2rgb_rainbow(CHSV(static_cast<uint8_t>(f * 2 + i), 255, 255), c);
+                    break;
+            }
+
+            rgb[i * 3] = c.r;
+            rgb[i * 3 + 1] = c.g;
+            rgb[i * 3 + 2] = c.b;
+        }
+    }
+
+    // 300 pixel effects through encoder, fragmenting and the real decoder. The
+    // first NUM_LEDS pixels of every decoded frame must match what was encoded.
+    void benchmarkStream()
+    {
+        static uint8_t black[BENCH_PIXELS * 3];
+        static uint8_t previous[BENCH_PIXELS * 3];
+        static uint8_t current[BENCH_PIXELS * 3];
+        static uint8_t ops[BENCH_PIXELS * 4 + 8];
+        static uint8_t packet[APP_FRAMESTREAM::HEADER_SIZE + BENCH_PAYLOAD];
+        uint8_t reply[APP_FRAMESTREAM::REPLY_SIZE];
+
+        for (uint8_t e = 0; e < NUM_BENCH_EFFECTS; ++e)
+        {
+            uint32_t bytes = 0;
+            uint32_t writes = 0;
+            uint32_t decodeUs = 0;
+            uint16_t bad = 0;
+            gHaveBase = false;
+            memset(previous, 0, sizeof(previous));
+
+            for (uint16_t f = 0; f < BENCH_FRAMES; ++f)
+            {
+                const bool key = f % BENCH_KEY_EVERY == 0;
+                benchFrame(static_cast<BenchEffect>(e), f, current);
+                const size_t length = APP_FRAMESTREAM_CODEC::encodeFrame(key ? black : previous, current, BENCH_PIXELS, ops);
+
+                size_t sent = 0;
+                uint8_t fragment = 0;
+                do
+                {
+                    const size_t n = length - sent < BENCH_PAYLOAD ? length - sent : BENCH_PAYLOAD;
+                    packet[0] = (key ? APP_FRAMESTREAM::FLAG_KEY : 0) | (sent + n == length ? APP_FRAMESTREAM::FLAG_LAST : 0);
+                    packet[1] = static_cast<uint8_t>(f);
+                    packet[2] = fragment++;
+                    memcpy(packet + APP_FRAMESTREAM::HEADER_SIZE, ops + sent, n);
+
+                    const unsigned long start = micros();
+                    APP_FRAMESTREAM::handle(packet, APP_FRAMESTREAM::HEADER_SIZE + n, reply);
+                    decodeUs += micros() - start;
+
+                    sent += n;
+                    bytes += APP_FRAMESTREAM::HEADER_SIZE + n;
+                    writes++;
+                }
+                while (sent < length);
+
+                if (memcmp(gBase, current, FRAME_BYTES) != 0)
+                {
+                    bad++;
+                }
+                memcpy(previous, current, sizeof(previous));
+            }
+
+            const float perFrame = static_cast<float>(bytes) / BENCH_FRAMES;
+            Serial.printf("[FRAME] bench %-8s %u px  ratio %5.1fx  %6.1f B/frame  %.2f writes/frame  %5.1f fps per 10 kB/s  decode %lu us/frame  %u/%u frames differ\n",
+                          BENCH_NAMES[e], BENCH_PIXELS,
+                          (BENCH_PIXELS * 3.0f) / perFrame, perFrame,
+                          static_cast<float>(writes) / BENCH_FRAMES,
+                          10000.0f / perFrame,
+                          static_cast<unsigned long>(decodeUs / BENCH_FRAMES),
+                          bad, BENCH_FRAMES);
+        }
+
+        // Leave nothing behind for a real stream
+        memset(&gStats, 0, sizeof(gStats));
+        gState = STATE_WAITING_FOR_KEY;
+        gHaveBase = false;
+        gReadyPending = false;
+        gActive = false;
+    }
+#endif
+}
+
+void APP_FRAMESTREAM::init()
+{
+#if FRAMESTREAM_BENCHMARK
+    benchmarkStream();
+#endif
+    gReportedAtMs = millis();
+}
+
+void APP_FRAMESTREAM::process()
+{
+    if (!gActive)
+    {
+        return;
+    }
+
+    if (!gAnnounced)
+    {
+        gAnnounced = true;
+        Serial.println("[FRAME] Stream started");
+    }
+
+    uint32_t lastFrameMs;
+    portENTER_CRITICAL(&gLock);
+    lastFrameMs = gLastFrameMs;
+    portEXIT_CRITICAL(&gLock);
+
+    if (millis() - lastFrameMs > TIMEOUT_MS)
+    {
+        gActive = false;
+        gAnnounced = false;
+        Serial.println("[FRAME] Stream stopped, back to the patterns");
+        report();
+    }
+    else if (report_timer.expired())
+    {
+        report();
+    }
+}
+
+size_t APP_FRAMESTREAM::handle(const uint8_t* data, size_t length, uint8_t* reply)
+{
+    gStats.writes++;
+    gStats.bytes += length;
+
+    if (length < HEADER_SIZE)
+    {
+        return answer(reply, STATUS_BAD_FRAME, 0);
+    }
+
+    const uint8_t flags = data[0];
+    const uint8_t sequence = data[1];
+    const uint8_t fragment = data[2];
+
+    if (fragment == 0)
+    {
+        if (gState == STATE_DECODING)
+        {
+            gStats.dropped++; // the last one never got its FLAG_LAST
+        }
+
+        if (flags & FLAG_KEY)
+        {
+            memset(gWork, 0, FRAME_BYTES);
+            gAsked = false;
+        }
+        else if (gHaveBase && sequence == static_cast<uint8_t>(gBaseSequence + 1))
+        {
+            memcpy(gWork, gBase, FRAME_BYTES);
+        }
+        else
+        {
+            gStats.dropped++;
+            return askForKeyframe(reply, sequence);
+        }
+
+        gDecoder.reset();
+        gState = STATE_DECODING;
+        gSequence = sequence;
+        gFragment = 0;
+    }
+    else if (gState != STATE_DECODING)
+    {
+        return 0; // rest of a frame already given up on
+    }
+    else if (sequence != gSequence || fragment != static_cast<uint8_t>(gFragment + 1))
+    {
+        gStats.dropped++;
+        return askForKeyframe(reply, sequence);
+    }
+    else
+    {
+        gFragment = fragment;
+    }
+
+    gDecoder.decode(data + HEADER_SIZE, length - HEADER_SIZE, gWork);
+
+    if (flags & FLAG_LAST)
+    {
+        if (!gDecoder.isBetweenOps())
+        {
+            gStats.dropped++;
+            gState = STATE_WAITING_FOR_KEY;
+            gHaveBase = false;
+            return answer(reply, STATUS_BAD_FRAME, sequence);
+        }
+        finishFrame(sequence, flags & FLAG_KEY);
+    }
+    return 0;
+}
+
+bool APP_FRAMESTREAM::isActive()
+{
+    return gActive;
+}
+
+void APP_FRAMESTREAM::render(uint8_t* rgb)
+{
+    portENTER_CRITICAL(&gLock);
+    if (gReadyPending)
+    {
+        memcpy(rgb, gReady, FRAME_BYTES);
+        gReadyPending = false;
+    }
+    portEXIT_CRITICAL(&gLock);
+}
+
+void APP_FRAMESTREAM::report()
+{
+    const Stats now = gStats;
+    const uint32_t elapsedMs = millis() - gReportedAtMs;
+    const uint32_t frames = now.frames - gReported.frames;
+    const uint32_t bytes = now.bytes - gReported.bytes;
+
+    Serial.printf("[FRAME] %lu frames (%.1f/s, %lu never shown), %lu keyframes, %lu dropped, %lu keyframe requests\n",
+                  static_cast<unsigned long>(frames),
+                  elapsedMs ? frames * 1000.0f / elapsedMs : 0.0f,
+                  static_cast<unsigned long>(now.superseded - gReported.superseded),
+                  static_cast<unsigned long>(now.keyframes - gReported.keyframes),
+                  static_cast<unsigned long>(now.dropped - gReported.dropped),
+                  static_cast<unsigned long>(now.keyRequests - gReported.keyRequests));
+
+    if (frames && bytes)
+    {
+        Serial.printf("[FRAME] %lu writes, %.1f bytes/frame, %.1fx smaller than %u raw pixels\n",
+                      static_cast<unsigned long>(now.writes - gReported.writes),
+                      static_cast<float>(bytes) / frames,
+                      static_cast<float>(frames) * FRAME_BYTES / bytes,
+                      NUM_LEDS);
+    }
+
+    gReported = now;
+    gReportedAtMs = millis();
+}
@@ -0,0 +1,134 @@
+/*
+ * File:        APP_GOLDEN.cpp
+ * Author:      Marcus Lechner
+ * Created:     2025-08-23
+ * Description: Golden checksum comparison against the source table and PPM dump of differing patterns
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#include "APP_GOLDEN.hpp"
+#include "APP_LED.hpp"
+#include "APP_CRC.hpp"
+#include <Arduino.h>
+
+namespace
+{
+    volatile bool gCheckRequested = false;
+    volatile bool gPrintRequested = false;
+
+    // Strip over time: one row per frame, plain text P3 so it survives the serial monitor
+    void dumpPpm(uint8_t animId)
+    {
+        Serial.printf("[GOLDEN] ---- begin pattern%02u.ppm ----\n", animId);
+        Serial.printf("P3\n%u %u\n255\n", APP_LED::NUM_LEDS, APP_GOLDEN::FRAMES);
+
+        APP_LED::beginReference(animId, APP_GOLDEN::SEED);
+        for (uint16_t f = 0; f < APP_GOLDEN::FRAMES; ++f)
+        {
+            const uint8_t* pixels = APP_LED::renderReference(f);
+            for (uint8_t i = 0; i < APP_LED::NUM_LEDS; ++i)
+            {
+                Serial.printf("%u %u %u ", pixels[i * 3], pixels[i * 3 + 1], pixels[i * 3 + 2]);
+            }
+            Serial.println();
+        }
+        APP_LED::endReference();
+
+        Serial.println("[GOLDEN] ---- end ----");
+    }
+
+    void check()
+    {
+        if (APP_GOLDEN::TABLE_SIZE != APP_LED::patternCount())
+        {
+            Serial.printf("[GOLDEN] Table has %u entries for %u patterns, regenerate APP_GOLDEN_TABLE.cpp\n",
+                          APP_GOLDEN::TABLE_SIZE, APP_LED::patternCount());
+        }
+
+        uint8_t passed = 0;
+        uint8_t failed = 0;
+        uint8_t skipped = 0;
+
+        for (uint8_t p = 0; p < APP_LED::patternCount(); ++p)
+        {
+            if (p >= APP_GOLDEN::TABLE_SIZE || APP_GOLDEN::TABLE[p] == APP_GOLDEN::NOT_RECORDED
+                || !APP_LED::isDeterministic(p))
+            {
+                skipped++; // new since the table, or follows live input
+                continue;
+            }
+
+            const uint32_t crc = APP_GOLDEN::checksum(p);
+            if (crc == APP_GOLDEN::TABLE[p])
+            {
+                passed++;
+                continue;
+            }
+
+            failed++;
+            Serial.printf("[GOLDEN] Pattern %u differs: %08lX, reference %08lX\n",
+                          p, static_cast<unsigned long>(crc), static_cast<unsigned long>(APP_GOLDEN::TABLE[p]));
+            dumpPpm(p);
+        }
+
+        Serial.printf("[GOLDEN] %u passed, %u failed, %u skipped\n", passed, failed, skipped);
+    }
+}
+
+uint32_t APP_GOLDEN::checksum(uint8_t animId)
+{
+    uint32_t crc = 0;
+
+    APP_LED::beginReference(animId, SEED);
+    for (uint16_t f = 0; f < FRAMES; ++f)
+    {
+        crc = APP_CRC::crc32(APP_LED::renderReference(f), APP_LED::NUM_LEDS * 3, crc);
+    }
+    APP_LED::endReference();
+
+    return crc;
+}
+
+void APP_GOLDEN::printTable()
+{
+    Serial.println("const uint32_t APP_GOLDEN::TABLE[] =");
+    Serial.println("{");
+    for (uint8_t p = 0; p < APP_LED::patternCount(); ++p)
+    {
+        const char* separator = (p + 1 < APP_LED::patternCount()) ? "," : " ";
+        if (APP_LED::isDeterministic(p))
+        {
+            Serial.printf("    0x%08lX%s // %2u\n", static_cast<unsigned long>(checksum(p)), separator, p);
+        }
+        else
+        {
+            Serial.printf("    NOT_RECORDED%s // %2u\n", separator, p);
+        }
+    }
+    Serial.println("};");
+}
+
+void APP_GOLDEN::process()
+{
+    if (gPrintRequested)
+    {
+        gPrintRequested = false;
+        printTable();
+    }
+
+    if (gCheckRequested)
+    {
+        gCheckRequested = false;
+        check();
+    }
+}
+
+void APP_GOLDEN::requestCheck()
+{
+    gCheckRequested = true;
+}
+
+void APP_GOLDEN::requestPrint()
+{
+    gPrintRequested = true;
+}
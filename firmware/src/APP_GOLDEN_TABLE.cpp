@@ -0,0 +1,39 @@
+/*
+ * File:        APP_GOLDEN_TABLE.cpp
+ * Author:      Marcus Lechner
+ * Created:     2025-10-18
+ * Description: Reference checksums of the built-in patterns, see APP_GOLDEN.hpp
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#include "APP_GOLDEN.hpp"
+
+// One entry per APP_LED pattern, in the order of gPatterns[] there. Regenerate
+// with "pio test -e native" (the failing test prints this block and writes a
+// PPM per pattern) or "GOLDEN:PRINT" on a lamp, never by hand. Pattern 13
+// follows the microphone and stays NOT_RECORDED.
+//
+// Pattern 0 is a plain fill and does not depend on the FastLED math. The rest
+// have to be recorded against the FastLED version in platformio.ini, the
+// native test fails until they are.
+const uint32_t APP_GOLDEN::TABLE[] =
+{
+    0x3AECACC1,   //  0
+    NOT_RECORDED, //  1
+    NOT_RECORDED, //  2
+    NOT_RECORDED, //  3
+    NOT_RECORDED, //  4
+    NOT_RECORDED, //  5
+    NOT_RECORDED, //  6
+    NOT_RECORDED, //  7
+    NOT_RECORDED, //  8
+    NOT_RECORDED, //  9
+    NOT_RECORDED, // 10
+    NOT_RECORDED, // 11
+    NOT_RECORDED, // 12
+    NOT_RECORDED, // 13
+    NOT_RECORDED, // 14
+    NOT_RECORDED  // 15
+};
+
+const uint8_t APP_GOLDEN::TABLE_SIZE = static_cast<uint8_t>(sizeof(TABLE) / sizeof(TABLE[0]));
@@ -0,0 +1,203 @@
+/*
+ * File:        APP_IDLE.cpp
+ * Author:      Marcus Lechner
+ * Created:     2025-08-30
+ * Description: Idle manager that slows the lamp down while its output is static
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#include "APP_IDLE.hpp"
+#include "APP_TIMER.hpp"
+#include "APP_LED.hpp"
+#include "APP_SERVO.hpp"
+#include "APP_SCENE.hpp"
+#include "APP_RECORD.hpp"
+#include "APP_CONSOLE.hpp"
+#include "APP_OTA.hpp"
+#include "APP_BLINKY.hpp"
+#include "APP_AUDIO.hpp"
+#include "APP_PIXELNET.hpp"
+#include "APP_FRAMESTREAM.hpp"
+#include <Arduino.h>
+
+namespace
+{
+    TaskHandle_t gLoopTask = nullptr;
+
+    volatile bool gIdle = false;
+    volatile uint32_t gLastActivityMs = 0;
+    volatile uint32_t gWakeMicros = 0;
+    volatile bool gWakePending = false; // woken, first frame not shown yet
+
+    uint32_t gStaticSinceMs = 0;
+    bool gStatic = false;
+
+    // Report window
+    Timer report_timer(APP_IDLE::REPORT_MS, true);
+    uint32_t gStateSinceMs = 0;
+    uint32_t gIdleMs = 0;
+    uint32_t gActiveMs = 0;
+    uint32_t gIdlePasses = 0;
+    uint32_t gActivePasses = 0;
+    uint32_t gWakes = 0;
+    uint32_t gWakeSumUs = 0;
+    uint32_t gWakeMaxUs = 0;
+
+    // Everything that needs the loop at full speed or fresh frames
+    bool outputStatic()
+    {
+        return APP_LED::isStatic()
+            && !APP_SERVO::isMoving()
+            && !APP_SCENE::isPlaying()
+            && !APP_RECORD::isReplaying()
+            && !APP_CONSOLE::isStreaming()
+            && !APP_OTA::isUpdating()
+            && !APP_PIXELNET::isActive()
+            && !APP_FRAMESTREAM::isActive();
+    }
+
+    void accountState(uint32_t now)
+    {
+        (gIdle ? gIdleMs : gActiveMs) += now - gStateSinceMs;
+        gStateSinceMs = now;
+    }
+
+    void enterIdle(uint32_t now)
+    {
+        accountState(now);
+        gIdle = true;
+        APP_BLINKY::setEnabled(false);
+        APP_AUDIO::setEnabled(false); // no audio pattern runs while the output is static
+        setCpuFrequencyMhz(APP_IDLE::IDLE_CPU_MHZ);
+    }
+
+    void leaveIdle(uint32_t now)
+    {
+        setCpuFrequencyMhz(APP_IDLE::ACTIVE_CPU_MHZ);
+        accountState(now);
+        gIdle = false;
+        gStatic = false;
+        APP_BLINKY::setEnabled(true);
+        APP_AUDIO::setEnabled(true);
+    }
+
+    void printMs(const char* label, uint32_t us)
+    {
+        Serial.printf(" %s %lu.%02lu ms", label, static_cast<unsigned long>(us / 1000), static_cast<unsigned long>((us % 1000) / 10));
+    }
+
+    void report(uint32_t now)
+    {
+        accountState(now);
+        const uint32_t total = gIdleMs + gActiveMs;
+
+        if (gIdleMs > 0 && total > 0)
+        {
+            Serial.printf("[IDLE] %lu s: idle %lu%%, loop %lu/s idle, %lu/s active, %lu wakes",
+                          static_cast<unsigned long>(total / 1000),
+                          static_cast<unsigned long>((static_cast<uint64_t>(gIdleMs) * 100) / total),
+                          static_cast<unsigned long>(gIdleMs ? (static_cast<uint64_t>(gIdlePasses) * 1000) / gIdleMs : 0),
+                          static_cast<unsigned long>(gActiveMs ? (static_cast<uint64_t>(gActivePasses) * 1000) / gActiveMs : 0),
+                          static_cast<unsigned long>(gWakes));
+            if (gWakes > 0)
+            {
+                Serial.print(", wake to frame");
+                printMs("avg", gWakeSumUs / gWakes);
+                printMs("max", gWakeMaxUs);
+            }
+            Serial.println();
+        }
+
+        gIdleMs = gActiveMs = 0;
+        gIdlePasses = gActivePasses = 0;
+        gWakes = gWakeSumUs = gWakeMaxUs = 0;
+    }
+}
+
+void APP_IDLE::init()
+{
+    gLoopTask = xTaskGetCurrentTaskHandle(); // setup() and loop() share the Arduino task
+    gLastActivityMs = millis();
+    gStateSinceMs = gLastActivityMs;
+}
+
+void APP_IDLE::process()
+{
+    uint32_t now = millis();
+
+    if (report_timer.expired())
+    {
+        report(now);
+    }
+
+    if (gIdle)
+    {
+        gIdlePasses++;
+
+        // Sleeps until the poll interval is over or activity() gives the notification
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(IDLE_POLL_MS));
+        now = millis();
+
+        if (now - gLastActivityMs < IDLE_AFTER_MS || !outputStatic())
+        {
+            leaveIdle(now);
+        }
+        return;
+    }
+
+    gActivePasses++;
+
+    if (!outputStatic())
+    {
+        gStatic = false;
+        return;
+    }
+
+    if (!gStatic)
+    {
+        gStatic = true;
+        gStaticSinceMs = now;
+    }
+
+    if (now - gStaticSinceMs >= IDLE_AFTER_MS && now - gLastActivityMs >= IDLE_AFTER_MS)
+    {
+        enterIdle(now);
+    }
+}
+
+void APP_IDLE::activity()
+{
+    gLastActivityMs = millis();
+
+    if (gIdle && !gWakePending)
+    {
+        gWakeMicros = micros();
+        gWakePending = true;
+        if (gLoopTask)
+        {
+            xTaskNotifyGive(gLoopTask);
+        }
+    }
+}
+
+void APP_IDLE::frameShown()
+{
+    if (!gWakePending)
+    {
+        return;
+    }
+    gWakePending = false;
+
+    const uint32_t us = micros() - gWakeMicros;
+    gWakes++;
+    gWakeSumUs += us;
+    if (us > gWakeMaxUs)
+    {
+        gWakeMaxUs = us;
+    }
+}
+
+bool APP_IDLE::isIdle()
+{
+    return gIdle;
+}
@@ -0,0 +1,294 @@
+/*
+ * File:        APP_LATENCY.cpp
+ * Author:      Marcus Lechner
+ * Created:     2025-08-24
+ * Description: Command-to-frame latency histograms and a slider storm load generator
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#include "APP_LATENCY.hpp"
+#include <Arduino.h>
+#include <FastLED.h>
+#include "APP_RECORD.hpp"
+
+namespace
+{
+    constexpr uint16_t MAX_RATE_HZ = 1000;      // one write per tick at most on average
+    constexpr uint16_t MAX_SECONDS = 600;
+    constexpr uint32_t TASK_STACK = 4096;       // dispatch() runs on this stack
+    constexpr UBaseType_t TASK_PRIORITY = 1;    // same as the BLE host callbacks
+    constexpr BaseType_t TASK_CORE = 0;
+
+    const char* const TRANSPORT_NAMES[APP_BLE::NUM_TRANSPORTS] = { "gatt", "serial", "load", "socket" };
+
+    // Only touched from the render loop
+    struct Histogram
+    {
+        uint32_t bucket[APP_LATENCY::NUM_BUCKETS];
+        uint32_t count;
+        uint32_t maxUs;
+        uint64_t sumUs;
+    };
+
+    Histogram gHistogram[APP_BLE::NUM_TRANSPORTS];
+
+    struct Pending
+    {
+        uint32_t arrived;
+        uint8_t transport;
+    };
+
+    // Applied writes waiting for their frame, oldest first. Filled from any
+    // task, drained by the render loop.
+    portMUX_TYPE gLock = portMUX_INITIALIZER_UNLOCKED;
+    Pending gPending[APP_LATENCY::MAX_PENDING];
+    uint8_t gPendingHead = 0;
+    uint8_t gPendingCount = 0;
+    uint8_t gInFlight = 0;                        // pending when the current frame started
+    uint32_t gOverflow[APP_BLE::NUM_TRANSPORTS];  // writes that found the queue full, not timed
+
+    // Load generator, parameters are set before the task starts
+    volatile bool gLoadRunning = false;
+    volatile bool gLoadFinished = false;
+    uint16_t gLoadRate = 0;
+    uint16_t gLoadSeconds = 0;
+    APP_LATENCY::Slider gLoadSlider = APP_LATENCY::SLIDER_RGB;
+    uint32_t gLoadWrites = 0;
+    uint32_t gLoadDropped = 0;
+
+    void add(Histogram& h, uint32_t us)
+    {
+        uint32_t bucket = us / APP_LATENCY::BUCKET_US;
+        if (bucket >= APP_LATENCY::NUM_BUCKETS)
+        {
+            bucket = APP_LATENCY::NUM_BUCKETS - 1;
+        }
+
+        h.bucket[bucket]++;
+        h.count++;
+        h.sumUs += us;
+        if (us > h.maxUs)
+        {
+            h.maxUs = us;
+        }
+    }
+
+    // Upper edge of the bucket holding the given fraction of samples, in us
+    uint32_t percentile(const Histogram& h, uint8_t percent)
+    {
+        const uint32_t wanted = (static_cast<uint64_t>(h.count) * percent + 99) / 100;
+        uint32_t seen = 0;
+
+        for (uint16_t b = 0; b < APP_LATENCY::NUM_BUCKETS; ++b)
+        {
+            seen += h.bucket[b];
+            if (seen >= wanted)
+            {
+                return (b + 1UL) * APP_LATENCY::BUCKET_US;
+            }
+        }
+        return h.maxUs;
+    }
+
+    void printMs(const char* label, uint32_t us)
+    {
+        Serial.printf(" %s %lu.%02lu", label, static_cast<unsigned long>(us / 1000), static_cast<unsigned long>((us % 1000) / 10));
+    }
+
+    void printHistogram(uint8_t transport)
+    {
+        const Histogram& h = gHistogram[transport];
+
+        Serial.printf("[LATENCY] %-6s %lu writes", TRANSPORT_NAMES[transport], static_cast<unsigned long>(h.count));
+        printMs("avg", static_cast<uint32_t>(h.sumUs / h.count));
+        printMs("p50", percentile(h, 50));
+        printMs("p90", percentile(h, 90));
+        printMs("p99", percentile(h, 99));
+        printMs("max", h.maxUs);
+        Serial.printf(" ms, %lu untimed\n", static_cast<unsigned long>(gOverflow[transport]));
+    }
+
+    // Position of a slider dragged back and forth, one step per write
+    uint8_t triangle(uint32_t step, uint8_t top)
+    {
+        const uint32_t phase = step % (2UL * top);
+        return static_cast<uint8_t>(phase <= top ? phase : 2UL * top - phase);
+    }
+
+    void loadTask(void*)
+    {
+        const uint32_t total = static_cast<uint32_t>(gLoadRate) * gLoadSeconds;
+        const TickType_t start = xTaskGetTickCount();
+        TickType_t wake = start;
+        uint32_t sent = 0;
+
+        // Paced per tick: each tick sends the writes due so far, which keeps
+        // the average rate exact even above one write per tick
+        while (sent < total)
+        {
+            const uint32_t elapsedMs = (xTaskGetTickCount() - start) * portTICK_PERIOD_MS;
+            uint32_t due = static_cast<uint32_t>((static_cast<uint64_t>(elapsedMs) * gLoadRate) / 1000);
+            if (due > total)
+            {
+                due = total;
+            }
+
+            for (; sent < due; ++sent)
+            {
+                bool applied;
+
+                if (gLoadSlider == APP_LATENCY::SLIDER_SHUTTER)
+                {
+                    const uint8_t percent = triangle(sent, 100);
+                    applied = APP_BLE::receive(APP_BLE::TRANSPORT_LOAD, APP_RECORD::CHANNEL_SHUTTER, &percent, 1);
+                }
+                else
+                {
+                    CRGB color;
+                    hsv2rgb_rainbow(CHSV(static_cast<uint8_t>(sent * 3), 255, 255), color);
+                    const uint8_t rgb[3] = { color.r, color.g, color.b };
+                    applied = APP_BLE::receive(APP_BLE::TRANSPORT_LOAD, APP_RECORD::CHANNEL_RGB, rgb, sizeof(rgb));
+                }
+
+                if (applied)
+                {
+                    gLoadWrites++;
+                }
+                else
+                {
+                    gLoadDropped++;
+                }
+            }
+
+            vTaskDelayUntil(&wake, 1);
+        }
+
+        gLoadFinished = true;
+        vTaskDelete(nullptr);
+    }
+}
+
+void APP_LATENCY::commandApplied(APP_BLE::Transport transport, uint32_t arrived)
+{
+    portENTER_CRITICAL(&gLock);
+    if (gPendingCount < MAX_PENDING)
+    {
+        Pending& p = gPending[(gPendingHead + gPendingCount) % MAX_PENDING];
+        p.arrived = arrived;
+        p.transport = transport;
+        gPendingCount++;
+    }
+    else
+    {
+        gOverflow[transport]++;
+    }
+    portEXIT_CRITICAL(&gLock);
+}
+
+void APP_LATENCY::frameStarted()
+{
+    portENTER_CRITICAL(&gLock);
+    gInFlight = gPendingCount;
+    portEXIT_CRITICAL(&gLock);
+}
+
+void APP_LATENCY::frameShown()
+{
+    if (gInFlight == 0)
+    {
+        return;
+    }
+
+    const uint32_t shown = micros();
+    Pending done[MAX_PENDING];
+    uint8_t count;
+
+    portENTER_CRITICAL(&gLock);
+    count = gInFlight;
+    for (uint8_t i = 0; i < count; ++i)
+    {
+        done[i] = gPending[(gPendingHead + i) % MAX_PENDING];
+    }
+    gPendingHead = (gPendingHead + count) % MAX_PENDING;
+    gPendingCount -= count;
+    gInFlight = 0;
+    portEXIT_CRITICAL(&gLock);
+
+    for (uint8_t i = 0; i < count; ++i)
+    {
+        add(gHistogram[done[i].transport], shown - done[i].arrived);
+    }
+}
+
+bool APP_LATENCY::startLoad(uint16_t rateHz, uint16_t seconds, Slider slider)
+{
+    if (gLoadRunning)
+    {
+        return false;
+    }
+
+    gLoadRate = constrain(rateHz, 1, MAX_RATE_HZ);
+    gLoadSeconds = constrain(seconds, 1, MAX_SECONDS);
+    gLoadSlider = slider;
+    gLoadWrites = 0;
+    gLoadDropped = 0;
+    gHistogram[APP_BLE::TRANSPORT_LOAD] = Histogram();
+    gOverflow[APP_BLE::TRANSPORT_LOAD] = 0;
+
+    gLoadFinished = false;
+    gLoadRunning = true;
+    Serial.printf("[LATENCY] %s storm, %u writes/s for %u s\n",
+                  slider == SLIDER_SHUTTER ? "Shutter" : "Colour", gLoadRate, gLoadSeconds);
+
+    if (xTaskCreatePinnedToCore(loadTask, "load", TASK_STACK, nullptr, TASK_PRIORITY, nullptr, TASK_CORE) != pdPASS)
+    {
+        gLoadRunning = false;
+        return false;
+    }
+    return true;
+}
+
+void APP_LATENCY::report()
+{
+    bool any = false;
+
+    for (uint8_t t = 0; t < APP_BLE::NUM_TRANSPORTS; ++t)
+    {
+        if (gHistogram[t].count > 0)
+        {
+            printHistogram(t);
+            any = true;
+        }
+    }
+
+    if (!any)
+    {
+        Serial.println("[LATENCY] No writes timed yet");
+    }
+}
+
+void APP_LATENCY::reset()
+{
+    for (uint8_t t = 0; t < APP_BLE::NUM_TRANSPORTS; ++t)
+    {
+        gHistogram[t] = Histogram();
+        gOverflow[t] = 0;
+    }
+}
+
+void APP_LATENCY::process()
+{
+    if (!gLoadFinished)
+    {
+        return;
+    }
+    gLoadFinished = false;
+    gLoadRunning = false;
+
+    Serial.printf("[LATENCY] Storm done, %lu writes applied, %lu dropped\n",
+                  static_cast<unsigned long>(gLoadWrites), static_cast<unsigned long>(gLoadDropped));
+    if (gHistogram[APP_BLE::TRANSPORT_LOAD].count > 0)
+    {
+        printHistogram(APP_BLE::TRANSPORT_LOAD);
+    }
+}
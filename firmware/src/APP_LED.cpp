@@ -8,8 +8,25 @@
 
 #include "APP_LED.hpp"
 #include "APP_TIMER.hpp"
+#include "APP_PATTERN.hpp"
+#include "APP_SERVO.hpp"
+#include "APP_AUDIO.hpp"
+#include "APP_MAP.hpp"
+#include "APP_NOISE.hpp"
+#include "APP_PARTICLE.hpp"
+#include "APP_RECORD.hpp"
+#include "APP_CONSOLE.hpp"
+#include "APP_LATENCY.hpp"
+#include "APP_IDLE.hpp"
+#include "APP_MEMORY.hpp"
+#include "APP_CALIBRATION.hpp"
+#include "APP_OUTPUT.hpp"
+#include "APP_PIXELNET.hpp"
+#include "APP_FRAMESTREAM.hpp"
 #include <FastLED.h>
 
+#define PATTERN_BENCHMARK 0  // Set to 1 to time patterns, noise and particles at boot
+
 namespace
 {
     //namespace for private variables and functions
@@ -20,12 +37,20 @@ namespace
     //and ensures they all have internal linkage
 
 
-    constexpr uint8_t DATA_PIN = 4;
-    constexpr uint8_t NUM_LEDS = 30;
+    using APP_LED::NUM_LEDS;
     constexpr uint8_t BRIGHTNESS = 255;
     constexpr uint8_t FRAMES_PER_SECOND = 120;
     constexpr uint8_t FRAME_DELAY_MS = (1000 + (FRAMES_PER_SECOND / 2)) / FRAMES_PER_SECOND; //round up to the nearest ms with integer division
 
+    // Power model for the shared 5V supply. A WS2812 channel draws about 20 mA at
+    // full duty, plus ~1 mA quiescent per pixel. While the shutter servo is moving
+    // its stall current is reserved out of the budget so the rail doesn't brown out.
+    constexpr uint16_t POWER_BUDGET_MA = 2000; // default, the supply fitted can be set over BLE
+    constexpr uint16_t LED_CHANNEL_MA = 20;
+    constexpr uint16_t LED_IDLE_MA = 1;
+    constexpr uint16_t SERVO_MOVING_MA = 700;
+    constexpr unsigned long POWER_REPORT_MS = 10000;
+
     void solidColor();
     void rainbow();
     void rainbowWithGlitter();
@@ -39,21 +64,101 @@ namespace
     void lightning();
     void colorWaves();
     void noisePerlin();
+    void audioSpectrum();
+    void clouds();
+    void water();
 
-    // extra state for Cylon
+    // extra state for Cylon, the eye position is an x coordinate (0-255) from APP_MAP
+    constexpr uint8_t CYLON_STEP = 255 / (NUM_LEDS - 1); // same sweep time as one pixel per frame
+    constexpr uint8_t CYLON_EYE = 12;
+    constexpr uint8_t CYLON_TAIL = 40;
     int16_t gCylonPos = 0;
     int8_t  gCylonDir = 1;
 
+    // height band lit by Sinelon, about one turn of the helix
+    constexpr uint8_t SINELON_WIDTH = 48;
+
+    uint8_t gField[NUM_LEDS]; // scratch for APP_MAP fields, one value per pixel
+    constexpr uint8_t MAP_CENTER = 128; // middle of the lamp in APP_MAP coordinates
+    uint8_t gRings[NUM_LEDS];  // distance from MAP_CENTER, pixels never move so it is built once in init()
+
+    // noise fields over the lamp, placed on the map in init()
+    constexpr uint8_t NOISE_OCTAVES = 3;
+    APP_NOISE::NoiseField<NUM_LEDS, NOISE_OCTAVES> gNoise(1, 2, 2);
+    APP_NOISE::NoiseField<NUM_LEDS, NOISE_OCTAVES> gCloudNoise(2, 3, 2);
+    APP_NOISE::NoiseField<NUM_LEDS, NOISE_OCTAVES> gWaterNoise(3, 4, 3);
+    uint16_t gNoiseTime = 0; // advanced once per frame, in 1/256 lattice cells
+
+    // Scratch memory for pattern state that only lives while the pattern is shown.
+    // Bump allocated by the pattern on its first frame (gPatternEntered) and
+    // released all at once when the pattern changes, so patterns never use the heap.
+    constexpr size_t ARENA_SIZE = 1024;
+    alignas(4) uint8_t gArena[ARENA_SIZE];
+    size_t gArenaUsed = 0;
+    bool gPatternEntered = true;
+
+    // Fire2012 style heat simulation. On a helix every column of pixels above each
+    // other burns as its own segment, on a straight strip the whole strip is one.
+    constexpr uint8_t FIRE_SEGMENTS = (APP_MAP::GEOMETRY == APP_MAP::GEOMETRY_HELIX) ? APP_MAP::LEDS_PER_TURN : 1;
+    constexpr uint8_t FIRE_CELLS = (NUM_LEDS + FIRE_SEGMENTS - 1) / FIRE_SEGMENTS; // heat cells per segment, bottom first
+    constexpr uint8_t FIRE_COOLING = 55;   // higher = shorter flames
+    constexpr uint8_t FIRE_SPARKING = 120; // chance out of 255 for a new spark per segment and frame
+    constexpr uint8_t FIRE_SPARK_CELLS = FIRE_CELLS < 3 ? FIRE_CELLS : 3;
+
+    // Shared by confetti, glitter, juggle and lightning, emptied whenever the pattern changes.
+    // Juggle is the hungriest, 8 dots per frame that live about 60 frames.
+    constexpr uint16_t PARTICLE_CAPACITY = 512;
+    APP_PARTICLE::ParticlePool<PARTICLE_CAPACITY> gParticles;
+
+    // per-frame fraction of brightness kept, same trail length as the fadeToBlackBy() amounts they replace
+    constexpr uint8_t CONFETTI_KEEP = 256 - 10;
+    constexpr uint8_t GLITTER_KEEP = 160;
+    constexpr uint8_t JUGGLE_KEEP = 256 - 20;
+    constexpr uint8_t LIGHTNING_KEEP = 256 - 40;
+
     Timer led_timer(FRAME_DELAY_MS, true); // 8ms timer for LED animation
 
-    CRGB leds[NUM_LEDS]; //RGB pixel obkject array, each pixel object has 3 uint8_t values for red, green and blue
+    CRGB gLiveLeds[NUM_LEDS]; //RGB pixel obkject array, each pixel object has 3 uint8_t values for red, green and blue
     //could just make a struct of a pixel with 3 uint8_t values
 
+    // A reference render (APP_GOLDEN) draws into its own strip so the trails in gLiveLeds
+    // survive it. Patterns only ever see leds, which points at one or the other.
+    CRGB gReferenceLeds[NUM_LEDS];
+    CRGB* leds = gLiveLeds;
+
+    // Patterns draw into leds[] and use it as their state (fadeToBlackBy trails etc.),
+    // so the crossfade is composed into a separate output buffer that APP_OUTPUT sends
+    CRGB frame[NUM_LEDS];
+    CRGB fadeFrom[NUM_LEDS];    // output frozen at the moment a crossfade started
+
+    uint8_t gBrightness = BRIGHTNESS;
+    uint8_t gFrameBrightness = BRIGHTNESS; // what frame[] is sent with, after crossfade and power limit
+    uint8_t gFadeFromBrightness = BRIGHTNESS;
+    unsigned long gFadeStart = 0;
+    uint16_t gFadeDuration = 0; // 0 = no crossfade running
+
+    uint16_t gPowerBudget = POWER_BUDGET_MA;
+    uint32_t gFramesTotal = 0;
+    uint32_t gFramesLimited = 0;
+    uint32_t gPeakDemandMa = 0; // unlimited estimate, worst frame since the last report
+    Timer power_report_timer(POWER_REPORT_MS, true);
+
     // Solid color used by "Solid Color" pattern
     CRGB   gSolidColor = CRGB::White;
 
     uint8_t gCurrentPattern = 0;
+    uint8_t gRenderedPattern = 0xFF; // pattern whose state the arena holds, 0xFF = none
     uint8_t gHue = 0;
+    constexpr uint8_t HUE_STEP_MS = 20;
+
+    // what a reference render (APP_GOLDEN) replaces, put back afterwards
+    uint8_t gSavedPattern = 0;
+    uint8_t gSavedHue = 0;
+    CRGB gSavedSolidColor;
+    int16_t gSavedCylonPos = 0;
+    int8_t gSavedCylonDir = 1;
+    uint16_t gSavedNoiseTime = 0;
+    uint16_t gSavedSeed = 0;
 
     using PatternFn = void (*)();
 
@@ -80,6 +185,9 @@ namespace
     // 10: Lightning
     // 11: Color Waves
     // 12: Noise / Perlin
+    // 13: Audio Spectrum
+    // 14: Clouds
+    // 15: Water
     //
     PatternFn gPatterns[] =
     {
@@ -95,7 +203,10 @@ namespace
         cylon,
         lightning,
         colorWaves,
-        noisePerlin
+        noisePerlin,
+        audioSpectrum,
+        clouds,
+        water
     };
 
     const uint8_t NUM_PATTERNS =  static_cast<uint8_t>(sizeof(gPatterns) / sizeof(gPatterns[0]));
@@ -113,50 +224,94 @@ namespace
         fill_rainbow(leds, NUM_LEDS, gHue, 7);
     }
 
+    // Anywhere on the strip, at rest, white unless hue/saturation are filled in
+    APP_PARTICLE::Emitter stripEmitter(uint8_t keep)
+    {
+        APP_PARTICLE::Emitter e = {};
+        e.spread = NUM_LEDS * APP_PARTICLE::PIXEL;
+        e.life = 255;
+        e.keep = keep;
+        return e;
+    }
+
     void rainbowWithGlitter()
     {
+        // glitter sparkles that twinkle out over a few frames
         rainbow();
+        gParticles.update(NUM_LEDS);
         if (random8() < 80)
         {
-            leds[random16(NUM_LEDS)] += CRGB::White;
+            gParticles.emit(stripEmitter(GLITTER_KEEP), 1);
         }
+        gParticles.render(leds, NUM_LEDS);
     }
 
     void confetti()
     {
-        fadeToBlackBy(leds, NUM_LEDS, 10);
-        int pos = random16(NUM_LEDS);
-        leds[pos] += CHSV(gHue + random8(64), 200, 255);
+        // one new speck per frame, drifting slowly while it fades
+        APP_PARTICLE::Emitter speck = stripEmitter(CONFETTI_KEEP);
+        speck.jitter = 4;
+        speck.hue = gHue;
+        speck.hueSpread = 64;
+        speck.saturation = 200;
+
+        fill_solid(leds, NUM_LEDS, CRGB::Black);
+        gParticles.update(NUM_LEDS);
+        gParticles.emit(speck, 1);
+        gParticles.render(leds, NUM_LEDS);
+    }
+
+    uint8_t distance8(uint8_t a, uint8_t b)
+    {
+        return a > b ? a - b : b - a;
     }
 
     void sinelon()
     {
+        // a ring of light riding up and down the lamp
         fadeToBlackBy(leds, NUM_LEDS, 20);
-        int pos = beatsin16(13, 0, NUM_LEDS - 1);
-        leds[pos] += CHSV(gHue, 255, 192);
+
+        const APP_MAP::Map& map = APP_MAP::get();
+        const uint8_t level = beatsin8(13);
+
+        for (uint8_t i = 0; i < NUM_LEDS; ++i)
+        {
+            const uint8_t d = distance8(map.z[i], level);
+            if (d < SINELON_WIDTH)
+            {
+                leds[i] += CHSV(gHue, 255, (192 * (SINELON_WIDTH - d)) / SINELON_WIDTH);
+            }
+        }
     }
 
     void bpm()
     {
+        // party colours pulsing out from the middle of the lamp at 62 BPM
         uint8_t BeatsPerMinute = 62;
-        CRGBPalette16 palette = PartyColors_p;
+        static const CRGBPalette16 palette = PartyColors_p; // built once, not every frame
         uint8_t beat = beatsin8(BeatsPerMinute, 64, 255);
 
         for (int i = 0; i < NUM_LEDS; ++i)
         {
-            leds[i] = ColorFromPalette(palette, gHue + (i * 2), beat - gHue + (i * 10));
+            leds[i] = ColorFromPalette(palette, gHue + gRings[i], beat - gHue + gRings[i] * 5);
         }
     }
 
     void juggle()
     {
-        fadeToBlackBy(leds, NUM_LEDS, 20);
+        // eight dots weaving in and out, each leaves a trail of fading particles
+        fill_solid(leds, NUM_LEDS, CRGB::Black);
+        gParticles.update(NUM_LEDS);
+
         uint8_t dothue = 0;
         for (int i = 0; i < 8; ++i)
         {
-            leds[beatsin16(i + 7, 0, NUM_LEDS - 1)] |= CHSV(dothue, 200, 255);
+            const int32_t pos = beatsin16(i + 7, 0, (NUM_LEDS - 1) * APP_PARTICLE::PIXEL);
+            gParticles.spawn(pos, 0, CHSV(dothue, 200, 255), 255, JUGGLE_KEEP);
             dothue += 32;
         }
+
+        gParticles.render(leds, NUM_LEDS);
     }
 
     void nextPattern()
@@ -164,17 +319,79 @@ namespace
         gCurrentPattern = (gCurrentPattern + 1) % (sizeof(gPatterns) / sizeof(gPatterns[0]));
     }
 
-        void fire()
+    // Returns nullptr when the arena is full, callers must fall back gracefully
+    void* arenaAlloc(size_t bytes)
     {
-        // simple ember-like fire: reds/oranges that flicker
-        fadeToBlackBy(leds, NUM_LEDS, 40);
+        bytes = (bytes + 3) & ~static_cast<size_t>(3);
+        if (gArenaUsed + bytes > ARENA_SIZE)
+        {
+            Serial.printf("[LED] Arena full, %u of %u bytes used\n",
+                          static_cast<unsigned>(gArenaUsed), static_cast<unsigned>(ARENA_SIZE));
+            return nullptr;
+        }
 
-        const uint8_t sparks = NUM_LEDS / 3;
-        for (uint8_t i = 0; i < sparks; ++i)
+        void* block = gArena + gArenaUsed;
+        gArenaUsed += bytes;
+        return block;
+    }
+
+    void fire()
+    {
+        static uint8_t* heat = nullptr;  // FIRE_SEGMENTS runs of FIRE_CELLS, from the arena
+        static CRGB* heatColor = nullptr; // heat -> colour lookup, from the arena
+
+        if (gPatternEntered)
         {
-            uint8_t pos = random8(NUM_LEDS);
-            uint8_t heat = random8(160, 255);
-            leds[pos] += CRGB(heat, heat / 4, 0); // orange-ish
+            heat = static_cast<uint8_t*>(arenaAlloc(FIRE_SEGMENTS * FIRE_CELLS));
+            heatColor = static_cast<CRGB*>(arenaAlloc(256 * sizeof(CRGB)));
+
+            if (heat && heatColor)
+            {
+                memset(heat, 0, FIRE_SEGMENTS * FIRE_CELLS);
+                for (uint16_t h = 0; h < 256; ++h)
+                {
+                    // stop short of the palette end so the hottest cells don't wrap back to black
+                    heatColor[h] = ColorFromPalette(HeatColors_p, scale8(h, 240));
+                }
+            }
+        }
+
+        if (!heat || !heatColor)
+        {
+            fill_solid(leds, NUM_LEDS, CRGB::Black);
+            return;
+        }
+
+        const uint8_t maxCooling = ((FIRE_COOLING * 10) / FIRE_CELLS) + 2;
+
+        for (uint8_t seg = 0; seg < FIRE_SEGMENTS; ++seg)
+        {
+            uint8_t* h = heat + seg * FIRE_CELLS;
+
+            if (random8() < FIRE_SPARKING)
+            {
+                const uint8_t y = random8(FIRE_SPARK_CELLS);
+                h[y] = qadd8(h[y], random8(160, 255));
+            }
+
+            // One pass from the top down: every cell takes its heat from the two below
+            // (which are not updated yet), cools off and is drawn straight away
+            for (int8_t y = FIRE_CELLS - 1; y >= 0; --y)
+            {
+                uint8_t cell = h[y];
+                if (y >= 2)
+                {
+                    cell = (h[y - 1] + h[y - 2] + h[y - 2]) / 3;
+                }
+                cell = qsub8(cell, random8(0, maxCooling));
+                h[y] = cell;
+
+                const uint16_t pixel = y * FIRE_SEGMENTS + seg;
+                if (pixel < NUM_LEDS)
+                {
+                    leds[pixel] = heatColor[cell];
+                }
+            }
         }
     }
 
@@ -192,38 +409,44 @@ namespace
 
     void cylon()
     {
-        // single red "eye" scanning back and forth
+        // single red "eye" scanning back and forth across the lamp
         fadeToBlackBy(leds, NUM_LEDS, 20);
 
-        gCylonPos += gCylonDir;
+        gCylonPos += gCylonDir * CYLON_STEP;
 
         if (gCylonPos <= 0)
         {
             gCylonPos = 0;
             gCylonDir = 1;
         }
-        else if (gCylonPos >= NUM_LEDS - 1)
+        else if (gCylonPos >= 255)
         {
-            gCylonPos = NUM_LEDS - 1;
+            gCylonPos = 255;
             gCylonDir = -1;
         }
 
-        // eye + a little tail
-        leds[gCylonPos] = CRGB::Red;
-        if (gCylonPos > 0)
-        {
-            leds[gCylonPos - 1] += CRGB(64, 0, 0);
-        }
-        if (gCylonPos < NUM_LEDS - 1)
+        // eye + a little tail, every pixel in that vertical slice lights up
+        const APP_MAP::Map& map = APP_MAP::get();
+
+        for (uint8_t i = 0; i < NUM_LEDS; ++i)
         {
-            leds[gCylonPos + 1] += CRGB(64, 0, 0);
+            const uint8_t d = distance8(map.x[i], static_cast<uint8_t>(gCylonPos));
+            if (d < CYLON_EYE)
+            {
+                leds[i] = CRGB::Red;
+            }
+            else if (d < CYLON_TAIL)
+            {
+                leds[i] += CRGB(64, 0, 0);
+            }
         }
     }
 
     void lightning()
     {
         // mostly dark strip with random bright flashes
-        fadeToBlackBy(leds, NUM_LEDS, 40);
+        fill_solid(leds, NUM_LEDS, CRGB::Black);
+        gParticles.update(NUM_LEDS);
 
         if (random8() < 20)
         {
@@ -232,56 +455,608 @@ namespace
 
             for (uint8_t i = 0; i < len && (start + i) < NUM_LEDS; ++i)
             {
-                leds[start + i] = CRGB::White;
+                gParticles.spawn((start + i) * APP_PARTICLE::PIXEL, 0, CRGB::White, 255, LIGHTNING_KEEP);
             }
         }
+
+        gParticles.render(leds, NUM_LEDS);
     }
 
     void colorWaves()
     {
-        // smooth palette-based color waves along the strip
+        // palette waves climbing the lamp at a slant, brightness spiralling around it
         static CRGBPalette16 palette = RainbowColors_p;
 
+        const APP_MAP::Map& map = APP_MAP::get();
+        APP_MAP::linearField(gField, 16, 0, 64, gHue * 2);
+
         for (uint8_t i = 0; i < NUM_LEDS; ++i)
         {
-            uint8_t index = sin8(i * 8 + gHue * 2);
-            uint8_t bright = sin8(i * 16 + gHue * 3);
+            uint8_t index = sin8(gField[i]);
+            uint8_t bright = sin8(map.angle[i] + map.z[i] + gHue * 3);
             leds[i] = ColorFromPalette(palette, index, bright, LINEARBLEND);
         }
     }
 
+    // Octave sums bunch up around 128, spread them back over the full range
+    uint8_t contrast(uint8_t n)
+    {
+        const int16_t v = (static_cast<int16_t>(n) - 128) * 2 + 128;
+        return v < 0 ? 0 : (v > 255 ? 255 : v);
+    }
+
     void noisePerlin()
     {
-        // simple 1D Perlin/noise-based color strip
+        // slowly drifting noise colours wrapped around the lamp
+        gNoiseTime += 3;
+        gNoise.render(gField, gNoiseTime);
+
+        for (uint8_t i = 0; i < NUM_LEDS; ++i)
+        {
+            leds[i] = CHSV(contrast(gField[i]), 255, 255);
+        }
+    }
+
+    void clouds()
+    {
+        // soft white clouds drifting over a blue sky
+        gNoiseTime += 1;
+        gCloudNoise.render(gField, gNoiseTime);
+
+        for (uint8_t i = 0; i < NUM_LEDS; ++i)
+        {
+            leds[i] = ColorFromPalette(CloudColors_p, contrast(gField[i]), 255, LINEARBLEND);
+        }
+    }
+
+    void water()
+    {
+        // ocean colours with brighter caustics rippling through them
+        gNoiseTime += 4;
+        gWaterNoise.render(gField, gNoiseTime);
+
+        for (uint8_t i = 0; i < NUM_LEDS; ++i)
+        {
+            const uint8_t n = contrast(gField[i]);
+            const uint8_t ripple = sin8(n * 3 + (gNoiseTime >> 2));
+            leds[i] = ColorFromPalette(OceanColors_p, n, 128 + (ripple >> 1), LINEARBLEND);
+        }
+    }
+
+    void audioSpectrum()
+    {
+        // microphone bands spread along the strip, bass at the start, with a flash on every beat
+        static uint16_t lastBeat = 0;
+        const APP_AUDIO::Bands audio = APP_AUDIO::get();
+
+        fadeToBlackBy(leds, NUM_LEDS, 40);
+
+        for (uint8_t i = 0; i < NUM_LEDS; ++i)
+        {
+            const uint8_t band = (i * APP_AUDIO::NUM_BANDS) / NUM_LEDS;
+            leds[i] |= CHSV(gHue + band * 32, 240, audio.band[band]);
+        }
+
+        if (audio.beatCount != lastBeat)
+        {
+            lastBeat = audio.beatCount;
+            for (uint8_t i = 0; i < NUM_LEDS; ++i)
+            {
+                leds[i] += CRGB(48, 48, 48);
+            }
+        }
+    }
+
+    bool isUserPattern(uint8_t animId)
+    {
+        return animId >= APP_LED::USER_PATTERN_BASE;
+    }
+
+    // Highest global brightness that keeps the estimated strip current under
+    // budget, given the summed channel values of the frame at full brightness
+    uint8_t limitBrightness(uint8_t brightness, uint32_t channelSum)
+    {
+        gFramesTotal++;
+
+        int32_t available = static_cast<int32_t>(gPowerBudget) - LED_IDLE_MA * NUM_LEDS;
+        if (APP_SERVO::isMoving())
+        {
+            available -= SERVO_MOVING_MA;
+        }
+
+        // demand in mA = channelSum * LED_CHANNEL_MA * brightness / (255 * 255)
+        const uint32_t fullScale = channelSum * LED_CHANNEL_MA;
+        const uint32_t demand = (fullScale * brightness) / (255UL * 255UL);
+
+        if (demand + LED_IDLE_MA * NUM_LEDS > gPeakDemandMa)
+        {
+            gPeakDemandMa = demand + LED_IDLE_MA * NUM_LEDS;
+        }
+
+        if (demand <= static_cast<uint32_t>(available > 0 ? available : 0))
+        {
+            return brightness;
+        }
+
+        gFramesLimited++;
+
+        if (available <= 0)
+        {
+            return 0;
+        }
+
+        return static_cast<uint8_t>((static_cast<uint32_t>(available) * 255UL * 255UL) / fullScale);
+    }
+
+    inline CRGB calibrate(const CRGB& c, const APP_CALIBRATION::Table* t)
+    {
+        return CRGB(t->r[c.r], t->g[c.g], t->b[c.b]);
+    }
+
+    // Copies the pattern into the output buffer, blending from the frozen
+    // frame while a crossfade is running, and sums the channel values for
+    // the power limiter in the same pass. The fixture calibration is applied
+    // on the way, one table lookup per channel (see APP_CALIBRATION.hpp). The limit is applied through
+    // the global brightness APP_OUTPUT folds into its conversion, so it costs no extra pass over the pixels.
+    // Timed from the clock so a fade finishes on time even if a frame is late.
+    void composeFrame()
+    {
+        uint8_t brightness = gBrightness;
+        uint32_t channelSum = 0;
+        const APP_CALIBRATION::Table* const* tables = APP_CALIBRATION::pixelTables();
+
+        if (gFadeDuration && APP_RECORD::now() - gFadeStart >= gFadeDuration)
+        {
+            gFadeDuration = 0;
+        }
+
+        if (gFadeDuration)
+        {
+            uint8_t amount = static_cast<uint8_t>(((APP_RECORD::now() - gFadeStart) * 255) / gFadeDuration);
+            brightness = lerp8by8(gFadeFromBrightness, gBrightness, amount);
+
+            for (uint8_t i = 0; i < NUM_LEDS; ++i)
+            {
+                const CRGB c = calibrate(blend(fadeFrom[i], leds[i], amount), tables[i]);
+                frame[i] = c;
+                channelSum += c.r + c.g + c.b;
+            }
+        }
+        else
+        {
+            for (uint8_t i = 0; i < NUM_LEDS; ++i)
+            {
+                const CRGB c = calibrate(leds[i], tables[i]);
+                frame[i] = c;
+                channelSum += c.r + c.g + c.b;
+            }
+        }
+
+        gFrameBrightness = limitBrightness(brightness, channelSum);
+    }
+
+    void reportPower()
+    {
+        if (gFramesLimited)
+        {
+            Serial.printf("[LED] Power limit engaged in %lu/%lu frames, peak demand %lu mA (budget %u mA)\n",
+                          static_cast<unsigned long>(gFramesLimited),
+                          static_cast<unsigned long>(gFramesTotal),
+                          static_cast<unsigned long>(gPeakDemandMa),
+                          gPowerBudget);
+        }
+
+        gFramesTotal = 0;
+        gFramesLimited = 0;
+        gPeakDemandMa = 0;
+    }
+
+    // Releases everything the previous pattern held, the next one allocates on its first frame
+    void enterPattern()
+    {
+        gRenderedPattern = gCurrentPattern;
+        gArenaUsed = 0;
+        gPatternEntered = true;
+        gParticles.clear();
+    }
+
+    void drawPattern()
+    {
+        if (gCurrentPattern != gRenderedPattern)
+        {
+            // checked here rather than in setAnimation() so the arena is only ever touched from the render loop
+            enterPattern();
+        }
+
+        if (isUserPattern(gCurrentPattern))
+        {
+            APP_PATTERN::render(gCurrentPattern - APP_LED::USER_PATTERN_BASE, leds, NUM_LEDS, gHue);
+        }
+        else
+        {
+            gPatterns[gCurrentPattern]();
+        }
+        gPatternEntered = false;
+    }
+
+    void runPattern()
+    {
+        if (APP_PIXELNET::isActive())
+        {
+            APP_PIXELNET::render(reinterpret_cast<uint8_t*>(leds)); // the pattern pauses while a stream plays
+        }
+        else if (APP_FRAMESTREAM::isActive())
+        {
+            APP_FRAMESTREAM::render(reinterpret_cast<uint8_t*>(leds));
+        }
+        else
+        {
+            drawPattern();
+        }
+    }
+
+    void renderFrame()
+    {
+        APP_LATENCY::frameStarted();
+        runPattern();
+        composeFrame();
+        APP_RECORD::frameRendered(reinterpret_cast<const uint8_t*>(frame), sizeof(frame), gFrameBrightness);
+        APP_CONSOLE::frameRendered(reinterpret_cast<const uint8_t*>(frame), sizeof(frame), gFrameBrightness);
+        APP_OUTPUT::show(reinterpret_cast<const uint8_t*>(frame), gFrameBrightness);
+        APP_LATENCY::frameShown();
+        APP_IDLE::frameShown();
+    }
+
+#if PATTERN_BENCHMARK
+    // Bytecode equivalents of the native patterns, see APP_PATTERN.hpp for the format
+    const uint8_t BENCH_COLOR_WAVES[] =
+    {
+        0x01, APP_PATTERN::PALETTE_RAINBOW, 0x00, 0x00, 0x00,
+        0x02, 0x01, 0x08, 0x0A, 0x03, 0x01, 0x02, 0x0A, 0x08, 0x10,
+        0x02, 0x01, 0x10, 0x0A, 0x03, 0x01, 0x03, 0x0A, 0x08, 0x10,
+        0x20
+    };
+
+    const uint8_t BENCH_RAINBOW[] =
+    {
+        0x01, APP_PATTERN::PALETTE_NONE, 0x00, 0x00, 0x00,
+        0x03, 0x02, 0x01, 0x07, 0x0A, 0x08,
+        0x01, 0xF0, 0x01, 0xFF,     // fill_rainbow's saturation
+        0x21
+    };
+
+    constexpr uint16_t BENCH_FRAMES = 2000;
+
+    unsigned long timeNative(PatternFn fn)
+    {
+        unsigned long start = micros();
+        for (uint16_t f = 0; f < BENCH_FRAMES; ++f)
+        {
+            fn();
+            gHue++;
+        }
+        return micros() - start;
+    }
+
+    // Bytecode against native code on a fixture the size the interpreter has to
+    // keep up with, not this lamp's strip
+    constexpr uint16_t BENCH_PATTERN_PIXELS = 300;
+    constexpr uint16_t BENCH_PATTERN_FRAMES = 500;
+    CRGB gBenchPixels[BENCH_PATTERN_PIXELS];
+
+    typedef void (*BenchFn)(CRGB* pixels, uint16_t count);
+
+    void colorWavesBench(CRGB* pixels, uint16_t count)
+    {
+        static CRGBPalette16 palette = RainbowColors_p;
+
+        for (uint16_t i = 0; i < count; ++i)
+        {
+            uint8_t index = sin8(i * 8 + gHue * 2);
+            uint8_t bright = sin8(i * 16 + gHue * 3);
+            pixels[i] = ColorFromPalette(palette, index, bright, LINEARBLEND);
+        }
+    }
+
+    void rainbowBench(CRGB* pixels, uint16_t count)
+    {
+        fill_rainbow(pixels, count, gHue, 7);
+    }
+
+    unsigned long timeBenchNative(BenchFn fn)
+    {
+        unsigned long start = micros();
+        for (uint16_t f = 0; f < BENCH_PATTERN_FRAMES; ++f)
+        {
+            fn(gBenchPixels, BENCH_PATTERN_PIXELS);
+            gHue++;
+        }
+        return micros() - start;
+    }
+
+    unsigned long timeBytecode(uint8_t slot)
+    {
+        unsigned long start = micros();
+        for (uint16_t f = 0; f < BENCH_PATTERN_FRAMES; ++f)
+        {
+            APP_PATTERN::render(slot, gBenchPixels, BENCH_PATTERN_PIXELS, gHue);
+            gHue++;
+        }
+        return micros() - start;
+    }
+
+    void benchmarkPair(const char* name, BenchFn fn, const uint8_t* program, size_t length)
+    {
+        if (!APP_PATTERN::load(0, program, length))
+        {
+            Serial.printf("[LED] bench %s: bytecode rejected\n", name);
+            return;
+        }
+
+        unsigned long native = timeBenchNative(fn);
+        unsigned long bytecode = timeBytecode(0);
+        APP_PATTERN::clear(0);
+        APP_PATTERN::render(0, gBenchPixels, 0, 0); // takes the clear over
+
+        // ns per pixel keeps the numbers comparable across strip lengths
+        const float pixels = static_cast<float>(BENCH_PATTERN_FRAMES) * BENCH_PATTERN_PIXELS;
+        Serial.printf("[LED] bench %-12s x%u native %6.1f ns/px  bytecode %6.1f ns/px  ratio %.2fx%s\n",
+                      name,
+                      BENCH_PATTERN_PIXELS,
+                      native * 1000.0f / pixels,
+                      bytecode * 1000.0f / pixels,
+                      static_cast<float>(bytecode) / native,
+                      bytecode > 2 * native ? "  OVER 2x" : "");
+    }
+
+    // Index based versions of the mapped patterns, as they were before APP_MAP
+    void colorWavesRaw()
+    {
+        static CRGBPalette16 palette = RainbowColors_p;
+
         for (uint8_t i = 0; i < NUM_LEDS; ++i)
         {
-            // inoise8 is from FastLED
-            uint8_t n = inoise8(i * 30, 0, gHue * 4);
-            leds[i] = CHSV(n, 255, 255);
+            uint8_t index = sin8(i * 8 + gHue * 2);
+            uint8_t bright = sin8(i * 16 + gHue * 3);
+            leds[i] = ColorFromPalette(palette, index, bright, LINEARBLEND);
+        }
+    }
+
+    void sinelonRaw()
+    {
+        fadeToBlackBy(leds, NUM_LEDS, 20);
+        int pos = beatsin16(13, 0, NUM_LEDS - 1);
+        leds[pos] += CHSV(gHue, 255, 192);
+    }
+
+    void bpmRaw()
+    {
+        static const CRGBPalette16 palette = PartyColors_p;
+        uint8_t beat = beatsin8(62, 64, 255);
+
+        for (int i = 0; i < NUM_LEDS; ++i)
+        {
+            leds[i] = ColorFromPalette(palette, gHue + (i * 2), beat - gHue + (i * 10));
+        }
+    }
+
+    void benchmarkMapped(const char* name, PatternFn raw, PatternFn mapped)
+    {
+        unsigned long rawTime = timeNative(raw);
+        unsigned long mappedTime = timeNative(mapped);
+
+        const float pixels = static_cast<float>(BENCH_FRAMES) * NUM_LEDS;
+        Serial.printf("[LED] bench %-12s raw    %6.1f ns/px  mapped   %6.1f ns/px  ratio %.2fx\n",
+                      name,
+                      rawTime * 1000.0f / pixels,
+                      mappedTime * 1000.0f / pixels,
+                      static_cast<float>(mappedTime) / rawTime);
+    }
+
+    // Noise over a large fixture, the engine against per-pixel inoise8 with the same octaves
+    constexpr uint16_t BENCH_NOISE_PIXELS = 1000;
+    constexpr uint16_t BENCH_NOISE_FRAMES = 200;
+
+    void benchmarkNoise()
+    {
+        static APP_NOISE::NoiseField<BENCH_NOISE_PIXELS, NOISE_OCTAVES> noise(1, 4, 4);
+        static uint8_t angle[BENCH_NOISE_PIXELS];
+        static uint8_t height[BENCH_NOISE_PIXELS];
+        static uint8_t out[BENCH_NOISE_PIXELS];
+
+        for (uint16_t i = 0; i < BENCH_NOISE_PIXELS; ++i)
+        {
+            angle[i] = static_cast<uint8_t>((i * 256UL) / 33);
+            height[i] = static_cast<uint8_t>((i * 255UL) / (BENCH_NOISE_PIXELS - 1));
+        }
+        noise.init(angle, height);
+
+        unsigned long start = micros();
+        for (uint16_t f = 0; f < BENCH_NOISE_FRAMES; ++f)
+        {
+            for (uint16_t i = 0; i < BENCH_NOISE_PIXELS; ++i)
+            {
+                uint8_t v = 0;
+                for (uint8_t o = 0; o < NOISE_OCTAVES; ++o)
+                {
+                    v += inoise8(angle[i] << (4 + o), height[i] << (4 + o), f << (4 + o)) >> (o + 1);
+                }
+                out[i] = v;
+            }
+        }
+        const unsigned long perPixel = micros() - start;
+
+        start = micros();
+        for (uint16_t f = 0; f < BENCH_NOISE_FRAMES; ++f)
+        {
+            noise.render(out, f * 16);
+        }
+        const unsigned long engine = micros() - start;
+
+        Serial.printf("[LED] bench noise x%u  inoise8 %lu us/frame  engine %lu us/frame  ratio %.2fx\n",
+                      BENCH_NOISE_PIXELS,
+                      perPixel / BENCH_NOISE_FRAMES,
+                      engine / BENCH_NOISE_FRAMES,
+                      static_cast<float>(engine) / perPixel);
+    }
+
+    // Full pool of slowly drifting particles, update + splat only
+    constexpr uint16_t BENCH_PARTICLES = 2048;
+    constexpr uint16_t BENCH_PARTICLE_FRAMES = 200;
+
+    void benchmarkParticles()
+    {
+        static APP_PARTICLE::ParticlePool<BENCH_PARTICLES> pool;
+        APP_PARTICLE::Emitter e = stripEmitter(255);
+        e.jitter = 16;
+        e.saturation = 255;
+        e.hueSpread = 255;
+
+        unsigned long elapsed = 0;
+        uint32_t particles = 0;
+
+        for (uint16_t f = 0; f < BENCH_PARTICLE_FRAMES; ++f)
+        {
+            pool.emit(e, BENCH_PARTICLES - pool.size()); // keep it full, not timed
+            particles += pool.size();
+
+            unsigned long start = micros();
+            pool.update(NUM_LEDS);
+            pool.render(leds, NUM_LEDS);
+            elapsed += micros() - start;
+        }
+
+        Serial.printf("[LED] bench particles x%u  %lu particles/ms\n",
+                      BENCH_PARTICLES,
+                      static_cast<unsigned long>((particles * 1000ULL) / (elapsed ? elapsed : 1)));
+    }
+
+    // Output stage with the calibration tables against a plain copy, as it was before them
+    void benchmarkOutput()
+    {
+        volatile uint32_t sink = 0; // keeps the plain copy from being optimised away
+
+        unsigned long start = micros();
+        for (uint16_t f = 0; f < BENCH_FRAMES; ++f)
+        {
+            uint32_t channelSum = 0;
+            for (uint8_t i = 0; i < NUM_LEDS; ++i)
+            {
+                const CRGB c = leds[i];
+                frame[i] = c;
+                channelSum += c.r + c.g + c.b;
+            }
+            sink = sink + channelSum;
+        }
+        const unsigned long plain = micros() - start;
+
+        start = micros();
+        for (uint16_t f = 0; f < BENCH_FRAMES; ++f)
+        {
+            composeFrame();
         }
+        const unsigned long calibrated = micros() - start;
+
+        const float pixels = static_cast<float>(BENCH_FRAMES) * NUM_LEDS;
+        Serial.printf("[LED] bench %-12s copy   %6.1f ns/px  tables   %6.1f ns/px  ratio %.2fx\n",
+                      "output",
+                      plain * 1000.0f / pixels,
+                      calibrated * 1000.0f / pixels,
+                      static_cast<float>(calibrated) / plain);
+    }
+
+    // Conversion into each pixel format, at a brightness that exercises the scaling
+    void benchmarkFormats()
+    {
+        static uint8_t tx[APP_OUTPUT::frameBytes(APP_OUTPUT::FORMAT_HD108, NUM_LEDS)];
+        const char* const names[APP_OUTPUT::NUM_FORMATS] = { "grb", "rgbw", "apa102", "hd108" };
+
+        for (uint8_t f = 0; f < APP_OUTPUT::NUM_FORMATS; ++f)
+        {
+            const APP_OUTPUT::PixelFormat format = static_cast<APP_OUTPUT::PixelFormat>(f);
+
+            unsigned long start = micros();
+            for (uint16_t n = 0; n < BENCH_FRAMES; ++n)
+            {
+                APP_OUTPUT::encode(format, reinterpret_cast<const uint8_t*>(frame), NUM_LEDS, 180, tx);
+            }
+            const unsigned long elapsed = micros() - start;
+
+            Serial.printf("[LED] bench format %-7s %6.1f ns/px  %u bytes/frame\n", names[f],
+                          elapsed * 1000.0f / (static_cast<float>(BENCH_FRAMES) * NUM_LEDS),
+                          static_cast<unsigned>(APP_OUTPUT::frameBytes(format, NUM_LEDS)));
+        }
+    }
+
+    void benchmarkPatterns()
+    {
+        benchmarkPair("colorWaves", colorWavesBench, BENCH_COLOR_WAVES, sizeof(BENCH_COLOR_WAVES));
+        benchmarkPair("rainbow", rainbowBench, BENCH_RAINBOW, sizeof(BENCH_RAINBOW));
+        benchmarkMapped("colorWaves", colorWavesRaw, colorWaves);
+        benchmarkMapped("sinelon", sinelonRaw, sinelon);
+        benchmarkMapped("bpm", bpmRaw, bpm);
+        benchmarkNoise();
+        benchmarkParticles();
+        benchmarkOutput();
+        benchmarkFormats();
     }
+#endif
 }
 
 void APP_LED::init()
 {
-    FastLED.addLeds<WS2812, DATA_PIN, GRB>(leds, NUM_LEDS).setCorrection(TypicalLEDStrip);
-    FastLED.setBrightness(BRIGHTNESS);
+    APP_MEMORY::Scope memory(APP_MEMORY::MODULE_LED);
+    APP_MAP::init(); // patterns read the coordinate tables from the first frame on
+
+    const APP_MAP::Map& map = APP_MAP::get();
+    gNoise.init(map.angle, map.z);
+    gCloudNoise.init(map.angle, map.z);
+    gWaterNoise.init(map.angle, map.z);
+    APP_MAP::radialField(gRings, MAP_CENTER, MAP_CENTER, MAP_CENTER, 64, 0);
+
+    APP_OUTPUT::init();
+
+    // a replay from a checkpoint continues from the look it recorded
+    if (const APP_RECORD::Snapshot* snapshot = APP_RECORD::snapshot())
+    {
+        gBrightness = snapshot->brightness;
+        gHue = snapshot->hue;
+    }
+
+#if PATTERN_BENCHMARK
+    benchmarkPatterns();
+#endif
+
+    // light the strip right away instead of waiting for the first timer tick,
+    // a replay takes this frame from the log like every other one
+    if (!APP_RECORD::isReplaying())
+    {
+        renderFrame();
+    }
+    led_timer.start();
 }
 
 void APP_LED::process()
 {
-    if (led_timer.expired())
+    APP_MEMORY::Scope memory(APP_MEMORY::MODULE_LED);
+    // when replaying, frames are rendered exactly when they were in the recording,
+    // while idle the strip keeps showing the last (identical) frame
+    if (APP_RECORD::isReplaying() ? APP_RECORD::frameDue() : (led_timer.expired() && !APP_IDLE::isIdle()))
     {
         // printf("LED timer expired\n");
-        gPatterns[gCurrentPattern]();
-        FastLED.show(); //updates fastled interal clock
+        renderFrame();
     }
 
-    EVERY_N_MILLISECONDS(20) 
+    EVERY_N_MILLISECONDS(HUE_STEP_MS) 
     { 
         gHue++; 
     }
 
+    if (power_report_timer.expired())
+    {
+        reportPower();
+    }
+
     // EVERY_N_SECONDS(10) 
     // { 
     //     nextPattern(); 
@@ -294,13 +1069,139 @@ void APP_LED::setSolidColor(uint8_t r, uint8_t g, uint8_t b)
     gSolidColor = CRGB(r, g, b);
 }
 
-// Called from BLE Animation characteristic (1 byte: 0-12)
+// Called from BLE Animation characteristic (1 byte: 0-15, or USER_PATTERN_BASE + slot)
 void APP_LED::setAnimation(uint8_t animId)
 {
+    if (isUserPattern(animId))
+    {
+        if (APP_PATTERN::isLoaded(animId - USER_PATTERN_BASE))
+        {
+            gCurrentPattern = animId;
+            return;
+        }
+        animId = 0; // empty slot, fallback to Solid Color
+    }
+
     if (animId >= NUM_PATTERNS)
     {
         animId = 0; // fallback to Solid Color
     }
 
     gCurrentPattern = animId;
-}
\ No newline at end of file
+}
+
+void APP_LED::setBrightness(uint8_t brightness)
+{
+    gBrightness = brightness; // applied (and power limited) with the next frame
+}
+
+void APP_LED::setPowerBudget(uint16_t milliamps)
+{
+    if (milliamps == 0)
+    {
+        milliamps = POWER_BUDGET_MA;
+    }
+    else if (milliamps < MIN_POWER_BUDGET_MA)
+    {
+        milliamps = MIN_POWER_BUDGET_MA;
+    }
+    gPowerBudget = milliamps; // read once per frame by the render loop
+}
+
+uint16_t APP_LED::getPowerBudget()
+{
+    return gPowerBudget;
+}
+
+// Freezes the current output and blends from it to whatever is selected next
+void APP_LED::startCrossfade(uint16_t durationMs)
+{
+    memcpy(fadeFrom, frame, sizeof(fadeFrom));
+    gFadeFromBrightness = gFrameBrightness;
+    gFadeStart = APP_RECORD::now();
+    gFadeDuration = durationMs;
+}
+
+void APP_LED::getSolidColor(uint8_t& r, uint8_t& g, uint8_t& b)
+{
+    r = gSolidColor.r;
+    g = gSolidColor.g;
+    b = gSolidColor.b;
+}
+
+bool APP_LED::isStatic()
+{
+    return gCurrentPattern == 0 && gFadeDuration == 0;
+}
+
+uint8_t APP_LED::getAnimation()
+{
+    return gCurrentPattern;
+}
+
+uint8_t APP_LED::getBrightness()
+{
+    return gBrightness;
+}
+
+uint8_t APP_LED::getHue()
+{
+    return gHue;
+}
+
+uint8_t APP_LED::patternCount()
+{
+    return NUM_PATTERNS;
+}
+
+bool APP_LED::isDeterministic(uint8_t animId)
+{
+    return gPatterns[animId] != audioSpectrum; // follows the microphone
+}
+
+void APP_LED::beginReference(uint8_t animId, uint16_t seed)
+{
+    gSavedPattern = gCurrentPattern;
+    gSavedHue = gHue;
+    gSavedSolidColor = gSolidColor;
+    gSavedCylonPos = gCylonPos;
+    gSavedCylonDir = gCylonDir;
+    gSavedNoiseTime = gNoiseTime;
+    gSavedSeed = random16_get_seed();
+
+    // same starting point every time: empty strip, fresh pattern state, fixed colour and seed
+    leds = gReferenceLeds;
+    gCurrentPattern = animId;
+    gSolidColor = CRGB::White;
+    fill_solid(leds, NUM_LEDS, CRGB::Black);
+    gCylonPos = 0;
+    gCylonDir = 1;
+    gNoiseTime = 0;
+    random16_set_seed(seed);
+    enterPattern();
+}
+
+const uint8_t* APP_LED::renderReference(uint16_t frame)
+{
+    const uint32_t time = static_cast<uint32_t>(frame) * FRAME_DELAY_MS;
+
+    APP_RECORD::pinClock(time);
+    gHue = static_cast<uint8_t>(time / HUE_STEP_MS);
+    drawPattern(); // the pattern alone, a running pixel stream is not part of the reference
+    APP_RECORD::unpinClock();
+
+    return reinterpret_cast<const uint8_t*>(leds);
+}
+
+void APP_LED::endReference()
+{
+    leds = gLiveLeds;
+    gCurrentPattern = gSavedPattern;
+    gHue = gSavedHue;
+    gSolidColor = gSavedSolidColor;
+    gCylonPos = gSavedCylonPos;
+    gCylonDir = gSavedCylonDir;
+    gNoiseTime = gSavedNoiseTime;
+    random16_set_seed(gSavedSeed);
+    gRenderedPattern = 0xFF; // arena and particles were reused, the live pattern starts those over
+}
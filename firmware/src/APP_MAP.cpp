@@ -0,0 +1,94 @@
+/*
+ * File:        APP_MAP.cpp
+ * Author:      Marcus Lechner
+ * Created:     2025-07-26
+ * Description: Builds the pixel coordinate tables and evaluates spatial fields
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#include "APP_MAP.hpp"
+#include <FastLED.h>
+
+namespace
+{
+    constexpr uint8_t CENTER = 128;
+
+    APP_MAP::Map gMap;
+
+    // Position along the strip, first pixel 0, last pixel 255
+    uint8_t alongStrip(uint8_t i)
+    {
+        return static_cast<uint8_t>((static_cast<uint16_t>(i) * 255) / (APP_MAP::NUM_PIXELS - 1));
+    }
+
+    // Patterns read height (z), angle or x depending on what they draw. On a
+    // straight strip all three run along it, so each one sweeps end to end.
+    void buildLine()
+    {
+        for (uint8_t i = 0; i < APP_MAP::NUM_PIXELS; ++i)
+        {
+            const uint8_t along = alongStrip(i);
+            gMap.x[i] = along;
+            gMap.y[i] = CENTER;
+            gMap.z[i] = along;
+            gMap.angle[i] = along;
+        }
+    }
+
+    void buildHelix()
+    {
+        for (uint8_t i = 0; i < APP_MAP::NUM_PIXELS; ++i)
+        {
+            const uint8_t angle = static_cast<uint8_t>((static_cast<uint16_t>(i) * 256) / APP_MAP::LEDS_PER_TURN);
+            gMap.angle[i] = angle;
+            gMap.x[i] = cos8(angle);
+            gMap.y[i] = sin8(angle);
+            gMap.z[i] = alongStrip(i); // the helix climbs evenly, one pitch per turn
+        }
+    }
+}
+
+void APP_MAP::init()
+{
+    static_assert(NUM_PIXELS > 1, "a map needs at least two pixels");
+    static_assert(LEDS_PER_TURN > 0, "LEDS_PER_TURN must not be 0");
+
+    if (GEOMETRY == GEOMETRY_HELIX)
+    {
+        buildHelix();
+    }
+    else
+    {
+        buildLine();
+    }
+}
+
+const APP_MAP::Map& APP_MAP::get()
+{
+    return gMap;
+}
+
+void APP_MAP::linearField(uint8_t* out, int8_t kx, int8_t ky, int8_t kz, uint8_t phase)
+{
+    for (uint8_t i = 0; i < NUM_PIXELS; ++i)
+    {
+        const int16_t dx = static_cast<int16_t>(gMap.x[i]) - CENTER;
+        const int16_t dy = static_cast<int16_t>(gMap.y[i]) - CENTER;
+        const int16_t dz = static_cast<int16_t>(gMap.z[i]) - CENTER;
+        const int32_t along = dx * kx + dy * ky + dz * kz;
+        out[i] = static_cast<uint8_t>(phase + (along >> 6));
+    }
+}
+
+void APP_MAP::radialField(uint8_t* out, uint8_t cx, uint8_t cy, uint8_t cz, uint8_t scale, uint8_t phase)
+{
+    for (uint8_t i = 0; i < NUM_PIXELS; ++i)
+    {
+        // halved so the squared sum of all three axes still fits sqrt16()
+        const int16_t dx = (static_cast<int16_t>(gMap.x[i]) - cx) / 2;
+        const int16_t dy = (static_cast<int16_t>(gMap.y[i]) - cy) / 2;
+        const int16_t dz = (static_cast<int16_t>(gMap.z[i]) - cz) / 2;
+        const uint16_t distance = sqrt16(static_cast<uint16_t>(dx * dx + dy * dy + dz * dz)) * 2;
+        out[i] = static_cast<uint8_t>(phase + ((static_cast<uint32_t>(distance) * scale) >> 6));
+    }
+}
@@ -0,0 +1,319 @@
+/*
+ * File:        APP_MEMORY.cpp
+ * Author:      Marcus Lechner
+ * Created:     2025-08-31
+ * Description: Heap accounting per module, steady-state allocation audit and task stack watermarks
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#include "APP_MEMORY.hpp"
+#include "APP_BOOT.hpp"
+#include "APP_TIMER.hpp"
+#include <Arduino.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+
+#define MEMORY_AUDIT 0  // Set to 1 to abort on the first allocation in steady state
+
+namespace
+{
+    // Put in front of every block so delete knows what to give back. 8 bytes
+    // keep the block as aligned as malloc() made it.
+    struct Header
+    {
+        uint32_t size;
+        uint8_t module;
+        uint8_t reserved[3];
+    };
+
+    static_assert(sizeof(Header) == 8, "allocation header must keep 8 byte alignment");
+
+    struct Usage
+    {
+        uint32_t live;    // bytes
+        uint32_t peak;    // bytes
+        uint32_t allocs;  // since boot
+        uint32_t steady;  // since steady state
+    };
+
+    const char* const MODULE_NAMES[APP_MEMORY::NUM_MODULES] =
+    {
+        "other", "ble", "led", "settings", "scene", "audio", "ota", "net"
+    };
+
+    constexpr uint8_t MAX_TASKS = 8;
+
+    struct WatchedTask
+    {
+        TaskHandle_t handle;
+        const char* name;
+    };
+
+    // Written from any task inside operator new/delete
+    portMUX_TYPE gLock = portMUX_INITIALIZER_UNLOCKED;
+    Usage gUsage[APP_MEMORY::NUM_MODULES];
+    bool gSteady = false;
+    uint32_t gSteadyBytes = 0;
+    bool gHaveFirst = false;
+    uint8_t gFirstModule = 0;
+    uint32_t gFirstSize = 0;
+    void* gFirstCaller = nullptr;
+    bool gFirstReported = false;
+
+    __thread uint8_t tModule = APP_MEMORY::MODULE_OTHER; // per task
+
+    WatchedTask gTasks[MAX_TASKS];
+    uint8_t gTaskCount = 0;
+
+    uint32_t gSteadyAtMs = 0;
+    Timer report_timer(APP_MEMORY::REPORT_MS, true);
+
+    void* allocate(size_t size, void* caller)
+    {
+        Header* header = static_cast<Header*>(malloc(sizeof(Header) + size));
+        if (header == nullptr)
+        {
+            return nullptr;
+        }
+
+        const uint8_t module = tModule;
+        header->size = size;
+        header->module = module;
+
+        portENTER_CRITICAL(&gLock);
+        Usage& u = gUsage[module];
+        u.live += size;
+        u.allocs++;
+        if (u.live > u.peak)
+        {
+            u.peak = u.live;
+        }
+        if (gSteady)
+        {
+            if (!gHaveFirst)
+            {
+                gHaveFirst = true;
+                gFirstModule = module;
+                gFirstSize = size;
+                gFirstCaller = caller;
+            }
+            u.steady++;
+            gSteadyBytes += size;
+        }
+        portEXIT_CRITICAL(&gLock);
+
+#if MEMORY_AUDIT
+        if (gSteady)
+        {
+            abort(); // the backtrace leads to the allocation
+        }
+#endif
+
+        return header + 1;
+    }
+
+    void release(void* ptr)
+    {
+        if (ptr == nullptr)
+        {
+            return;
+        }
+
+        Header* header = static_cast<Header*>(ptr) - 1;
+
+        portENTER_CRITICAL(&gLock);
+        gUsage[header->module].live -= header->size;
+        portEXIT_CRITICAL(&gLock);
+
+        free(header);
+    }
+
+    void* allocateOrThrow(size_t size, void* caller)
+    {
+        void* ptr = allocate(size, caller);
+        if (ptr == nullptr)
+        {
+#if __cpp_exceptions
+            throw std::bad_alloc();
+#else
+            abort();
+#endif
+        }
+        return ptr;
+    }
+
+    void printFirstSteadyAllocation()
+    {
+        Serial.printf("[MEM] Allocation in steady state: %lu bytes by %s, called from %p\n",
+                      static_cast<unsigned long>(gFirstSize), MODULE_NAMES[gFirstModule], gFirstCaller);
+    }
+}
+
+// Replacements for the global allocation functions, every new and delete in
+// the firmware and its libraries ends up here
+void* operator new(size_t size)
+{
+    return allocateOrThrow(size, __builtin_return_address(0));
+}
+
+void* operator new[](size_t size)
+{
+    return allocateOrThrow(size, __builtin_return_address(0));
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    return allocate(size, __builtin_return_address(0));
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    return allocate(size, __builtin_return_address(0));
+}
+
+void operator delete(void* ptr) noexcept
+{
+    release(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    release(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    release(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept
+{
+    release(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept
+{
+    release(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept
+{
+    release(ptr);
+}
+
+APP_MEMORY::Scope::Scope(Module module) : _previous(tModule)
+{
+    tModule = module;
+}
+
+APP_MEMORY::Scope::~Scope()
+{
+    tModule = _previous;
+}
+
+void APP_MEMORY::init()
+{
+    watchTask(xTaskGetCurrentTaskHandle(), "loop"); // setup() and loop() share the Arduino task
+}
+
+void APP_MEMORY::process()
+{
+    if (!gSteady && APP_BOOT::isComplete())
+    {
+        if (gSteadyAtMs == 0)
+        {
+            gSteadyAtMs = millis() + STEADY_AFTER_MS;
+        }
+        else if (static_cast<int32_t>(millis() - gSteadyAtMs) >= 0)
+        {
+            gSteady = true;
+            Serial.printf("[MEM] Steady state, %lu bytes heap free, counting allocations from here\n",
+                          static_cast<unsigned long>(ESP.getFreeHeap()));
+        }
+    }
+
+    if (gHaveFirst && !gFirstReported)
+    {
+        gFirstReported = true;
+        printFirstSteadyAllocation();
+    }
+
+    if (report_timer.expired())
+    {
+        report();
+    }
+}
+
+bool APP_MEMORY::isSteady()
+{
+    return gSteady;
+}
+
+uint32_t APP_MEMORY::steadyAllocations()
+{
+    uint32_t count = 0;
+
+    portENTER_CRITICAL(&gLock);
+    for (uint8_t m = 0; m < NUM_MODULES; ++m)
+    {
+        count += gUsage[m].steady;
+    }
+    portEXIT_CRITICAL(&gLock);
+
+    return count;
+}
+
+void APP_MEMORY::watchTask(TaskHandle_t task, const char* name)
+{
+    if (task != nullptr && gTaskCount < MAX_TASKS)
+    {
+        gTasks[gTaskCount].handle = task;
+        gTasks[gTaskCount].name = name;
+        gTaskCount++;
+    }
+}
+
+void APP_MEMORY::report()
+{
+    Usage usage[NUM_MODULES];
+    uint32_t steadyBytes;
+    bool haveFirst;
+
+    // Copied out first, printing allocates for long lines
+    portENTER_CRITICAL(&gLock);
+    memcpy(usage, gUsage, sizeof(usage));
+    steadyBytes = gSteadyBytes;
+    haveFirst = gHaveFirst;
+    portEXIT_CRITICAL(&gLock);
+
+    Serial.printf("[MEM] Heap %lu free, %lu lowest, %lu largest block\n",
+                  static_cast<unsigned long>(ESP.getFreeHeap()),
+                  static_cast<unsigned long>(ESP.getMinFreeHeap()),
+                  static_cast<unsigned long>(ESP.getMaxAllocHeap()));
+
+    for (uint8_t m = 0; m < NUM_MODULES; ++m)
+    {
+        if (usage[m].allocs > 0)
+        {
+            Serial.printf("[MEM] %-8s %6lu live %6lu peak %5lu allocs %lu in steady state\n", MODULE_NAMES[m],
+                          static_cast<unsigned long>(usage[m].live), static_cast<unsigned long>(usage[m].peak),
+                          static_cast<unsigned long>(usage[m].allocs), static_cast<unsigned long>(usage[m].steady));
+        }
+    }
+
+    if (gSteady)
+    {
+        Serial.printf("[MEM] %lu bytes allocated in steady state\n", static_cast<unsigned long>(steadyBytes));
+        if (haveFirst)
+        {
+            printFirstSteadyAllocation();
+        }
+    }
+
+    for (uint8_t t = 0; t < gTaskCount; ++t)
+    {
+        Serial.printf("[MEM] Stack %-8s %5u bytes never used\n", gTasks[t].name,
+                      static_cast<unsigned>(uxTaskGetStackHighWaterMark(gTasks[t].handle)));
+    }
+}
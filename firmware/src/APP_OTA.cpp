@@ -0,0 +1,172 @@
+/*
+ * File:        APP_OTA.cpp
+ * Author:      Marcus Lechner
+ * Created:     2025-08-25
+ * Description: Firmware updates over BLE into the inactive OTA slot with rollback
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#include "APP_OTA.hpp"
+#include "APP_OTA_SESSION.hpp"
+#include "APP_MEMORY.hpp"
+#include "APP_BOOT.hpp"
+#include <Arduino.h>
+#include <esp_ota_ops.h>
+#include <esp_system.h>
+#include <mbedtls/sha256.h>
+
+// Arduino marks a freshly booted image valid before setup() unless this says
+// otherwise. APP_OTA::process() decides instead, once the loop proved healthy.
+extern "C" bool verifyRollbackLater()
+{
+    return true;
+}
+
+namespace
+{
+    // The inactive app slot through esp_ota_*
+    class SlotFlash
+    {
+    public:
+        uint32_t capacity()
+        {
+            _partition = esp_ota_get_next_update_partition(nullptr);
+            return _partition ? _partition->size : 0;
+        }
+
+        // Sequential writes erase sector by sector as data arrives, instead of
+        // blocking the BLE task for seconds to erase the whole slot up front
+        bool begin()
+        {
+            return esp_ota_begin(_partition, OTA_WITH_SEQUENTIAL_WRITES, &_handle) == ESP_OK;
+        }
+
+        bool write(const uint8_t* data, size_t length)
+        {
+            return esp_ota_write(_handle, data, length) == ESP_OK;
+        }
+
+        bool end()
+        {
+            return esp_ota_end(_handle) == ESP_OK && esp_ota_set_boot_partition(_partition) == ESP_OK;
+        }
+
+        void abort()
+        {
+            esp_ota_abort(_handle);
+        }
+
+        const char* label()
+        {
+            return _partition ? _partition->label : "none";
+        }
+
+    private:
+        const esp_partition_t* _partition = nullptr;
+        esp_ota_handle_t _handle = 0;
+    };
+
+    class Sha256
+    {
+    public:
+        void begin()
+        {
+            mbedtls_sha256_init(&_sha);
+            mbedtls_sha256_starts_ret(&_sha, 0);
+        }
+
+        void update(const uint8_t* data, size_t length)
+        {
+            mbedtls_sha256_update_ret(&_sha, data, length);
+        }
+
+        void finish(uint8_t* hash)
+        {
+            mbedtls_sha256_finish_ret(&_sha, hash);
+        }
+
+        void discard()
+        {
+            mbedtls_sha256_free(&_sha);
+        }
+
+    private:
+        mbedtls_sha256_context _sha;
+    };
+
+    SlotFlash gFlash;
+    Sha256 gSha;
+    APP_OTA_SESSION::Session<SlotFlash, Sha256> gSession(gFlash, gSha);
+
+    volatile uint32_t gRestartAtMs = 0;
+    constexpr uint32_t RESTART_DELAY_MS = 500;
+
+    bool gPendingVerify = false; // this boot is an update that has not proven itself yet
+    uint32_t gHealthySinceMs = 0;
+}
+
+void APP_OTA::init()
+{
+    const esp_partition_t* running = esp_ota_get_running_partition();
+    esp_ota_img_states_t state;
+
+    gPendingVerify = esp_ota_get_state_partition(running, &state) == ESP_OK && state == ESP_OTA_IMG_PENDING_VERIFY;
+
+    if (gPendingVerify)
+    {
+        Serial.printf("[OTA] Running new image from %s, waiting for a healthy loop\n", running->label);
+    }
+}
+
+void APP_OTA::process()
+{
+    // END is answered from the BLE task, the restart waits until the reply has gone out
+    if (gRestartAtMs && static_cast<int32_t>(millis() - gRestartAtMs) >= 0)
+    {
+        Serial.flush();
+        esp_restart();
+    }
+
+    if (!gPendingVerify)
+    {
+        return;
+    }
+
+    if (!APP_BOOT::isComplete())
+    {
+        if (millis() > BOOT_DEADLINE_MS)
+        {
+            Serial.println("[OTA] New image never finished booting, rolling back");
+            esp_ota_mark_app_invalid_rollback_and_reboot();
+        }
+        return;
+    }
+
+    if (gHealthySinceMs == 0)
+    {
+        gHealthySinceMs = millis();
+    }
+    else if (millis() - gHealthySinceMs >= HEALTHY_MS)
+    {
+        esp_ota_mark_app_valid_cancel_rollback();
+        gPendingVerify = false;
+        Serial.println("[OTA] New image confirmed");
+    }
+}
+
+size_t APP_OTA::handle(const uint8_t* data, size_t length, uint8_t* out)
+{
+    APP_MEMORY::Scope memory(APP_MEMORY::MODULE_OTA);
+    const size_t replyLength = gSession.handle(data, length, out, millis());
+
+    if (gSession.isDone() && gRestartAtMs == 0)
+    {
+        gRestartAtMs = (millis() + RESTART_DELAY_MS) | 1; // 0 means no restart pending
+    }
+    return replyLength;
+}
+
+bool APP_OTA::isUpdating()
+{
+    return gSession.isOpen();
+}
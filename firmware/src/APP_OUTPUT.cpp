@@ -0,0 +1,240 @@
+/*
+ * File:        APP_OUTPUT.cpp
+ * Author:      Marcus Lechner
+ * Created:     2025-09-13
+ * Description: Converts the rendered frame to the fixture's pixel format and sends it to the strip
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#include "APP_OUTPUT.hpp"
+#include "APP_WIRE.hpp"
+#include <Arduino.h>
+#include <SPI.h>
+#include <driver/rmt.h>
+#include <string.h>
+
+#define WIRE_BENCHMARK 0  // Set to 1 to check and time the symbol encoder at boot
+
+namespace
+{
+    using APP_LED::NUM_LEDS;
+    using APP_OUTPUT::FORMAT;
+
+    constexpr bool ONE_WIRE = FORMAT == APP_OUTPUT::FORMAT_GRB || FORMAT == APP_OUTPUT::FORMAT_RGBW;
+
+    constexpr rmt_channel_t RMT_CHANNEL = RMT_CHANNEL_0;
+    constexpr APP_WIRE::BitTiming TIMING = FORMAT == APP_OUTPUT::FORMAT_RGBW ? APP_WIRE::SK6812_TIMING
+                                                                            : APP_WIRE::WS2812_TIMING;
+
+    alignas(4) uint8_t gTx[APP_OUTPUT::frameBytes(FORMAT, NUM_LEDS)];
+    bool gSending = false;
+
+    // Symbols for the whole frame, the RMT driver feeds them to the peripheral
+    // from this buffer while the frame goes out
+    APP_WIRE::Encoder<ONE_WIRE ? sizeof(gTx) : 1> gWire(TIMING);
+
+    inline uint8_t scale(uint8_t c, uint16_t scale)
+    {
+        return static_cast<uint8_t>((c * scale) >> 8);
+    }
+
+    void initRmt()
+    {
+        rmt_config_t config = RMT_DEFAULT_CONFIG_TX(static_cast<gpio_num_t>(APP_OUTPUT::DATA_PIN), RMT_CHANNEL);
+        config.clk_div = APP_WIRE::RMT_CLK_DIV;
+        rmt_config(&config);
+        rmt_driver_install(RMT_CHANNEL, 0, 0);
+    }
+
+#if WIRE_BENCHMARK
+    constexpr uint16_t BENCH_FRAMES = 2000;
+
+    // Table encoder against the bit-by-bit reference on pseudo random frames,
+    // every symbol has to match before the timing means anything
+    void benchmarkWire()
+    {
+        static uint32_t reference[sizeof(gTx) * APP_WIRE::SYMBOLS_PER_BYTE];
+        uint32_t seed = 1;
+        uint16_t mismatches = 0;
+
+        unsigned long tableTime = 0;
+        unsigned long referenceTime = 0;
+
+        for (uint16_t f = 0; f < BENCH_FRAMES; ++f)
+        {
+            for (size_t i = 0; i < sizeof(gTx); ++i)
+            {
+                seed = seed * 1664525UL + 1013904223UL;
+                gTx[i] = static_cast<uint8_t>(seed >> 24);
+            }
+
+            unsigned long start = micros();
+            const size_t count = gWire.encode(gTx, sizeof(gTx));
+            tableTime += micros() - start;
+
+            start = micros();
+            APP_WIRE::encodeReference(TIMING, gTx, sizeof(gTx), reference);
+            referenceTime += micros() - start;
+
+            if (memcmp(gWire.symbols(), reference, count * sizeof(uint32_t)) != 0)
+            {
+                mismatches++;
+            }
+        }
+
+        const float pixels = static_cast<float>(BENCH_FRAMES) * NUM_LEDS;
+        Serial.printf("[OUT] bench wire  reference %6.1f ns/px  table %6.1f ns/px  ratio %.2fx  %u/%u frames differ\n",
+                      referenceTime * 1000.0f / pixels,
+                      tableTime * 1000.0f / pixels,
+                      static_cast<float>(tableTime) / referenceTime,
+                      mismatches, BENCH_FRAMES);
+    }
+#endif
+
+    // The conversion loops, brightness is folded into a per-frame factor first
+
+    size_t encodeGrb(const uint8_t* rgb, uint16_t count, uint8_t brightness, uint8_t* out)
+    {
+        const uint16_t s = brightness + 1;
+        uint8_t* o = out;
+
+        for (uint16_t i = 0; i < count; ++i, rgb += 3)
+        {
+            *o++ = scale(rgb[1], s);
+            *o++ = scale(rgb[0], s);
+            *o++ = scale(rgb[2], s);
+        }
+        return o - out;
+    }
+
+    size_t encodeRgbw(const uint8_t* rgb, uint16_t count, uint8_t brightness, uint8_t* out)
+    {
+        const uint16_t s = brightness + 1;
+        uint8_t* o = out;
+
+        for (uint16_t i = 0; i < count; ++i, rgb += 3)
+        {
+            uint8_t w = rgb[0];
+            if (rgb[1] < w) w = rgb[1];
+            if (rgb[2] < w) w = rgb[2];
+
+            *o++ = scale(rgb[1] - w, s);
+            *o++ = scale(rgb[0] - w, s);
+            *o++ = scale(rgb[2] - w, s);
+            *o++ = scale(w, s);
+        }
+        return o - out;
+    }
+
+    size_t encodeApa102(const uint8_t* rgb, uint16_t count, uint8_t brightness, uint8_t* out)
+    {
+        // Lowest current that still reaches the brightness, the colour makes up the rest
+        const uint8_t current = static_cast<uint8_t>((brightness * 31U + 254) / 255);
+        const uint16_t s = current ? static_cast<uint16_t>((brightness * 31U * 256) / (current * 255U)) : 0;
+        const uint8_t header = 0xE0 | current;
+        uint8_t* o = out;
+
+        for (size_t i = 0; i < APP_OUTPUT::startBytes(APP_OUTPUT::FORMAT_APA102); ++i)
+        {
+            *o++ = 0;
+        }
+        for (uint16_t i = 0; i < count; ++i, rgb += 3)
+        {
+            *o++ = header;
+            *o++ = scale(rgb[2], s);
+            *o++ = scale(rgb[1], s);
+            *o++ = scale(rgb[0], s);
+        }
+        for (size_t i = 0; i < APP_OUTPUT::endBytes(APP_OUTPUT::FORMAT_APA102, count); ++i)
+        {
+            *o++ = 0;
+        }
+        return o - out;
+    }
+
+    size_t encodeHd108(const uint8_t* rgb, uint16_t count, uint8_t brightness, uint8_t* out)
+    {
+        // Start bit and all three 5 bit gains at 31, the colour carries the brightness
+        constexpr uint8_t HEADER = 0xFF;
+        const uint32_t s = brightness * 257U + 1; // 8 x 8 bits stretched to the full 16 bits
+        uint8_t* o = out;
+
+        for (size_t i = 0; i < APP_OUTPUT::startBytes(APP_OUTPUT::FORMAT_HD108); ++i)
+        {
+            *o++ = 0;
+        }
+        for (uint16_t i = 0; i < count; ++i, rgb += 3)
+        {
+            *o++ = HEADER;
+            *o++ = HEADER;
+            for (uint8_t ch = 0; ch < 3; ++ch)
+            {
+                const uint16_t v = static_cast<uint16_t>((rgb[ch] * 257U * s) >> 16);
+                *o++ = static_cast<uint8_t>(v >> 8);
+                *o++ = static_cast<uint8_t>(v);
+            }
+        }
+        for (size_t i = 0; i < APP_OUTPUT::endBytes(APP_OUTPUT::FORMAT_HD108, count); ++i)
+        {
+            *o++ = 0;
+        }
+        return o - out;
+    }
+}
+
+void APP_OUTPUT::init()
+{
+    if (ONE_WIRE)
+    {
+        initRmt();
+    }
+    else
+    {
+        SPI.begin(CLOCK_PIN, -1, DATA_PIN, -1);
+    }
+
+    Serial.printf("[OUT] Format %u on pin %u, %u bytes per frame\n",
+                  FORMAT, DATA_PIN, static_cast<unsigned>(sizeof(gTx)));
+
+#if WIRE_BENCHMARK
+    if (ONE_WIRE)
+    {
+        benchmarkWire();
+    }
+#endif
+}
+
+size_t APP_OUTPUT::encode(PixelFormat format, const uint8_t* rgb, uint16_t count, uint8_t brightness, uint8_t* out)
+{
+    switch (format)
+    {
+        case FORMAT_GRB:    return encodeGrb(rgb, count, brightness, out);
+        case FORMAT_RGBW:   return encodeRgbw(rgb, count, brightness, out);
+        case FORMAT_APA102: return encodeApa102(rgb, count, brightness, out);
+        case FORMAT_HD108:  return encodeHd108(rgb, count, brightness, out);
+        default:            return 0;
+    }
+}
+
+void APP_OUTPUT::show(const uint8_t* rgb, uint8_t brightness)
+{
+    if (ONE_WIRE)
+    {
+        if (gSending)
+        {
+            rmt_wait_tx_done(RMT_CHANNEL, portMAX_DELAY); // a frame at 120 FPS is long gone by now
+        }
+
+        const size_t length = encode(FORMAT, rgb, NUM_LEDS, brightness, gTx);
+        const size_t symbols = gWire.encode(gTx, length);
+        rmt_write_items(RMT_CHANNEL, reinterpret_cast<const rmt_item32_t*>(gWire.symbols()), symbols, false);
+        gSending = true;
+    }
+    else
+    {
+        const size_t length = encode(FORMAT, rgb, NUM_LEDS, brightness, gTx);
+        SPI.beginTransaction(SPISettings(SPI_HZ, MSBFIRST, SPI_MODE0));
+        SPI.writeBytes(gTx, length);
+        SPI.endTransaction();
+    }
+}
@@ -0,0 +1,757 @@
+/*
+ * File:        APP_PATTERN.cpp
+ * Author:      Marcus Lechner
+ * Created:     2025-06-14
+ * Description: Loader/validator and allocation-free interpreter for bytecode patterns
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#include "APP_PATTERN.hpp"
+#include "APP_AUDIO.hpp"
+#include <Arduino.h>
+#include <string.h>
+
+namespace
+{
+    constexpr uint8_t HEADER_SIZE = 5;
+
+    const TProgmemRGBPalette16* const PALETTES[APP_PATTERN::NUM_PALETTES] =
+    {
+        &RainbowColors_p,
+        &PartyColors_p,
+        &OceanColors_p,
+        &ForestColors_p,
+        &LavaColors_p,
+        &CloudColors_p,
+        &HeatColors_p
+    };
+
+    constexpr uint8_t MAX_CODE = APP_PATTERN::MAX_PROGRAM_SIZE - HEADER_SIZE;
+    constexpr uint8_t BLOCK = 32;   // pixels each instruction runs over per dispatch
+
+    // The uploaded code is compiled into this form when a slot is taken over.
+    // Everything that does not depend on the pixel (K, T, P, B and whatever is
+    // computed from those alone) moves into registers worked out once per
+    // frame, and the common shapes left are fused into one instruction each,
+    // so colorWaves runs 5 dispatches per pixel instead of 19.
+    enum Instruction : uint8_t
+    {
+        X_R,                // r        push register r
+        X_I,                //          push pixel index
+        X_I_MUL_R,          // r        push i * register r
+        X_AFFINE,           // ra rb    push i * register ra + register rb
+        X_AFFINE_SIN,       // ra rb    push sin8(i * register ra + register rb)
+        X_RND,
+        X_DUP,
+
+        X_ADD, X_SUB, X_MUL, X_SCALE, X_QADD, X_QSUB, X_NOISE, X_MAX,                    // a op b, same order as OP_ADD..OP_MAX
+        X_ADD_R, X_SUB_R, X_MUL_R, X_SCALE_R, X_QADD_R, X_QSUB_R, X_NOISE_R, X_MAX_R,    // r     a op register r
+        X_RSUB_R,           // r        register r - a
+        X_ADD_R_SIN,        // r        sin8(a + register r)
+
+        X_SIN, X_COS, X_TRI, X_QUAD, X_INV, X_BAND,     // same order as OP_SIN..OP_BAND
+
+        X_PAL,
+        X_PAL_R,            // r        ColorFromPalette(index, register r)
+        X_HSV,
+        X_HSV_RR,           // rs rv    CHSV(h, register rs, register rv)
+        X_RGB
+    };
+
+    // One register computed per frame: dst = op(register a, register b), with
+    // op a source opcode. For OP_K a is the constant itself.
+    struct FrameOp
+    {
+        uint8_t op;
+        uint8_t dst;
+        uint8_t a;
+        uint8_t b;
+    };
+
+    struct Slot
+    {
+        bool loaded;
+        bool additive;
+        uint8_t fade;
+        uint8_t phaseStep;
+        uint8_t bpm;
+        uint8_t phase;
+        CRGBPalette16 palette;  // expanded once at load time, not every frame
+        uint8_t frameOps;
+        uint8_t pixelLength;
+        uint8_t randoms;                    // OP_RND in the code
+        FrameOp frame[MAX_CODE];            // at most one register per source opcode
+        uint8_t pixel[2 * MAX_CODE];        // a one byte opcode becomes at most X_R r
+    };
+
+    Slot gSlots[APP_PATTERN::NUM_SLOTS]; // render loop only
+
+    // Uploads arrive on the BLE task while the render loop interprets the
+    // slot. They are posted here and taken over by render() at the start of a
+    // frame, so the code and palette never change under the interpreter.
+    enum PendingState : uint8_t
+    {
+        PENDING_NONE = 0,
+        PENDING_LOAD,
+        PENDING_CLEAR
+    };
+
+    struct Pending
+    {
+        PendingState state;
+        uint8_t paletteId;
+        uint8_t fade;
+        uint8_t phaseStep;
+        uint8_t bpm;
+        uint8_t codeLength;
+        uint8_t code[MAX_CODE];
+    };
+
+    Pending gPending[APP_PATTERN::NUM_SLOTS];
+    portMUX_TYPE gLock = portMUX_INITIALIZER_UNLOCKED;
+
+    // A value on the compile-time stack: a register, or the instructions from
+    // start on that leave it on the pixel stack, last being its final one
+    struct Value
+    {
+        bool invariant;
+        uint8_t reg;
+        uint8_t start;
+        uint8_t last;
+    };
+
+    bool isCommutative(uint8_t op)
+    {
+        using namespace APP_PATTERN;
+        return op == OP_ADD || op == OP_MUL || op == OP_QADD || op == OP_MAX;
+    }
+
+    // Translates validated code into s.frame and s.pixel. An invariant value is
+    // always exactly "X_R reg" at the end of the pixel code while it is on top,
+    // so folding and fusing only ever rewrite the tail.
+    void compile(Slot& s, const uint8_t* code, uint8_t length)
+    {
+        using namespace APP_PATTERN;
+
+        Value stack[MAX_STACK];
+        uint8_t depth = 0;
+        uint8_t regs = 0;
+        uint8_t n = 0;
+        uint8_t* const px = s.pixel;
+
+        s.frameOps = 0;
+        s.randoms = 0;
+
+        auto pushRegister = [&](uint8_t op, uint8_t a, uint8_t b, uint8_t start)
+        {
+            const uint8_t reg = regs++;
+            s.frame[s.frameOps++] = { op, reg, a, b };
+            n = start;
+            px[n++] = X_R;
+            px[n++] = reg;
+            stack[depth++] = { true, reg, start, start };
+        };
+
+        for (uint8_t pc = 0; pc < length; ++pc)
+        {
+            const uint8_t op = code[pc];
+
+            if (op == OP_K || op == OP_T || op == OP_P || op == OP_B)
+            {
+                pushRegister(op, op == OP_K ? code[++pc] : 0, 0, n);
+            }
+            else if (op == OP_I || op == OP_RND)
+            {
+                s.randoms += (op == OP_RND);
+                px[n] = (op == OP_I) ? X_I : X_RND;
+                stack[depth++] = { false, 0, n, n };
+                n++;
+            }
+            else if (op == OP_DUP)
+            {
+                const Value top = stack[depth - 1];
+                if (top.invariant)
+                {
+                    px[n++] = X_R;
+                    px[n++] = top.reg;
+                    stack[depth++] = { true, top.reg, static_cast<uint8_t>(n - 2), static_cast<uint8_t>(n - 2) };
+                }
+                else
+                {
+                    px[n] = X_DUP;
+                    stack[depth++] = { false, 0, n, n };
+                    n++;
+                }
+            }
+            else if (op >= OP_ADD && op <= OP_MAX)
+            {
+                Value b = stack[--depth];
+                const Value a = stack[--depth];
+                const uint8_t k = op - OP_ADD;
+
+                if (a.invariant && b.invariant)
+                {
+                    pushRegister(op, a.reg, b.reg, a.start);
+                    continue;
+                }
+
+                bool withRegister = true;
+                uint8_t reg = 0;
+                uint8_t fused = X_ADD_R + k;
+
+                if (b.invariant)
+                {
+                    reg = b.reg;
+                    n = b.start;
+                    b = a;
+                }
+                else if (a.invariant && (isCommutative(op) || op == OP_SUB))
+                {
+                    // the register moves behind the pixel side, which shifts down over it
+                    memmove(px + a.start, px + b.start, n - b.start);
+                    n -= 2;
+                    b.start = a.start;
+                    b.last -= 2;
+                    reg = a.reg;
+                    if (op == OP_SUB)
+                    {
+                        fused = X_RSUB_R;
+                    }
+                }
+                else
+                {
+                    withRegister = false;
+                }
+
+                if (!withRegister)
+                {
+                    // both on the pixel stack, or a register that has to stay where it is
+                    px[n] = X_ADD + k;
+                    stack[depth++] = { false, 0, a.start, n };
+                    n++;
+                }
+                else if (fused == X_MUL_R && b.last == b.start && px[b.start] == X_I)
+                {
+                    px[b.start] = X_I_MUL_R;
+                    px[n++] = reg;
+                    stack[depth++] = { false, 0, b.start, b.start };
+                }
+                else if (fused == X_ADD_R && b.last == b.start && px[b.start] == X_I_MUL_R)
+                {
+                    px[b.start] = X_AFFINE;
+                    px[n++] = reg;
+                    stack[depth++] = { false, 0, b.start, b.start };
+                }
+                else
+                {
+                    px[n++] = fused;
+                    px[n++] = reg;
+                    stack[depth++] = { false, 0, b.start, static_cast<uint8_t>(n - 2) };
+                }
+            }
+            else if (op >= OP_SIN && op <= OP_BAND)
+            {
+                const Value a = stack[--depth];
+
+                if (a.invariant)
+                {
+                    pushRegister(op, a.reg, 0, a.start);
+                }
+                else if (op == OP_SIN && px[a.last] == X_ADD_R && a.last == n - 2)
+                {
+                    px[a.last] = X_ADD_R_SIN;
+                    stack[depth++] = a;
+                }
+                else if (op == OP_SIN && px[a.last] == X_AFFINE && a.last == n - 3)
+                {
+                    px[a.last] = X_AFFINE_SIN;
+                    stack[depth++] = a;
+                }
+                else
+                {
+                    px[n] = X_SIN + (op - OP_SIN);
+                    stack[depth++] = { false, 0, a.start, n };
+                    n++;
+                }
+            }
+            else if (op == OP_PAL)
+            {
+                const Value bright = stack[depth - 1];
+                if (bright.invariant)
+                {
+                    n = bright.start;
+                    px[n++] = X_PAL_R;
+                    px[n++] = bright.reg;
+                }
+                else
+                {
+                    px[n++] = X_PAL;
+                }
+            }
+            else if (op == OP_HSV)
+            {
+                const Value sat = stack[depth - 2];
+                const Value val = stack[depth - 1];
+                if (sat.invariant && val.invariant)
+                {
+                    n = sat.start;
+                    px[n++] = X_HSV_RR;
+                    px[n++] = sat.reg;
+                    px[n++] = val.reg;
+                }
+                else
+                {
+                    px[n++] = X_HSV;
+                }
+            }
+            else // OP_RGB, validate() made sure it is the last opcode
+            {
+                px[n++] = X_RGB;
+            }
+        }
+
+        s.pixelLength = n;
+    }
+
+    // Output of a block, with the fade/overwrite decision taken once and not per pixel
+    template <typename Color>
+    inline void store(CRGB* out, uint8_t count, bool additive, Color color)
+    {
+        if (additive)
+        {
+            for (uint8_t k = 0; k < count; ++k) out[k] += color(k);
+        }
+        else
+        {
+            for (uint8_t k = 0; k < count; ++k) out[k] = color(k);
+        }
+    }
+
+    // Once per frame, before the pixel loop
+    void computeRegisters(const Slot& s, uint8_t* reg, uint8_t hue, uint8_t beat, const APP_AUDIO::Bands& audio)
+    {
+        using namespace APP_PATTERN;
+
+        for (uint8_t i = 0; i < s.frameOps; ++i)
+        {
+            const FrameOp& f = s.frame[i];
+
+            if (f.op == OP_K)
+            {
+                reg[f.dst] = f.a;
+                continue;
+            }
+
+            const uint8_t a = reg[f.a];
+            const uint8_t b = reg[f.b];
+            uint8_t v = 0;
+
+            switch (f.op)
+            {
+                case OP_T:     v = hue;                             break;
+                case OP_P:     v = s.phase;                         break;
+                case OP_B:     v = beat;                            break;
+                case OP_ADD:   v = a + b;                           break;
+                case OP_SUB:   v = a - b;                           break;
+                case OP_MUL:   v = a * b;                           break;
+                case OP_SCALE: v = scale8(a, b);                    break;
+                case OP_QADD:  v = qadd8(a, b);                     break;
+                case OP_QSUB:  v = qsub8(a, b);                     break;
+                case OP_NOISE: v = inoise8(a * 32, b * 4);          break;
+                case OP_MAX:   v = a > b ? a : b;                   break;
+                case OP_SIN:   v = sin8(a);                         break;
+                case OP_COS:   v = cos8(a);                         break;
+                case OP_TRI:   v = triwave8(a);                     break;
+                case OP_QUAD:  v = quadwave8(a);                    break;
+                case OP_INV:   v = 255 - a;                         break;
+                case OP_BAND:  v = audio.band[a % APP_AUDIO::NUM_BANDS]; break;
+                default:                                            break;
+            }
+
+            reg[f.dst] = v;
+        }
+    }
+
+    // Render loop: adopts an upload posted since the last frame
+    void adoptPending(uint8_t slot)
+    {
+        Pending p;
+
+        portENTER_CRITICAL(&gLock);
+        p.state = gPending[slot].state;
+        if (p.state == PENDING_LOAD)
+        {
+            p = gPending[slot];
+        }
+        gPending[slot].state = PENDING_NONE;
+        portEXIT_CRITICAL(&gLock);
+
+        if (p.state == PENDING_NONE)
+        {
+            return;
+        }
+
+        Slot& s = gSlots[slot];
+        s.loaded = false;
+        if (p.state == PENDING_CLEAR)
+        {
+            return;
+        }
+
+        s.fade = p.fade;
+        s.additive = (s.fade != 0);
+        s.phaseStep = p.phaseStep;
+        s.bpm = p.bpm;
+        s.phase = 0;
+        if (p.paletteId != APP_PATTERN::PALETTE_NONE)
+        {
+            s.palette = CRGBPalette16(*PALETTES[p.paletteId]);
+        }
+        compile(s, p.code, p.codeLength);
+        s.loaded = true;
+    }
+
+    // Stack effect of one opcode, returns false for unknown opcodes
+    bool stackEffect(uint8_t op, uint8_t& pops, uint8_t& pushes)
+    {
+        using namespace APP_PATTERN;
+
+        switch (op)
+        {
+            case OP_K: case OP_I: case OP_T: case OP_P: case OP_B: case OP_RND:
+                pops = 0; pushes = 1; return true;
+            case OP_DUP:
+                pops = 1; pushes = 2; return true;
+            case OP_ADD: case OP_SUB: case OP_MUL: case OP_SCALE:
+            case OP_QADD: case OP_QSUB: case OP_NOISE: case OP_MAX:
+                pops = 2; pushes = 1; return true;
+            case OP_SIN: case OP_COS: case OP_TRI: case OP_QUAD: case OP_INV: case OP_BAND:
+                pops = 1; pushes = 1; return true;
+            case OP_PAL:
+                pops = 2; pushes = 0; return true;
+            case OP_HSV: case OP_RGB:
+                pops = 3; pushes = 0; return true;
+            default:
+                return false;
+        }
+    }
+
+    // Walks the code once, tracking stack depth. Everything the interpreter
+    // relies on (no underflow, no overflow, terminating output op) is proven here.
+    bool validate(const uint8_t* code, size_t length, bool hasPalette)
+    {
+        using namespace APP_PATTERN;
+
+        uint8_t depth = 0;
+
+        for (size_t pc = 0; pc < length; ++pc)
+        {
+            const uint8_t op = code[pc];
+            uint8_t pops = 0;
+            uint8_t pushes = 0;
+
+            if (!stackEffect(op, pops, pushes))
+            {
+                return false;
+            }
+
+            if (op == OP_K && ++pc >= length)
+            {
+                return false; // missing immediate
+            }
+
+            if (op == OP_PAL && !hasPalette)
+            {
+                return false;
+            }
+
+            if (depth < pops)
+            {
+                return false;
+            }
+
+            depth = depth - pops + pushes;
+
+            if (depth > MAX_STACK)
+            {
+                return false;
+            }
+
+            if (op >= OP_PAL)
+            {
+                // output must be last and must consume the whole stack
+                return (pc == length - 1) && (depth == 0);
+            }
+        }
+
+        return false; // never reached an output opcode
+    }
+}
+
+bool APP_PATTERN::load(uint8_t slot, const uint8_t* program, size_t length)
+{
+    if (slot >= NUM_SLOTS || program == nullptr)
+    {
+        return false;
+    }
+
+    if (length <= HEADER_SIZE || length > MAX_PROGRAM_SIZE)
+    {
+        return false;
+    }
+
+    const uint8_t version = program[0];
+    const uint8_t paletteId = program[1];
+
+    if (version != FORMAT_VERSION)
+    {
+        return false;
+    }
+
+    if (paletteId >= NUM_PALETTES && paletteId != PALETTE_NONE)
+    {
+        return false;
+    }
+
+    const uint8_t* code = program + HEADER_SIZE;
+    const size_t codeLength = length - HEADER_SIZE;
+
+    if (!validate(code, codeLength, paletteId != PALETTE_NONE))
+    {
+        return false;
+    }
+
+    // a later upload to the same slot replaces one not yet taken over
+    portENTER_CRITICAL(&gLock);
+    Pending& p = gPending[slot];
+    p.paletteId = paletteId;
+    p.fade = program[2];
+    p.phaseStep = program[3];
+    p.bpm = program[4];
+    p.codeLength = static_cast<uint8_t>(codeLength);
+    memcpy(p.code, code, codeLength);
+    p.state = PENDING_LOAD;
+    portEXIT_CRITICAL(&gLock);
+
+    return true;
+}
+
+bool APP_PATTERN::clear(uint8_t slot)
+{
+    if (slot >= NUM_SLOTS)
+    {
+        return false;
+    }
+
+    portENTER_CRITICAL(&gLock);
+    gPending[slot].state = PENDING_CLEAR;
+    portEXIT_CRITICAL(&gLock);
+    return true;
+}
+
+bool APP_PATTERN::isLoaded(uint8_t slot)
+{
+    if (slot >= NUM_SLOTS)
+    {
+        return false;
+    }
+
+    // a posted upload counts already, it is shown from the next frame on
+    portENTER_CRITICAL(&gLock);
+    const PendingState state = gPending[slot].state;
+    portEXIT_CRITICAL(&gLock);
+
+    if (state != PENDING_NONE)
+    {
+        return state == PENDING_LOAD;
+    }
+    return gSlots[slot].loaded;
+}
+
+void APP_PATTERN::render(uint8_t slot, CRGB* leds, uint16_t count, uint8_t hue)
+{
+    if (slot >= NUM_SLOTS)
+    {
+        return;
+    }
+
+    adoptPending(slot);
+
+    if (!gSlots[slot].loaded)
+    {
+        return;
+    }
+
+    Slot& s = gSlots[slot];
+
+    // per-frame registers, hoisted out of the pixel loop
+    s.phase += s.phaseStep;
+    const uint8_t beat = s.bpm ? beatsin8(s.bpm) : 0;
+    const uint8_t* const code = s.pixel;
+    const CRGBPalette16& palette = s.palette;
+    const bool additive = s.additive; // leds may alias the slot as far as the compiler knows
+    const APP_AUDIO::Bands audio = APP_AUDIO::get();
+
+    uint8_t reg[MAX_CODE] = {};
+    computeRegisters(s, reg, hue, beat, audio);
+
+    if (s.fade)
+    {
+        fadeToBlackBy(leds, count, s.fade);
+    }
+
+    // The code runs over a block of pixels at a time, every stack entry is a
+    // row of the block. Random numbers are drawn in pixel order as long as
+    // there is one OP_RND, with more the block shrinks to a single pixel.
+    uint8_t stack[MAX_STACK][BLOCK];
+    const uint16_t blockSize = (s.randoms > 1) ? 1 : BLOCK;
+
+    for (uint16_t first = 0; first < count; first += blockSize)
+    {
+        const uint8_t m = static_cast<uint8_t>((count - first < blockSize) ? count - first : blockSize);
+        const uint8_t index = static_cast<uint8_t>(first); // I is the low 8 bits
+        CRGB* const out = leds + first;
+        const uint8_t* pc = code;
+        uint8_t (*sp)[BLOCK] = stack; // next free entry
+
+        // validate() guarantees the stack stays in bounds and that an
+        // output instruction terminates the program, so no checks are needed here
+        for (;;)
+        {
+            uint8_t* const a = sp[-2];
+            uint8_t* const b = sp[-1];
+            uint8_t* const top = sp[-1];
+            uint8_t* const push = sp[0];
+
+            switch (*pc++)
+            {
+                case X_R:
+                    memset(push, reg[*pc++], m);
+                    ++sp;
+                    continue;
+
+                case X_I:
+                    for (uint8_t k = 0; k < m; ++k) push[k] = index + k;
+                    ++sp;
+                    continue;
+
+                case X_I_MUL_R:
+                {
+                    const uint8_t r = reg[*pc++];
+                    for (uint8_t k = 0; k < m; ++k) push[k] = (index + k) * r;
+                    ++sp;
+                    continue;
+                }
+
+                case X_AFFINE:
+                case X_AFFINE_SIN:
+                {
+                    const uint8_t r = reg[pc[0]];
+                    uint8_t v = index * r + reg[pc[1]];
+                    if (pc[-1] == X_AFFINE)
+                    {
+                        for (uint8_t k = 0; k < m; ++k, v += r) push[k] = v;
+                    }
+                    else
+                    {
+                        for (uint8_t k = 0; k < m; ++k, v += r) push[k] = sin8(v);
+                    }
+                    pc += 2;
+                    ++sp;
+                    continue;
+                }
+
+                case X_RND:
+                    for (uint8_t k = 0; k < m; ++k) push[k] = random8();
+                    ++sp;
+                    continue;
+
+                case X_DUP:
+                    memcpy(push, top, m);
+                    ++sp;
+                    continue;
+
+                case X_ADD:   for (uint8_t k = 0; k < m; ++k) a[k] += b[k];                        --sp; continue;
+                case X_SUB:   for (uint8_t k = 0; k < m; ++k) a[k] -= b[k];                        --sp; continue;
+                case X_MUL:   for (uint8_t k = 0; k < m; ++k) a[k] *= b[k];                        --sp; continue;
+                case X_SCALE: for (uint8_t k = 0; k < m; ++k) a[k] = scale8(a[k], b[k]);           --sp; continue;
+                case X_QADD:  for (uint8_t k = 0; k < m; ++k) a[k] = qadd8(a[k], b[k]);            --sp; continue;
+                case X_QSUB:  for (uint8_t k = 0; k < m; ++k) a[k] = qsub8(a[k], b[k]);            --sp; continue;
+                case X_NOISE: for (uint8_t k = 0; k < m; ++k) a[k] = inoise8(a[k] * 32, b[k] * 4); --sp; continue;
+                case X_MAX:   for (uint8_t k = 0; k < m; ++k) if (b[k] > a[k]) a[k] = b[k];        --sp; continue;
+
+                case X_ADD_R:
+                case X_SUB_R:
+                case X_MUL_R:
+                case X_SCALE_R:
+                case X_QADD_R:
+                case X_QSUB_R:
+                case X_NOISE_R:
+                case X_MAX_R:
+                case X_RSUB_R:
+                case X_ADD_R_SIN:
+                {
+                    const uint8_t r = reg[*pc++];
+                    switch (pc[-2])
+                    {
+                        case X_ADD_R:     for (uint8_t k = 0; k < m; ++k) top[k] += r;                      break;
+                        case X_SUB_R:     for (uint8_t k = 0; k < m; ++k) top[k] -= r;                      break;
+                        case X_MUL_R:     for (uint8_t k = 0; k < m; ++k) top[k] *= r;                      break;
+                        case X_SCALE_R:   for (uint8_t k = 0; k < m; ++k) top[k] = scale8(top[k], r);       break;
+                        case X_QADD_R:    for (uint8_t k = 0; k < m; ++k) top[k] = qadd8(top[k], r);        break;
+                        case X_QSUB_R:    for (uint8_t k = 0; k < m; ++k) top[k] = qsub8(top[k], r);        break;
+                        case X_NOISE_R:   for (uint8_t k = 0; k < m; ++k) top[k] = inoise8(top[k] * 32, r * 4); break;
+                        case X_MAX_R:     for (uint8_t k = 0; k < m; ++k) if (r > top[k]) top[k] = r;       break;
+                        case X_RSUB_R:    for (uint8_t k = 0; k < m; ++k) top[k] = r - top[k];              break;
+                        default:          for (uint8_t k = 0; k < m; ++k) top[k] = sin8(top[k] + r);        break;
+                    }
+                    continue;
+                }
+
+                case X_SIN:   for (uint8_t k = 0; k < m; ++k) top[k] = sin8(top[k]);                        continue;
+                case X_COS:   for (uint8_t k = 0; k < m; ++k) top[k] = cos8(top[k]);                        continue;
+                case X_TRI:   for (uint8_t k = 0; k < m; ++k) top[k] = triwave8(top[k]);                    continue;
+                case X_QUAD:  for (uint8_t k = 0; k < m; ++k) top[k] = quadwave8(top[k]);                   continue;
+                case X_INV:   for (uint8_t k = 0; k < m; ++k) top[k] = 255 - top[k];                        continue;
+                case X_BAND:  for (uint8_t k = 0; k < m; ++k) top[k] = audio.band[top[k] % APP_AUDIO::NUM_BANDS]; continue;
+
+                case X_PAL:
+                    store(out, m, additive, [&](uint8_t k) { return ColorFromPalette(palette, a[k], b[k]); });
+                    break;
+
+                case X_PAL_R:
+                {
+                    const uint8_t bright = reg[*pc];
+                    store(out, m, additive, [&](uint8_t k) { return ColorFromPalette(palette, top[k], bright); });
+                    break;
+                }
+
+                case X_HSV:
+                {
+                    const uint8_t* const h = sp[-3];
+                    store(out, m, additive, [&](uint8_t k) { return CRGB(CHSV(h[k], a[k], b[k])); });
+                    break;
+                }
+
+                case X_HSV_RR:
+                {
+                    const uint8_t sat = reg[pc[0]];
+                    const uint8_t val = reg[pc[1]];
+                    store(out, m, additive, [&](uint8_t k) { return CRGB(CHSV(top[k], sat, val)); });
+                    break;
+                }
+
+                case X_RGB:
+                {
+                    const uint8_t* const r = sp[-3];
+                    store(out, m, additive, [&](uint8_t k) { return CRGB(r[k], a[k], b[k]); });
+                    break;
+                }
+
+                default:
+                    break;
+            }
+            break;
+        }
+    }
+}
@@ -0,0 +1,450 @@
+/*
+ * File:        APP_PIXELNET.cpp
+ * Author:      Marcus Lechner
+ * Created:     2025-09-20
+ * Description: Optional DDP and E1.31 (sACN) pixel stream receiver over Wi-Fi with a jitter buffer
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#include "APP_PIXELNET.hpp"
+#include "APP_IDLE.hpp"
+#include "APP_MEMORY.hpp"
+#include "APP_PIXELNET_STREAM.hpp"
+#include <Arduino.h>
+#include <FastLED.h>
+#include <Preferences.h>
+#include <WiFi.h>
+#include <lwip/sockets.h>
+#include <string.h>
+
+namespace
+{
+    using namespace APP_PIXELNET_STREAM;
+    using APP_LED::NUM_LEDS;
+
+    constexpr char NVS_NAMESPACE[] = "lamp";
+    constexpr char WIFI_KEY[] = "wifi";
+
+    constexpr size_t FRAME_BYTES = NUM_LEDS * 3;
+    constexpr size_t PACKET_SIZE = 1472;          // largest UDP payload in one Ethernet frame
+    constexpr uint8_t MAX_PACKETS_PER_PASS = 16;  // the loop has other work too
+
+    // Loopback load generator
+    constexpr uint16_t MAX_LOAD_FPS = 1000;
+    constexpr uint16_t MAX_LOAD_SECONDS = 600;
+    constexpr uint32_t TASK_STACK = 4096;
+    constexpr UBaseType_t TASK_PRIORITY = 1;
+    constexpr BaseType_t TASK_CORE = 0;
+    constexpr uint32_t LOOPBACK = 0x7F000001;
+
+    struct Credentials
+    {
+        char ssid[33];
+        char password[65];
+    };
+
+    Preferences prefs;
+    Credentials gCredentials;
+    bool gRadioOn = false;
+    bool gConnected = false;
+
+    int gDdpSocket = -1;
+    int gE131Socket = -1;
+    uint8_t gPacket[PACKET_SIZE];
+
+    Receiver<NUM_LEDS> gReceiver;
+    uint32_t gStatsSinceMs = 0;
+
+    // Load generator, parameters are set before the task starts
+    volatile bool gLoadRunning = false;
+    volatile bool gLoadFinished = false;
+    uint16_t gLoadRate = 0;
+    uint16_t gLoadSeconds = 0;
+    uint32_t gLoadSent = 0;
+
+    int openSocket(uint16_t port)
+    {
+        const int s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        if (s < 0)
+        {
+            return -1;
+        }
+
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+
+        if (bind(s, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) < 0)
+        {
+            close(s);
+            return -1;
+        }
+        return s;
+    }
+
+    // sACN sources usually send to 239.255.<universe high>.<universe low>
+    void joinUniverses()
+    {
+        for (uint16_t u = 0; u < APP_PIXELNET::NUM_UNIVERSES; ++u)
+        {
+            const uint16_t universe = APP_PIXELNET::START_UNIVERSE + u;
+            ip_mreq group;
+            group.imr_multiaddr.s_addr = htonl(0xEFFF0000UL | universe);
+            group.imr_interface.s_addr = htonl(INADDR_ANY);
+            setsockopt(gE131Socket, IPPROTO_IP, IP_ADD_MEMBERSHIP, &group, sizeof(group));
+        }
+    }
+
+    // Starts the network stack and opens the ports, joins the network if credentials are stored
+    void startRadio()
+    {
+        if (!gRadioOn)
+        {
+            WiFi.mode(WIFI_STA);
+            WiFi.setAutoReconnect(true);
+            gDdpSocket = openSocket(APP_PIXELNET::DDP_PORT);
+            gE131Socket = openSocket(APP_PIXELNET::E131_PORT);
+            gRadioOn = true;
+
+            if (gDdpSocket < 0 || gE131Socket < 0)
+            {
+                Serial.println("[NET] Could not open the UDP ports");
+            }
+        }
+
+        if (gCredentials.ssid[0])
+        {
+            WiFi.begin(gCredentials.ssid, gCredentials.password);
+            Serial.printf("[NET] Joining %s\n", gCredentials.ssid);
+        }
+    }
+
+    void stopRadio()
+    {
+        if (!gRadioOn)
+        {
+            return;
+        }
+
+        if (gDdpSocket >= 0)
+        {
+            close(gDdpSocket);
+        }
+        if (gE131Socket >= 0)
+        {
+            close(gE131Socket);
+        }
+        gDdpSocket = -1;
+        gE131Socket = -1;
+
+        WiFi.disconnect(true);
+        WiFi.mode(WIFI_OFF);
+        gRadioOn = false;
+        gConnected = false;
+        Serial.println("[NET] Wi-Fi off");
+    }
+
+    // NET LOAD starts the radio for itself. Without a network to join it goes
+    // off again afterwards, along with whatever the load left in the ring.
+    void releaseLoadRadio()
+    {
+        if (gCredentials.ssid[0])
+        {
+            return;
+        }
+        gReceiver.stop();
+        stopRadio();
+    }
+
+    void streamEnded(const char* why)
+    {
+        Serial.printf("[NET] Stream %s, back to the patterns\n", why);
+        APP_PIXELNET::report();
+    }
+
+    void endStream(const char* why)
+    {
+        if (gReceiver.stop())
+        {
+            streamEnded(why);
+        }
+    }
+
+    void onEvent(Event event, const char* protocol)
+    {
+        switch (event)
+        {
+            case EVENT_STARTED:
+                Serial.printf("[NET] %s stream started\n", protocol);
+                APP_IDLE::activity();
+                break;
+            case EVENT_FRAME:
+                APP_IDLE::activity();
+                break;
+            case EVENT_TERMINATED:
+                streamEnded("terminated by the source");
+                break;
+            default:
+                break;
+        }
+    }
+
+    void handleDdp(size_t length, uint32_t arrived)
+    {
+        onEvent(gReceiver.ddp(gPacket, length, arrived), "DDP");
+    }
+
+    void handleE131(size_t length, uint32_t arrived)
+    {
+        onEvent(gReceiver.e131(gPacket, length, arrived), "E1.31");
+    }
+
+    void readSocket(int s, void (*handle)(size_t, uint32_t))
+    {
+        if (s < 0)
+        {
+            return;
+        }
+
+        for (uint8_t i = 0; i < MAX_PACKETS_PER_PASS; ++i)
+        {
+            const int length = recv(s, gPacket, sizeof(gPacket), MSG_DONTWAIT);
+            if (length <= 0)
+            {
+                return;
+            }
+
+            handle(static_cast<size_t>(length), micros());
+        }
+    }
+
+    void loadTask(void*)
+    {
+        const int s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+
+        sockaddr_in to;
+        memset(&to, 0, sizeof(to));
+        to.sin_family = AF_INET;
+        to.sin_port = htons(APP_PIXELNET::DDP_PORT);
+        to.sin_addr.s_addr = htonl(LOOPBACK);
+
+        uint8_t packet[DDP_HEADER + FRAME_BYTES];
+        packet[0] = DDP_VERSION_1 | DDP_PUSH;
+        packet[2] = DDP_TYPE_RGB8;
+        packet[3] = DDP_ID_DISPLAY;
+        memset(packet + 4, 0, 4);
+        packet[8] = static_cast<uint8_t>(FRAME_BYTES >> 8);
+        packet[9] = static_cast<uint8_t>(FRAME_BYTES);
+
+        const uint32_t total = static_cast<uint32_t>(gLoadRate) * gLoadSeconds;
+        const TickType_t start = xTaskGetTickCount();
+        TickType_t wake = start;
+        uint32_t sent = 0;
+
+        // Paced per tick like the slider storm in APP_LATENCY
+        while (s >= 0 && sent < total)
+        {
+            const uint32_t elapsedMs = (xTaskGetTickCount() - start) * portTICK_PERIOD_MS;
+            uint32_t due = static_cast<uint32_t>((static_cast<uint64_t>(elapsedMs) * gLoadRate) / 1000);
+            if (due > total)
+            {
+                due = total;
+            }
+
+            for (; sent < due; ++sent)
+            {
+                packet[1] = static_cast<uint8_t>(sent % 15 + 1);
+                for (uint8_t i = 0; i < NUM_LEDS; ++i)
+                {
+                    CRGB color;
+                    hsv2rgb_rainbow(CHSV(static_cast<uint8_t>(sent * 3 + i * 8), 255, 255), color);
+                    packet[DDP_HEADER + i * 3] = color.r;
+                    packet[DDP_HEADER + i * 3 + 1] = color.g;
+                    packet[DDP_HEADER + i * 3 + 2] = color.b;
+                }
+
+                if (sendto(s, packet, sizeof(packet), 0, reinterpret_cast<const sockaddr*>(&to), sizeof(to)) > 0)
+                {
+                    gLoadSent++;
+                }
+            }
+
+            vTaskDelayUntil(&wake, 1);
+        }
+
+        if (s >= 0)
+        {
+            close(s);
+        }
+        gLoadFinished = true;
+        vTaskDelete(nullptr);
+    }
+}
+
+void APP_PIXELNET::init()
+{
+    APP_MEMORY::Scope scope(APP_MEMORY::MODULE_NET);
+    prefs.begin(NVS_NAMESPACE, false);
+    gStatsSinceMs = millis();
+
+    memset(&gCredentials, 0, sizeof(gCredentials));
+    if (prefs.getBytesLength(WIFI_KEY) == sizeof(gCredentials))
+    {
+        prefs.getBytes(WIFI_KEY, &gCredentials, sizeof(gCredentials));
+        gCredentials.ssid[sizeof(gCredentials.ssid) - 1] = '\0';
+        gCredentials.password[sizeof(gCredentials.password) - 1] = '\0';
+    }
+}
+
+void APP_PIXELNET::connect()
+{
+    APP_MEMORY::Scope scope(APP_MEMORY::MODULE_NET);
+
+    if (gCredentials.ssid[0])
+    {
+        startRadio();
+    }
+}
+
+void APP_PIXELNET::process()
+{
+    if (gLoadFinished)
+    {
+        gLoadFinished = false;
+        gLoadRunning = false;
+        Serial.printf("[NET] Loopback load done, %lu frames sent\n", static_cast<unsigned long>(gLoadSent));
+        report();
+        releaseLoadRadio();
+    }
+
+    if (!gRadioOn)
+    {
+        return;
+    }
+
+    APP_MEMORY::Scope scope(APP_MEMORY::MODULE_NET);
+
+    const bool connected = WiFi.status() == WL_CONNECTED;
+    if (connected != gConnected)
+    {
+        gConnected = connected;
+        if (connected)
+        {
+            const IPAddress ip = WiFi.localIP();
+            Serial.printf("[NET] Connected as %u.%u.%u.%u, DDP on %u, E1.31 on %u from universe %u\n",
+                          ip[0], ip[1], ip[2], ip[3], DDP_PORT, E131_PORT, START_UNIVERSE);
+            joinUniverses();
+        }
+        else
+        {
+            Serial.println("[NET] Wi-Fi connection lost");
+        }
+    }
+
+    readSocket(gDdpSocket, handleDdp);
+    readSocket(gE131Socket, handleE131);
+
+    if (gReceiver.expire(micros()))
+    {
+        streamEnded("timed out");
+    }
+}
+
+bool APP_PIXELNET::isActive()
+{
+    return gReceiver.isActive();
+}
+
+void APP_PIXELNET::render(uint8_t* rgb)
+{
+    gReceiver.render(rgb, micros());
+}
+
+void APP_PIXELNET::setCredentials(const char* ssid, const char* password)
+{
+    APP_MEMORY::Scope scope(APP_MEMORY::MODULE_NET);
+
+    endStream("stopped");
+    memset(&gCredentials, 0, sizeof(gCredentials));
+
+    if (ssid == nullptr || ssid[0] == '\0')
+    {
+        prefs.remove(WIFI_KEY);
+        stopRadio();
+        return;
+    }
+
+    strncpy(gCredentials.ssid, ssid, sizeof(gCredentials.ssid) - 1);
+    if (password)
+    {
+        strncpy(gCredentials.password, password, sizeof(gCredentials.password) - 1);
+    }
+    prefs.putBytes(WIFI_KEY, &gCredentials, sizeof(gCredentials));
+
+    if (gRadioOn)
+    {
+        WiFi.disconnect();
+    }
+    startRadio();
+}
+
+bool APP_PIXELNET::startLoad(uint16_t frameRate, uint16_t seconds)
+{
+    if (gLoadRunning)
+    {
+        return false;
+    }
+
+    startRadio(); // loopback needs the network stack, not a network
+    if (gDdpSocket < 0)
+    {
+        releaseLoadRadio();
+        return false;
+    }
+
+    gLoadRate = constrain(frameRate, 1, MAX_LOAD_FPS);
+    gLoadSeconds = constrain(seconds, 1, MAX_LOAD_SECONDS);
+    gLoadSent = 0;
+    gReceiver.resetStats();
+    gStatsSinceMs = millis();
+
+    gLoadFinished = false;
+    gLoadRunning = true;
+    Serial.printf("[NET] Loopback load, %u DDP frames/s for %u s\n", gLoadRate, gLoadSeconds);
+
+    if (xTaskCreatePinnedToCore(loadTask, "netload", TASK_STACK, nullptr, TASK_PRIORITY, nullptr, TASK_CORE) != pdPASS)
+    {
+        gLoadRunning = false;
+        releaseLoadRadio();
+        return false;
+    }
+    return true;
+}
+
+void APP_PIXELNET::report()
+{
+    const uint32_t elapsedMs = millis() - gStatsSinceMs;
+    const Stats& s = gReceiver.stats();
+
+    Serial.printf("[NET] %lu packets (%lu/s), %lu frames, %lu shown, %lu gaps, %lu late, %lu overruns, %lu skipped, %lu malformed\n",
+                  static_cast<unsigned long>(s.packets),
+                  static_cast<unsigned long>(elapsedMs ? (s.packets * 1000ULL) / elapsedMs : 0),
+                  static_cast<unsigned long>(s.frames), static_cast<unsigned long>(s.presented),
+                  static_cast<unsigned long>(s.gaps), static_cast<unsigned long>(s.late),
+                  static_cast<unsigned long>(s.overruns), static_cast<unsigned long>(s.skipped),
+                  static_cast<unsigned long>(s.malformed));
+
+    if (s.presented)
+    {
+        const uint32_t avg = static_cast<uint32_t>(s.latencySumUs / s.presented);
+        Serial.printf("[NET] Arrival to frame avg %lu.%02lu max %lu.%02lu ms\n",
+                      static_cast<unsigned long>(avg / 1000), static_cast<unsigned long>((avg % 1000) / 10),
+                      static_cast<unsigned long>(s.latencyMaxUs / 1000),
+                      static_cast<unsigned long>((s.latencyMaxUs % 1000) / 10));
+    }
+
+    gReceiver.resetStats();
+    gStatsSinceMs = millis();
+}
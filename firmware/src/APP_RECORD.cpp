@@ -0,0 +1,681 @@
+/*
+ * File:        APP_RECORD.cpp
+ * Author:      Marcus Lechner
+ * Created:     2025-08-16
+ * Description: Ring log of external inputs, replayed on a virtual clock after a restart
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#include "APP_RECORD.hpp"
+#include "APP_BLE.hpp"
+#include "APP_CRC.hpp"
+#include "APP_LED.hpp"
+#include "APP_SCENE.hpp"
+#include "APP_SERVO.hpp"
+#include <Arduino.h>
+#include <FastLED.h>
+#include <esp_attr.h>
+#include <esp_system.h>
+
+namespace
+{
+    constexpr uint32_t LOG_MAGIC = 0x4C524532; // "LRE2", changes with the Log layout
+    constexpr uint16_t LOG_SIZE = 16384;       // about 30 s of a busy session
+    constexpr uint8_t MAX_PAYLOAD = 255;       // longer BLE writes are cut, the cue list is 163 bytes at most
+    constexpr uint8_t DUMP_LINE = 32;
+    constexpr uint16_t CHECKPOINT_BYTES = LOG_SIZE / 2;
+    constexpr uint8_t NUM_CHECKPOINTS = 2;
+    constexpr uint8_t FROM_BOOT = 0xFF;        // replay starts from the boot state, not a checkpoint
+
+    enum Mode : uint8_t
+    {
+        MODE_RECORD = 1,
+        MODE_REPLAY_ARMED = 2
+    };
+
+    // Each record is: type, ms since the previous record, payload
+    enum EventType : uint8_t
+    {
+        EV_WAIT  = 1, // no payload, only moves the clock on (gaps longer than 255 ms)
+        EV_FRAME = 2, // no payload
+        EV_ADC   = 3, // axis, value low, value high
+        EV_BLE   = 4  // channel, length, bytes
+    };
+
+    struct Checkpoint
+    {
+        uint8_t  valid;
+        uint32_t position;   // log bytes written before it, see Log::written
+        uint32_t time;       // clock when it was taken
+        uint32_t baseTime;   // clock of the record before it
+        uint32_t frames;     // frames hashed since
+        uint32_t frameCrc;
+        APP_RECORD::Snapshot state;
+    };
+
+    // Lives in .noinit so a software restart into replay finds it intact,
+    // the magic tells it apart from power-on garbage
+    struct Log
+    {
+        uint32_t magic;
+        uint8_t  mode;
+        uint8_t  wrapped;    // oldest records were dropped, the start state is lost
+        uint8_t  fromBoot;   // recording began at boot, not after a replay
+        uint8_t  replayFrom; // checkpoint index or FROM_BOOT, set when a replay is armed
+        uint16_t seed;
+        APP_SETTINGS::Settings start;
+        uint32_t startTime;  // clock when recording began
+        uint32_t tailTime;   // clock of the record before the oldest one kept
+        uint32_t lastTime;   // clock of the newest record
+        uint32_t frames;     // frames hashed while recording
+        uint32_t frameCrc;
+        uint16_t head;       // next byte written
+        uint16_t tail;       // first byte of the oldest record
+        uint16_t used;
+        uint32_t written;    // bytes ever put, head is written % LOG_SIZE
+        Checkpoint checkpoints[NUM_CHECKPOINTS];
+        uint8_t  data[LOG_SIZE];
+    };
+
+    static_assert((LOG_SIZE & (LOG_SIZE - 1)) == 0, "written % LOG_SIZE must stay in step with head across a wrap of written");
+
+    __NOINIT_ATTR Log gLog;
+
+    portMUX_TYPE gLock = portMUX_INITIALIZER_UNLOCKED; // BLE writes are logged from the BLE task
+
+    bool gRecording = false;
+    bool gReplaying = false;
+    bool gCheckpointDue = false;   // take one on the next loop pass, recording resumed after a replay
+    const APP_RECORD::Snapshot* gSnapshot = nullptr;
+    volatile bool gReplayRequested = false;
+    volatile bool gDumpRequested = false;
+    uint32_t gClockOffset = 0; // keeps now() moving forward after a replay ends
+    bool gClockPinned = false;
+    uint32_t gPinnedTime = 0;
+
+    // Replay cursor
+    uint32_t gVirtualTime = 0;
+    uint16_t gCursor = 0;
+    uint16_t gRemaining = 0;
+    uint32_t gCursorBase = 0;    // clock of the record before the cursor
+    uint32_t gConsumed = 0;
+    uint32_t gLeftMark = 0;
+    bool gLeftForConsumer = false;
+
+    uint32_t gReplayFrames = 0;
+    uint32_t gReplayCrc = 0;
+    uint32_t gExpectedFrames = 0;
+    uint32_t gExpectedCrc = 0;
+    uint32_t gDiverged = 0;
+    uint32_t gBleDelivered = 0;
+    unsigned long gReplayStartMicros = 0;
+
+    uint32_t hashFrame(uint32_t crc, const uint8_t* pixels, size_t length, uint8_t brightness)
+    {
+        crc = APP_CRC::crc32(pixels, length, crc);
+        return APP_CRC::crc32(&brightness, 1, crc);
+    }
+
+    uint8_t at(uint16_t offset)
+    {
+        return gLog.data[offset % LOG_SIZE];
+    }
+
+    uint16_t recordLength(uint16_t offset)
+    {
+        switch (at(offset))
+        {
+            case EV_ADC: return 5;
+            case EV_BLE: return 4 + at(offset + 3);
+            default:     return 2;
+        }
+    }
+
+    void put(uint8_t value)
+    {
+        gLog.data[gLog.head] = value;
+        gLog.head = (gLog.head + 1) % LOG_SIZE;
+        gLog.used++;
+        gLog.written++;
+    }
+
+    // Drops the oldest records until length bytes fit
+    void reserve(uint16_t length)
+    {
+        while (LOG_SIZE - gLog.used < length)
+        {
+            const uint16_t dropped = recordLength(gLog.tail);
+            gLog.tailTime += at(gLog.tail + 1);
+            gLog.tail = (gLog.tail + dropped) % LOG_SIZE;
+            gLog.used -= dropped;
+            gLog.wrapped = 1;
+        }
+    }
+
+    // Appends one record, prefix is the fixed part of the payload and data the variable part
+    void append(EventType type, const uint8_t* prefix, uint8_t prefixLength, const uint8_t* data, uint8_t dataLength)
+    {
+        portENTER_CRITICAL(&gLock);
+
+        const uint32_t time = APP_RECORD::now();
+        uint32_t dt = time - gLog.lastTime;
+
+        while (dt > 255)
+        {
+            reserve(2);
+            put(EV_WAIT);
+            put(255);
+            dt -= 255;
+        }
+
+        reserve(2 + prefixLength + dataLength);
+        put(type);
+        put(static_cast<uint8_t>(dt));
+        for (uint8_t i = 0; i < prefixLength; ++i)
+        {
+            put(prefix[i]);
+        }
+        for (uint8_t i = 0; i < dataLength; ++i)
+        {
+            put(data[i]);
+        }
+        gLog.lastTime = time;
+
+        portEXIT_CRITICAL(&gLock);
+    }
+
+    // Empties the log, time is where its clock starts
+    void resetLog(uint32_t time)
+    {
+        gLog.magic = LOG_MAGIC;
+        gLog.mode = MODE_RECORD;
+        gLog.wrapped = 0;
+        gLog.startTime = time;
+        gLog.tailTime = time;
+        gLog.lastTime = time;
+        gLog.frames = 0;
+        gLog.frameCrc = 0;
+        gLog.head = 0;
+        gLog.tail = 0;
+        gLog.used = 0;
+        gLog.written = 0;
+        for (Checkpoint& c : gLog.checkpoints)
+        {
+            c.valid = 0;
+        }
+    }
+
+    void startRecording()
+    {
+        resetLog(millis());
+        gLog.fromBoot = 1;
+        gLog.seed = static_cast<uint16_t>(esp_random());
+
+        random16_set_seed(gLog.seed);
+        gRecording = true;
+    }
+
+    // After a replay, record on from the state it left behind
+    void resumeRecording()
+    {
+        resetLog(APP_RECORD::now());
+        gLog.fromBoot = 0;
+        gLog.seed = random16_get_seed();
+        gRecording = true;
+        gCheckpointDue = true; // the boot state does not describe this log, a checkpoint has to
+    }
+
+    // Loop only, between two passes, so every module is in a consistent state
+    void takeCheckpoint()
+    {
+        APP_RECORD::Snapshot state;
+        state.settings = APP_SETTINGS::get();
+        APP_LED::getSolidColor(state.settings.red, state.settings.green, state.settings.blue);
+        state.settings.pattern = APP_LED::getAnimation();
+        state.settings.shutter = static_cast<uint8_t>(APP_SERVO::getPosition());
+        state.seed = random16_get_seed();
+        state.brightness = APP_LED::getBrightness();
+        state.hue = APP_LED::getHue();
+
+        bool playing = false;
+        APP_SCENE::getPlayback(playing, state.sceneCue, state.sceneCueDue);
+        state.scenePlaying = playing ? 1 : 0;
+
+        portENTER_CRITICAL(&gLock);
+
+        // replaces the older one, or a free one
+        uint8_t slot = 0;
+        for (uint8_t i = 1; i < NUM_CHECKPOINTS; ++i)
+        {
+            const Checkpoint& c = gLog.checkpoints[i];
+            if (!c.valid || (gLog.checkpoints[slot].valid && c.position < gLog.checkpoints[slot].position))
+            {
+                slot = i;
+            }
+        }
+
+        Checkpoint& c = gLog.checkpoints[slot];
+        c.position = gLog.written;
+        c.time = APP_RECORD::now();
+        c.baseTime = gLog.lastTime;
+        c.frames = 0;
+        c.frameCrc = 0;
+        c.state = state;
+        c.valid = 1;
+
+        portEXIT_CRITICAL(&gLock);
+    }
+
+    bool checkpointDue()
+    {
+        if (gCheckpointDue)
+        {
+            return true;
+        }
+
+        uint32_t newest = 0;
+        for (const Checkpoint& c : gLog.checkpoints)
+        {
+            if (c.valid && c.position > newest)
+            {
+                newest = c.position;
+            }
+        }
+        return gLog.written - newest >= CHECKPOINT_BYTES;
+    }
+
+    // The oldest checkpoint whose records are all still in the log, FROM_BOOT
+    // while nothing was dropped, or NUM_CHECKPOINTS when there is nothing to replay
+    uint8_t replayStart()
+    {
+        if (gLog.fromBoot && !gLog.wrapped)
+        {
+            return FROM_BOOT;
+        }
+
+        const uint32_t tailPosition = gLog.written - gLog.used;
+        uint8_t found = NUM_CHECKPOINTS;
+
+        for (uint8_t i = 0; i < NUM_CHECKPOINTS; ++i)
+        {
+            const Checkpoint& c = gLog.checkpoints[i];
+            if (c.valid && c.position >= tailPosition
+                && (found == NUM_CHECKPOINTS || c.position < gLog.checkpoints[found].position))
+            {
+                found = i;
+            }
+        }
+        return found;
+    }
+
+    void startReplay()
+    {
+        gLog.mode = MODE_RECORD; // a crash during replay must not replay again forever
+
+        if (gLog.replayFrom < NUM_CHECKPOINTS)
+        {
+            const Checkpoint& c = gLog.checkpoints[gLog.replayFrom];
+            random16_set_seed(c.state.seed);
+            gVirtualTime = c.time;
+            gCursor = static_cast<uint16_t>(c.position % LOG_SIZE);
+            gRemaining = static_cast<uint16_t>(gLog.written - c.position);
+            gCursorBase = c.baseTime;
+            gExpectedFrames = c.frames;
+            gExpectedCrc = c.frameCrc;
+            gSnapshot = &c.state;
+        }
+        else
+        {
+            random16_set_seed(gLog.seed);
+            gVirtualTime = gLog.startTime;
+            gCursor = gLog.tail;
+            gRemaining = gLog.used;
+            gCursorBase = gLog.tailTime;
+            gExpectedFrames = gLog.frames;
+            gExpectedCrc = gLog.frameCrc;
+        }
+        gReplaying = true;
+        gReplayStartMicros = micros();
+
+        Serial.printf("[RECORD] Replaying %u bytes, %lu frames, from %s\n",
+                      gRemaining, static_cast<unsigned long>(gExpectedFrames),
+                      gSnapshot ? "a checkpoint" : "boot");
+    }
+
+    bool peek(uint8_t& type, uint32_t& time)
+    {
+        if (gRemaining == 0)
+        {
+            return false;
+        }
+        type = at(gCursor);
+        time = gCursorBase + at(gCursor + 1);
+        return true;
+    }
+
+    bool headDue(uint8_t& type)
+    {
+        uint32_t time = 0;
+        return peek(type, time) && time <= gVirtualTime;
+    }
+
+    void consume()
+    {
+        const uint16_t length = recordLength(gCursor);
+        gCursorBase += at(gCursor + 1);
+        gCursor = (gCursor + length) % LOG_SIZE;
+        gRemaining -= length;
+        gConsumed++;
+    }
+
+    void deliverBle()
+    {
+        static uint8_t payload[MAX_PAYLOAD];
+
+        const uint8_t channel = at(gCursor + 2);
+        const uint8_t length = at(gCursor + 3);
+        for (uint8_t i = 0; i < length; ++i)
+        {
+            payload[i] = at(gCursor + 4 + i);
+        }
+
+        consume(); // before dispatching, in case the handler reads the clock
+        APP_BLE::handleWrite(channel, payload, length);
+        gBleDelivered++;
+    }
+
+    void finishReplay()
+    {
+        gReplaying = false;
+        gClockOffset = gVirtualTime - millis();
+
+        const unsigned long wallMs = (micros() - gReplayStartMicros) / 1000;
+        const uint32_t virtualMs = gVirtualTime - (gSnapshot ? gLog.checkpoints[gLog.replayFrom].time : gLog.startTime);
+        const bool identical = (gReplayFrames == gExpectedFrames) && (gReplayCrc == gExpectedCrc);
+
+        Serial.printf("[RECORD] Replay done: %lu ms of input in %lu ms (%.1fx), %lu BLE writes, %lu diverged\n",
+                      static_cast<unsigned long>(virtualMs),
+                      wallMs,
+                      wallMs ? static_cast<float>(virtualMs) / wallMs : 0.0f,
+                      static_cast<unsigned long>(gBleDelivered),
+                      static_cast<unsigned long>(gDiverged));
+        Serial.printf("[RECORD] Frames %lu/%lu, checksum %08lX vs recorded %08lX: %s\n",
+                      static_cast<unsigned long>(gReplayFrames),
+                      static_cast<unsigned long>(gExpectedFrames),
+                      static_cast<unsigned long>(gReplayCrc),
+                      static_cast<unsigned long>(gExpectedCrc),
+                      identical ? "IDENTICAL" : "DIFFERENT");
+
+        gSnapshot = nullptr;
+        resumeRecording();
+        Serial.println("[RECORD] Recording again");
+    }
+
+    void dump()
+    {
+        Serial.printf("[RECORD] magic %08lX seed %u start %lu frames %lu crc %08lX used %u%s\n",
+                      static_cast<unsigned long>(gLog.magic),
+                      gLog.seed,
+                      static_cast<unsigned long>(gLog.startTime),
+                      static_cast<unsigned long>(gLog.frames),
+                      static_cast<unsigned long>(gLog.frameCrc),
+                      gLog.used,
+                      gLog.wrapped ? " (wrapped)" : "");
+
+        for (const Checkpoint& c : gLog.checkpoints)
+        {
+            if (c.valid)
+            {
+                Serial.printf("[RECORD] checkpoint at byte %lu, %s\n",
+                              static_cast<unsigned long>(c.position),
+                              c.position >= gLog.written - gLog.used ? "replayable" : "dropped");
+            }
+        }
+
+        for (uint16_t i = 0; i < gLog.used; i += DUMP_LINE)
+        {
+            for (uint16_t j = i; j < i + DUMP_LINE && j < gLog.used; ++j)
+            {
+                Serial.printf("%02X", at(gLog.tail + j));
+            }
+            Serial.println();
+        }
+    }
+}
+
+void APP_RECORD::init()
+{
+    const bool armed = gLog.magic == LOG_MAGIC
+                    && gLog.mode == MODE_REPLAY_ARMED
+                    && esp_reset_reason() == ESP_RST_SW;
+
+    if (armed)
+    {
+        startReplay();
+    }
+    else
+    {
+        startRecording();
+    }
+}
+
+void APP_RECORD::process()
+{
+    if (gReplayRequested)
+    {
+        gReplayRequested = false;
+
+        const uint8_t from = replayStart();
+
+        if (from == NUM_CHECKPOINTS)
+        {
+            Serial.println("[RECORD] Log wrapped past every checkpoint, nothing to replay");
+        }
+        else
+        {
+            gRecording = false;
+            gLog.replayFrom = from;
+            gLog.mode = MODE_REPLAY_ARMED;
+            Serial.println("[RECORD] Restarting into replay");
+            Serial.flush();
+            esp_restart();
+        }
+    }
+
+    if (gDumpRequested)
+    {
+        gDumpRequested = false;
+        dump();
+    }
+
+    if (gRecording && checkpointDue())
+    {
+        gCheckpointDue = false;
+        takeCheckpoint();
+    }
+
+    if (!gReplaying)
+    {
+        return;
+    }
+
+    uint8_t type = 0;
+
+    // A frame or pot reading that sat at the head for a whole loop pass was not
+    // asked for at the same moment as when recording
+    if (gLeftForConsumer && gConsumed == gLeftMark && headDue(type))
+    {
+        consume();
+        gDiverged++;
+    }
+    gLeftForConsumer = false;
+
+    // The clock only moves on once everything recorded for this millisecond is out
+    if (!headDue(type))
+    {
+        gVirtualTime++;
+    }
+
+    while (headDue(type) && (type == EV_WAIT || type == EV_BLE))
+    {
+        if (type == EV_BLE)
+        {
+            deliverBle();
+        }
+        else
+        {
+            consume();
+        }
+    }
+
+    if (headDue(type))
+    {
+        gLeftForConsumer = true; // a frame or pot reading, taken by APP_LED / APP_SERVO this pass
+        gLeftMark = gConsumed;
+    }
+
+    if (gRemaining == 0)
+    {
+        finishReplay();
+    }
+}
+
+uint32_t APP_RECORD::now()
+{
+    if (gClockPinned)
+    {
+        return gPinnedTime;
+    }
+    return gReplaying ? gVirtualTime : millis() + gClockOffset;
+}
+
+void APP_RECORD::pinClock(uint32_t ms)
+{
+    gPinnedTime = ms;
+    gClockPinned = true;
+}
+
+void APP_RECORD::unpinClock()
+{
+    gClockPinned = false;
+}
+
+bool APP_RECORD::isReplaying()
+{
+    return gReplaying;
+}
+
+void APP_RECORD::setStartSettings(const APP_SETTINGS::Settings& settings)
+{
+    gLog.start = settings;
+}
+
+const APP_SETTINGS::Settings& APP_RECORD::startSettings()
+{
+    return gSnapshot ? gSnapshot->settings : gLog.start;
+}
+
+const APP_RECORD::Snapshot* APP_RECORD::snapshot()
+{
+    return gSnapshot;
+}
+
+bool APP_RECORD::bleWrite(Channel channel, const uint8_t* data, size_t length)
+{
+    if (gReplaying)
+    {
+        return false;
+    }
+
+    if (gRecording)
+    {
+        const uint8_t clipped = length > MAX_PAYLOAD ? MAX_PAYLOAD : static_cast<uint8_t>(length);
+        const uint8_t prefix[2] = { channel, clipped };
+        append(EV_BLE, prefix, sizeof(prefix), data, clipped);
+    }
+
+    return true;
+}
+
+int APP_RECORD::adcSample(uint8_t axis, int value)
+{
+    if (gRecording)
+    {
+        const uint8_t payload[3] = { axis, static_cast<uint8_t>(value), static_cast<uint8_t>(value >> 8) };
+        append(EV_ADC, payload, sizeof(payload), nullptr, 0);
+        return value;
+    }
+
+    if (!gReplaying)
+    {
+        return value;
+    }
+
+    uint8_t type = 0;
+    if (headDue(type) && type == EV_ADC && at(gCursor + 2) == axis)
+    {
+        const int recorded = at(gCursor + 3) | (at(gCursor + 4) << 8);
+        consume();
+        return recorded;
+    }
+
+    gDiverged++;
+    return value; // no recorded reading here, fall back to the real pot
+}
+
+bool APP_RECORD::frameDue()
+{
+    uint8_t type = 0;
+    if (headDue(type) && type == EV_FRAME)
+    {
+        consume();
+        return true;
+    }
+    return false;
+}
+
+void APP_RECORD::frameRendered(const uint8_t* pixels, size_t length, uint8_t brightness)
+{
+    if (gReplaying)
+    {
+        gReplayFrames++;
+        gReplayCrc = hashFrame(gReplayCrc, pixels, length, brightness);
+        return;
+    }
+
+    if (gRecording)
+    {
+        append(EV_FRAME, nullptr, 0, nullptr, 0);
+        gLog.frames++;
+        gLog.frameCrc = hashFrame(gLog.frameCrc, pixels, length, brightness);
+
+        for (Checkpoint& c : gLog.checkpoints)
+        {
+            if (c.valid)
+            {
+                c.frames++;
+                c.frameCrc = hashFrame(c.frameCrc, pixels, length, brightness);
+            }
+        }
+    }
+}
+
+void APP_RECORD::requestReplay()
+{
+    if (!gReplaying)
+    {
+        gReplayRequested = true;
+    }
+}
+
+void APP_RECORD::requestDump()
+{
+    gDumpRequested = true;
+}
+
+// FastLED's beat and EVERY_N helpers read the time through this when
+// USE_GET_MILLISECOND_TIMER is defined, so they follow the virtual clock too
+uint32_t get_millisecond_timer()
+{
+    return APP_RECORD::now();
+}
@@ -0,0 +1,526 @@
+/*
+ * File:        APP_SCENE.cpp
+ * Author:      Marcus Lechner
+ * Created:     2025-07-05
+ * Description: Scene slots and cue list playback against the record clock
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#include "APP_SCENE.hpp"
+#include "APP_MEMORY.hpp"
+#include "APP_LED.hpp"
+#include "APP_SERVO.hpp"
+#include "APP_SETTINGS.hpp"
+#include "APP_RECORD.hpp"
+#include "APP_CRC.hpp"
+#include <Arduino.h>
+#include <Preferences.h>
+
+namespace
+{
+    constexpr char NVS_NAMESPACE[] = "lamp";
+    constexpr char SCENES_KEY[] = "scenes";
+    constexpr char CUES_KEY[] = "cues";
+
+    // Bump when Scene, Cue or the records below change, older blobs are then ignored
+    constexpr uint8_t LAYOUT_VERSION = 1;
+
+    // Stored as one blob so a cue list is never half written
+    struct CueList
+    {
+        uint8_t count;
+        uint8_t loop;
+        APP_SCENE::Cue cues[APP_SCENE::MAX_CUES];
+    };
+
+    struct SceneRecord
+    {
+        uint8_t version;
+        uint8_t reserved[3];
+        APP_SCENE::Scene scenes[APP_SCENE::NUM_SCENES];
+        uint32_t crc;       // over everything before it
+    };
+
+    struct CueRecord
+    {
+        uint8_t version;
+        uint8_t reserved[3];
+        CueList list;
+        uint32_t crc;       // over everything before it
+    };
+
+    // Commands arrive on the BLE task and are applied by process() on the loop,
+    // which owns everything from gScenes down. The queue, the pending cue list,
+    // gShowing and gPlaying are shared, and only touched under gLock (gPlaying
+    // is only written by the loop, so the loop may read it without).
+    enum CommandType : uint8_t
+    {
+        COMMAND_STORE,
+        COMMAND_DEFINE,
+        COMMAND_RECALL,
+        COMMAND_SET_CUES,
+        COMMAND_PLAY,
+        COMMAND_STOP
+    };
+
+    struct Command
+    {
+        CommandType type;
+        uint8_t slot;
+        uint16_t fadeMs;
+        APP_SCENE::Scene scene;     // COMMAND_DEFINE only
+    };
+
+    constexpr uint8_t QUEUE_SIZE = 8;
+
+    portMUX_TYPE gLock = portMUX_INITIALIZER_UNLOCKED;
+
+    Command gQueue[QUEUE_SIZE];
+    uint8_t gQueueHead = 0;
+    uint8_t gQueueCount = 0;
+
+    CueList gPendingCues;           // carried by the one COMMAND_SET_CUES allowed in the queue
+    bool gCuesPending = false;
+
+    APP_SCENE::Scene gShowing;      // scene of the running cue, so stop() can remember it from any task
+    bool gShowingValid = false;
+
+    Preferences prefs;
+
+    APP_SCENE::Scene gScenes[APP_SCENE::NUM_SCENES]; // indexed directly by slot
+    CueList gCueList = {};
+
+    bool gPlaying = false;
+    uint8_t gCueIndex = 0;
+    uint32_t gCueDue = 0; // APP_RECORD::now() at which the next cue starts
+
+    template <typename Record>
+    uint32_t recordCrc(const Record& record)
+    {
+        return APP_CRC::crc32(reinterpret_cast<const uint8_t*>(&record), offsetof(Record, crc));
+    }
+
+    template <typename Record>
+    bool loadRecord(const char* key, Record& record)
+    {
+        if (prefs.getBytesLength(key) != sizeof(record))
+        {
+            return false;
+        }
+
+        prefs.getBytes(key, &record, sizeof(record));
+        return record.version == LAYOUT_VERSION && record.crc == recordCrc(record);
+    }
+
+    template <typename Record>
+    void saveRecord(const char* key, Record& record)
+    {
+        record.version = LAYOUT_VERSION;
+        memset(record.reserved, 0, sizeof(record.reserved));
+        record.crc = recordCrc(record);
+
+        if (prefs.putBytes(key, &record, sizeof(record)) != sizeof(record))
+        {
+            Serial.printf("[SCENE] Write of %s failed\n", key);
+        }
+    }
+
+    // A replay runs the recorded writes again, it must not change what is stored
+    void saveScenes()
+    {
+        if (!APP_RECORD::isReplaying())
+        {
+            SceneRecord record;
+            memcpy(record.scenes, gScenes, sizeof(gScenes));
+            saveRecord(SCENES_KEY, record);
+        }
+    }
+
+    void saveCues()
+    {
+        if (!APP_RECORD::isReplaying())
+        {
+            CueRecord record;
+            record.list = gCueList;
+            saveRecord(CUES_KEY, record);
+        }
+    }
+
+    bool post(const Command& command)
+    {
+        bool posted = false;
+
+        portENTER_CRITICAL(&gLock);
+        if (gQueueCount < QUEUE_SIZE)
+        {
+            gQueue[(gQueueHead + gQueueCount) % QUEUE_SIZE] = command;
+            gQueueCount++;
+            posted = true;
+        }
+        portEXIT_CRITICAL(&gLock);
+
+        return posted;
+    }
+
+    bool take(Command& command)
+    {
+        bool taken = false;
+
+        portENTER_CRITICAL(&gLock);
+        if (gQueueCount > 0)
+        {
+            command = gQueue[gQueueHead];
+            gQueueHead = (gQueueHead + 1) % QUEUE_SIZE;
+            gQueueCount--;
+            taken = true;
+        }
+        portEXIT_CRITICAL(&gLock);
+
+        return taken;
+    }
+
+    void setShowing(const APP_SCENE::Scene* scene)
+    {
+        portENTER_CRITICAL(&gLock);
+        if (scene != nullptr)
+        {
+            gShowing = *scene;
+        }
+        gShowingValid = scene != nullptr;
+        portEXIT_CRITICAL(&gLock);
+    }
+
+    void apply(const APP_SCENE::Scene& s, uint16_t fadeMs)
+    {
+        APP_LED::startCrossfade(fadeMs);
+        APP_LED::setSolidColor(s.red, s.green, s.blue);
+        APP_LED::setAnimation(s.pattern);
+        APP_LED::setBrightness(s.brightness);
+        APP_SERVO::setPosition(s.shutter, fadeMs); // shutter travels with the light crossfade
+    }
+
+    // What the lamp comes back up with after a reboot
+    void remember(const APP_SCENE::Scene& s)
+    {
+        APP_SETTINGS::setSolidColor(s.red, s.green, s.blue);
+        APP_SETTINGS::setPattern(s.pattern);
+        APP_SETTINGS::setShutter(s.shutter);
+    }
+
+    // Cues are scheduled from the start of the one before, not from when the
+    // loop got round to it, so a long show does not drift by a loop pass per cue
+    void startCue(uint8_t index, uint32_t start)
+    {
+        const APP_SCENE::Cue& cue = gCueList.cues[index];
+        const APP_SCENE::Scene* scene = APP_SCENE::get(cue.scene);
+
+        gCueIndex = index;
+        if (scene != nullptr)
+        {
+            apply(*scene, cue.fadeMs); // not remembered, a running show would keep the settings busy
+            setShowing(scene);
+        }
+
+        // next cue fires once this one has faded in and held
+        gCueDue = start + cue.fadeMs + cue.holdMs;
+    }
+
+    // ----------- Loop side of the commands -----------
+
+    void setPlaying(bool playing)
+    {
+        portENTER_CRITICAL(&gLock);
+        gPlaying = playing;
+        if (!playing)
+        {
+            gShowingValid = false;
+        }
+        portEXIT_CRITICAL(&gLock);
+    }
+
+    void storeScene(uint8_t slot)
+    {
+        APP_SCENE::Scene& s = gScenes[slot];
+        APP_LED::getSolidColor(s.red, s.green, s.blue);
+        s.pattern = APP_LED::getAnimation();
+        s.shutter = static_cast<uint8_t>(APP_SERVO::getPosition());
+        s.brightness = APP_LED::getBrightness();
+        s.valid = 1;
+        s.reserved = 0;
+
+        saveScenes();
+    }
+
+    void defineScene(uint8_t slot, const APP_SCENE::Scene& scene)
+    {
+        gScenes[slot] = scene;
+        gScenes[slot].valid = 1;
+        gScenes[slot].reserved = 0;
+
+        saveScenes();
+    }
+
+    void recallScene(uint8_t slot, uint16_t fadeMs)
+    {
+        const APP_SCENE::Scene* s = APP_SCENE::get(slot);
+
+        if (s == nullptr)
+        {
+            Serial.printf("[SCENE] Recall of empty slot %u\n", slot);
+            return;
+        }
+
+        apply(*s, fadeMs);
+        remember(*s);
+    }
+
+    void setCueList()
+    {
+        setPlaying(false);
+
+        portENTER_CRITICAL(&gLock);
+        gCueList = gPendingCues;
+        gCuesPending = false;
+        portEXIT_CRITICAL(&gLock);
+
+        saveCues();
+    }
+
+    void playCues()
+    {
+        if (gCueList.count == 0)
+        {
+            Serial.println("[SCENE] Play with an empty cue list");
+            return;
+        }
+
+        setPlaying(true);
+        startCue(0, APP_RECORD::now());
+    }
+
+    void run(const Command& command)
+    {
+        switch (command.type)
+        {
+            case COMMAND_STORE:    storeScene(command.slot);                  break;
+            case COMMAND_DEFINE:   defineScene(command.slot, command.scene);  break;
+            case COMMAND_RECALL:   recallScene(command.slot, command.fadeMs); break;
+            case COMMAND_SET_CUES: setCueList();                              break;
+            case COMMAND_PLAY:     playCues();                                break;
+            case COMMAND_STOP:     setPlaying(false);                            break;
+        }
+    }
+}
+
+void APP_SCENE::init()
+{
+    APP_MEMORY::Scope memory(APP_MEMORY::MODULE_SCENE);
+    prefs.begin(NVS_NAMESPACE, false);
+
+    SceneRecord scenes;
+    if (loadRecord(SCENES_KEY, scenes))
+    {
+        memcpy(gScenes, scenes.scenes, sizeof(gScenes));
+    }
+
+    CueRecord cues;
+    if (loadRecord(CUES_KEY, cues) && cues.list.count <= MAX_CUES)
+    {
+        gCueList = cues.list;
+    }
+
+    // a replay from a checkpoint picks the show up where it was
+    const APP_RECORD::Snapshot* snapshot = APP_RECORD::snapshot();
+    if (snapshot != nullptr && snapshot->scenePlaying && snapshot->sceneCue < gCueList.count)
+    {
+        setPlaying(true);
+        gCueIndex = snapshot->sceneCue;
+        gCueDue = snapshot->sceneCueDue;
+        setShowing(get(gCueList.cues[gCueIndex].scene));
+    }
+}
+
+void APP_SCENE::process()
+{
+    Command command;
+    while (take(command))
+    {
+        run(command);
+    }
+
+    if (!gPlaying || static_cast<int32_t>(APP_RECORD::now() - gCueDue) < 0)
+    {
+        return;
+    }
+
+    uint8_t next = gCueIndex + 1;
+
+    if (next >= gCueList.count)
+    {
+        if (!gCueList.loop)
+        {
+            // the show ends on its current scene, keep that one across a reboot
+            const Scene* s = get(gCueList.cues[gCueIndex].scene);
+            if (s != nullptr)
+            {
+                remember(*s);
+            }
+            setPlaying(false);
+            return;
+        }
+        next = 0;
+    }
+
+    startCue(next, gCueDue);
+}
+
+bool APP_SCENE::store(uint8_t slot)
+{
+    Command command = {};
+    command.type = COMMAND_STORE;
+    command.slot = slot;
+
+    return slot < NUM_SCENES && post(command);
+}
+
+bool APP_SCENE::define(uint8_t slot, const Scene& scene)
+{
+    Command command = {};
+    command.type = COMMAND_DEFINE;
+    command.slot = slot;
+    command.scene = scene;
+
+    return slot < NUM_SCENES && post(command);
+}
+
+bool APP_SCENE::recall(uint8_t slot, uint16_t fadeMs)
+{
+    Command command = {};
+    command.type = COMMAND_RECALL;
+    command.slot = slot;
+    command.fadeMs = fadeMs;
+
+    return slot < NUM_SCENES && post(command);
+}
+
+const APP_SCENE::Scene* APP_SCENE::get(uint8_t slot)
+{
+    if (slot >= NUM_SCENES || !gScenes[slot].valid)
+    {
+        return nullptr;
+    }
+
+    return &gScenes[slot];
+}
+
+bool APP_SCENE::setCues(const Cue* cues, uint8_t count, bool loop)
+{
+    if (count > MAX_CUES)
+    {
+        return false;
+    }
+
+    bool posted = false;
+
+    // one cue list in flight at a time, it is too big to copy into every queue entry
+    portENTER_CRITICAL(&gLock);
+    if (!gCuesPending && gQueueCount < QUEUE_SIZE)
+    {
+        gPendingCues.count = count;
+        gPendingCues.loop = loop ? 1 : 0;
+        memset(gPendingCues.cues, 0, sizeof(gPendingCues.cues));
+        memcpy(gPendingCues.cues, cues, count * sizeof(Cue));
+        gCuesPending = true;
+
+        Command& command = gQueue[(gQueueHead + gQueueCount) % QUEUE_SIZE];
+        command = Command();
+        command.type = COMMAND_SET_CUES;
+        gQueueCount++;
+        posted = true;
+    }
+    portEXIT_CRITICAL(&gLock);
+
+    return posted;
+}
+
+bool APP_SCENE::play()
+{
+    Command command = {};
+    command.type = COMMAND_PLAY;
+
+    return post(command);
+}
+
+void APP_SCENE::stop()
+{
+    Scene showing;
+    bool wasShowing;
+    bool stopPending = false;
+    bool posted = true;
+
+    portENTER_CRITICAL(&gLock);
+
+    // Whatever a queued play or recall would show is superseded by the live
+    // write that follows, stored scenes and cue lists still go through
+    uint8_t kept = 0;
+    for (uint8_t i = 0; i < gQueueCount; ++i)
+    {
+        const Command& command = gQueue[(gQueueHead + i) % QUEUE_SIZE];
+        if (command.type != COMMAND_PLAY && command.type != COMMAND_RECALL)
+        {
+            stopPending = stopPending || command.type == COMMAND_STOP;
+            gQueue[(gQueueHead + kept) % QUEUE_SIZE] = command;
+            kept++;
+        }
+    }
+    gQueueCount = kept;
+
+    showing = gShowing;
+    wasShowing = gShowingValid;
+    gShowingValid = false;
+
+    // every live write calls this, only queue a stop when there is a show to stop
+    if (gPlaying && !stopPending)
+    {
+        if (gQueueCount < QUEUE_SIZE)
+        {
+            Command& command = gQueue[(gQueueHead + gQueueCount) % QUEUE_SIZE];
+            command = Command();
+            command.type = COMMAND_STOP;
+            gQueueCount++;
+        }
+        else
+        {
+            posted = false;
+        }
+    }
+    portEXIT_CRITICAL(&gLock);
+
+    // the show ends on its current scene, keep that one across a reboot. Done
+    // here rather than on the loop so the live write that follows still wins.
+    if (wasShowing)
+    {
+        remember(showing);
+    }
+
+    if (!posted)
+    {
+        Serial.println("[SCENE] Command queue full, stop dropped");
+    }
+}
+
+bool APP_SCENE::isPlaying()
+{
+    portENTER_CRITICAL(&gLock);
+    const bool playing = gPlaying;
+    portEXIT_CRITICAL(&gLock);
+
+    return playing;
+}
+
+void APP_SCENE::getPlayback(bool& playing, uint8_t& cue, uint32_t& due)
+{
+    playing = gPlaying;
+    cue = gCueIndex;
+    due = gCueDue;
+}
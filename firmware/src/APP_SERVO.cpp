@@ -2,34 +2,129 @@
  * File:        APP_SERVO.cpp
  * Author:      Marcus Lechner
  * Created:     2025-03-22
- * Description: Servo control implementation with smoothing and auto-release
+ * Description: Multi-axis servo control with potentiometer feedback, stall detection and auto-release
  * License:     Custom MIT License (Non-Commercial + Beerware)
  */
 
 
 #include "APP_SERVO.hpp"
 #include "APP_TIMER.hpp"
+#include "APP_MOTION.hpp"
+#include "APP_RECORD.hpp"
 #include <Arduino.h>
 #include <ESP32Servo.h>
+#include <Preferences.h>
 
-#define TEST_MODE 1  // Set to 0 to disable test mode
+#define TEST_MODE 0  // Set to 1 to log command and pot position while moving
 
 namespace //unamed (anonymous) namespace, everything inside this namespace is private to this.cpp file
 {  
-    constexpr int SERVO_PIN = 18;
-    constexpr int POT_PIN = 34;
+    constexpr int NO_POT = -1;
+
+    struct AxisConfig
+    {
+        int servoPin;
+        int potPin;          // NO_POT for axes without feedback
+        int pulseClosedUs;   // pulse width at CLOSED_POSITION
+        int pulseOpenUs;     // pulse width at OPEN_POSITION
+        const char* calKey;  // NVS key for this axis' pot calibration
+    };
+
+    // One entry per actuator on this fixture variant, order defines the axis index.
+    // Axis 0 is the main shutter.
+    constexpr AxisConfig AXES[APP_SERVO::NUM_AXES] =
+    {
+        { 18, 34, 500, 2400, "servo_cal" },
+    };
+
+    constexpr int SERVO_TIMER = 0;       // all axes run at 50 Hz and share one LEDC timer
     constexpr int CLOSED_POSITION = 0;   // Servo position for fully closed
     constexpr int OPEN_POSITION = 100;   // Servo position for fully ope
     constexpr int refresh_period = 20; // 50ms refresh period for the servo
 
+    // Output is driven as a pulse width rather than an integer angle. The LEDC
+    // timer behind ESP32Servo latches a new duty at the start of the next 20 ms
+    // period, so updating once per servo tick stays in step with the servo frame.
+    constexpr int32_t POS_SCALE = 100;     // internal positions are 1/100 %, 0-10000
+    constexpr int32_t FULL_SCALE = OPEN_POSITION * POS_SCALE;
+    constexpr int32_t DEFAULT_SLEW = POS_SCALE; // 1% per tick, full travel in 2 s
+
+    // Feedback from the potentiometers
+    constexpr uint8_t ADC_OVERSAMPLE = 16;     // raw reads averaged per servo tick
+    constexpr uint8_t ADC_FILTER_SHIFT = 2;    // IIR filter, new = old + (sample - old) / 4
+    constexpr int MIN_CAL_SPAN = 400;          // ADC counts between endpoints, less means no pot fitted
+    constexpr int MAX_CAL_NOISE = 60;          // filtered ADC wander at rest, a floating input wanders further
+    constexpr int16_t NO_FEEDBACK_ADC = -1;    // stored in both endpoints when calibration found no pot
+
+    // Closed loop tuning, in servo ticks (20 ms) and percent
+    constexpr int POSITION_TOLERANCE = 1;      // close enough to release
+    constexpr int MAX_TRIM = 5;                // how far the command may be offset to correct the linkage
+    constexpr uint8_t SETTLE_TICKS = 3;        // consecutive in-tolerance ticks before release
+    constexpr uint8_t SETTLE_TIMEOUT_TICKS = 50;
+    constexpr uint8_t STALL_WINDOW_TICKS = 15; // no progress for this long while driving = stalled
+    constexpr int STALL_MIN_PROGRESS = 2;
+    constexpr int STALL_LAG = 10;              // axis this far behind the moving command = not following
+    constexpr uint8_t CAL_SETTLE_TICKS = 60;   // time given to reach each endpoint while calibrating
+    constexpr uint8_t CAL_NOISE_TICKS = 20;    // last ticks at each endpoint, the axis is at rest by then
+    constexpr uint8_t TEST_MODE_TICKS = 10;    // log every 10th tick while moving, 5 lines/s
+
+    constexpr char NVS_NAMESPACE[] = "lamp";
+
     enum State
     {
         IDLE,
-        MOVING
+        MOVING,      // motion engine ramping the command towards the target
+        SETTLING,    // command at target, trimming until the pot agrees
+        CAL_CLOSED,  // auto-calibration, driving to the closed endpoint
+        CAL_OPEN     // auto-calibration, driving to the open endpoint
+    };
+
+    struct Calibration
+    {
+        int16_t adcClosed;
+        int16_t adcOpen;
+    };
+
+    // Closed loop state for one actuator, the trajectory itself lives in the motion engine
+    struct Axis
+    {
+        Servo servo;
+        State state = IDLE;
+        int desired = OPEN_POSITION / 2;  // percent open, default to mid position
+        Calibration calibration = {0, 0};
+        bool feedbackValid = false;       // calibrated and the pot moves with the axis
+        int filteredAdc = -1;             // -1 until the first sample
+        int trim = 0;                     // closed loop correction added to the command, percent
+        uint8_t stateTicks = 0;
+        uint8_t settledTicks = 0;
+        uint8_t lagTicks = 0;
+        int stallReference = 0;           // measured position at the start of the stall window
+
+        // pot checks while calibrating, a floating ADC pin can show any span
+        int calPrevious = 0;
+        int calRise = 0;                  // summed upward steps during the sweep to open
+        int calFall = 0;                  // summed downward steps during the sweep to open
+        int calMin = 0;                   // range at rest at the current endpoint
+        int calMax = 0;
+        int calNoise = 0;                 // worst range at rest over both endpoints
+    };
+
+    Timer servo_timer(refresh_period, true); // 20ms timer for servo refresh
+    volatile bool gCalibrationRequested = false; // set from the BLE task, started by process()
+
+    // Moves are asked for on the BLE task (writes, scene recalls) but the
+    // motion engine and axes[] belong to the loop. A move is posted here under
+    // gMoveLock and taken over by process(), the newest post per axis wins.
+    struct PendingMoves
+    {
+        bool posted[APP_SERVO::NUM_AXES];
+        int position[APP_SERVO::NUM_AXES];     // percent, already clamped
+        uint16_t fadeMs[APP_SERVO::NUM_AXES];
+        bool together;                         // from moveAll(), every axis arrives on the same tick
     };
 
-    Timer servo_timer(refresh_period, true); // 50ms timer for servo refresh
-    Timer servo_wait_timer(1000, true); // 2 second timer for servo wait
+    portMUX_TYPE gMoveLock = portMUX_INITIALIZER_UNLOCKED;
+    PendingMoves gPendingMoves = {};
 
     ///------------about constexpr: qualifiers and specifiers------------------///
     //constexpr is known as a compile-time constant, it is evaluated at compile time and can be used in switch statements, array sizes, etc.
@@ -50,98 +145,544 @@ namespace //unamed (anonymous) namespace, everything inside this namespace is pr
     //constexpr is  a specifier because it specifies to the compiler what the behavior of the data type is, ie it cannot
     //be seen outside of this file
 
-    Servo myservo;
-    int previous_val = 0;
-    int steps_til_release = 0;
-    int desired_position = OPEN_POSITION/2; // Default to mid position
-    int current_position = desired_position; // Default to mid position
-}
+    Axis axes[APP_SERVO::NUM_AXES];
+    MotionEngine<APP_SERVO::NUM_AXES> motion(DEFAULT_SLEW, refresh_period);
+    Preferences prefs;
 
+    // Position in 1/100 % to pulse width, rounded to the nearest microsecond
+    // (~0.1 degree on a 180 degree servo, against 1.8 degrees per percent before)
+    void writePulse(uint8_t i, int32_t positionCp)
+    {
+        const AxisConfig& cfg = AXES[i];
+        int32_t command = constrain(positionCp, static_cast<int32_t>(0), FULL_SCALE);
+        int32_t us = cfg.pulseClosedUs + ((cfg.pulseOpenUs - cfg.pulseClosedUs) * command + FULL_SCALE / 2) / FULL_SCALE;
+        axes[i].servo.writeMicroseconds(static_cast<int>(us));
+    }
 
-/**
- *  @brief Sets the desired servo position in percent (0-100)
- *  @param position Desired position in percent (0 = closed, 100 = open)
- */
+    void writeCommand(uint8_t i)
+    {
+        writePulse(i, motion.position(i) + axes[i].trim * POS_SCALE);
+    }
 
-void APP_SERVO::setPosition(int position)
-{
-    if(position < CLOSED_POSITION) position = CLOSED_POSITION;
-    if(position > OPEN_POSITION) position = OPEN_POSITION;
-    desired_position = position;
-}
+    int commandPercent(uint8_t i)
+    {
+        return static_cast<int>(motion.position(i) / POS_SCALE);
+    }
 
-void APP_SERVO::init()
-{
-    ESP32PWM::allocateTimer(0);
-    myservo.setPeriodHertz(50);
-    myservo.attach(SERVO_PIN, 500, 2400);
-    myservo.write(current_position);
-}
+    // Oversampled and IIR filtered pot reading, called once per servo tick
+    void sampleAdc(uint8_t i)
+    {
+        Axis& a = axes[i];
+        uint32_t sum = 0;
 
-void APP_SERVO::process()
-{
-    static State servo_state = IDLE;
+        for (uint8_t n = 0; n < ADC_OVERSAMPLE; ++n)
+        {
+            sum += analogRead(AXES[i].potPin);
+        }
+        int sample = APP_RECORD::adcSample(i, static_cast<int>(sum / ADC_OVERSAMPLE));
+
+        if (a.filteredAdc < 0)
+        {
+            a.filteredAdc = sample;
+        }
+        else
+        {
+            a.filteredAdc += (sample - a.filteredAdc) >> ADC_FILTER_SHIFT;
+        }
+    }
+
+    // Pot reading as percent open, using the calibrated endpoints
+    int measuredPosition(uint8_t i)
+    {
+        const Axis& a = axes[i];
+        int span = a.calibration.adcOpen - a.calibration.adcClosed; // may be negative if the pot is reversed
+        int percent = ((a.filteredAdc - a.calibration.adcClosed) * OPEN_POSITION + span / 2) / span;
+        return constrain(percent, CLOSED_POSITION, OPEN_POSITION);
+    }
 
-    if(servo_timer.expired()) // Check if the timer has expired)
+    bool calibrationUsable(const Calibration& cal)
     {
-        servo_timer.start(); // Start the servo refresh timer
-        
-        switch (servo_state)
+        return abs(cal.adcOpen - cal.adcClosed) >= MIN_CAL_SPAN;
+    }
+
+    // A real pot moves one way through the sweep and stays put at the ends. A
+    // floating input drifts both ways and never settles, whatever span it shows.
+    bool feedbackPlausible(const Axis& a)
+    {
+        const int span = abs(a.calibration.adcOpen - a.calibration.adcClosed);
+        const int against = a.calRise < a.calFall ? a.calRise : a.calFall;
+        return a.calNoise <= MAX_CAL_NOISE && against <= span / 4;
+    }
+
+    void saveCalibration(uint8_t i)
+    {
+        if (!APP_RECORD::isReplaying()) // a replay must not change the fixture
+        {
+            prefs.putBytes(AXES[i].calKey, &axes[i].calibration, sizeof(axes[i].calibration));
+        }
+    }
+
+    void enterState(uint8_t i, State state)
+    {
+        Axis& a = axes[i];
+        a.state = state;
+        a.stateTicks = 0;
+        a.settledTicks = 0;
+        a.lagTicks = 0;
+        a.stallReference = a.feedbackValid ? measuredPosition(i) : commandPercent(i);
+    }
+
+    void release(uint8_t i)
+    {
+        axes[i].servo.release();
+        enterState(i, IDLE);
+    }
+
+    // Returns true when the axis stays well behind the ramping command for a full
+    // window. Comparing against the command rather than raw progress keeps slow
+    // fades from looking like stalls.
+    bool lagging(uint8_t i, int measured)
+    {
+        Axis& a = axes[i];
+
+        if (abs(commandPercent(i) - measured) <= STALL_LAG)
+        {
+            a.lagTicks = 0;
+            return false;
+        }
+
+        return ++a.lagTicks >= STALL_WINDOW_TICKS;
+    }
+
+    // Returns true when the axis has not moved for a full window while it should have
+    bool stalled(uint8_t i, int measured)
+    {
+        Axis& a = axes[i];
+
+        if (a.stateTicks % STALL_WINDOW_TICKS != 0)
+        {
+            return false;
+        }
+
+        bool stuck = abs(measured - a.stallReference) < STALL_MIN_PROGRESS &&
+                     abs(a.desired - measured) > POSITION_TOLERANCE;
+        a.stallReference = measured;
+        return stuck;
+    }
+
+    // Tracks the pot through one calibration tick, see feedbackPlausible()
+    void checkCalibrationSample(uint8_t i)
+    {
+        Axis& a = axes[i];
+        const int sample = a.filteredAdc;
+        const int step = sample - a.calPrevious;
+        a.calPrevious = sample;
+
+        if (a.stateTicks <= CAL_SETTLE_TICKS - CAL_NOISE_TICKS)
+        {
+            if (a.state == CAL_OPEN)
+            {
+                if (step > 0) a.calRise += step;
+                else          a.calFall -= step;
+            }
+            a.calMin = sample;
+            a.calMax = sample;
+            return;
+        }
+
+        if (sample < a.calMin) a.calMin = sample;
+        if (sample > a.calMax) a.calMax = sample;
+        if (a.calMax - a.calMin > a.calNoise)
+        {
+            a.calNoise = a.calMax - a.calMin;
+        }
+    }
+
+    void processCalibration(uint8_t i)
+    {
+        Axis& a = axes[i];
+
+        ++a.stateTicks;
+        checkCalibrationSample(i);
+
+        if (a.stateTicks < CAL_SETTLE_TICKS)
+        {
+            return;
+        }
+
+        if (a.state == CAL_CLOSED)
+        {
+            a.calibration.adcClosed = static_cast<int16_t>(a.filteredAdc);
+            writePulse(i, FULL_SCALE);
+            enterState(i, CAL_OPEN);
+            return;
+        }
+
+        a.calibration.adcOpen = static_cast<int16_t>(a.filteredAdc);
+        a.feedbackValid = calibrationUsable(a.calibration) && feedbackPlausible(a);
+
+        if (a.feedbackValid)
+        {
+            Serial.printf("[SERVO] Axis %u calibrated: closed %d, open %d, noise %d\n", i,
+                          a.calibration.adcClosed, a.calibration.adcOpen, a.calNoise);
+        }
+        else
+        {
+            Serial.printf("[SERVO] Axis %u has no feedback from its pot (span %d, noise %d, against %d/%d), running open loop\n", i,
+                          a.calibration.adcOpen - a.calibration.adcClosed, a.calNoise, a.calRise, a.calFall);
+
+            // remembered, so later boots don't sweep again until asked to
+            a.calibration.adcClosed = NO_FEEDBACK_ADC;
+            a.calibration.adcOpen = NO_FEEDBACK_ADC;
+        }
+        saveCalibration(i);
+
+        // head back to wherever we were asked to be
+        a.trim = 0;
+        motion.reset(i, FULL_SCALE);
+        motion.moveTo(i, a.desired * POS_SCALE, 0);
+        enterState(i, MOVING);
+    }
+
+    void startCalibration(uint8_t i)
+    {
+        if (AXES[i].potPin == NO_POT)
+        {
+            return;
+        }
+
+        Axis& a = axes[i];
+        a.trim = 0;
+        a.feedbackValid = false;
+        a.calPrevious = a.filteredAdc;
+        a.calRise = 0;
+        a.calFall = 0;
+        a.calNoise = 0;
+        writePulse(i, 0);
+        enterState(i, CAL_CLOSED);
+    }
+
+    bool isCalibrating(uint8_t i)
+    {
+        return axes[i].state == CAL_CLOSED || axes[i].state == CAL_OPEN;
+    }
+
+    int clampPosition(int position)
+    {
+        if(position < CLOSED_POSITION) position = CLOSED_POSITION;
+        if(position > OPEN_POSITION) position = OPEN_POSITION;
+        return position;
+    }
+
+    PendingMoves takePendingMoves()
+    {
+        portENTER_CRITICAL(&gMoveLock);
+        const PendingMoves moves = gPendingMoves;
+        gPendingMoves = PendingMoves();
+        portEXIT_CRITICAL(&gMoveLock);
+        return moves;
+    }
+
+    // Loop only: hands posted moves to the motion engine. An axis that is
+    // calibrating keeps its sweep and heads for the new position afterwards.
+    void applyPendingMoves()
+    {
+        const PendingMoves moves = takePendingMoves();
+
+        if (moves.together)
+        {
+            int32_t targets[APP_SERVO::NUM_AXES];
+            for (uint8_t i = 0; i < APP_SERVO::NUM_AXES; ++i)
+            {
+                axes[i].desired = moves.position[i];
+                targets[i] = isCalibrating(i) ? motion.target(i) : axes[i].desired * POS_SCALE;
+            }
+            motion.moveAll(targets, moves.fadeMs[0]);
+            return;
+        }
+
+        for (uint8_t i = 0; i < APP_SERVO::NUM_AXES; ++i)
+        {
+            if (!moves.posted[i])
+            {
+                continue;
+            }
+
+            axes[i].desired = moves.position[i];
+            if (!isCalibrating(i))
+            {
+                motion.moveTo(i, axes[i].desired * POS_SCALE, moves.fadeMs[i]);
+            }
+        }
+    }
+
+    // Per-axis closed loop, runs after the motion engine has stepped every axis
+    void processAxis(uint8_t i)
+    {
+        Axis& a = axes[i];
+
+        if (a.feedbackValid || isCalibrating(i))
+        {
+            sampleAdc(i);
+        }
+
+        switch (a.state)
         {
             case IDLE:
-                if (desired_position != current_position)
+                if (motion.isMoving(i))
                 {
-                    servo_state = MOVING;
-                    // servo_wait_timer.start(); // Start the wait timer when we begin moving
-                    // servo_timer.start(); // Start the servo refresh timer
-                }
-                else
-                {   
-                    myservo.release(); // Release the servo if at desired position
-                    // if(servo_wait_timer.expired())
-                    // {
-                    //     //make up new position
-                    //     desired_position = desired_position + (OPEN_POSITION/2);
-                    //     desired_position = desired_position % OPEN_POSITION;
-                    // }
+                    enterState(i, MOVING);
+                    writeCommand(i);
                 }
                 break;
 
             case MOVING:
-                // This section simulates the behavior of a potentiometer using a simple algorithm.
-                // It creates a fake ADC value that oscillates between ADC_MIN and ADC_MAX.
-                
-                static int fake_adc = CLOSED_POSITION;
-                static bool rising = true;
-                if(desired_position > current_position) 
+            {
+                writeCommand(i);
+                a.stateTicks++;
+
+#if TEST_MODE
+                if (a.stateTicks % TEST_MODE_TICKS == 1)
                 {
-                    current_position++;
-                } 
-                else if(desired_position < current_position) 
+                    Serial.printf("[SERVO] axis %u command %ld.%02ld measured %d\n", i,
+                                  static_cast<long>(motion.position(i) / POS_SCALE), static_cast<long>(motion.position(i) % POS_SCALE),
+                                  a.feedbackValid ? measuredPosition(i) : -1);
+                }
+#endif
+
+                if (a.feedbackValid && lagging(i, measuredPosition(i)))
                 {
-                    current_position--;
+                    Serial.printf("[SERVO] Axis %u stalled at %d%% (target %d%%), releasing\n", i, measuredPosition(i), a.desired);
+                    a.desired = measuredPosition(i);
+                    motion.reset(i, a.desired * POS_SCALE);
+                    release(i);
+                    break;
                 }
-            
-                Serial.print("current_position ");
-                Serial.println(current_position);
-                int val = current_position;
-                // -----------------------------------------
-
-                val = map(val, CLOSED_POSITION, OPEN_POSITION, 0, 180);
-
-                Serial.print("val ");
-                Serial.println(val);
-                myservo.write(val);
-                
-                if(current_position == desired_position)
+
+                if (!motion.isMoving(i))
                 {
-                    servo_state = IDLE;
-                    // servo_wait_timer.start(); // Start the wait timer when we reach the desired position
-                    // servo_timer.stop(); // Stop the servo refresh timer
+                    if (a.feedbackValid)
+                    {
+                        enterState(i, SETTLING);
+                    }
+                    else
+                    {
+                        release(i); // open loop, trust the servo
+                    }
                 }
+                break;
+            }
 
+            case SETTLING:
+            {
+                if (motion.isMoving(i))
+                {
+                    enterState(i, MOVING); // new target arrived while settling
+                    break;
+                }
 
+                const int measured = measuredPosition(i);
+                const int error = a.desired - measured;
+                a.stateTicks++;
+
+                if (abs(error) <= POSITION_TOLERANCE)
+                {
+                    if (++a.settledTicks >= SETTLE_TICKS)
+                    {
+                        release(i); // in position, stop driving the servo to save power
+                    }
+                    break;
+                }
+
+                a.settledTicks = 0;
+
+                if (stalled(i, measured) || a.stateTicks >= SETTLE_TIMEOUT_TICKS)
+                {
+                    Serial.printf("[SERVO] Axis %u could not settle at %d%% (measured %d%%), releasing\n", i, a.desired, measured);
+                    release(i);
+                    break;
+                }
+
+                // integrate the remaining error into the command offset
+                a.trim = constrain(a.trim + (error > 0 ? 1 : -1), -MAX_TRIM, MAX_TRIM);
+                writeCommand(i);
+                break;
+            }
+
+            case CAL_CLOSED:
+            case CAL_OPEN:
+                processCalibration(i);
                 break;
         }
     }
 }
+
+
+/**
+ *  @brief Sets the desired position of one axis in percent (0-100)
+ *  @param axis Axis index, 0 is the main shutter
+ *  @param position Desired position in percent (0 = closed, 100 = open)
+ *  @param fadeMs Time to spend getting there, 0 moves at the default speed
+ */
+
+void APP_SERVO::setAxisPosition(uint8_t axis, int position, uint16_t fadeMs)
+{
+    if (axis >= NUM_AXES)
+    {
+        return;
+    }
+
+    portENTER_CRITICAL(&gMoveLock);
+    gPendingMoves.posted[axis] = true;
+    gPendingMoves.position[axis] = clampPosition(position);
+    gPendingMoves.fadeMs[axis] = fadeMs;
+    gPendingMoves.together = false; // a single axis breaks up a coordinated move still waiting
+    portEXIT_CRITICAL(&gMoveLock);
+}
+
+void APP_SERVO::setPosition(int position, uint16_t fadeMs)
+{
+    setAxisPosition(0, position, fadeMs);
+}
+
+/**
+ *  @brief Moves every axis at once so they all arrive together
+ *  @param positions Desired position per axis in percent
+ *  @param fadeMs Time to spend getting there, 0 lets the longest move set the pace
+ */
+
+void APP_SERVO::moveAll(const int (&positions)[NUM_AXES], uint16_t fadeMs)
+{
+    portENTER_CRITICAL(&gMoveLock);
+    for (uint8_t i = 0; i < NUM_AXES; ++i)
+    {
+        gPendingMoves.posted[i] = true;
+        gPendingMoves.position[i] = clampPosition(positions[i]);
+        gPendingMoves.fadeMs[i] = fadeMs;
+    }
+    gPendingMoves.together = true;
+    portEXIT_CRITICAL(&gMoveLock);
+}
+
+int APP_SERVO::getPosition(uint8_t axis)
+{
+    if (axis >= NUM_AXES)
+    {
+        return 0;
+    }
+
+    // a move still waiting for the loop is already where the lamp is headed
+    portENTER_CRITICAL(&gMoveLock);
+    const int position = gPendingMoves.posted[axis] ? gPendingMoves.position[axis] : axes[axis].desired;
+    portEXIT_CRITICAL(&gMoveLock);
+    return position;
+}
+
+int APP_SERVO::getActualPosition(uint8_t axis)
+{
+    if (axis >= NUM_AXES)
+    {
+        return 0;
+    }
+    return axes[axis].feedbackValid ? measuredPosition(axis) : commandPercent(axis);
+}
+
+bool APP_SERVO::isMoving()
+{
+    for (uint8_t i = 0; i < NUM_AXES; ++i)
+    {
+        if (axes[i].state != IDLE)
+        {
+            return true; // servo is powered and driving in every other state
+        }
+    }
+    return false;
+}
+
+bool APP_SERVO::hasFeedback(uint8_t axis)
+{
+    return axis < NUM_AXES && axes[axis].feedbackValid;
+}
+
+void APP_SERVO::calibrate()
+{
+    gCalibrationRequested = true; // may come from the BLE task, the sweep runs in process()
+}
+
+void APP_SERVO::init()
+{
+    ESP32PWM::allocateTimer(SERVO_TIMER);
+    prefs.begin(NVS_NAMESPACE, false);
+
+    // the restored settings were posted before the servo started, start there
+    const PendingMoves restored = takePendingMoves();
+    for (uint8_t i = 0; i < NUM_AXES; ++i)
+    {
+        if (restored.posted[i])
+        {
+            axes[i].desired = restored.position[i];
+        }
+    }
+
+    for (uint8_t i = 0; i < NUM_AXES; ++i)
+    {
+        const AxisConfig& cfg = AXES[i];
+        Axis& a = axes[i];
+
+        a.servo.setPeriodHertz(50);
+        a.servo.attach(cfg.servoPin, cfg.pulseClosedUs, cfg.pulseOpenUs);
+
+        if (cfg.potPin != NO_POT)
+        {
+            analogSetPinAttenuation(cfg.potPin, ADC_11db); // full 0-3.3V pot range
+            sampleAdc(i);
+
+            if (prefs.getBytesLength(cfg.calKey) != sizeof(a.calibration))
+            {
+                startCalibration(i); // first boot, find the endpoints before taking commands
+                continue;
+            }
+
+            prefs.getBytes(cfg.calKey, &a.calibration, sizeof(a.calibration));
+            a.feedbackValid = calibrationUsable(a.calibration);
+            if (!a.feedbackValid)
+            {
+                Serial.printf("[SERVO] Axis %u has no pot feedback stored, running open loop (CALIBRATE to retry)\n", i);
+            }
+        }
+
+        motion.reset(i, a.desired * POS_SCALE); // start where the restored settings left off
+        writeCommand(i);
+        enterState(i, a.feedbackValid ? SETTLING : IDLE);
+    }
+}
+
+void APP_SERVO::process()
+{
+    if(!servo_timer.expired()) // Check if the timer has expired)
+    {
+        return;
+    }
+
+    applyPendingMoves();
+
+    if (gCalibrationRequested)
+    {
+        gCalibrationRequested = false;
+        for (uint8_t i = 0; i < NUM_AXES; ++i)
+        {
+            if (axes[i].servo.attached())
+            {
+                startCalibration(i);
+            }
+        }
+    }
+
+    // one planning pass for every axis, then each axis' own feedback loop
+    motion.step();
+
+    for (uint8_t i = 0; i < NUM_AXES; ++i)
+    {
+        processAxis(i);
+    }
+}
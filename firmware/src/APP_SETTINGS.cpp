@@ -0,0 +1,280 @@
+/*
+ * File:        APP_SETTINGS.cpp
+ * Author:      Marcus Lechner
+ * Created:     2025-06-21
+ * Description: NVS backed settings with record rotation and write coalescing
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#include "APP_SETTINGS.hpp"
+#include "APP_MEMORY.hpp"
+#include "APP_TIMER.hpp"
+#include "APP_LED.hpp"
+#include "APP_SERVO.hpp"
+#include "APP_RECORD.hpp"
+#include "APP_CRC.hpp"
+#include <Arduino.h>
+#include <Preferences.h>
+
+namespace
+{
+    constexpr char NVS_NAMESPACE[] = "lamp";
+
+    // Records rotate over these keys. NVS already spreads writes over its pages,
+    // rotating also keeps the previous record intact if a write is interrupted.
+    const char* const RECORD_KEYS[] = { "set0", "set1", "set2", "set3" };
+    constexpr uint8_t NUM_RECORDS = sizeof(RECORD_KEYS) / sizeof(RECORD_KEYS[0]);
+
+    constexpr unsigned long QUIET_MS = 1500;     // commit after the user stops changing things
+    constexpr unsigned long MAX_DELAY_MS = 10000; // but never hold a change longer than this
+
+    Preferences prefs;
+
+    // The setters run on the BLE task, commits on the loop. Everything below
+    // gCommitted is shared between them and only touched under gLock. The
+    // flash write itself happens outside of it, on a copy.
+    portMUX_TYPE gLock = portMUX_INITIALIZER_UNLOCKED;
+
+    APP_SETTINGS::Settings gCommitted;  // what is in flash, loop only
+    APP_SETTINGS::Settings gCurrent;    // what the lamp is doing now
+
+    bool gDirty = false;
+    uint32_t gChanges = 0;
+    uint32_t gCommits = 0;
+
+    Timer quiet_timer(QUIET_MS, false);
+    Timer max_delay_timer(MAX_DELAY_MS, false);
+
+    uint32_t recordCrc(const APP_SETTINGS::Settings& s)
+    {
+        return APP_CRC::crc32(reinterpret_cast<const uint8_t*>(&s), offsetof(APP_SETTINGS::Settings, crc));
+    }
+
+    // Only the payload counts when deciding whether a write is needed
+    bool samePayload(const APP_SETTINGS::Settings& a, const APP_SETTINGS::Settings& b)
+    {
+        return memcmp(&a, &b, offsetof(APP_SETTINGS::Settings, sequence)) == 0;
+    }
+
+    void setDefaults(APP_SETTINGS::Settings& s)
+    {
+        memset(&s, 0, sizeof(s));
+        s.version = APP_SETTINGS::LAYOUT_VERSION;
+        s.red = 255;
+        s.green = 255;
+        s.blue = 255;
+        s.pattern = 0;
+        s.shutter = 50;
+    }
+
+    bool loadNewest(APP_SETTINGS::Settings& out)
+    {
+        bool found = false;
+
+        for (uint8_t i = 0; i < NUM_RECORDS; ++i)
+        {
+            APP_SETTINGS::Settings record;
+
+            if (prefs.getBytesLength(RECORD_KEYS[i]) != sizeof(record))
+            {
+                continue;
+            }
+
+            prefs.getBytes(RECORD_KEYS[i], &record, sizeof(record));
+
+            if (record.version != APP_SETTINGS::LAYOUT_VERSION || record.crc != recordCrc(record))
+            {
+                continue;
+            }
+
+            if (!found || record.sequence > out.sequence)
+            {
+                out = record;
+                found = true;
+            }
+        }
+
+        return found;
+    }
+
+    void commit()
+    {
+        APP_SETTINGS::Settings record;
+
+        portENTER_CRITICAL(&gLock);
+        gDirty = false;
+        quiet_timer.stop();
+        max_delay_timer.stop();
+        record = gCurrent;
+        portEXIT_CRITICAL(&gLock);
+
+        if (samePayload(record, gCommitted))
+        {
+            return; // changed and changed back, nothing to write
+        }
+
+        record.sequence = gCommitted.sequence + 1;
+        record.crc = recordCrc(record);
+
+        const char* key = RECORD_KEYS[record.sequence % NUM_RECORDS];
+        if (prefs.putBytes(key, &record, sizeof(record)) != sizeof(record))
+        {
+            Serial.println("[SETTINGS] Write failed");
+            return;
+        }
+
+        gCommitted = record;
+
+        portENTER_CRITICAL(&gLock);
+        gCommits++;
+        const uint32_t changes = gChanges;
+        portEXIT_CRITICAL(&gLock);
+
+        Serial.printf("[SETTINGS] Saved seq %lu (%lu changes, %lu writes)\n",
+                      static_cast<unsigned long>(gCommitted.sequence),
+                      static_cast<unsigned long>(changes),
+                      static_cast<unsigned long>(gCommits));
+    }
+
+    // Call with gLock held
+    void markDirty()
+    {
+        gChanges++;
+
+        if (!gDirty)
+        {
+            gDirty = true;
+            max_delay_timer.start();
+        }
+
+        quiet_timer.start(); // every change pushes the quiet window out again
+    }
+}
+
+void APP_SETTINGS::init()
+{
+    APP_MEMORY::Scope memory(APP_MEMORY::MODULE_SETTINGS);
+    prefs.begin(NVS_NAMESPACE, false);
+
+    setDefaults(gCommitted);
+    if (APP_RECORD::isReplaying())
+    {
+        gCommitted = APP_RECORD::startSettings(); // start exactly where the recording did
+    }
+    else
+    {
+        if (!loadNewest(gCommitted))
+        {
+            Serial.println("[SETTINGS] No valid record, using defaults");
+        }
+        APP_RECORD::setStartSettings(gCommitted);
+    }
+
+    gCurrent = gCommitted;
+
+    APP_LED::setSolidColor(gCurrent.red, gCurrent.green, gCurrent.blue);
+    APP_LED::setAnimation(gCurrent.pattern);
+    APP_SERVO::setPosition(gCurrent.shutter);
+    APP_LED::setPowerBudget(gCurrent.powerBudget);
+}
+
+void APP_SETTINGS::process()
+{
+    APP_MEMORY::Scope memory(APP_MEMORY::MODULE_SETTINGS);
+    if (APP_RECORD::isReplaying())
+    {
+        return; // a replay must not overwrite the saved settings, it is committed once it ends
+    }
+
+    portENTER_CRITICAL(&gLock);
+    const bool due = gDirty && (quiet_timer.expired() || max_delay_timer.expired());
+    portEXIT_CRITICAL(&gLock);
+
+    if (due)
+    {
+        commit();
+    }
+}
+
+void APP_SETTINGS::setSolidColor(uint8_t r, uint8_t g, uint8_t b)
+{
+    portENTER_CRITICAL(&gLock);
+    if (gCurrent.red != r || gCurrent.green != g || gCurrent.blue != b)
+    {
+        gCurrent.red = r;
+        gCurrent.green = g;
+        gCurrent.blue = b;
+        markDirty();
+    }
+    portEXIT_CRITICAL(&gLock);
+}
+
+void APP_SETTINGS::setPattern(uint8_t pattern)
+{
+    portENTER_CRITICAL(&gLock);
+    if (gCurrent.pattern != pattern)
+    {
+        gCurrent.pattern = pattern;
+        markDirty();
+    }
+    portEXIT_CRITICAL(&gLock);
+}
+
+void APP_SETTINGS::setShutter(uint8_t percent)
+{
+    portENTER_CRITICAL(&gLock);
+    if (gCurrent.shutter != percent)
+    {
+        gCurrent.shutter = percent;
+        markDirty();
+    }
+    portEXIT_CRITICAL(&gLock);
+}
+
+void APP_SETTINGS::setPowerBudget(uint16_t milliamps)
+{
+    portENTER_CRITICAL(&gLock);
+    if (gCurrent.powerBudget != milliamps)
+    {
+        gCurrent.powerBudget = milliamps;
+        markDirty();
+    }
+    portEXIT_CRITICAL(&gLock);
+}
+
+APP_SETTINGS::Settings APP_SETTINGS::get()
+{
+    portENTER_CRITICAL(&gLock);
+    const Settings current = gCurrent;
+    portEXIT_CRITICAL(&gLock);
+    return current;
+}
+
+uint32_t APP_SETTINGS::changeCount()
+{
+    portENTER_CRITICAL(&gLock);
+    const uint32_t changes = gChanges;
+    portEXIT_CRITICAL(&gLock);
+    return changes;
+}
+
+uint32_t APP_SETTINGS::commitCount()
+{
+    portENTER_CRITICAL(&gLock);
+    const uint32_t commits = gCommits;
+    portEXIT_CRITICAL(&gLock);
+    return commits;
+}
+
+void APP_SETTINGS::report()
+{
+    const uint32_t changes = changeCount();
+    const uint32_t commits = commitCount();
+
+    // flash writes per setter change, what the debounce saves
+    Serial.printf("[SETTINGS] %lu changes, %lu writes, %.1f%% written, seq %lu\n",
+                  static_cast<unsigned long>(changes),
+                  static_cast<unsigned long>(commits),
+                  changes ? commits * 100.0f / changes : 0.0f,
+                  static_cast<unsigned long>(gCommitted.sequence));
+}
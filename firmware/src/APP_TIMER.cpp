@@ -7,11 +7,12 @@
  */
 
 #include "APP_TIMER.hpp"
+#include "APP_RECORD.hpp"
 #include <Arduino.h>
 
 Timer::Timer(unsigned long intervalMs, bool startNow)
     : _interval(intervalMs),
-      _lastTime(startNow ? millis() : 0),
+      _lastTime(startNow ? APP_RECORD::now() : 0),
       _enabled(startNow)
 {}
 
@@ -26,7 +27,7 @@ Timer::Timer(unsigned long intervalMs, bool startNow)
 
 void Timer::start()
 {
-    _lastTime = millis();
+    _lastTime = APP_RECORD::now();
     _enabled = true;
 }
 void Timer::stop()
@@ -36,7 +37,7 @@ void Timer::stop()
 
 void Timer::reset()
 {
-    _lastTime = millis();
+    _lastTime = APP_RECORD::now();
 }
 
 bool Timer::expired()
@@ -44,7 +45,7 @@ bool Timer::expired()
     if (!_enabled)
         return false;
 
-    unsigned long now = millis();
+    unsigned long now = APP_RECORD::now(); // virtual while replaying
     if (now - _lastTime >= _interval)
     {
         _lastTime = now;
@@ -29,27 +29,111 @@
 #include "APP_TIMER.hpp"
 #include "APP_BLINKY.hpp"
 #include "APP_BLE.hpp"
+#include "APP_SETTINGS.hpp"
+#include "APP_BOOT.hpp"
+#include "APP_SCENE.hpp"
+#include "APP_CALIBRATION.hpp"
+#include "APP_AUDIO.hpp"
+#include "APP_RECORD.hpp"
+#include "APP_GOLDEN.hpp"
+#include "APP_CONSOLE.hpp"
+#include "APP_LATENCY.hpp"
+#include "APP_OTA.hpp"
+#include "APP_IDLE.hpp"
+#include "APP_MEMORY.hpp"
+#include "APP_PIXELNET.hpp"
+#include "APP_FRAMESTREAM.hpp"
 
 
 
 
+namespace
+{
+    bool servo_ready = false;
+
+    // BLEDevice::init() blocks for several hundred ms, so it runs on core 0
+    // (where the BLE host lives anyway) while loop() keeps rendering
+    void bleInitTask(void*)
+    {
+        APP_BLE::init();
+        APP_MEMORY::watchTask(xTaskGetHandle("BTC_TASK"), "ble"); // where the GATT callbacks run
+        APP_BOOT::mark(APP_BOOT::STAGE_BLE);
+        vTaskDelete(nullptr);
+    }
+}
+
 void setup()
 {
-    delay(3000);
+    // Stage 1: get light out of the strip as fast as possible
+    Serial.setTxBufferSize(APP_CONSOLE::TX_BUFFER); // room for a streamed frame, see APP_CONSOLE.hpp
     Serial.begin(115200);
-    delay(1000);
     Serial.println("Starting up...");
-    APP_BLINKY::init();   
-    APP_BLE::init();
-    APP_LED::init();
-    APP_SERVO::init();
+    APP_BOOT::mark(APP_BOOT::STAGE_SERIAL);
+
+    APP_RECORD::init();   // seeds the RNG and picks record or replay before anything reads the clock
+
+    APP_SETTINGS::init(); // restore before LED/servo start so they come up in the saved state
+    APP_SCENE::init();
+    APP_CALIBRATION::init(); // the output tables have to be ready for the first frame
+    APP_BOOT::mark(APP_BOOT::STAGE_SETTINGS);
+
+    APP_LED::init();      // renders and shows the restored scene immediately
+    APP_BOOT::mark(APP_BOOT::STAGE_LED);
 
+    APP_MEMORY::init();
+    APP_OTA::init();      // the rollback is armed by the bootloader, this only notes that it is
+    APP_BLINKY::init();
+    APP_IDLE::init();
+    APP_AUDIO::init();    // analysis runs on its own task from here on
+    APP_PIXELNET::init(); // credentials only, Wi-Fi comes up from loop()
+    APP_FRAMESTREAM::init();
+
+    // Stage 2: everything else comes up behind the running animation
+    xTaskCreatePinnedToCore(bleInitTask, "ble_init", 6144, nullptr, 1, nullptr, 0);
 }
 
 void loop()
 {
+    APP_RECORD::process(); // replayed input lands before anything else runs this pass
+    APP_CONSOLE::process();
     APP_BLINKY::process();
-    APP_BLE::process();
     APP_LED::process();
-    APP_SERVO::process();
-}
\ No newline at end of file
+
+    if (!APP_BOOT::isDone(APP_BOOT::STAGE_LOOP))
+    {
+        APP_BOOT::mark(APP_BOOT::STAGE_LOOP);
+    }
+    else if (!servo_ready)
+    {
+        APP_SERVO::init();
+        servo_ready = true;
+        APP_BOOT::mark(APP_BOOT::STAGE_SERVO);
+    }
+    else if (!APP_BOOT::isDone(APP_BOOT::STAGE_NETWORK))
+    {
+        APP_PIXELNET::connect();
+        APP_BOOT::mark(APP_BOOT::STAGE_NETWORK);
+    }
+
+    if (servo_ready)
+    {
+        APP_SERVO::process();
+    }
+
+    if (APP_BOOT::isDone(APP_BOOT::STAGE_BLE))
+    {
+        APP_BLE::process();
+    }
+
+    APP_SCENE::process();
+    APP_AUDIO::process();
+    APP_PIXELNET::process();
+    APP_FRAMESTREAM::process();
+    APP_SETTINGS::process();
+    APP_GOLDEN::process();
+    APP_LATENCY::process();
+    APP_OTA::process();
+    APP_MEMORY::process();
+    APP_BOOT::process();
+    APP_IDLE::process(); // last: blocks here while the lamp is idle
+}
@@ -0,0 +1,528 @@
+/*
+ * File:        SIM_HAL.cpp
+ * Author:      Marcus Lechner
+ * Created:     2025-10-18
+ * Description: Host Arduino core and FreeRTOS calls on the simulator's virtual clock
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#include "SIM_HAL.hpp"
+#include <Arduino.h>
+#include <ESP32Servo.h>
+#include <esp_system.h>
+#include <esp_timer.h>
+#include <poll.h>
+#include <unistd.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    uint64_t gMicros = 0;
+    const std::chrono::steady_clock::time_point gStarted = std::chrono::steady_clock::now();
+    char** gArgv = nullptr;
+    bool gRestarted = false;
+    uint32_t gRandom = 0x9E3779B9; // fixed, so a run repeats exactly
+    bool gNotified = false;
+    int gLoopTask = 0; // only its address is used, as the loop task's handle
+
+    // ---------------- Tasks ---------------- //
+
+    // One core: every task gets a thread, but only the one gRunning names may
+    // run. The loop task hands the core over between two passes whenever a
+    // task is due on the virtual clock and gets it back once the task waits.
+    struct Task
+    {
+        std::string name;
+        uint64_t wakeUs = 0;
+        bool ended = false;
+    };
+
+    // Never destroyed, a task still waiting at exit would hold up the destructor
+    std::mutex& gCoreLock = *new std::mutex;
+    std::condition_variable& gCoreChanged = *new std::condition_variable;
+    Task* gRunning = nullptr;           // nullptr while the loop task has the core
+    std::vector<Task*> gTasks;
+    thread_local Task* tCurrent = nullptr; // nullptr on the loop task
+
+    // Loop task: lets the task run until it waits or ends
+    void runTask(Task* task)
+    {
+        std::unique_lock<std::mutex> lock(gCoreLock);
+        gRunning = task;
+        gCoreChanged.notify_all();
+        gCoreChanged.wait(lock, [] { return gRunning == nullptr; });
+    }
+
+    // Task: gives the core back until the virtual clock reaches wakeUs
+    void sleepTask(uint64_t wakeUs)
+    {
+        Task* self = tCurrent;
+        std::unique_lock<std::mutex> lock(gCoreLock);
+        self->wakeUs = wakeUs;
+        gRunning = nullptr;
+        gCoreChanged.notify_all();
+        gCoreChanged.wait(lock, [self] { return gRunning == self; });
+    }
+
+    // Loop task: moves the clock to untilUs, stopping at every task that wakes
+    // on the way. With stopOnNotify a notification ends the wait early.
+    void runUntil(uint64_t untilUs, bool stopOnNotify)
+    {
+        while (true)
+        {
+            for (size_t i = 0; i < gTasks.size(); ++i)
+            {
+                if (!gTasks[i]->ended && gTasks[i]->wakeUs <= gMicros)
+                {
+                    runTask(gTasks[i]);
+                }
+            }
+
+            if (gMicros >= untilUs || (stopOnNotify && gNotified))
+            {
+                return;
+            }
+
+            uint64_t next = untilUs;
+            for (Task* t : gTasks)
+            {
+                if (!t->ended && t->wakeUs < next)
+                {
+                    next = t->wakeUs;
+                }
+            }
+            gMicros = next;
+        }
+    }
+
+    // ---------------- Console input ---------------- //
+
+    struct HeldLine
+    {
+        uint32_t dueMs;
+        std::string text; // with its newline
+    };
+
+    std::string gPartial;          // read but not a whole line yet
+    std::deque<HeldLine> gHeld;    // whole lines, in the order they were read
+    std::string gReady;            // handed to Serial.read()
+    bool gInputClosed = false;
+
+    void queueLine(const std::string& line)
+    {
+        HeldLine held = { 0, line + "\n" };
+
+        if (line.size() > 1 && line[0] == '@')
+        {
+            char* end = nullptr;
+            held.dueMs = static_cast<uint32_t>(strtoul(line.c_str() + 1, &end, 10));
+            while (*end == ' ')
+            {
+                ++end;
+            }
+            held.text = std::string(end) + "\n";
+        }
+
+        gHeld.push_back(held);
+    }
+
+    void readInput()
+    {
+        while (!gInputClosed)
+        {
+            pollfd input = { STDIN_FILENO, POLLIN, 0 };
+            if (poll(&input, 1, 0) <= 0)
+            {
+                break;
+            }
+
+            char chunk[256];
+            const ssize_t length = read(STDIN_FILENO, chunk, sizeof(chunk));
+            if (length <= 0)
+            {
+                gInputClosed = true;
+                break;
+            }
+
+            for (ssize_t i = 0; i < length; ++i)
+            {
+                if (chunk[i] == '\n')
+                {
+                    queueLine(gPartial);
+                    gPartial.clear();
+                }
+                else
+                {
+                    gPartial += chunk[i];
+                }
+            }
+        }
+
+        // in order, a line is never overtaken by a later one that is due sooner
+        while (!gHeld.empty() && gHeld.front().dueMs <= millis())
+        {
+            gReady += gHeld.front().text;
+            gHeld.pop_front();
+        }
+    }
+
+    // ---------------- Shutter model ---------------- //
+
+    struct Shaft
+    {
+        int minUs = 500;
+        int maxUs = 2400;
+        bool driven = false;
+        int targetUs = 0;
+        int32_t positionUs = -1;  // -1 until the first pulse, the servo then starts there
+        uint64_t updatedUs = 0;
+    };
+
+    Shaft gShaft;
+
+    void moveShaft()
+    {
+        const uint64_t elapsed = gMicros - gShaft.updatedUs;
+        gShaft.updatedUs = gMicros;
+
+        if (!gShaft.driven || gShaft.positionUs < 0)
+        {
+            return;
+        }
+
+        const int32_t step = static_cast<int32_t>(elapsed * SIM_HAL::SERVO_US_PER_S / 1000000);
+        const int32_t error = gShaft.targetUs - gShaft.positionUs;
+
+        if (error > step)        gShaft.positionUs += step;
+        else if (error < -step)  gShaft.positionUs -= step;
+        else                     gShaft.positionUs = gShaft.targetUs;
+    }
+}
+
+// ---------------- Virtual clock ---------------- //
+
+void SIM_HAL::advance(uint32_t us)
+{
+    runUntil(gMicros + us, false);
+}
+
+uint64_t SIM_HAL::nowMicros()
+{
+    return gMicros;
+}
+
+bool SIM_HAL::inputDone()
+{
+    readInput();
+    return gInputClosed && gHeld.empty() && gReady.empty();
+}
+
+int SIM_HAL::shutterPercent()
+{
+    moveShaft();
+    if (gShaft.positionUs < 0)
+    {
+        return 50; // unpowered, the fixture ships half open
+    }
+    return static_cast<int>((gShaft.positionUs - gShaft.minUs) * 100 / (gShaft.maxUs - gShaft.minUs));
+}
+
+unsigned long millis()
+{
+    return static_cast<unsigned long>(gMicros / 1000);
+}
+
+unsigned long micros()
+{
+    return static_cast<unsigned long>(gMicros);
+}
+
+int64_t esp_timer_get_time()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - gStarted).count();
+}
+
+void delay(unsigned long ms)
+{
+    const uint64_t until = gMicros + static_cast<uint64_t>(ms) * 1000;
+
+    if (tCurrent)
+    {
+        sleepTask(until);
+    }
+    else
+    {
+        runUntil(until, false);
+    }
+}
+
+void pinMode(int, int)
+{
+}
+
+void digitalWrite(int, int)
+{
+}
+
+int analogRead(int)
+{
+    const int percent = SIM_HAL::shutterPercent();
+    const int noise = (rand() % (2 * SIM_HAL::POT_NOISE + 1)) - SIM_HAL::POT_NOISE;
+    return SIM_HAL::POT_CLOSED + (SIM_HAL::POT_OPEN - SIM_HAL::POT_CLOSED) * percent / 100 + noise;
+}
+
+void analogSetPinAttenuation(int, int)
+{
+}
+
+bool setCpuFrequencyMhz(uint32_t)
+{
+    return true;
+}
+
+// ---------------- Serial ---------------- //
+
+HostSerial Serial;
+
+int HostSerial::available()
+{
+    readInput();
+    return static_cast<int>(gReady.size());
+}
+
+int HostSerial::read()
+{
+    readInput();
+    if (gReady.empty())
+    {
+        return -1;
+    }
+    const int c = static_cast<unsigned char>(gReady[0]);
+    gReady.erase(0, 1);
+    return c;
+}
+
+// ---------------- Servo ---------------- //
+
+int Servo::attach(int pin, int minUs, int maxUs)
+{
+    _pin = pin;
+    gShaft.minUs = minUs;
+    gShaft.maxUs = maxUs;
+    return pin;
+}
+
+void Servo::writeMicroseconds(int us)
+{
+    moveShaft();
+    if (gShaft.positionUs < 0)
+    {
+        gShaft.positionUs = (gShaft.minUs + gShaft.maxUs) / 2;
+    }
+    gShaft.targetUs = us;
+    gShaft.driven = true;
+}
+
+void Servo::release()
+{
+    moveShaft();
+    gShaft.driven = false;
+}
+
+// ---------------- FreeRTOS ---------------- //
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task, const char* name, uint32_t, void* parameters,
+                                   UBaseType_t, TaskHandle_t* created, BaseType_t)
+{
+    if (tCurrent)
+    {
+        return pdFAIL; // only the loop task starts others, see task.h
+    }
+
+    Task* t = new Task();
+    t->name = name;
+    gTasks.push_back(t);
+
+    std::thread([t, task, parameters]
+    {
+        tCurrent = t;
+        {
+            std::unique_lock<std::mutex> lock(gCoreLock);
+            gCoreChanged.wait(lock, [t] { return gRunning == t; });
+        }
+
+        task(parameters);
+
+        std::lock_guard<std::mutex> lock(gCoreLock);
+        t->ended = true;
+        gRunning = nullptr;
+        gCoreChanged.notify_all();
+    }).detach();
+
+    if (created)
+    {
+        *created = t;
+    }
+    runTask(t); // runs until it first waits, as a new task of higher priority would
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    // A task ends by returning once it has deleted itself, which every task in
+    // the firmware does right away. Deleting another task is not simulated.
+    (void)task;
+}
+
+void vTaskSuspend(TaskHandle_t)
+{
+}
+
+void vTaskResume(TaskHandle_t)
+{
+}
+
+TaskHandle_t xTaskGetHandle(const char* name)
+{
+    for (Task* t : gTasks)
+    {
+        if (!t->ended && t->name == name)
+        {
+            return t;
+        }
+    }
+    return nullptr;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle()
+{
+    return tCurrent ? static_cast<TaskHandle_t>(tCurrent) : &gLoopTask;
+}
+
+TickType_t xTaskGetTickCount()
+{
+    return static_cast<TickType_t>(millis());
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    delay(ticks);
+}
+
+void vTaskDelayUntil(TickType_t* previousWake, TickType_t ticks)
+{
+    *previousWake += ticks;
+    const uint64_t wakeUs = static_cast<uint64_t>(*previousWake) * 1000;
+
+    if (wakeUs <= gMicros)
+    {
+        return; // already late, as on the lamp it does not wait at all
+    }
+
+    if (tCurrent)
+    {
+        sleepTask(wakeUs);
+    }
+    else
+    {
+        runUntil(wakeUs, false);
+    }
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticksToWait)
+{
+    if (!gNotified)
+    {
+        runUntil(gMicros + static_cast<uint64_t>(ticksToWait) * 1000, true);
+        if (!gNotified)
+        {
+            return 0;
+        }
+    }
+
+    if (clearOnExit)
+    {
+        gNotified = false;
+    }
+    return 1;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t)
+{
+    gNotified = true;
+    return pdPASS;
+}
+
+// ---------------- Restart ---------------- //
+
+// Bounds of the __NOINIT_ATTR section, from the linker
+extern "C" uint8_t __start_host_noinit[];
+extern "C" uint8_t __stop_host_noinit[];
+
+namespace
+{
+    constexpr char RESTART_ENV[] = "SIM_RESTART"; // file the noinit RAM was saved to
+}
+
+void SIM_HAL::start(char** argv)
+{
+    gArgv = argv;
+
+    const char* saved = getenv(RESTART_ENV);
+    if (!saved)
+    {
+        return;
+    }
+
+    FILE* file = fopen(saved, "rb");
+    const size_t size = static_cast<size_t>(__stop_host_noinit - __start_host_noinit);
+    gRestarted = file && fread(__start_host_noinit, 1, size, file) == size;
+    if (file)
+    {
+        fclose(file);
+    }
+    remove(saved);
+    unsetenv(RESTART_ENV);
+}
+
+esp_reset_reason_t esp_reset_reason()
+{
+    return gRestarted ? ESP_RST_SW : ESP_RST_POWERON;
+}
+
+// Runs the binary again with the same arguments, the way the lamp reboots:
+// everything starts over but the noinit RAM, which goes through a file
+void esp_restart()
+{
+    char path[] = "/tmp/sim_noinit_XXXXXX";
+    const int fd = mkstemp(path);
+    const size_t size = static_cast<size_t>(__stop_host_noinit - __start_host_noinit);
+
+    if (fd < 0 || write(fd, __start_host_noinit, size) != static_cast<ssize_t>(size))
+    {
+        fprintf(stderr, "[SIM] cannot save the noinit RAM, restart lost\n");
+        abort();
+    }
+    close(fd);
+
+    fflush(stdout);
+    setenv(RESTART_ENV, path, 1);
+    execvp(gArgv[0], gArgv);
+
+    fprintf(stderr, "[SIM] cannot run %s again\n", gArgv[0]);
+    abort();
+}
+
+uint32_t esp_random()
+{
+    gRandom ^= gRandom << 13;
+    gRandom ^= gRandom >> 17;
+    gRandom ^= gRandom << 5;
+    return gRandom;
+}
@@ -0,0 +1,55 @@
+/*
+ * File:        SIM_HAL.hpp
+ * Author:      Marcus Lechner
+ * Created:     2025-10-18
+ * Description: Virtual clock, console input and shutter model behind the host Arduino core
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#ifndef SIM_HAL_HPP
+#define SIM_HAL_HPP
+
+#include <stdint.h>
+
+// millis(), micros() and every FreeRTOS wait run on a virtual clock that only
+// moves when the simulator moves it, so a run is as fast as the host allows
+// and repeats exactly. Only esp_timer_get_time() is the host's real clock,
+// so the boot trace shows what setup() costs on the host.
+//
+// Serial input comes from stdin. A line may start with "@<ms> " to hold it
+// back until the virtual clock gets there, so a script can be replayed with
+// its timing however fast the simulation runs:
+//
+//   @0 W anim 07
+//   @2000 W shutter 14
+//
+// Lines without a time go through as soon as they are read.
+//
+// esp_restart() runs the binary again with the same arguments, the way the
+// lamp reboots: the clock, the modules and the views start over, input already
+// read but not yet due is lost, and only the __NOINIT_ATTR section (the
+// APP_RECORD log) is carried over. A REPLAY therefore restarts into the replay
+// exactly as on the lamp.
+//
+// The shutter is one servo driving one pot. The shaft follows the pulse
+// width at SERVO_US_PER_S while the servo is driven and stays put once it is
+// released. Every pot read returns the shaft position between POT_CLOSED and
+// POT_OPEN, plus a little noise.
+namespace SIM_HAL
+{
+    constexpr uint32_t SERVO_US_PER_S = 4000; // pulse width travelled per second, about 0.15 s per 60 degrees
+    constexpr int POT_CLOSED = 600;           // ADC counts at the closed end
+    constexpr int POT_OPEN = 3400;
+    constexpr int POT_NOISE = 4;
+
+    void start(char** argv); // first in main(), takes the noinit RAM over from a restart
+
+    void advance(uint32_t us);
+    uint64_t nowMicros();
+
+    bool inputDone(); // stdin closed and every held line has been read
+
+    int shutterPercent(); // where the shaft is, 0-100 % open
+}
+
+#endif // SIM_HAL_HPP
@@ -0,0 +1,147 @@
+/*
+ * File:        SIM_MAIN.cpp
+ * Author:      Marcus Lechner
+ * Created:     2025-10-18
+ * Description: Runs the lamp firmware's setup() and loop() on the host, pio run -e sim
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#include "SIM_HAL.hpp"
+#include "SIM_SOCKET.hpp"
+#include "SIM_VIEW.hpp"
+#include "APP_RECORD.hpp"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <thread>
+
+// The simulator is the firmware from src/ built for the host, with the
+// hardware stood in for by host/ and SIM_STUBS.cpp. It talks the serial
+// console protocol on stdin/stdout (see APP_CONSOLE.hpp), so a script drives
+// it exactly like a lamp on USB: W/RX writes go through APP_BLE::receive(),
+// STREAM sends the frames back.
+//
+//   .pio/build/sim/program [--speed <x>] [--ms <n>] [--view] [--ppm <file>] [--socket <path>]
+//
+//   --speed <x>   virtual seconds per real second, 1 is real time, the
+//                 default 0 runs as fast as the host can
+//   --ms <n>      stop after n virtual milliseconds, otherwise the run ends
+//                 once stdin is closed and every held line has been read
+//   --view        draw the strip and shutter in the terminal (stderr)
+//   --ppm <file>  write every frame as a row of a strip-over-time image
+//   --socket <path>  take characteristic writes on a Unix socket, see SIM_SOCKET.hpp
+//
+// With HOST_NVS=<file> in the environment the settings, scenes and calibration
+// are kept in that file from one run to the next (see host/Preferences.h).
+//
+// Each pass of loop() moves the clock LOOP_US on. Waits inside the firmware
+// (the idle loop) move it further, tasks such as the LOAD storm run in between
+// on the same clock. LOAD and LATENCY on the console work as on the lamp.
+
+void setup();
+void loop();
+
+namespace
+{
+    constexpr uint32_t LOOP_US = 1000;
+
+    double gSpeed = 0;
+    uint32_t gStopMs = 0; // 0 = run until the input is done
+    bool gLastPass = false;
+
+    bool parseArgs(int argc, char** argv)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const bool hasValue = i + 1 < argc;
+
+            if (strcmp(argv[i], "--speed") == 0 && hasValue)
+            {
+                gSpeed = atof(argv[++i]);
+            }
+            else if (strcmp(argv[i], "--ms") == 0 && hasValue)
+            {
+                gStopMs = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+            }
+            else if (strcmp(argv[i], "--view") == 0)
+            {
+                SIM_VIEW::openTerminal();
+            }
+            else if (strcmp(argv[i], "--ppm") == 0 && hasValue)
+            {
+                if (!SIM_VIEW::openImage(argv[++i]))
+                {
+                    fprintf(stderr, "cannot write %s\n", argv[i]);
+                    return false;
+                }
+            }
+            else if (strcmp(argv[i], "--socket") == 0 && hasValue)
+            {
+                if (!SIM_SOCKET::open(argv[++i]))
+                {
+                    fprintf(stderr, "cannot listen on %s\n", argv[i]);
+                    return false;
+                }
+            }
+            else
+            {
+                fprintf(stderr, "usage: %s [--speed <x>] [--ms <n>] [--view] [--ppm <file>] [--socket <path>]\n", argv[0]);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool finished()
+    {
+        if (gStopMs)
+        {
+            return SIM_HAL::nowMicros() >= gStopMs * 1000ULL;
+        }
+        if (!SIM_HAL::inputDone() || APP_RECORD::isReplaying()) // a replay needs no input
+        {
+            gLastPass = false;
+            return false;
+        }
+
+        // one pass more, REPLAY and DUMP are carried out on the pass after the line
+        const bool done = gLastPass;
+        gLastPass = true;
+        return done;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    SIM_HAL::start(argv);
+
+    if (!parseArgs(argc, argv))
+    {
+        return 2;
+    }
+
+    setvbuf(stdout, nullptr, _IOLBF, 0); // a script reads the answers line by line
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    setup();
+
+    while (!finished())
+    {
+        SIM_SOCKET::poll();
+        loop();
+        SIM_HAL::advance(LOOP_US);
+        SIM_VIEW::refresh();
+
+        if (gSpeed > 0)
+        {
+            // hold the virtual clock back to the real one
+            const std::chrono::microseconds due(static_cast<long long>(SIM_HAL::nowMicros() / gSpeed));
+            std::this_thread::sleep_until(start + due);
+        }
+    }
+
+    SIM_SOCKET::close();
+    SIM_VIEW::close();
+    return 0;
+}
@@ -0,0 +1,183 @@
+/*
+ * File:        SIM_SOCKET.cpp
+ * Author:      Marcus Lechner
+ * Created:     2025-10-18
+ * Description: Unix socket stand-in for the GATT server, takes characteristic writes from host tools
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#include "SIM_SOCKET.hpp"
+#include "APP_BLE.hpp"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+namespace
+{
+    constexpr size_t HEADER_SIZE = 3; // channel8, length16
+
+    struct Client
+    {
+        int fd;
+        std::vector<uint8_t> pending; // read, not a whole write yet
+    };
+
+    int gListener = -1;
+    std::string gPath;
+    std::vector<Client> gClients;
+
+    bool setNonBlocking(int fd)
+    {
+        const int flags = fcntl(fd, F_GETFL, 0);
+        return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+    }
+
+    void acceptClients()
+    {
+        while (true)
+        {
+            const int fd = accept(gListener, nullptr, nullptr);
+            if (fd < 0)
+            {
+                return;
+            }
+
+            if (gClients.size() >= SIM_SOCKET::MAX_CLIENTS || !setNonBlocking(fd))
+            {
+                ::close(fd);
+                continue;
+            }
+
+            Client client = { fd, std::vector<uint8_t>() };
+            gClients.push_back(client);
+        }
+    }
+
+    // Hands every whole write to APP_BLE, returns false when the client sent garbage
+    bool deliver(Client& client)
+    {
+        size_t used = 0;
+
+        while (client.pending.size() - used >= HEADER_SIZE)
+        {
+            const uint8_t* write = client.pending.data() + used;
+            const uint16_t length = static_cast<uint16_t>(write[1] | (write[2] << 8));
+
+            if (length > SIM_SOCKET::MAX_WRITE)
+            {
+                return false;
+            }
+            if (client.pending.size() - used < HEADER_SIZE + length)
+            {
+                break;
+            }
+
+            APP_BLE::receive(APP_BLE::TRANSPORT_SOCKET, write[0], write + HEADER_SIZE, length);
+            used += HEADER_SIZE + length;
+        }
+
+        client.pending.erase(client.pending.begin(), client.pending.begin() + used);
+        return true;
+    }
+
+    // Returns false once the client is gone
+    bool readClient(Client& client)
+    {
+        uint8_t chunk[1024];
+
+        while (true)
+        {
+            const ssize_t length = recv(client.fd, chunk, sizeof(chunk), 0);
+            if (length == 0)
+            {
+                return false;
+            }
+            if (length < 0)
+            {
+                return errno == EAGAIN || errno == EWOULDBLOCK;
+            }
+
+            client.pending.insert(client.pending.end(), chunk, chunk + length);
+            if (!deliver(client))
+            {
+                fprintf(stderr, "[SIM] socket client sent a write over %u bytes, closed\n", SIM_SOCKET::MAX_WRITE);
+                return false;
+            }
+        }
+    }
+}
+
+bool SIM_SOCKET::open(const char* path)
+{
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(address.sun_path))
+    {
+        return false;
+    }
+    strcpy(address.sun_path, path);
+
+    gListener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (gListener < 0)
+    {
+        return false;
+    }
+
+    unlink(path); // left behind by an earlier run
+    if (bind(gListener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        listen(gListener, MAX_CLIENTS) != 0 || !setNonBlocking(gListener))
+    {
+        ::close(gListener);
+        gListener = -1;
+        return false;
+    }
+
+    gPath = path;
+    return true;
+}
+
+void SIM_SOCKET::poll()
+{
+    if (gListener < 0)
+    {
+        return;
+    }
+
+    acceptClients();
+
+    for (size_t i = 0; i < gClients.size();)
+    {
+        if (readClient(gClients[i]))
+        {
+            ++i;
+        }
+        else
+        {
+            ::close(gClients[i].fd);
+            gClients.erase(gClients.begin() + i);
+        }
+    }
+}
+
+void SIM_SOCKET::close()
+{
+    for (const Client& client : gClients)
+    {
+        ::close(client.fd);
+    }
+    gClients.clear();
+
+    if (gListener >= 0)
+    {
+        ::close(gListener);
+        unlink(gPath.c_str());
+        gListener = -1;
+    }
+}
@@ -0,0 +1,39 @@
+/*
+ * File:        SIM_SOCKET.hpp
+ * Author:      Marcus Lechner
+ * Created:     2025-10-18
+ * Description: Unix socket stand-in for the GATT server, takes characteristic writes from host tools
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#ifndef SIM_SOCKET_HPP
+#define SIM_SOCKET_HPP
+
+#include <stdint.h>
+
+// With --socket <path> the simulator listens on a Unix stream socket and takes
+// the same writes the phone sends to the lamp's characteristics, so a host tool
+// can drive it like the app does (slider storms, scene shows) while APP_LATENCY
+// times them as TRANSPORT_SOCKET. Any number of clients may connect, each sends
+// a stream of writes:
+//
+//   channel8, length16 (little endian), value[length]
+//
+// channel is an APP_RECORD::Channel (0 RX, 1 shutter, 2 RGB, 3 anim, 4 pattern,
+// 5 scene, 6 calibration). Writes go to APP_BLE::receive() between two loop
+// passes, where the BLE task would hand them over on the lamp. A write longer
+// than MAX_WRITE closes its connection.
+//
+// Writes arrive in real time while the virtual clock runs as fast as the host
+// allows, so run with --speed 1 for rates and latencies that mean anything.
+namespace SIM_SOCKET
+{
+    constexpr uint16_t MAX_WRITE = 512; // largest attribute value GATT allows
+    constexpr uint8_t MAX_CLIENTS = 8;
+
+    bool open(const char* path);
+    void poll(); // every simulated loop pass
+    void close();
+}
+
+#endif // SIM_SOCKET_HPP
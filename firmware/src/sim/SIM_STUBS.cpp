@@ -0,0 +1,70 @@
+/*
+ * File:        SIM_STUBS.cpp
+ * Author:      Marcus Lechner
+ * Created:     2025-10-18
+ * Description: The lamp's modules that need its hardware, as far as the simulator can stand in for them
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#include "SIM_VIEW.hpp"
+#include "APP_AUDIO.hpp"
+#include "APP_MEMORY.hpp"
+#include "APP_OTA.hpp"
+#include "APP_OUTPUT.hpp"
+#include "APP_PIXELNET.hpp"
+#include <Arduino.h>
+
+// Everything else is built from src/ as it is, APP_RECORD too (its restart
+// into replay is SIM_HAL's). These need the I2S microphone, the heap
+// allocator, the OTA partitions, the strip driver and Wi-Fi.
+
+namespace
+{
+    void notSimulated(const char* what)
+    {
+        Serial.printf("[SIM] %s is not simulated\n", what);
+    }
+}
+
+// ---------------- APP_OUTPUT: into the views ---------------- //
+
+void APP_OUTPUT::init() {}
+
+void APP_OUTPUT::show(const uint8_t* rgb, uint8_t brightness)
+{
+    SIM_VIEW::frame(rgb, brightness);
+}
+
+// ---------------- No microphone, network, updates or heap accounting ---------------- //
+
+void APP_AUDIO::init() {}
+void APP_AUDIO::process() {}
+void APP_AUDIO::setEnabled(bool) {}
+
+APP_AUDIO::Bands APP_AUDIO::get()
+{
+    APP_AUDIO::Bands silence = {};
+    return silence;
+}
+
+void APP_PIXELNET::init() {}
+void APP_PIXELNET::connect() {}
+void APP_PIXELNET::process() {}
+bool APP_PIXELNET::isActive() { return false; }
+void APP_PIXELNET::render(uint8_t*) {}
+void APP_PIXELNET::setCredentials(const char*, const char*) { notSimulated("Wi-Fi"); }
+bool APP_PIXELNET::startLoad(uint16_t, uint16_t) { return false; }
+void APP_PIXELNET::report() { notSimulated("Wi-Fi"); }
+
+void APP_OTA::init() {}
+void APP_OTA::process() {}
+size_t APP_OTA::handle(const uint8_t*, size_t, uint8_t*) { return 0; }
+bool APP_OTA::isUpdating() { return false; }
+
+APP_MEMORY::Scope::Scope(Module module) : _previous(module) {}
+APP_MEMORY::Scope::~Scope() {}
+void APP_MEMORY::init() {}
+void APP_MEMORY::process() {}
+void APP_MEMORY::watchTask(TaskHandle_t, const char*) {}
+void APP_MEMORY::report() { notSimulated("MEM"); }
+
@@ -0,0 +1,109 @@
+/*
+ * File:        SIM_VIEW.cpp
+ * Author:      Marcus Lechner
+ * Created:     2025-10-18
+ * Description: Terminal and PPM views of the simulated strip and shutter
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#include "SIM_VIEW.hpp"
+#include "SIM_HAL.hpp"
+#include "APP_LED.hpp"
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+namespace
+{
+    constexpr uint8_t IMAGE_GAP = 2;
+    constexpr uint16_t IMAGE_WIDTH = APP_LED::NUM_LEDS + IMAGE_GAP + SIM_VIEW::SHUTTER_WIDTH;
+
+    bool gTerminal = false;
+    FILE* gImage = nullptr;
+    std::vector<uint8_t> gRows; // written out on close, the height is only known then
+
+    uint8_t gShown[APP_LED::NUM_LEDS * 3]; // last frame at the brightness it went out with
+    bool gHaveFrame = false;
+    uint64_t gDrawnUs = 0;
+
+    uint8_t scale(uint8_t value, uint8_t brightness)
+    {
+        return static_cast<uint8_t>((value * (brightness + 1)) >> 8);
+    }
+
+    void drawTerminal()
+    {
+        fputs("\r", stderr);
+        for (uint8_t i = 0; i < APP_LED::NUM_LEDS; ++i)
+        {
+            fprintf(stderr, "\x1b[48;2;%u;%u;%um ", gShown[i * 3], gShown[i * 3 + 1], gShown[i * 3 + 2]);
+        }
+        fprintf(stderr, "\x1b[0m  shutter %3d%%  %8.3f s ", SIM_HAL::shutterPercent(),
+                static_cast<double>(SIM_HAL::nowMicros()) / 1e6);
+        fflush(stderr);
+    }
+
+    void addRow()
+    {
+        const size_t start = gRows.size();
+        gRows.resize(start + IMAGE_WIDTH * 3, 0);
+        memcpy(&gRows[start], gShown, sizeof(gShown));
+
+        const int open = SIM_HAL::shutterPercent() * SIM_VIEW::SHUTTER_WIDTH / 100;
+        uint8_t* bar = &gRows[start + (APP_LED::NUM_LEDS + IMAGE_GAP) * 3];
+        memset(bar, 0xC0, static_cast<size_t>(open) * 3);
+    }
+}
+
+void SIM_VIEW::openTerminal()
+{
+    gTerminal = true;
+}
+
+bool SIM_VIEW::openImage(const char* path)
+{
+    gImage = fopen(path, "wb");
+    return gImage != nullptr;
+}
+
+void SIM_VIEW::close()
+{
+    if (gTerminal)
+    {
+        fputs("\n", stderr);
+    }
+
+    if (gImage)
+    {
+        const size_t height = gRows.size() / (IMAGE_WIDTH * 3);
+        fprintf(gImage, "P6\n%u %u\n255\n", IMAGE_WIDTH, static_cast<unsigned>(height));
+        fwrite(gRows.data(), 1, gRows.size(), gImage);
+        fclose(gImage);
+        gImage = nullptr;
+    }
+}
+
+void SIM_VIEW::frame(const uint8_t* rgb, uint8_t brightness)
+{
+    for (size_t i = 0; i < sizeof(gShown); ++i)
+    {
+        gShown[i] = scale(rgb[i], brightness);
+    }
+    gHaveFrame = true;
+
+    if (gImage)
+    {
+        addRow();
+    }
+    refresh();
+}
+
+void SIM_VIEW::refresh()
+{
+    if (!gTerminal || !gHaveFrame || SIM_HAL::nowMicros() - gDrawnUs < TERMINAL_MS * 1000ULL)
+    {
+        return;
+    }
+    gDrawnUs = SIM_HAL::nowMicros();
+    drawTerminal();
+}
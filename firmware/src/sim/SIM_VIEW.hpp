@@ -0,0 +1,37 @@
+/*
+ * File:        SIM_VIEW.hpp
+ * Author:      Marcus Lechner
+ * Created:     2025-10-18
+ * Description: Shows what the simulated lamp puts out, in the terminal or as a strip-over-time image
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#ifndef SIM_VIEW_HPP
+#define SIM_VIEW_HPP
+
+#include <stdint.h>
+
+// Both views take the frames APP_OUTPUT would send to the strip, at the
+// brightness it would send them with, and the shutter where the shaft is.
+//
+// The terminal view redraws one line on stderr, stdout stays free for the
+// console: a block per pixel in 24-bit colour and the shutter opening. It
+// follows the virtual clock and draws at most every TERMINAL_MS, also while
+// the lamp idles and sends no frames.
+//
+// The image is a binary PPM with one row per frame, the strip from pixel 0 on
+// the left, a gap and a bar as wide as the shutter is open.
+namespace SIM_VIEW
+{
+    constexpr uint32_t TERMINAL_MS = 33;
+    constexpr uint8_t SHUTTER_WIDTH = 25; // image pixels for a fully open shutter
+
+    void openTerminal();
+    bool openImage(const char* path);
+    void close(); // writes the image
+
+    void frame(const uint8_t* rgb, uint8_t brightness); // from APP_OUTPUT::show()
+    void refresh(); // every simulated loop pass
+}
+
+#endif // SIM_VIEW_HPP
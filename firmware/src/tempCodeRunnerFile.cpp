@@ -1 +0,0 @@
-fill_solid
\ No newline at end of file
@@ -0,0 +1,195 @@
+/*
+ * File:        HOST_HAL.hpp
+ * Author:      Marcus Lechner
+ * Created:     2025-10-18
+ * Description: Stand-ins for the hardware modules around the pattern engine, for the native test env
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#ifndef HOST_HAL_HPP
+#define HOST_HAL_HPP
+
+#include <Arduino.h>
+#include <ESP32Servo.h>
+#include "APP_RECORD.hpp"
+#include "APP_SERVO.hpp"
+#include "APP_AUDIO.hpp"
+#include "APP_CONSOLE.hpp"
+#include "APP_LATENCY.hpp"
+#include "APP_IDLE.hpp"
+#include "APP_MEMORY.hpp"
+#include "APP_BOOT.hpp"
+#include "APP_CALIBRATION.hpp"
+#include "APP_OUTPUT.hpp"
+#include "APP_PIXELNET.hpp"
+#include "APP_FRAMESTREAM.hpp"
+
+// The native env builds APP_LED, APP_MAP, APP_PATTERN, APP_TIMER, APP_GOLDEN,
+// APP_SETTINGS, APP_MEMORY and APP_SERVO as they are (see build_src_filter in
+// platformio.ini), so every test runs on APP_MEMORY's operator new, and
+// Preferences keeps NVS in an mmap'd file (host/Preferences.h). Everything
+// they call on the lamp's other modules is defined here instead: a clock that
+// only moves when a test moves it, a servo that logs its pulses, a pot that
+// reads gPotAdc, a quiet microphone, identity calibration and an output that
+// goes nowhere.
+//
+// This header defines symbols, include it from exactly one file per test.
+namespace HOST_HAL
+{
+    uint32_t gClockMs = 0;
+    uint32_t gPinnedMs = 0;
+    bool gClockPinned = false;
+
+    APP_SETTINGS::Settings gStartSettings = {};
+
+    bool gBootComplete = false;     // what APP_BOOT reports, lets APP_MEMORY reach steady state
+
+    bool gStreamActive = false;     // what APP_PIXELNET and APP_FRAMESTREAM report
+    uint32_t gStreamRenders = 0;    // frames the streams were asked for
+    uint32_t gFramesShown = 0;
+    uint8_t gShown[APP_LED::NUM_LEDS * 3]; // the last frame APP_OUTPUT was given
+
+    constexpr size_t MAX_PULSES = 4096;
+    ServoPulse gPulses[MAX_PULSES]; // every Servo write and release, oldest first, later ones dropped
+    size_t gPulseCount = 0;
+    int gPotAdc = 0;                // what analogRead() returns, a constant reads as no pot fitted
+
+    APP_CALIBRATION::Table gIdentity;
+    const APP_CALIBRATION::Table* gTables[APP_LED::NUM_LEDS];
+
+    void logPulse(int pin, int us)
+    {
+        if (gPulseCount < MAX_PULSES)
+        {
+            gPulses[gPulseCount].ms = millis();
+            gPulses[gPulseCount].pin = pin;
+            gPulses[gPulseCount].us = us;
+            gPulseCount++;
+        }
+    }
+
+    void init()
+    {
+        for (uint16_t v = 0; v < 256; ++v)
+        {
+            gIdentity.r[v] = gIdentity.g[v] = gIdentity.b[v] = static_cast<uint8_t>(v);
+        }
+        for (uint8_t i = 0; i < APP_LED::NUM_LEDS; ++i)
+        {
+            gTables[i] = &gIdentity;
+        }
+    }
+}
+
+HostSerial Serial;
+HostEsp ESP;
+
+uint32_t HostEsp::getFreeHeap() { return 0; }
+uint32_t HostEsp::getMinFreeHeap() { return 0; }
+uint32_t HostEsp::getMaxAllocHeap() { return 0; }
+
+TaskHandle_t xTaskGetCurrentTaskHandle()
+{
+    static int loopTask;
+    return &loopTask;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t) { return 0; }
+
+bool APP_BOOT::isComplete() { return HOST_HAL::gBootComplete; }
+
+uint32_t get_millisecond_timer()
+{
+    return APP_RECORD::now();
+}
+
+unsigned long millis()
+{
+    return APP_RECORD::now();
+}
+
+uint32_t APP_RECORD::now()
+{
+    return HOST_HAL::gClockPinned ? HOST_HAL::gPinnedMs : HOST_HAL::gClockMs;
+}
+
+void APP_RECORD::pinClock(uint32_t ms)
+{
+    HOST_HAL::gPinnedMs = ms;
+    HOST_HAL::gClockPinned = true;
+}
+
+void APP_RECORD::unpinClock()
+{
+    HOST_HAL::gClockPinned = false;
+}
+
+bool APP_RECORD::isReplaying() { return false; }
+void APP_RECORD::setStartSettings(const APP_SETTINGS::Settings& settings) { HOST_HAL::gStartSettings = settings; }
+const APP_SETTINGS::Settings& APP_RECORD::startSettings() { return HOST_HAL::gStartSettings; }
+bool APP_RECORD::frameDue() { return false; }
+const APP_RECORD::Snapshot* APP_RECORD::snapshot() { return nullptr; }
+void APP_RECORD::frameRendered(const uint8_t*, size_t, uint8_t) {}
+
+int Servo::attach(int pin, int, int)
+{
+    _pin = pin;
+    return pin;
+}
+
+void Servo::writeMicroseconds(int us)
+{
+    HOST_HAL::logPulse(_pin, us);
+}
+
+void Servo::release()
+{
+    HOST_HAL::logPulse(_pin, 0);
+}
+
+int analogRead(int) { return HOST_HAL::gPotAdc; }
+void analogSetPinAttenuation(int, int) {}
+int APP_RECORD::adcSample(uint8_t, int value) { return value; }
+
+APP_AUDIO::Bands APP_AUDIO::get()
+{
+    APP_AUDIO::Bands silence = {};
+    return silence;
+}
+
+void APP_CONSOLE::frameRendered(const uint8_t*, size_t, uint8_t) {}
+void APP_LATENCY::frameStarted() {}
+void APP_LATENCY::frameShown() {}
+void APP_IDLE::frameShown() {}
+bool APP_IDLE::isIdle() { return false; }
+
+const APP_CALIBRATION::Table* const* APP_CALIBRATION::pixelTables()
+{
+    return HOST_HAL::gTables;
+}
+
+void APP_OUTPUT::init() {}
+
+void APP_OUTPUT::show(const uint8_t* rgb, uint8_t)
+{
+    memcpy(HOST_HAL::gShown, rgb, sizeof(HOST_HAL::gShown));
+    HOST_HAL::gFramesShown++;
+}
+
+bool APP_PIXELNET::isActive() { return HOST_HAL::gStreamActive; }
+
+void APP_PIXELNET::render(uint8_t* rgb)
+{
+    HOST_HAL::gStreamRenders++;
+    memset(rgb, 0xFF, APP_LED::NUM_LEDS * 3); // a full white frame, unlike any reference
+}
+
+bool APP_FRAMESTREAM::isActive() { return HOST_HAL::gStreamActive; }
+
+void APP_FRAMESTREAM::render(uint8_t* rgb)
+{
+    HOST_HAL::gStreamRenders++;
+    memset(rgb, 0xFF, APP_LED::NUM_LEDS * 3);
+}
+
+#endif // HOST_HAL_HPP
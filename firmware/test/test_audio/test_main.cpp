@@ -0,0 +1,370 @@
+/*
+ * File:        test_main.cpp
+ * Author:      Marcus Lechner
+ * Created:     2025-10-18
+ * Description: Host check of the audio analysis on WAV data, bands, beats and throughput, pio test -e native
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#include <unity.h>
+#include "HOST_HAL.hpp"
+#include "APP_AUDIO_ANALYSIS.hpp"
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <chrono>
+
+// Test signals are written as 16 kHz mono 16-bit WAV and read back through
+// the same reader that takes a recording: AUDIO_WAV=song.wav pio test -e native
+// -f test_audio prints the bands and beats the lamp would see for it.
+namespace
+{
+    using namespace APP_AUDIO_ANALYSIS;
+
+    constexpr float TAU = 6.2831853f;
+    constexpr int16_t TONE_AMPLITUDE = 4000;    // about -18 dBFS
+    constexpr int16_t KICK_AMPLITUDE = 7000;    // 4x after SAMPLE_SHIFT, just short of clipping
+    constexpr uint32_t BEAT_SAMPLES = SAMPLE_RATE / 2;   // 120 BPM
+    constexpr uint8_t KICKS = 16;
+    constexpr uint8_t MAX_BEAT_DELAY_HOPS = 3;  // 24 ms from kick to beat
+    constexpr uint8_t SETTLE_HOPS = 50;
+    constexpr uint8_t TONE_HOPS = 10;           // the band peaks decay 1/8 of an energy doubling per hop
+    constexpr uint8_t FAR_BAND_MAX = 128;
+    constexpr float MAX_US_PER_HOP = 100.0f;    // host, the lamp has 8000 us per hop
+
+    Analyser gAnalyser;
+
+    typedef std::vector<int16_t> Samples;
+
+    void writeLE(FILE* f, uint32_t value, uint8_t bytes)
+    {
+        for (uint8_t i = 0; i < bytes; ++i)
+        {
+            fputc((value >> (8 * i)) & 0xFF, f);
+        }
+    }
+
+    uint32_t readLE(const uint8_t* p, uint8_t bytes)
+    {
+        uint32_t value = 0;
+        for (uint8_t i = 0; i < bytes; ++i)
+        {
+            value |= static_cast<uint32_t>(p[i]) << (8 * i);
+        }
+        return value;
+    }
+
+    void writeWav(FILE* f, const Samples& samples)
+    {
+        const uint32_t dataBytes = samples.size() * 2;
+        fwrite("RIFF", 1, 4, f);
+        writeLE(f, 36 + dataBytes, 4);
+        fwrite("WAVEfmt ", 1, 8, f);
+        writeLE(f, 16, 4);
+        writeLE(f, 1, 2);               // PCM
+        writeLE(f, 1, 2);               // mono
+        writeLE(f, SAMPLE_RATE, 4);
+        writeLE(f, SAMPLE_RATE * 2, 4);
+        writeLE(f, 2, 2);
+        writeLE(f, 16, 2);
+        fwrite("data", 1, 4, f);
+        writeLE(f, dataBytes, 4);
+        for (size_t i = 0; i < samples.size(); ++i)
+        {
+            writeLE(f, static_cast<uint16_t>(samples[i]), 2);
+        }
+    }
+
+    // 16-bit PCM at SAMPLE_RATE, the first channel of a multichannel file
+    bool readWav(FILE* f, Samples& samples)
+    {
+        uint8_t riff[12];
+        if (fread(riff, 1, sizeof(riff), f) != sizeof(riff) ||
+            memcmp(riff, "RIFF", 4) != 0 || memcmp(riff + 8, "WAVE", 4) != 0)
+        {
+            return false;
+        }
+
+        uint16_t channels = 0;
+        bool format = false;
+        uint8_t chunk[8];
+        while (fread(chunk, 1, sizeof(chunk), f) == sizeof(chunk))
+        {
+            const uint32_t size = readLE(chunk + 4, 4);
+            if (memcmp(chunk, "fmt ", 4) == 0 && size >= 16)
+            {
+                uint8_t fmt[16];
+                if (fread(fmt, 1, sizeof(fmt), f) != sizeof(fmt))
+                {
+                    return false;
+                }
+                channels = static_cast<uint16_t>(readLE(fmt + 2, 2));
+                format = readLE(fmt, 2) == 1 && readLE(fmt + 4, 4) == SAMPLE_RATE && readLE(fmt + 14, 2) == 16;
+                fseek(f, size - sizeof(fmt) + (size & 1), SEEK_CUR);
+            }
+            else if (memcmp(chunk, "data", 4) == 0 && format && channels > 0)
+            {
+                uint8_t frame[4];
+                const uint8_t frameBytes = static_cast<uint8_t>(channels * 2);
+                samples.clear();
+                for (uint32_t i = 0; i < size / frameBytes; ++i)
+                {
+                    if (fread(frame, 1, 2, f) != 2)
+                    {
+                        return false;
+                    }
+                    fseek(f, frameBytes - 2, SEEK_CUR);
+                    samples.push_back(static_cast<int16_t>(readLE(frame, 2)));
+                }
+                return true;
+            }
+            else
+            {
+                fseek(f, size + (size & 1), SEEK_CUR);
+            }
+        }
+        return false;
+    }
+
+    // Through a WAV file like a recording would come in
+    Samples roundTrip(const Samples& samples)
+    {
+        FILE* f = tmpfile();
+        TEST_ASSERT_NOT_NULL(f);
+        writeWav(f, samples);
+        rewind(f);
+
+        Samples read;
+        TEST_ASSERT_TRUE(readWav(f, read));
+        fclose(f);
+        TEST_ASSERT_TRUE(read == samples);
+        return read;
+    }
+
+    Samples tone(float hz, uint32_t count, int16_t amplitude)
+    {
+        Samples s(count);
+        for (uint32_t n = 0; n < count; ++n)
+        {
+            s[n] = static_cast<int16_t>(amplitude * sinf(TAU * hz * n / SAMPLE_RATE));
+        }
+        return s;
+    }
+
+    // Kick drum at 120 BPM (a decaying 60 Hz thump) over a quiet hi-hat tone,
+    // after one beat of hi-hat alone: the detector holds off its first
+    // BEAT_REFRACTORY_HOPS so the microphone settling is no beat
+    Samples kicks()
+    {
+        Samples s = tone(4000.0f, (KICKS + 1) * BEAT_SAMPLES, 300);
+        for (uint32_t n = BEAT_SAMPLES; n < s.size(); ++n)
+        {
+            const float t = static_cast<float>(n % BEAT_SAMPLES) / SAMPLE_RATE;
+            s[n] = static_cast<int16_t>(s[n] + KICK_AMPLITUDE * expf(-t * 30.0f) * sinf(TAU * 60.0f * t));
+        }
+        return s;
+    }
+
+    // Middle of a band
+    float bandHz(uint8_t band)
+    {
+        const float bin = (BAND_EDGES[band] + BAND_EDGES[band + 1] - 1) / 2.0f;
+        return bin * SAMPLE_RATE / FFT_SIZE;
+    }
+
+    // One hop of 16-bit samples as the microphone sends them, 24 bits left aligned
+    const APP_AUDIO::Bands& feedHop(const Samples& s, size_t hop)
+    {
+        int32_t raw[HOP_SIZE];
+        for (uint16_t n = 0; n < HOP_SIZE; ++n)
+        {
+            const size_t i = hop * HOP_SIZE + n;
+            raw[n] = i < s.size() ? static_cast<int32_t>(s[i]) * 65536 : 0;
+        }
+        return gAnalyser.hop(raw, HOP_SIZE, static_cast<uint32_t>(hop + 1));
+    }
+
+    // Beat hops of a whole signal
+    std::vector<size_t> beats(const Samples& s)
+    {
+        std::vector<size_t> at;
+        uint16_t count = 0;
+        for (size_t hop = 0; hop < s.size() / HOP_SIZE; ++hop)
+        {
+            const APP_AUDIO::Bands& b = feedHop(s, hop);
+            if (b.beatCount != count)
+            {
+                count = b.beatCount;
+                at.push_back(hop);
+            }
+        }
+        return at;
+    }
+}
+
+void setUp()
+{
+    gAnalyser.begin();
+}
+
+void tearDown() {}
+
+void test_silence_reads_zero()
+{
+    const Samples s = roundTrip(Samples(SAMPLE_RATE, 0));
+
+    for (size_t hop = 0; hop < s.size() / HOP_SIZE; ++hop)
+    {
+        const APP_AUDIO::Bands& b = feedHop(s, hop);
+        for (uint8_t band = 0; band < APP_AUDIO::NUM_BANDS; ++band)
+        {
+            TEST_ASSERT_EQUAL_UINT8(0, b.band[band]);
+        }
+        TEST_ASSERT_EQUAL_UINT8(0, b.level);
+        TEST_ASSERT_EQUAL_UINT32(0, b.beatCount);
+    }
+}
+
+// Every band auto-gains on its own, so a steady tone would in the end read
+// full scale in the bands its window leakage reaches too. After all bands
+// heard the same loudness, a tone in the middle of a band lights that band
+// and the bands two or more away stay well below it.
+void test_tone_lands_in_its_band()
+{
+    Samples all(SAMPLE_RATE / 2, 0);
+    for (uint8_t band = 0; band < APP_AUDIO::NUM_BANDS; ++band)
+    {
+        const Samples t = tone(bandHz(band), all.size(), TONE_AMPLITUDE / APP_AUDIO::NUM_BANDS);
+        for (size_t n = 0; n < all.size(); ++n)
+        {
+            all[n] = static_cast<int16_t>(all[n] + t[n]);
+        }
+    }
+
+    for (uint8_t band = 0; band < APP_AUDIO::NUM_BANDS; ++band)
+    {
+        gAnalyser.begin();
+        Samples s = all;
+        const Samples t = roundTrip(tone(bandHz(band), TONE_HOPS * HOP_SIZE, TONE_AMPLITUDE / APP_AUDIO::NUM_BANDS));
+        s.insert(s.end(), t.begin(), t.end());
+
+        APP_AUDIO::Bands b = {};
+        for (size_t hop = 0; hop < s.size() / HOP_SIZE; ++hop)
+        {
+            b = feedHop(s, hop);
+        }
+
+        printf("%6.0f Hz:", bandHz(band));
+        for (uint8_t other = 0; other < APP_AUDIO::NUM_BANDS; ++other)
+        {
+            printf(" %3u", b.band[other]);
+        }
+        printf("  level %u\n", b.level);
+
+        TEST_ASSERT_TRUE_MESSAGE(b.band[band] > 200, "tone band");
+        TEST_ASSERT_TRUE_MESSAGE(b.level > 0, "level");
+        for (uint8_t other = 0; other < APP_AUDIO::NUM_BANDS; ++other)
+        {
+            if (other + 1 < band || other > band + 1)
+            {
+                TEST_ASSERT_TRUE_MESSAGE(b.band[other] < FAR_BAND_MAX, "far band");
+            }
+        }
+    }
+}
+
+// Every kick gives exactly one beat, within a few hops of the kick
+void test_beats_follow_the_kick()
+{
+    const Samples s = roundTrip(kicks());
+    const std::vector<size_t> at = beats(s);
+
+    printf("%u kicks, %u beats, first at hop %u\n", KICKS, static_cast<unsigned>(at.size()),
+           at.empty() ? 0U : static_cast<unsigned>(at[0]));
+
+    TEST_ASSERT_EQUAL_UINT32(KICKS, at.size());
+    for (size_t k = 0; k < at.size(); ++k)
+    {
+        const size_t kickHop = (k + 1) * BEAT_SAMPLES / HOP_SIZE;
+        TEST_ASSERT_TRUE_MESSAGE(at[k] >= kickHop && at[k] <= kickHop + MAX_BEAT_DELAY_HOPS, "beat timing");
+    }
+}
+
+// A steady bass note starts once and is not a beat after that
+void test_steady_bass_is_not_a_beat()
+{
+    const Samples s = roundTrip(tone(90.0f, 4 * SAMPLE_RATE, KICK_AMPLITUDE));
+    const std::vector<size_t> at = beats(s);
+
+    TEST_ASSERT_TRUE(at.size() <= 1);
+    TEST_ASSERT_TRUE(at.empty() || at[0] < SETTLE_HOPS);
+}
+
+void test_throughput()
+{
+    const Samples s = kicks();
+    const size_t hops = s.size() / HOP_SIZE;
+    uint32_t sink = 0;
+
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t hop = 0; hop < hops; ++hop)
+    {
+        sink += feedHop(s, hop).band[0];
+    }
+    const float us = std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+    const float perHop = us / hops;
+    printf("%u hops, %.2f us/hop, %.0fx real time (%u)\n", static_cast<unsigned>(hops), perHop,
+           perHop > 0.0f ? 8000.0f / perHop : 0.0f, static_cast<unsigned>(sink & 1));
+    TEST_ASSERT_TRUE(perHop < MAX_US_PER_HOP);
+}
+
+// Not a check, a report for tuning on real music
+void test_recording()
+{
+    const char* path = getenv("AUDIO_WAV");
+    if (path == nullptr)
+    {
+        TEST_IGNORE_MESSAGE("set AUDIO_WAV to a 16 kHz 16-bit WAV to analyse it");
+    }
+
+    FILE* f = fopen(path, "rb");
+    TEST_ASSERT_NOT_NULL(f);
+    Samples s;
+    const bool ok = readWav(f, s);
+    fclose(f);
+    TEST_ASSERT_TRUE_MESSAGE(ok, "not a 16 kHz 16-bit PCM WAV");
+
+    uint32_t sum[APP_AUDIO::NUM_BANDS] = {};
+    APP_AUDIO::Bands b = {};
+    const size_t hops = s.size() / HOP_SIZE;
+    for (size_t hop = 0; hop < hops; ++hop)
+    {
+        b = feedHop(s, hop);
+        for (uint8_t band = 0; band < APP_AUDIO::NUM_BANDS; ++band)
+        {
+            sum[band] += b.band[band];
+        }
+    }
+
+    const float seconds = static_cast<float>(s.size()) / SAMPLE_RATE;
+    printf("%s: %.1f s, %u beats (%.0f per minute), mean bands", path, seconds, b.beatCount,
+           seconds > 0.0f ? b.beatCount * 60.0f / seconds : 0.0f);
+    for (uint8_t band = 0; band < APP_AUDIO::NUM_BANDS; ++band)
+    {
+        printf(" %3lu", static_cast<unsigned long>(hops ? sum[band] / hops : 0));
+    }
+    printf("\n");
+}
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_silence_reads_zero);
+    RUN_TEST(test_tone_lands_in_its_band);
+    RUN_TEST(test_beats_follow_the_kick);
+    RUN_TEST(test_steady_bass_is_not_a_beat);
+    RUN_TEST(test_throughput);
+    RUN_TEST(test_recording);
+    return UNITY_END();
+}
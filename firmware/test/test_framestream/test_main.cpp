@@ -0,0 +1,227 @@
+/*
+ * File:        test_main.cpp
+ * Author:      Marcus Lechner
+ * Created:     2025-10-18
+ * Description: Host round trip of the frame stream ops at 300 px, compression and frame rate, pio test -e native
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#include <unity.h>
+#include "HOST_HAL.hpp"
+#include "APP_FRAMESTREAM.hpp"
+#include "APP_FRAMESTREAM_CODEC.hpp"
+#include <stdio.h>
+#include <chrono>
+
+namespace
+{
+    using namespace APP_FRAMESTREAM_CODEC;
+
+    constexpr uint16_t PIXELS = 300;
+    constexpr size_t FRAME_BYTES = PIXELS * 3;
+    constexpr uint16_t FRAMES = 600;
+    constexpr uint8_t KEY_EVERY = 60;
+    constexpr uint16_t MTU = 247;          // what most phones negotiate with data length extension
+    constexpr size_t PAYLOAD = MTU - 3 - APP_FRAMESTREAM::HEADER_SIZE; // ATT header, frame header
+    constexpr float LINK_BYTES_PER_S = 10000.0f; // the unit FRAMESTREAM_BENCHMARK reports in
+
+    enum Effect : uint8_t
+    {
+        EFFECT_COMET = 0,
+        EFFECT_SPARKLE,
+        EFFECT_FADE,
+        EFFECT_RAINBOW,
+        NUM_EFFECTS
+    };
+
+    const char* const NAMES[NUM_EFFECTS] = { "comet", "sparkle", "fade", "rainbow" };
+
+    // Floors a little under what the encoder reaches (19.7x, 10.4x, 39.4x,
+    // 0.98x). Rainbow changes every pixel every frame and only must not grow.
+    const float MIN_RATIO[NUM_EFFECTS] = { 15.0f, 8.0f, 30.0f, 0.95f };
+    const float MIN_LINK_FPS[NUM_EFFECTS] = { 150.0f, 90.0f, 300.0f, 10.0f };  // at 10 kB/s
+
+    uint8_t gBlack[FRAME_BYTES];
+    uint8_t gPrevious[FRAME_BYTES];
+    uint8_t gCurrent[FRAME_BYTES];
+    uint8_t gDecoded[FRAME_BYTES];
+    uint8_t gOps[PIXELS * 4 + 8];
+
+    void put(uint8_t* rgb, uint16_t i, uint8_t r, uint8_t g, uint8_t b)
+    {
+        rgb[i * 3] = r;
+        rgb[i * 3 + 1] = g;
+        rgb[i * 3 + 2] = b;
+    }
+
+    // Hue wheel in three linear segments, enough to give every pixel its own colour
+    void wheel(uint8_t* rgb, uint16_t i, uint8_t hue)
+    {
+        const uint8_t segment = hue / 86;
+        const uint8_t step = static_cast<uint8_t>((hue % 86) * 3);
+        switch (segment)
+        {
+            case 0:  put(rgb, i, 255 - step, step, 0); break;
+            case 1:  put(rgb, i, 0, 255 - step, step); break;
+            default: put(rgb, i, step, 0, 255 - step); break;
+        }
+    }
+
+    // The effects of FRAMESTREAM_BENCHMARK, without FastLED so the ratios are exact
+    void effectFrame(Effect effect, uint16_t f, uint8_t* rgb)
+    {
+        memset(rgb, 0, FRAME_BYTES);
+
+        for (uint16_t i = 0; i < PIXELS; ++i)
+        {
+            switch (effect)
+            {
+                case EFFECT_COMET:
+                {
+                    const uint16_t head = (f * 2) % PIXELS;
+                    const uint16_t behind = (head + PIXELS - i) % PIXELS;
+                    if (behind < 12)
+                    {
+                        put(rgb, i, 0, 0, static_cast<uint8_t>(255 - behind * 20));
+                    }
+                    break;
+                }
+                case EFFECT_SPARKLE:
+                    if (((i * 7919U + f * 104729U) % 97) < 3)
+                    {
+                        put(rgb, i, 255, 255, 255);
+                    }
+                    break;
+                case EFFECT_FADE:
+                    wheel(rgb, i, static_cast<uint8_t>(f));
+                    break;
+                case EFFECT_RAINBOW:
+                default:
+                    wheel(rgb, i, static_cast<uint8_t>(f * 2 + i));
+                    break;
+            }
+        }
+    }
+
+    struct Result
+    {
+        uint32_t bytes;       // on the link, frame headers included
+        uint32_t writes;
+        uint16_t differ;
+        std::chrono::steady_clock::duration decode;
+    };
+
+    // Encodes every frame, splits it at the MTU like the app and decodes it
+    // fragment by fragment like the lamp, keyframes over black every KEY_EVERY
+    Result stream(Effect effect)
+    {
+        Decoder<PIXELS> decoder;
+        Result r = {};
+        memset(gPrevious, 0, sizeof(gPrevious));
+        memset(gDecoded, 0, sizeof(gDecoded));
+
+        for (uint16_t f = 0; f < FRAMES; ++f)
+        {
+            const bool key = f % KEY_EVERY == 0;
+            effectFrame(effect, f, gCurrent);
+            const size_t length = encodeFrame(key ? gBlack : gPrevious, gCurrent, PIXELS, gOps);
+
+            const auto start = std::chrono::steady_clock::now();
+            if (key)
+            {
+                memset(gDecoded, 0, sizeof(gDecoded));
+            }
+            decoder.reset();
+
+            size_t sent = 0;
+            do
+            {
+                const size_t n = length - sent < PAYLOAD ? length - sent : PAYLOAD;
+                decoder.decode(gOps + sent, n, gDecoded);
+                sent += n;
+                r.bytes += APP_FRAMESTREAM::HEADER_SIZE + n;
+                r.writes++;
+            }
+            while (sent < length);
+            r.decode += std::chrono::steady_clock::now() - start;
+
+            TEST_ASSERT_TRUE(decoder.isBetweenOps());
+            if (memcmp(gDecoded, gCurrent, FRAME_BYTES) != 0)
+            {
+                r.differ++;
+            }
+            memcpy(gPrevious, gCurrent, sizeof(gPrevious));
+        }
+        return r;
+    }
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_ops_split_anywhere()
+{
+    Decoder<4> decoder;
+    const uint8_t ops[] =
+    {
+        0x01, 1, 2, 3, 4, 5, 6,     // literal of 2
+        0x80,                       // skip 1
+        OP_RUN | 0x02, 9, 8, 7      // run of 3, the last 2 past the end
+    };
+    const uint8_t expected[12] = { 1, 2, 3, 4, 5, 6, 0xEE, 0xEE, 0xEE, 9, 8, 7 };
+
+    for (size_t split = 0; split <= sizeof(ops); ++split)
+    {
+        uint8_t frame[12];
+        memset(frame, 0xEE, sizeof(frame));
+        decoder.reset();
+        decoder.decode(ops, split, frame);
+        decoder.decode(ops + split, sizeof(ops) - split, frame);
+        TEST_ASSERT_TRUE(decoder.isBetweenOps());
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, frame, sizeof(frame));
+    }
+
+    // a frame cut off inside a literal
+    decoder.reset();
+    uint8_t frame[12];
+    decoder.decode(ops, 4, frame);
+    TEST_ASSERT_FALSE(decoder.isBetweenOps());
+}
+
+void test_unchanged_frame_is_empty()
+{
+    effectFrame(EFFECT_RAINBOW, 7, gCurrent);
+    TEST_ASSERT_EQUAL_UINT32(0, encodeFrame(gCurrent, gCurrent, PIXELS, gOps));
+}
+
+void test_effects_round_trip_with_ratio_and_frame_rate()
+{
+    for (uint8_t e = 0; e < NUM_EFFECTS; ++e)
+    {
+        const Result r = stream(static_cast<Effect>(e));
+
+        const float perFrame = static_cast<float>(r.bytes) / FRAMES;
+        const float ratio = FRAME_BYTES / perFrame;
+        const float linkFps = LINK_BYTES_PER_S / perFrame;
+        const float decodeUs = std::chrono::duration<float, std::micro>(r.decode).count() / FRAMES;
+
+        printf("%-8s %u px  ratio %5.1fx  %6.1f B/frame  %.2f writes/frame  %6.1f fps at 10 kB/s  decode %.2f us/frame (%.0f fps)\n",
+               NAMES[e], PIXELS, ratio, perFrame, static_cast<float>(r.writes) / FRAMES, linkFps,
+               decodeUs, decodeUs > 0.0f ? 1e6f / decodeUs : 0.0f);
+
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, r.differ, NAMES[e]);
+        TEST_ASSERT_TRUE_MESSAGE(ratio >= MIN_RATIO[e], NAMES[e]);
+        TEST_ASSERT_TRUE_MESSAGE(linkFps >= MIN_LINK_FPS[e], NAMES[e]);
+        // the BLE task decodes, 120 frames/s must leave it idle nearly all the time
+        TEST_ASSERT_TRUE_MESSAGE(decodeUs < 100.0f, NAMES[e]);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_ops_split_anywhere);
+    RUN_TEST(test_unchanged_frame_is_empty);
+    RUN_TEST(test_effects_round_trip_with_ratio_and_frame_rate);
+    return UNITY_END();
+}
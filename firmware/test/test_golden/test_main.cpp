@@ -0,0 +1,173 @@
+/*
+ * File:        test_main.cpp
+ * Author:      Marcus Lechner
+ * Created:     2025-10-18
+ * Description: Host check of every built-in pattern against the golden table, pio test -e native
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#include <unity.h>
+#include "HOST_HAL.hpp"
+#include "APP_LED.hpp"
+#include "APP_GOLDEN.hpp"
+#include <FastLED.h>
+#include <stdio.h>
+
+void setUp()
+{
+    HOST_HAL::gStreamActive = false;
+    HOST_HAL::gStreamRenders = 0;
+}
+
+void tearDown()
+{
+}
+
+// Strip over time like the lamp's GOLDEN dump, one row per frame, but binary
+// P6 into the working directory so an image viewer opens it straight away
+void writePpm(uint8_t animId)
+{
+    char path[32];
+    snprintf(path, sizeof(path), "golden_pattern%02u.ppm", animId);
+
+    FILE* file = fopen(path, "wb");
+    if (file == nullptr)
+    {
+        printf("cannot write %s\n", path);
+        return;
+    }
+
+    fprintf(file, "P6\n%u %u\n255\n", APP_LED::NUM_LEDS, APP_GOLDEN::FRAMES);
+
+    APP_LED::beginReference(animId, APP_GOLDEN::SEED);
+    for (uint16_t f = 0; f < APP_GOLDEN::FRAMES; ++f)
+    {
+        fwrite(APP_LED::renderReference(f), 3, APP_LED::NUM_LEDS, file);
+    }
+    APP_LED::endReference();
+
+    fclose(file);
+    printf("pattern %u frames written to %s\n", animId, path);
+}
+
+void test_table_covers_every_pattern()
+{
+    TEST_ASSERT_EQUAL_UINT8_MESSAGE(APP_LED::patternCount(), APP_GOLDEN::TABLE_SIZE,
+                                    "one golden entry per pattern, regenerate APP_GOLDEN_TABLE.cpp");
+}
+
+void test_patterns_match_golden()
+{
+    uint8_t failed = 0;
+    uint8_t missing = 0;
+
+    for (uint8_t p = 0; p < APP_LED::patternCount() && p < APP_GOLDEN::TABLE_SIZE; ++p)
+    {
+        if (!APP_LED::isDeterministic(p))
+        {
+            continue;
+        }
+
+        const uint32_t crc = APP_GOLDEN::checksum(p);
+        if (APP_GOLDEN::TABLE[p] == APP_GOLDEN::NOT_RECORDED)
+        {
+            missing++;
+            printf("pattern %u: %08lX, not recorded\n", p, static_cast<unsigned long>(crc));
+            writePpm(p);
+        }
+        else if (crc != APP_GOLDEN::TABLE[p])
+        {
+            failed++;
+            printf("pattern %u: %08lX, golden %08lX\n",
+                   p, static_cast<unsigned long>(crc), static_cast<unsigned long>(APP_GOLDEN::TABLE[p]));
+            writePpm(p);
+        }
+    }
+
+    if (failed || missing)
+    {
+        printf("If the change is intended, this is the new APP_GOLDEN_TABLE.cpp table:\n");
+        APP_GOLDEN::printTable();
+    }
+
+    TEST_ASSERT_EQUAL_UINT8_MESSAGE(0, failed, "patterns differ from the golden table");
+
+    // an empty entry would pass forever, check the PPMs and paste the table printed above
+    TEST_ASSERT_EQUAL_UINT8_MESSAGE(0, missing, "deterministic patterns without a golden entry");
+}
+
+void test_reference_is_repeatable()
+{
+    for (uint8_t p = 0; p < APP_LED::patternCount(); ++p)
+    {
+        if (APP_LED::isDeterministic(p))
+        {
+            TEST_ASSERT_EQUAL_HEX32(APP_GOLDEN::checksum(p), APP_GOLDEN::checksum(p));
+        }
+    }
+}
+
+// A pixel stream drives the live strip, the reference must still be the pattern alone
+void test_reference_ignores_streams()
+{
+    const uint32_t plain = APP_GOLDEN::checksum(1);
+
+    HOST_HAL::gStreamActive = true;
+    const uint32_t streaming = APP_GOLDEN::checksum(1);
+
+    TEST_ASSERT_EQUAL_HEX32(plain, streaming);
+    TEST_ASSERT_EQUAL_UINT32(0, HOST_HAL::gStreamRenders);
+}
+
+// One live frame: moves the clock past the frame timer and lets the render loop run
+void showLiveFrame()
+{
+    HOST_HAL::gClockMs += 100;
+    APP_LED::process();
+}
+
+// Twinkle fades what it drew before and places white sparkles from the seed,
+// so its second frame depends on the live strip and random state alone
+void twinkleTwice(bool referenceInBetween, uint8_t* shown)
+{
+    APP_LED::setSolidColor(0, 0, 0);
+    APP_LED::setAnimation(0);
+    showLiveFrame();
+
+    random16_set_seed(7);
+    APP_LED::setAnimation(8);
+    showLiveFrame();
+
+    if (referenceInBetween)
+    {
+        APP_GOLDEN::checksum(7); // fire, nothing like twinkle
+    }
+
+    showLiveFrame();
+    memcpy(shown, HOST_HAL::gShown, sizeof(HOST_HAL::gShown));
+}
+
+void test_reference_leaves_live_strip()
+{
+    uint8_t undisturbed[APP_LED::NUM_LEDS * 3];
+    uint8_t disturbed[APP_LED::NUM_LEDS * 3];
+
+    twinkleTwice(false, undisturbed);
+    twinkleTwice(true, disturbed);
+
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(undisturbed, disturbed, sizeof(undisturbed));
+}
+
+int main(int argc, char** argv)
+{
+    HOST_HAL::init();
+    APP_LED::init();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_table_covers_every_pattern);
+    RUN_TEST(test_patterns_match_golden);
+    RUN_TEST(test_reference_is_repeatable);
+    RUN_TEST(test_reference_ignores_streams);
+    RUN_TEST(test_reference_leaves_live_strip);
+    return UNITY_END();
+}
@@ -0,0 +1,196 @@
+/*
+ * File:        test_main.cpp
+ * Author:      Marcus Lechner
+ * Created:     2025-10-18
+ * Description: Host check of the APP_MAP fields and of mapped patterns against index based ones, pio test -e native
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#include <unity.h>
+#include "HOST_HAL.hpp"
+#include "APP_MAP.hpp"
+#include <FastLED.h>
+#include <math.h>
+#include <stdio.h>
+#include <chrono>
+
+namespace
+{
+    using APP_MAP::NUM_PIXELS;
+
+    constexpr uint16_t FRAMES = 20000;
+    constexpr float MAX_MAPPED_RATIO = 2.0f;   // mapped time over index based time
+
+    uint8_t gField[NUM_PIXELS];
+    uint8_t gRings[NUM_PIXELS];
+    CRGB gLeds[NUM_PIXELS];
+    uint8_t gHue = 0;
+    volatile uint8_t gSink;   // keeps the frames from being optimised away
+
+    // Signed distance between two field values, they wrap like a phase
+    int wrapped(uint8_t a, uint8_t b)
+    {
+        return static_cast<int8_t>(static_cast<uint8_t>(a - b));
+    }
+
+    // colorWaves and bpm as APP_LED draws them, and as they were before APP_MAP
+    void colorWavesMapped()
+    {
+        static CRGBPalette16 palette = RainbowColors_p;
+        const APP_MAP::Map& map = APP_MAP::get();
+        APP_MAP::linearField(gField, 16, 0, 64, gHue * 2);
+
+        for (uint8_t i = 0; i < NUM_PIXELS; ++i)
+        {
+            uint8_t index = sin8(gField[i]);
+            uint8_t bright = sin8(map.angle[i] + map.z[i] + gHue * 3);
+            gLeds[i] = ColorFromPalette(palette, index, bright, LINEARBLEND);
+        }
+    }
+
+    void colorWavesRaw()
+    {
+        static CRGBPalette16 palette = RainbowColors_p;
+
+        for (uint8_t i = 0; i < NUM_PIXELS; ++i)
+        {
+            uint8_t index = sin8(i * 8 + gHue * 2);
+            uint8_t bright = sin8(i * 16 + gHue * 3);
+            gLeds[i] = ColorFromPalette(palette, index, bright, LINEARBLEND);
+        }
+    }
+
+    // The rings come from APP_LED::init(), the pixels never move
+    void bpmMapped()
+    {
+        static const CRGBPalette16 palette = PartyColors_p;
+        uint8_t beat = beatsin8(62, 64, 255);
+
+        for (int i = 0; i < NUM_PIXELS; ++i)
+        {
+            gLeds[i] = ColorFromPalette(palette, gHue + gRings[i], beat - gHue + gRings[i] * 5);
+        }
+    }
+
+    void rings()
+    {
+        APP_MAP::radialField(gRings, 128, 128, 128, 64, 0);
+    }
+
+    void bpmRaw()
+    {
+        static const CRGBPalette16 palette = PartyColors_p;
+        uint8_t beat = beatsin8(62, 64, 255);
+
+        for (int i = 0; i < NUM_PIXELS; ++i)
+        {
+            gLeds[i] = ColorFromPalette(palette, gHue + (i * 2), beat - gHue + (i * 10));
+        }
+    }
+
+    float nsPerPixel(void (*pattern)())
+    {
+        const auto start = std::chrono::steady_clock::now();
+        for (uint16_t f = 0; f < FRAMES; ++f)
+        {
+            pattern();
+            gSink = gLeds[f % NUM_PIXELS].r;
+            gHue++;
+        }
+        const float ns = std::chrono::duration<float, std::nano>(std::chrono::steady_clock::now() - start).count();
+        return ns / (static_cast<float>(FRAMES) * NUM_PIXELS);
+    }
+}
+
+void setUp()
+{
+    APP_MAP::init();
+}
+
+void tearDown() {}
+
+// Every pixel's value is its distance from the centre, scaled and phased, up
+// to the rounding of the halved axes and sqrt16()
+void test_radial_field_is_the_distance()
+{
+    const APP_MAP::Map& map = APP_MAP::get();
+    const uint8_t centres[][3] = { { 128, 128, 128 }, { 128, 128, 0 }, { 0, 255, 64 } };
+    const uint8_t scales[] = { 16, 64, 128 };
+
+    for (const auto& c : centres)
+    {
+        for (uint8_t scale : scales)
+        {
+            const uint8_t phase = static_cast<uint8_t>(c[2] + scale);
+            APP_MAP::radialField(gField, c[0], c[1], c[2], scale, phase);
+
+            const int tolerance = 3 * scale / 64 + 1;
+            for (uint8_t i = 0; i < NUM_PIXELS; ++i)
+            {
+                const float dx = static_cast<float>(map.x[i]) - c[0];
+                const float dy = static_cast<float>(map.y[i]) - c[1];
+                const float dz = static_cast<float>(map.z[i]) - c[2];
+                const float distance = sqrtf(dx * dx + dy * dy + dz * dz);
+                const uint8_t expected = static_cast<uint8_t>(phase + static_cast<uint32_t>(distance * scale / 64.0f));
+                TEST_ASSERT_TRUE(abs(wrapped(gField[i], expected)) <= tolerance);
+            }
+        }
+    }
+}
+
+// Rings start at their centre: centred on a pixel, the field reads the phase
+// there and more on every other pixel. At scale 32 not even the 441 across
+// the cube wraps past 255.
+void test_radial_rings_start_at_the_centre()
+{
+    const APP_MAP::Map& map = APP_MAP::get();
+
+    for (uint8_t k = 0; k < NUM_PIXELS; ++k)
+    {
+        APP_MAP::radialField(gField, map.x[k], map.y[k], map.z[k], 32, 0);
+        TEST_ASSERT_EQUAL_UINT8(0, gField[k]);
+        for (uint8_t i = 0; i < NUM_PIXELS; ++i)
+        {
+            TEST_ASSERT_TRUE(i == k || gField[i] > 0);
+        }
+    }
+}
+
+// A mapped pattern pays for its field, not more than twice the index based one.
+// bpm's rings are worked out once, per frame they would be the sqrt16() cost
+// radialField reports.
+void test_mapped_patterns_against_raw()
+{
+    struct Pair
+    {
+        const char* name;
+        void (*raw)();
+        void (*mapped)();
+    };
+    const Pair pairs[] =
+    {
+        { "colorWaves", colorWavesRaw, colorWavesMapped },
+        { "bpm", bpmRaw, bpmMapped }
+    };
+
+    rings();
+    for (const Pair& p : pairs)
+    {
+        const float raw = nsPerPixel(p.raw);
+        const float mapped = nsPerPixel(p.mapped);
+        printf("%-12s x%u raw %6.1f ns/px  mapped %6.1f ns/px  ratio %.2fx\n",
+               p.name, NUM_PIXELS, raw, mapped, mapped / raw);
+        TEST_ASSERT_TRUE_MESSAGE(mapped < raw * MAX_MAPPED_RATIO, p.name);
+    }
+
+    printf("radialField  x%u %6.1f ns/px, once at init\n", NUM_PIXELS, nsPerPixel(rings));
+}
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_radial_field_is_the_distance);
+    RUN_TEST(test_radial_rings_start_at_the_centre);
+    RUN_TEST(test_mapped_patterns_against_raw);
+    return UNITY_END();
+}
@@ -0,0 +1,119 @@
+/*
+ * File:        test_main.cpp
+ * Author:      Marcus Lechner
+ * Created:     2025-10-18
+ * Description: Host allocation audit of the render loop on APP_MEMORY's operator new, pio test -e native
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#include <unity.h>
+#include "HOST_HAL.hpp"
+#include "APP_LED.hpp"
+#include "APP_SETTINGS.hpp"
+#include "APP_GOLDEN.hpp"
+#include "APP_PATTERN.hpp"
+#include "APP_MEMORY.hpp"
+
+namespace
+{
+    using namespace APP_PATTERN;
+
+    constexpr uint32_t PASS_MS = 8;           // one loop pass at 120 FPS
+    constexpr uint32_t PASSES = 3000;
+    constexpr uint32_t PASSES_PER_CHANGE = 50;
+
+    const uint8_t WAVES[] =
+    {
+        0x01, PALETTE_OCEAN, 0x00, 0x00, 0x00,
+        OP_I, OP_K, 0x08, OP_MUL, OP_T, OP_ADD, OP_SIN, OP_DUP, OP_PAL
+    };
+
+    // The parts of loop() the native env builds, in loop() order
+    void loopPass()
+    {
+        HOST_HAL::gClockMs += PASS_MS;
+        APP_LED::process();
+        APP_SETTINGS::process();
+        APP_GOLDEN::process();
+        APP_MEMORY::process();
+    }
+
+    // What the lamp does at run time besides rendering: pattern, colour,
+    // brightness and crossfades from BLE, and a user pattern upload
+    void change(uint32_t step)
+    {
+        const uint8_t patterns = APP_LED::patternCount();
+
+        APP_LED::startCrossfade(200);
+        switch (step % 4)
+        {
+            case 0:
+                APP_LED::setAnimation(static_cast<uint8_t>((step / 4) % patterns));
+                break;
+            case 1:
+                APP_LED::setSolidColor(static_cast<uint8_t>(step), 0x40, 0xC0);
+                break;
+            case 2:
+                APP_LED::setBrightness(static_cast<uint8_t>(64 + step));
+                break;
+            default:
+                TEST_ASSERT_TRUE(load(0, WAVES, sizeof(WAVES)));
+                APP_LED::setAnimation(APP_LED::USER_PATTERN_BASE);
+                break;
+        }
+    }
+}
+
+void setUp() {}
+void tearDown() {}
+
+// Settings commits are left out on purpose: on the lamp they go to NVS,
+// which allocates with malloc() out of operator new's sight, so the host
+// could not tell either way.
+void test_render_loop_does_not_allocate_in_steady_state()
+{
+    HOST_HAL::init();
+    APP_MEMORY::init();
+    APP_LED::init();
+    APP_SETTINGS::init();
+    HOST_HAL::gBootComplete = true;
+
+    // boot, then the STEADY_AFTER_MS grace period
+    while (!APP_MEMORY::isSteady())
+    {
+        loopPass();
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, APP_MEMORY::steadyAllocations());
+
+    for (uint32_t pass = 0; pass < PASSES; ++pass)
+    {
+        if (pass % PASSES_PER_CHANGE == 0)
+        {
+            change(pass / PASSES_PER_CHANGE);
+        }
+        loopPass();
+    }
+
+    TEST_ASSERT_TRUE(HOST_HAL::gFramesShown > PASSES / 2);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, APP_MEMORY::steadyAllocations(),
+                                     "allocation in steady state, see the [MEM] line above");
+}
+
+// The audit above only means something if new really goes through APP_MEMORY
+void test_audit_sees_an_allocation()
+{
+    const uint32_t before = APP_MEMORY::steadyAllocations();
+
+    uint8_t* volatile block = new uint8_t[16];
+    delete[] block;
+
+    TEST_ASSERT_EQUAL_UINT32(before + 1, APP_MEMORY::steadyAllocations());
+}
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_render_loop_does_not_allocate_in_steady_state);
+    RUN_TEST(test_audit_sees_an_allocation);
+    return UNITY_END();
+}
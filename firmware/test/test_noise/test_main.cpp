@@ -0,0 +1,245 @@
+/*
+ * File:        test_main.cpp
+ * Author:      Marcus Lechner
+ * Created:     2025-10-18
+ * Description: Host comparison of the APP_NOISE engine with per-pixel inoise8, speed and field quality, pio test -e native
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#include <unity.h>
+#include "HOST_HAL.hpp"
+#include "APP_NOISE.hpp"
+#include <FastLED.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+
+// The same fixture and octaves as benchmarkNoise() in APP_LED.cpp: 1000
+// pixels wound 33 to a turn, three octaves, the engine on a 4 x 4 base lattice
+// and inoise8 summed per pixel at matching scales.
+namespace
+{
+    constexpr uint16_t PIXELS = 1000;
+    constexpr uint8_t PIXELS_PER_TURN = 33;
+    constexpr uint8_t OCTAVES = 3;
+    constexpr uint16_t FRAMES = 200;
+    constexpr uint16_t TIME_STEP = 16;          // 1/16 of a coarse cell per frame, as the bench
+
+    constexpr float MAX_SPEED_RATIO = 0.5f;     // engine time over inoise8 time
+    constexpr float MIN_CONTRAST_RATIO = 0.5f;  // engine spread over inoise8 spread
+    constexpr float MAX_STEP_RATIO = 1.5f;      // engine frame-to-frame change over inoise8's
+
+    typedef APP_NOISE::NoiseField<PIXELS, OCTAVES> Field;
+
+    uint8_t gAngle[PIXELS];
+    uint8_t gHeight[PIXELS];
+    uint8_t gEngine[FRAMES][PIXELS];
+    uint8_t gReference[FRAMES][PIXELS];
+
+    Field gField(1, 4, 4);
+
+    void helix()
+    {
+        for (uint16_t i = 0; i < PIXELS; ++i)
+        {
+            gAngle[i] = static_cast<uint8_t>((i * 256UL) / PIXELS_PER_TURN);
+            gHeight[i] = static_cast<uint8_t>((i * 255UL) / (PIXELS - 1));
+        }
+    }
+
+    // The per-pixel way, as benchmarkNoise() does it
+    void referenceFrame(uint16_t f, uint8_t* out)
+    {
+        for (uint16_t i = 0; i < PIXELS; ++i)
+        {
+            uint8_t v = 0;
+            for (uint8_t o = 0; o < OCTAVES; ++o)
+            {
+                v += inoise8(gAngle[i] << (4 + o), gHeight[i] << (4 + o), f << (4 + o)) >> (o + 1);
+            }
+            out[i] = v;
+        }
+    }
+
+    struct Quality
+    {
+        float spread;   // 5th to 95th percentile over every pixel and frame
+        float step;     // mean change of a pixel from one frame to the next
+        int maxStep;
+    };
+
+    Quality quality(const uint8_t (&frames)[FRAMES][PIXELS])
+    {
+        uint32_t histogram[256] = {};
+        uint64_t steps = 0;
+        Quality q = {};
+
+        for (uint16_t f = 0; f < FRAMES; ++f)
+        {
+            for (uint16_t i = 0; i < PIXELS; ++i)
+            {
+                histogram[frames[f][i]]++;
+                if (f > 0)
+                {
+                    const int step = abs(frames[f][i] - frames[f - 1][i]);
+                    steps += step;
+                    q.maxStep = step > q.maxStep ? step : q.maxStep;
+                }
+            }
+        }
+
+        const uint32_t total = static_cast<uint32_t>(FRAMES) * PIXELS;
+        uint32_t seen = 0;
+        int low = -1;
+        int high = 255;
+        for (int v = 0; v < 256; ++v)
+        {
+            seen += histogram[v];
+            if (low < 0 && seen >= total / 20)
+            {
+                low = v;
+            }
+            if (seen >= total - total / 20)
+            {
+                high = v;
+                break;
+            }
+        }
+
+        q.spread = static_cast<float>(high - low);
+        q.step = static_cast<float>(steps) / (static_cast<float>(FRAMES - 1) * PIXELS);
+        return q;
+    }
+
+    template <class Fn>
+    float nsPerPixel(Fn frame)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        for (uint16_t f = 0; f < FRAMES; ++f)
+        {
+            frame(f);
+        }
+        const float ns = std::chrono::duration<float, std::nano>(std::chrono::steady_clock::now() - start).count();
+        return ns / (static_cast<float>(FRAMES) * PIXELS);
+    }
+}
+
+void setUp() {}
+void tearDown() {}
+
+// The engine is there to be cheaper than inoise8 per pixel without losing
+// what makes it noise: as much contrast and no harder steps in time
+void test_engine_against_per_pixel_inoise8()
+{
+    helix();
+    gField.init(gAngle, gHeight);
+
+    const float reference = nsPerPixel([](uint16_t f) { referenceFrame(f, gReference[f]); });
+    const float engine = nsPerPixel([](uint16_t f) { gField.render(gEngine[f], f * TIME_STEP); });
+
+    const Quality r = quality(gReference);
+    const Quality e = quality(gEngine);
+
+    printf("x%u, %u octaves: inoise8 %.1f ns/px, engine %.1f ns/px, ratio %.2fx\n",
+           PIXELS, OCTAVES, reference, engine, engine / reference);
+    printf("inoise8 spread %.0f, step %.2f (max %d)  engine spread %.0f, step %.2f (max %d)\n",
+           r.spread, r.step, r.maxStep, e.spread, e.step, e.maxStep);
+
+    TEST_ASSERT_TRUE_MESSAGE(engine < reference * MAX_SPEED_RATIO, "engine speed");
+    TEST_ASSERT_TRUE_MESSAGE(e.spread >= r.spread * MIN_CONTRAST_RATIO, "engine contrast");
+    TEST_ASSERT_TRUE_MESSAGE(e.step <= r.step * MAX_STEP_RATIO, "engine smoothness");
+}
+
+// Round the lamp there is no seam: stepping from angle 255 back to 0 changes
+// the value no more than any other step along the ring
+void test_no_seam_around_the_lamp()
+{
+    static APP_NOISE::NoiseField<256, OCTAVES> ring(1, 4, 4);
+    uint8_t angle[256];
+    uint8_t height[256];
+    uint8_t out[256];
+
+    for (uint16_t i = 0; i < 256; ++i)
+    {
+        angle[i] = static_cast<uint8_t>(i);
+        height[i] = 100;
+    }
+    ring.init(angle, height);
+
+    for (uint16_t f = 0; f < 64; ++f)
+    {
+        ring.render(out, f * 37);
+
+        int inside = 0;
+        for (uint16_t i = 1; i < 256; ++i)
+        {
+            const int step = abs(out[i] - out[i - 1]);
+            inside = step > inside ? step : inside;
+        }
+        TEST_ASSERT_TRUE(abs(out[0] - out[255]) <= inside + 1);
+    }
+}
+
+// Time may wrap: the frame after 0xFFFF continues the field like any other
+void test_time_wraps_smoothly()
+{
+    helix();
+    gField.init(gAngle, gHeight);
+
+    uint8_t previous[PIXELS];
+    uint8_t current[PIXELS];
+    int worst = 0;
+    int wrap = 0;
+
+    gField.render(previous, static_cast<uint16_t>(-32 * TIME_STEP));
+    for (int f = -31; f <= 32; ++f)
+    {
+        gField.render(current, static_cast<uint16_t>(f * TIME_STEP));
+        for (uint16_t i = 0; i < PIXELS; ++i)
+        {
+            const int step = abs(current[i] - previous[i]);
+            if (f == 0)
+            {
+                wrap = step > wrap ? step : wrap;
+            }
+            else
+            {
+                worst = step > worst ? step : worst;
+            }
+        }
+        memcpy(previous, current, sizeof(previous));
+    }
+
+    TEST_ASSERT_TRUE(wrap <= worst);
+}
+
+// Same seed, same field; another seed, another field
+void test_seed_decides_the_field()
+{
+    helix();
+    static Field same(1, 4, 4);
+    static Field other(2, 4, 4);
+    uint8_t a[PIXELS];
+    uint8_t b[PIXELS];
+    uint8_t c[PIXELS];
+
+    gField.init(gAngle, gHeight);
+    same.init(gAngle, gHeight);
+    other.init(gAngle, gHeight);
+    gField.render(a, 1234);
+    same.render(b, 1234);
+    other.render(c, 1234);
+
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(a, b, PIXELS);
+    TEST_ASSERT_TRUE(memcmp(a, c, PIXELS) != 0);
+}
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_engine_against_per_pixel_inoise8);
+    RUN_TEST(test_no_seam_around_the_lamp);
+    RUN_TEST(test_time_wraps_smoothly);
+    RUN_TEST(test_seed_decides_the_field);
+    return UNITY_END();
+}
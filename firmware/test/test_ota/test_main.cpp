@@ -0,0 +1,482 @@
+/*
+ * File:        test_main.cpp
+ * Author:      Marcus Lechner
+ * Created:     2025-10-18
+ * Description: Host check of the OTA chunk pipeline against a file standing in for the flash slot, pio test -e native
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#include <unity.h>
+#include "HOST_HAL.hpp"
+#include "APP_OTA.hpp"
+#include "APP_OTA_SESSION.hpp"
+#include <stdio.h>
+#include <vector>
+
+namespace
+{
+    constexpr uint32_t SLOT_SIZE = 64 * 1024;
+    constexpr uint32_t IMAGE_SIZE = 20000;  // not a multiple of a chunk or of ACK_BYTES
+    constexpr size_t CHUNK = 244;           // a 247 byte MTU less the ATT header
+    constexpr char SLOT_PATH[] = "ota_slot.bin";
+
+    // The app slot as a file: written sequentially, truncated on begin
+    class FileFlash
+    {
+    public:
+        uint32_t capacity() { return SLOT_SIZE; }
+
+        bool begin()
+        {
+            closeFile();
+            _file = fopen(SLOT_PATH, "wb");
+            begun++;
+            return _file != nullptr;
+        }
+
+        bool write(const uint8_t* data, size_t length)
+        {
+            return !failWrites && fwrite(data, 1, length, _file) == length;
+        }
+
+        bool end()
+        {
+            closeFile();
+            ended++;
+            return true;
+        }
+
+        void abort()
+        {
+            closeFile();
+            aborted++;
+        }
+
+        const char* label() { return SLOT_PATH; }
+
+        std::vector<uint8_t> contents()
+        {
+            fflush(_file);
+            std::vector<uint8_t> bytes;
+            FILE* file = fopen(SLOT_PATH, "rb");
+            int c;
+            while (file && (c = fgetc(file)) != EOF)
+            {
+                bytes.push_back(static_cast<uint8_t>(c));
+            }
+            if (file)
+            {
+                fclose(file);
+            }
+            return bytes;
+        }
+
+        uint32_t begun = 0;
+        uint32_t ended = 0;
+        uint32_t aborted = 0;
+        bool failWrites = false;
+
+    private:
+        void closeFile()
+        {
+            if (_file)
+            {
+                fclose(_file);
+                _file = nullptr;
+            }
+        }
+
+        FILE* _file = nullptr;
+    };
+
+    // FIPS 180-4 SHA-256, what mbedtls does on the lamp
+    class Sha256
+    {
+    public:
+        void begin()
+        {
+            static const uint32_t INIT[8] =
+            {
+                0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+            };
+            memcpy(_h, INIT, sizeof(_h));
+            _length = 0;
+            _used = 0;
+        }
+
+        void update(const uint8_t* data, size_t length)
+        {
+            for (size_t i = 0; i < length; ++i)
+            {
+                _block[_used++] = data[i];
+                if (_used == 64)
+                {
+                    compress();
+                    _used = 0;
+                }
+            }
+            _length += length;
+        }
+
+        void finish(uint8_t* hash)
+        {
+            const uint64_t bits = _length * 8;
+            const uint8_t one = 0x80;
+            const uint8_t zero = 0;
+
+            update(&one, 1);
+            while (_used != 56)
+            {
+                update(&zero, 1);
+            }
+            for (int shift = 56; shift >= 0; shift -= 8)
+            {
+                const uint8_t b = static_cast<uint8_t>(bits >> shift);
+                update(&b, 1);
+            }
+
+            for (uint8_t i = 0; i < 8; ++i)
+            {
+                hash[i * 4]     = static_cast<uint8_t>(_h[i] >> 24);
+                hash[i * 4 + 1] = static_cast<uint8_t>(_h[i] >> 16);
+                hash[i * 4 + 2] = static_cast<uint8_t>(_h[i] >> 8);
+                hash[i * 4 + 3] = static_cast<uint8_t>(_h[i]);
+            }
+        }
+
+        void discard() {}
+
+    private:
+        static uint32_t rotr(uint32_t x, uint8_t n) { return (x >> n) | (x << (32 - n)); }
+
+        void compress()
+        {
+            static const uint32_t K[64] =
+            {
+                0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+                0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+                0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+                0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+                0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+                0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+                0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+                0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+            };
+
+            uint32_t w[64];
+            for (uint8_t i = 0; i < 16; ++i)
+            {
+                w[i] = (static_cast<uint32_t>(_block[i * 4]) << 24) | (_block[i * 4 + 1] << 16)
+                     | (_block[i * 4 + 2] << 8) | _block[i * 4 + 3];
+            }
+            for (uint8_t i = 16; i < 64; ++i)
+            {
+                const uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+                const uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+                w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+            }
+
+            uint32_t a = _h[0], b = _h[1], c = _h[2], d = _h[3], e = _h[4], f = _h[5], g = _h[6], h = _h[7];
+            for (uint8_t i = 0; i < 64; ++i)
+            {
+                const uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+                const uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+                h = g; g = f; f = e; e = d + t1; d = c; c = b; b = a; a = t1 + t2;
+            }
+
+            _h[0] += a; _h[1] += b; _h[2] += c; _h[3] += d; _h[4] += e; _h[5] += f; _h[6] += g; _h[7] += h;
+        }
+
+        uint32_t _h[8];
+        uint8_t _block[64];
+        uint8_t _used;
+        uint64_t _length;
+    };
+
+    typedef APP_OTA_SESSION::Session<FileFlash, Sha256> Session;
+
+    uint8_t gImage[IMAGE_SIZE];
+    uint8_t gHash[APP_OTA_SESSION::HASH_SIZE];
+    uint32_t gNowMs = 0;
+
+    struct Reply
+    {
+        size_t length;
+        uint8_t status;
+        uint32_t offset;
+    };
+
+    Reply send(Session& session, const uint8_t* data, size_t length)
+    {
+        uint8_t out[APP_OTA::REPLY_SIZE];
+        Reply r = {};
+        r.length = session.handle(data, length, out, gNowMs);
+        if (r.length)
+        {
+            r.status = out[0];
+            r.offset = out[1] | (out[2] << 8) | (out[3] << 16) | (static_cast<uint32_t>(out[4]) << 24);
+        }
+        return r;
+    }
+
+    void putU32(uint8_t* p, uint32_t v)
+    {
+        p[0] = static_cast<uint8_t>(v);
+        p[1] = static_cast<uint8_t>(v >> 8);
+        p[2] = static_cast<uint8_t>(v >> 16);
+        p[3] = static_cast<uint8_t>(v >> 24);
+    }
+
+    Reply sendBegin(Session& session, uint32_t size, const uint8_t* hash)
+    {
+        uint8_t msg[APP_OTA_SESSION::BEGIN_SIZE];
+        msg[0] = APP_OTA::OP_BEGIN;
+        putU32(msg + 1, size);
+        memcpy(msg + 5, hash, APP_OTA_SESSION::HASH_SIZE);
+        return send(session, msg, sizeof(msg));
+    }
+
+    Reply sendData(Session& session, uint32_t offset)
+    {
+        uint8_t msg[APP_OTA_SESSION::DATA_HEADER + CHUNK];
+        const size_t count = (IMAGE_SIZE - offset < CHUNK) ? IMAGE_SIZE - offset : CHUNK;
+        msg[0] = APP_OTA::OP_DATA;
+        putU32(msg + 1, offset);
+        memcpy(msg + APP_OTA_SESSION::DATA_HEADER, gImage + offset, count);
+        gNowMs += 2; // roughly a connection interval per chunk
+        return send(session, msg, APP_OTA_SESSION::DATA_HEADER + count);
+    }
+
+    Reply sendOp(Session& session, uint8_t op)
+    {
+        return send(session, &op, 1);
+    }
+
+    // Streams the image from offset up to stop, checking every reply on the way
+    uint32_t stream(Session& session, uint32_t offset, uint32_t stop)
+    {
+        uint32_t acks = 0;
+        while (offset < stop)
+        {
+            const Reply r = sendData(session, offset);
+            offset += (IMAGE_SIZE - offset < CHUNK) ? IMAGE_SIZE - offset : CHUNK;
+            if (r.length)
+            {
+                TEST_ASSERT_EQUAL_UINT8(APP_OTA::STATUS_PROGRESS, r.status);
+                TEST_ASSERT_EQUAL_UINT32(offset, r.offset);
+                acks++;
+            }
+        }
+        return acks;
+    }
+
+    void checkSlotHoldsImage(FileFlash& flash)
+    {
+        const std::vector<uint8_t> slot = flash.contents();
+        TEST_ASSERT_EQUAL_UINT32(IMAGE_SIZE, slot.size());
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(gImage, slot.data(), IMAGE_SIZE);
+    }
+}
+
+void setUp()
+{
+    uint32_t x = 0x12345678;
+    for (uint32_t i = 0; i < IMAGE_SIZE; ++i)
+    {
+        x = x * 1664525 + 1013904223;
+        gImage[i] = static_cast<uint8_t>(x >> 24);
+    }
+
+    Sha256 sha;
+    sha.begin();
+    sha.update(gImage, IMAGE_SIZE);
+    sha.finish(gHash);
+}
+
+void tearDown()
+{
+    remove(SLOT_PATH);
+}
+
+// The stand-in has to be SHA-256 for the mismatch test to mean anything
+void test_sha256_matches_known_vector()
+{
+    const uint8_t expected[APP_OTA_SESSION::HASH_SIZE] =
+    {
+        0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea, 0x41, 0x41, 0x40, 0xde, 0x5d, 0xae, 0x22, 0x23,
+        0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17, 0x7a, 0x9c, 0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad
+    };
+    uint8_t hash[APP_OTA_SESSION::HASH_SIZE];
+
+    Sha256 sha;
+    sha.begin();
+    sha.update(reinterpret_cast<const uint8_t*>("abc"), 3);
+    sha.finish(hash);
+
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, hash, sizeof(hash));
+}
+
+void test_in_order_upload_is_written_and_verified()
+{
+    FileFlash flash;
+    Sha256 sha;
+    Session session(flash, sha);
+
+    Reply r = sendBegin(session, IMAGE_SIZE, gHash);
+    TEST_ASSERT_EQUAL_UINT8(APP_OTA::STATUS_READY, r.status);
+    TEST_ASSERT_EQUAL_UINT32(0, r.offset);
+
+    // one acknowledgement per ACK_BYTES, everything else goes unanswered
+    TEST_ASSERT_EQUAL_UINT32(IMAGE_SIZE / APP_OTA::ACK_BYTES, stream(session, 0, IMAGE_SIZE));
+
+    r = sendOp(session, APP_OTA::OP_END);
+    TEST_ASSERT_EQUAL_UINT8(APP_OTA::STATUS_DONE, r.status);
+    TEST_ASSERT_TRUE(session.isDone());
+    TEST_ASSERT_FALSE(session.isOpen());
+    TEST_ASSERT_EQUAL_UINT32(1, flash.ended);
+    TEST_ASSERT_EQUAL_UINT32(0, flash.aborted);
+    checkSlotHoldsImage(flash);
+}
+
+void test_begin_again_resumes_after_disconnect()
+{
+    FileFlash flash;
+    Sha256 sha;
+    Session session(flash, sha);
+
+    sendBegin(session, IMAGE_SIZE, gHash);
+    const uint32_t cut = 41 * CHUNK; // mid-sector
+    stream(session, 0, cut);
+
+    // the link drops, the client comes back a while later and asks where to go on
+    gNowMs += 30000;
+    Reply r = sendBegin(session, IMAGE_SIZE, gHash);
+    TEST_ASSERT_EQUAL_UINT8(APP_OTA::STATUS_READY, r.status);
+    TEST_ASSERT_EQUAL_UINT32(cut, r.offset);
+    TEST_ASSERT_EQUAL_UINT32(1, flash.begun); // same write, nothing erased again
+
+    stream(session, r.offset, IMAGE_SIZE);
+
+    r = sendOp(session, APP_OTA::OP_END);
+    TEST_ASSERT_EQUAL_UINT8(APP_OTA::STATUS_DONE, r.status);
+    checkSlotHoldsImage(flash);
+}
+
+void test_begin_with_another_image_starts_over()
+{
+    FileFlash flash;
+    Sha256 sha;
+    Session session(flash, sha);
+
+    sendBegin(session, IMAGE_SIZE, gHash);
+    stream(session, 0, 10 * CHUNK);
+
+    uint8_t other[APP_OTA_SESSION::HASH_SIZE];
+    memcpy(other, gHash, sizeof(other));
+    other[0] ^= 1;
+
+    const Reply r = sendBegin(session, IMAGE_SIZE, other);
+    TEST_ASSERT_EQUAL_UINT8(APP_OTA::STATUS_READY, r.status);
+    TEST_ASSERT_EQUAL_UINT32(0, r.offset);
+    TEST_ASSERT_EQUAL_UINT32(1, flash.aborted);
+    TEST_ASSERT_EQUAL_UINT32(2, flash.begun);
+}
+
+void test_hash_mismatch_discards_the_image()
+{
+    FileFlash flash;
+    Sha256 sha;
+    Session session(flash, sha);
+
+    uint8_t wrong[APP_OTA_SESSION::HASH_SIZE];
+    memcpy(wrong, gHash, sizeof(wrong));
+    wrong[31] ^= 0x80;
+
+    sendBegin(session, IMAGE_SIZE, wrong);
+    stream(session, 0, IMAGE_SIZE);
+
+    const Reply r = sendOp(session, APP_OTA::OP_END);
+    TEST_ASSERT_EQUAL_UINT8(APP_OTA::STATUS_BAD_HASH, r.status);
+    TEST_ASSERT_FALSE(session.isDone());
+    TEST_ASSERT_FALSE(session.isOpen());
+    TEST_ASSERT_EQUAL_UINT32(0, flash.ended);   // never made bootable
+    TEST_ASSERT_EQUAL_UINT32(1, flash.aborted);
+
+    TEST_ASSERT_EQUAL_UINT8(APP_OTA::STATUS_NO_SESSION, sendData(session, 0).status);
+}
+
+void test_out_of_order_offsets_are_refused()
+{
+    FileFlash flash;
+    Sha256 sha;
+    Session session(flash, sha);
+
+    sendBegin(session, IMAGE_SIZE, gHash);
+    stream(session, 0, 3 * CHUNK);
+
+    // a gap
+    Reply r = sendData(session, 5 * CHUNK);
+    TEST_ASSERT_EQUAL_UINT8(APP_OTA::STATUS_BAD_OFFSET, r.status);
+    TEST_ASSERT_EQUAL_UINT32(3 * CHUNK, r.offset);
+
+    // a repeat
+    r = sendData(session, 2 * CHUNK);
+    TEST_ASSERT_EQUAL_UINT8(APP_OTA::STATUS_BAD_OFFSET, r.status);
+    TEST_ASSERT_EQUAL_UINT32(3 * CHUNK, r.offset);
+
+    // END before the last byte
+    r = sendOp(session, APP_OTA::OP_END);
+    TEST_ASSERT_EQUAL_UINT8(APP_OTA::STATUS_BAD_OFFSET, r.status);
+    TEST_ASSERT_EQUAL_UINT32(3 * CHUNK, r.offset);
+
+    // none of it touched the slot, the upload carries on from where it was
+    stream(session, 3 * CHUNK, IMAGE_SIZE);
+    r = sendOp(session, APP_OTA::OP_END);
+    TEST_ASSERT_EQUAL_UINT8(APP_OTA::STATUS_DONE, r.status);
+    checkSlotHoldsImage(flash);
+}
+
+void test_oversized_and_sessionless_requests()
+{
+    FileFlash flash;
+    Sha256 sha;
+    Session session(flash, sha);
+
+    TEST_ASSERT_EQUAL_UINT8(APP_OTA::STATUS_NO_SESSION, sendData(session, 0).status);
+    TEST_ASSERT_EQUAL_UINT8(APP_OTA::STATUS_NO_SESSION, sendOp(session, APP_OTA::OP_END).status);
+    TEST_ASSERT_EQUAL_UINT8(APP_OTA::STATUS_TOO_BIG, sendBegin(session, SLOT_SIZE + 1, gHash).status);
+    TEST_ASSERT_EQUAL_UINT8(APP_OTA::STATUS_TOO_BIG, sendBegin(session, 0, gHash).status);
+    TEST_ASSERT_EQUAL_UINT8(APP_OTA::STATUS_BAD_REQUEST, sendOp(session, 0x7F).status);
+    TEST_ASSERT_EQUAL_UINT32(0, flash.begun);
+}
+
+void test_flash_error_closes_the_session()
+{
+    FileFlash flash;
+    Sha256 sha;
+    Session session(flash, sha);
+
+    sendBegin(session, IMAGE_SIZE, gHash);
+    stream(session, 0, 2 * CHUNK);
+
+    flash.failWrites = true;
+    const Reply r = sendData(session, 2 * CHUNK);
+    TEST_ASSERT_EQUAL_UINT8(APP_OTA::STATUS_FLASH_ERROR, r.status);
+    TEST_ASSERT_EQUAL_UINT32(2 * CHUNK, r.offset);
+    TEST_ASSERT_FALSE(session.isOpen());
+    TEST_ASSERT_EQUAL_UINT32(1, flash.aborted);
+}
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_sha256_matches_known_vector);
+    RUN_TEST(test_in_order_upload_is_written_and_verified);
+    RUN_TEST(test_begin_again_resumes_after_disconnect);
+    RUN_TEST(test_begin_with_another_image_starts_over);
+    RUN_TEST(test_hash_mismatch_discards_the_image);
+    RUN_TEST(test_out_of_order_offsets_are_refused);
+    RUN_TEST(test_oversized_and_sessionless_requests);
+    RUN_TEST(test_flash_error_closes_the_session);
+    return UNITY_END();
+}
@@ -0,0 +1,344 @@
+/*
+ * File:        test_main.cpp
+ * Author:      Marcus Lechner
+ * Created:     2025-10-18
+ * Description: Host check of the bytecode interpreter against plain evaluation and native patterns, pio test -e native
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#include <unity.h>
+#include "HOST_HAL.hpp"
+#include "APP_PATTERN.hpp"
+#include <FastLED.h>
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+
+namespace
+{
+    using namespace APP_PATTERN;
+
+    constexpr uint16_t PIXELS = 300;           // the fixture the interpreter has to keep up with
+    constexpr uint16_t BENCH_FRAMES = 200;
+    constexpr uint8_t BENCH_RUNS = 5;          // best of, the host is not otherwise idle
+    constexpr float MAX_RATIO = 2.0f;
+
+    CRGB gNative[PIXELS];
+    CRGB gBytecode[PIXELS];
+
+    // The bytecode twins of the native patterns below, as in the PATTERN_BENCHMARK of APP_LED.cpp
+    const uint8_t COLOR_WAVES[] =
+    {
+        0x01, PALETTE_RAINBOW, 0x00, 0x00, 0x00,
+        OP_I, OP_K, 0x08, OP_MUL, OP_T, OP_K, 0x02, OP_MUL, OP_ADD, OP_SIN,
+        OP_I, OP_K, 0x10, OP_MUL, OP_T, OP_K, 0x03, OP_MUL, OP_ADD, OP_SIN,
+        OP_PAL
+    };
+
+    const uint8_t RAINBOW[] =
+    {
+        0x01, PALETTE_NONE, 0x00, 0x00, 0x00,
+        OP_T, OP_I, OP_K, 0x07, OP_MUL, OP_ADD,
+        OP_K, 0xF0, OP_K, 0xFF,     // fill_rainbow's saturation
+        OP_HSV
+    };
+
+    void colorWaves(CRGB* pixels, uint16_t count, uint8_t hue)
+    {
+        static CRGBPalette16 palette = RainbowColors_p;
+
+        for (uint16_t i = 0; i < count; ++i)
+        {
+            uint8_t index = sin8(i * 8 + hue * 2);
+            uint8_t bright = sin8(i * 16 + hue * 3);
+            pixels[i] = ColorFromPalette(palette, index, bright, LINEARBLEND);
+        }
+    }
+
+    void rainbow(CRGB* pixels, uint16_t count, uint8_t hue)
+    {
+        fill_rainbow(pixels, count, hue, 7);
+    }
+
+    typedef void (*NativeFn)(CRGB* pixels, uint16_t count, uint8_t hue);
+
+    // The interpreter as it was before compile(), one opcode at a time straight
+    // from the uploaded code. Whatever the compiled form does must match it.
+    CRGB evaluate(const uint8_t* program, size_t length, const CRGBPalette16& palette,
+                  uint16_t i, uint8_t hue, uint8_t phase)
+    {
+        const uint8_t* pc = program + 5;
+        const uint8_t* const end = program + length;
+        const uint8_t beat = program[4] ? beatsin8(program[4]) : 0;
+        const APP_AUDIO::Bands audio = APP_AUDIO::get();
+        uint8_t stack[MAX_STACK];
+        uint8_t* sp = stack;
+
+        while (pc < end)
+        {
+            switch (*pc++)
+            {
+                case OP_K:     *sp++ = *pc++;                                   break;
+                case OP_I:     *sp++ = static_cast<uint8_t>(i);                 break;
+                case OP_T:     *sp++ = hue;                                     break;
+                case OP_P:     *sp++ = phase;                                   break;
+                case OP_B:     *sp++ = beat;                                    break;
+                case OP_RND:   *sp++ = random8();                               break;
+                case OP_DUP:   *sp = sp[-1]; ++sp;                              break;
+                case OP_ADD:   --sp; sp[-1] += sp[0];                           break;
+                case OP_SUB:   --sp; sp[-1] -= sp[0];                           break;
+                case OP_MUL:   --sp; sp[-1] *= sp[0];                           break;
+                case OP_SCALE: --sp; sp[-1] = scale8(sp[-1], sp[0]);            break;
+                case OP_QADD:  --sp; sp[-1] = qadd8(sp[-1], sp[0]);             break;
+                case OP_QSUB:  --sp; sp[-1] = qsub8(sp[-1], sp[0]);             break;
+                case OP_NOISE: --sp; sp[-1] = inoise8(sp[-1] * 32, sp[0] * 4);  break;
+                case OP_MAX:   --sp; if (sp[0] > sp[-1]) sp[-1] = sp[0];        break;
+                case OP_SIN:   sp[-1] = sin8(sp[-1]);                           break;
+                case OP_COS:   sp[-1] = cos8(sp[-1]);                           break;
+                case OP_TRI:   sp[-1] = triwave8(sp[-1]);                       break;
+                case OP_QUAD:  sp[-1] = quadwave8(sp[-1]);                      break;
+                case OP_INV:   sp[-1] = 255 - sp[-1];                           break;
+                case OP_BAND:  sp[-1] = audio.band[sp[-1] % APP_AUDIO::NUM_BANDS]; break;
+                case OP_PAL:   return ColorFromPalette(palette, sp[-2], sp[-1]);
+                case OP_HSV:   return CHSV(sp[-3], sp[-2], sp[-1]);
+                case OP_RGB:   return CRGB(sp[-3], sp[-2], sp[-1]);
+                default:       break;
+            }
+        }
+        return CRGB::Black;
+    }
+
+    // A random program that passes validate(): random header without fade,
+    // the stack kept within MAX_STACK, one output opcode at the end.
+    // Returns 0 when it came out too long, the caller draws another one.
+    size_t randomProgram(uint8_t* program)
+    {
+        static const uint8_t PUSHES[] = { OP_K, OP_I, OP_T, OP_P, OP_B, OP_RND, OP_DUP };
+        static const uint8_t UNARY[] = { OP_SIN, OP_COS, OP_TRI, OP_QUAD, OP_INV, OP_BAND };
+
+        const uint8_t output = OP_PAL + random8(3);
+        const uint8_t outputPops = (output == OP_PAL) ? 2 : 3;
+
+        size_t n = 0;
+        program[n++] = FORMAT_VERSION;
+        program[n++] = (output == OP_PAL) ? random8(NUM_PALETTES) : PALETTE_NONE;
+        program[n++] = 0;
+        program[n++] = random8();
+        program[n++] = random8(2) ? random8(1, 120) : 0;
+
+        uint8_t depth = 0;
+        const uint8_t steps = random8(4, 30);
+
+        for (uint8_t step = 0; step < steps + 2 * MAX_STACK; ++step)
+        {
+            uint8_t kind = random8(3);          // 0 push, 1 unary, 2 binary
+            if (step >= steps)
+            {
+                if (depth == outputPops)
+                {
+                    break;
+                }
+                kind = depth < outputPops ? 0 : 2;
+            }
+            if ((kind == 1 && depth < 1) || (kind == 2 && depth < 2))
+            {
+                kind = 0;
+            }
+            if (kind == 0 && depth == MAX_STACK)
+            {
+                kind = 2;
+            }
+
+            if (kind == 0)
+            {
+                uint8_t op = PUSHES[random8(sizeof(PUSHES))];
+                if (op == OP_DUP && depth == 0)
+                {
+                    op = OP_K;
+                }
+                program[n++] = op;
+                if (op == OP_K)
+                {
+                    program[n++] = random8();
+                }
+                depth++;
+            }
+            else if (kind == 1)
+            {
+                program[n++] = UNARY[random8(sizeof(UNARY))];
+            }
+            else
+            {
+                program[n++] = OP_ADD + random8(8);
+                depth--;
+            }
+
+            if (n >= MAX_PROGRAM_SIZE - 1)
+            {
+                return 0;
+            }
+        }
+
+        program[n++] = output;
+        return n;
+    }
+
+    float nsPerPixel(std::chrono::steady_clock::duration elapsed)
+    {
+        return std::chrono::duration<float, std::nano>(elapsed).count() / (static_cast<float>(BENCH_FRAMES) * PIXELS);
+    }
+
+    std::chrono::steady_clock::duration timeNative(NativeFn fn)
+    {
+        auto best = std::chrono::steady_clock::duration::max();
+        for (uint8_t run = 0; run < BENCH_RUNS; ++run)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            for (uint16_t f = 0; f < BENCH_FRAMES; ++f)
+            {
+                fn(gNative, PIXELS, static_cast<uint8_t>(f));
+            }
+            best = std::min(best, std::chrono::steady_clock::now() - start);
+        }
+        return best;
+    }
+
+    std::chrono::steady_clock::duration timeBytecode()
+    {
+        auto best = std::chrono::steady_clock::duration::max();
+        for (uint8_t run = 0; run < BENCH_RUNS; ++run)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            for (uint16_t f = 0; f < BENCH_FRAMES; ++f)
+            {
+                render(0, gBytecode, PIXELS, static_cast<uint8_t>(f));
+            }
+            best = std::min(best, std::chrono::steady_clock::now() - start);
+        }
+        return best;
+    }
+
+    void checkPair(const char* name, NativeFn fn, const uint8_t* program, size_t length)
+    {
+        TEST_ASSERT_TRUE_MESSAGE(load(0, program, length), name);
+
+        for (uint16_t hue = 0; hue < 256; hue += 37)
+        {
+            fn(gNative, PIXELS, static_cast<uint8_t>(hue));
+            render(0, gBytecode, PIXELS, static_cast<uint8_t>(hue));
+            TEST_ASSERT_EQUAL_HEX8_ARRAY_MESSAGE(gNative, gBytecode, sizeof(gNative), name);
+        }
+
+        const auto native = timeNative(fn);
+        const auto bytecode = timeBytecode();
+        const float ratio = nsPerPixel(bytecode) / nsPerPixel(native);
+
+        printf("%-12s x%u native %6.1f ns/px  bytecode %6.1f ns/px  ratio %.2fx\n",
+               name, PIXELS, nsPerPixel(native), nsPerPixel(bytecode), ratio);
+
+        clear(0);
+        render(0, gBytecode, 0, 0); // takes the clear over
+
+        TEST_ASSERT_TRUE_MESSAGE(ratio < MAX_RATIO, "bytecode more than 2x slower than native");
+    }
+}
+
+void setUp()
+{
+    HOST_HAL::gClockMs = 12345; // B is beatsin8 of this
+}
+
+void tearDown()
+{
+    clear(0);
+    render(0, gBytecode, 0, 0);
+}
+
+void test_compiled_matches_plain_evaluation()
+{
+    uint8_t program[MAX_PROGRAM_SIZE];
+    uint16_t checked = 0;
+
+    random16_set_seed(4242);
+
+    while (checked < 500)
+    {
+        const size_t length = randomProgram(program);
+        if (length == 0)
+        {
+            continue;
+        }
+        TEST_ASSERT_TRUE_MESSAGE(load(0, program, length), "generated program rejected");
+
+        CRGBPalette16 palette;
+        if (program[1] != PALETTE_NONE)
+        {
+            const TProgmemRGBPalette16* const palettes[NUM_PALETTES] =
+            {
+                &RainbowColors_p, &PartyColors_p, &OceanColors_p, &ForestColors_p,
+                &LavaColors_p, &CloudColors_p, &HeatColors_p
+            };
+            palette = CRGBPalette16(*palettes[program[1]]);
+        }
+
+        uint8_t phase = 0;
+        for (uint8_t frame = 0; frame < 3; ++frame)
+        {
+            const uint8_t hue = random8();
+            const uint16_t seed = random16();
+            phase += program[3];
+
+            random16_set_seed(seed);
+            render(0, gBytecode, PIXELS, hue);
+
+            random16_set_seed(seed);
+            for (uint16_t i = 0; i < PIXELS; ++i)
+            {
+                const CRGB expected = evaluate(program, length, palette, i, hue, phase);
+                if (expected != gBytecode[i])
+                {
+                    printf("program of %u bytes differs at frame %u pixel %u:", static_cast<unsigned>(length), frame, i);
+                    for (size_t b = 0; b < length; ++b)
+                    {
+                        printf(" %02X", program[b]);
+                    }
+                    printf("\n");
+                    TEST_FAIL_MESSAGE("compiled program differs from plain evaluation");
+                }
+            }
+        }
+        checked++;
+    }
+}
+
+// A slot past the last one is refused, for an upload and for a clear, so
+// APP_BLE can report it instead of claiming it was done
+void test_missing_slot_is_rejected()
+{
+    TEST_ASSERT_FALSE(load(NUM_SLOTS, RAINBOW, sizeof(RAINBOW)));
+    TEST_ASSERT_FALSE(clear(NUM_SLOTS));
+    TEST_ASSERT_FALSE(clear(0xFF));
+    TEST_ASSERT_TRUE(clear(NUM_SLOTS - 1));
+}
+
+void test_color_waves_within_2x_of_native()
+{
+    checkPair("colorWaves", colorWaves, COLOR_WAVES, sizeof(COLOR_WAVES));
+}
+
+void test_rainbow_within_2x_of_native()
+{
+    checkPair("rainbow", rainbow, RAINBOW, sizeof(RAINBOW));
+}
+
+int main(int argc, char** argv)
+{
+    HOST_HAL::init();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_compiled_matches_plain_evaluation);
+    RUN_TEST(test_missing_slot_is_rejected);
+    RUN_TEST(test_color_waves_within_2x_of_native);
+    RUN_TEST(test_rainbow_within_2x_of_native);
+    return UNITY_END();
+}
@@ -0,0 +1,373 @@
+/*
+ * File:        test_main.cpp
+ * Author:      Marcus Lechner
+ * Created:     2025-10-18
+ * Description: Host check of the DDP/E1.31 receiver fed from loopback UDP sockets, pio test -e native
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#include <unity.h>
+#include "HOST_HAL.hpp"
+#include "APP_PIXELNET_STREAM.hpp"
+#include <stdio.h>
+#include <chrono>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+namespace
+{
+    using namespace APP_PIXELNET_STREAM;
+
+    constexpr uint16_t PIXELS = 300;  // two E1.31 universes
+    typedef Receiver<PIXELS> Stream;
+    constexpr size_t FRAME_BYTES = Stream::FRAME_BYTES;
+    constexpr size_t PACKET_SIZE = 1472;
+    constexpr uint32_t LOAD_FRAMES = 5000;
+
+    // A socket pair on 127.0.0.1, the receiving end on a port the OS picks
+    class Loopback
+    {
+    public:
+        Loopback()
+        {
+            _rx = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+            _tx = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+
+            memset(&_to, 0, sizeof(_to));
+            _to.sin_family = AF_INET;
+            _to.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            bind(_rx, reinterpret_cast<const sockaddr*>(&_to), sizeof(_to));
+
+            socklen_t length = sizeof(_to);
+            getsockname(_rx, reinterpret_cast<sockaddr*>(&_to), &length);
+
+            timeval timeout = { 1, 0 };  // a lost loopback packet fails the test instead of hanging it
+            setsockopt(_rx, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        }
+
+        ~Loopback()
+        {
+            close(_rx);
+            close(_tx);
+        }
+
+        bool isOpen() const { return _rx >= 0 && _tx >= 0; }
+
+        bool send(const uint8_t* packet, size_t length)
+        {
+            return sendto(_tx, packet, length, 0, reinterpret_cast<const sockaddr*>(&_to), sizeof(_to)) ==
+                   static_cast<ssize_t>(length);
+        }
+
+        // Blocks for the next datagram, 0 on timeout
+        size_t receive(uint8_t* packet)
+        {
+            const ssize_t length = recv(_rx, packet, PACKET_SIZE, 0);
+            return length > 0 ? static_cast<size_t>(length) : 0;
+        }
+
+    private:
+        int _rx;
+        int _tx;
+        sockaddr_in _to;
+    };
+
+    Stream gStream;
+    uint8_t gPacket[PACKET_SIZE];
+    uint8_t gFrame[FRAME_BYTES];
+    uint8_t gShown[FRAME_BYTES];
+
+    void putU16(uint8_t* p, uint16_t v)
+    {
+        p[0] = static_cast<uint8_t>(v >> 8);
+        p[1] = static_cast<uint8_t>(v);
+    }
+
+    void putU32(uint8_t* p, uint32_t v)
+    {
+        putU16(p, static_cast<uint16_t>(v >> 16));
+        putU16(p + 2, static_cast<uint16_t>(v));
+    }
+
+    size_t buildDdp(uint8_t* p, uint8_t sequence, uint32_t offset, const uint8_t* rgb, uint16_t count, bool push)
+    {
+        p[0] = DDP_VERSION_1 | (push ? DDP_PUSH : 0);
+        p[1] = sequence;
+        p[2] = DDP_TYPE_RGB8;
+        p[3] = DDP_ID_DISPLAY;
+        putU32(p + 4, offset);
+        putU16(p + 8, count);
+        memcpy(p + DDP_HEADER, rgb, count);
+        return DDP_HEADER + count;
+    }
+
+    size_t buildE131(uint8_t* p, uint16_t universe, uint8_t sequence, uint8_t options, const uint8_t* data, uint16_t count)
+    {
+        memset(p, 0, E131_DATA);
+        memcpy(p + E131_ID_OFFSET, E131_PACKET_ID, sizeof(E131_PACKET_ID));
+        putU32(p + E131_ROOT_VECTOR, E131_VECTOR_ROOT_DATA);
+        putU32(p + E131_FRAME_VECTOR, E131_VECTOR_FRAME_DATA);
+        p[E131_SEQUENCE] = sequence;
+        p[E131_OPTIONS] = options;
+        putU16(p + E131_UNIVERSE, universe);
+        p[E131_DMP_VECTOR] = E131_VECTOR_DMP_SET;
+        putU16(p + E131_VALUE_COUNT, static_cast<uint16_t>(count + 1));
+        p[E131_START_CODE] = 0;
+        memcpy(p + E131_DATA, data, count);
+        return E131_DATA + count;
+    }
+
+    void fillFrame(uint8_t seed)
+    {
+        for (size_t i = 0; i < FRAME_BYTES; ++i)
+        {
+            gFrame[i] = static_cast<uint8_t>(seed + i * 7);
+        }
+    }
+
+    // Through the sockets and into the receiver, as readSocket() does on the lamp
+    Event ddpOver(Loopback& net, const uint8_t* packet, size_t length, uint32_t arrivedUs)
+    {
+        TEST_ASSERT_TRUE(net.send(packet, length));
+        const size_t received = net.receive(gPacket);
+        TEST_ASSERT_EQUAL_UINT32(length, received);
+        return gStream.ddp(gPacket, received, arrivedUs);
+    }
+
+    Event e131Over(Loopback& net, const uint8_t* packet, size_t length, uint32_t arrivedUs)
+    {
+        TEST_ASSERT_TRUE(net.send(packet, length));
+        const size_t received = net.receive(gPacket);
+        TEST_ASSERT_EQUAL_UINT32(length, received);
+        return gStream.e131(gPacket, received, arrivedUs);
+    }
+
+    // Both universes of the current gFrame
+    Event sendE131Frame(Loopback& net, uint8_t sequence, uint32_t arrivedUs)
+    {
+        uint8_t packet[PACKET_SIZE];
+        const uint16_t first = APP_PIXELNET::UNIVERSE_CHANNELS;
+        size_t length = buildE131(packet, APP_PIXELNET::START_UNIVERSE, sequence, 0, gFrame, first);
+        e131Over(net, packet, length, arrivedUs);
+        length = buildE131(packet, APP_PIXELNET::START_UNIVERSE + 1, sequence, 0, gFrame + first,
+                           static_cast<uint16_t>(FRAME_BYTES - first));
+        return e131Over(net, packet, length, arrivedUs);
+    }
+}
+
+void setUp()
+{
+    gStream = Stream();
+}
+
+void tearDown() {}
+
+void test_ddp_frame_waits_out_the_jitter_delay()
+{
+    Loopback net;
+    TEST_ASSERT_TRUE(net.isOpen());
+    uint8_t packet[PACKET_SIZE];
+
+    fillFrame(1);
+    // two packets, only the second pushes
+    size_t length = buildDdp(packet, 1, 0, gFrame, 600, false);
+    TEST_ASSERT_EQUAL_UINT8(EVENT_NONE, ddpOver(net, packet, length, 1000));
+    length = buildDdp(packet, 2, 600, gFrame + 600, FRAME_BYTES - 600, true);
+    TEST_ASSERT_EQUAL_UINT8(EVENT_STARTED, ddpOver(net, packet, length, 1000));
+    TEST_ASSERT_TRUE(gStream.isActive());
+
+    TEST_ASSERT_FALSE(gStream.render(gShown, 1000 + APP_PIXELNET::JITTER_US - 1));
+    TEST_ASSERT_TRUE(gStream.render(gShown, 1000 + APP_PIXELNET::JITTER_US));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(gFrame, gShown, FRAME_BYTES);
+    TEST_ASSERT_EQUAL_UINT32(0, gStream.stats().gaps);
+    TEST_ASSERT_EQUAL_UINT32(APP_PIXELNET::JITTER_US, gStream.stats().latencyMaxUs);
+}
+
+void test_ddp_sequence_gap_keeps_the_missing_pixels()
+{
+    Loopback net;
+    uint8_t packet[PACKET_SIZE];
+
+    fillFrame(10);
+    size_t length = buildDdp(packet, 14, 0, gFrame, FRAME_BYTES, true);
+    ddpOver(net, packet, length, 0);
+    const uint8_t before = gFrame[0];
+
+    // sequence 15 (the first half of the next frame) is lost, 1 wraps round
+    fillFrame(20);
+    length = buildDdp(packet, 1, 450, gFrame + 450, FRAME_BYTES - 450, true);
+    TEST_ASSERT_EQUAL_UINT8(EVENT_FRAME, ddpOver(net, packet, length, 100));
+    TEST_ASSERT_EQUAL_UINT32(1, gStream.stats().gaps);
+
+    gStream.render(gShown, APP_PIXELNET::JITTER_US);
+    gStream.render(gShown, 100 + APP_PIXELNET::JITTER_US);
+    TEST_ASSERT_EQUAL_UINT8(before, gShown[0]);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(gFrame + 450, gShown + 450, FRAME_BYTES - 450);
+}
+
+void test_e131_late_packets_are_dropped_and_gaps_counted()
+{
+    Loopback net;
+
+    fillFrame(30);
+    TEST_ASSERT_EQUAL_UINT8(EVENT_STARTED, sendE131Frame(net, 100, 0));
+
+    // a duplicate of the frame just sent, 1 to 20 behind is late
+    fillFrame(40);
+    TEST_ASSERT_EQUAL_UINT8(EVENT_NONE, sendE131Frame(net, 100, 10));
+    TEST_ASSERT_EQUAL_UINT8(EVENT_NONE, sendE131Frame(net, 81, 20));
+    TEST_ASSERT_EQUAL_UINT32(4, gStream.stats().late);
+    TEST_ASSERT_EQUAL_UINT32(1, gStream.stats().frames);
+
+    // 3 frames skipped on both universes
+    TEST_ASSERT_EQUAL_UINT8(EVENT_FRAME, sendE131Frame(net, 104, 30));
+    TEST_ASSERT_EQUAL_UINT32(2, gStream.stats().gaps);
+    TEST_ASSERT_EQUAL_UINT32(2, gStream.stats().frames);
+
+    // further back than the window is a restarted source, taken
+    fillFrame(50);
+    TEST_ASSERT_EQUAL_UINT8(EVENT_FRAME, sendE131Frame(net, 60, 40));
+    TEST_ASSERT_EQUAL_UINT32(3, gStream.stats().frames);
+
+    gStream.render(gShown, 40 + APP_PIXELNET::JITTER_US);
+    gStream.render(gShown, 40 + APP_PIXELNET::JITTER_US);
+    TEST_ASSERT_TRUE(gStream.render(gShown, 40 + APP_PIXELNET::JITTER_US));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(gFrame, gShown, FRAME_BYTES);
+}
+
+void test_e131_stream_terminated_ends_the_stream()
+{
+    Loopback net;
+    uint8_t packet[PACKET_SIZE];
+
+    fillFrame(60);
+    sendE131Frame(net, 1, 0);
+    sendE131Frame(net, 2, 100);
+    TEST_ASSERT_EQUAL_UINT8(2, gStream.queued());
+
+    const size_t length = buildE131(packet, APP_PIXELNET::START_UNIVERSE, 3, E131_OPT_TERMINATED, gFrame, 3);
+    TEST_ASSERT_EQUAL_UINT8(EVENT_TERMINATED, e131Over(net, packet, length, 200));
+    TEST_ASSERT_FALSE(gStream.isActive());
+    TEST_ASSERT_EQUAL_UINT8(0, gStream.queued());
+    TEST_ASSERT_FALSE(gStream.render(gShown, 1000000));
+
+    // the next source starts fresh, any sequence number is accepted
+    TEST_ASSERT_EQUAL_UINT8(EVENT_STARTED, sendE131Frame(net, 2, 300));
+    TEST_ASSERT_EQUAL_UINT32(0, gStream.stats().late);
+}
+
+void test_stream_times_out_back_to_the_patterns()
+{
+    Loopback net;
+    uint8_t packet[PACKET_SIZE];
+
+    fillFrame(70);
+    const size_t length = buildDdp(packet, 1, 0, gFrame, FRAME_BYTES, true);
+    const uint32_t start = 0xFFFFF000; // across the micros() wrap
+    ddpOver(net, packet, length, start);
+
+    const uint32_t timeoutUs = APP_PIXELNET::TIMEOUT_MS * 1000UL;
+    TEST_ASSERT_FALSE(gStream.expire(start + timeoutUs));
+    TEST_ASSERT_TRUE(gStream.isActive());
+    TEST_ASSERT_TRUE(gStream.expire(start + timeoutUs + 1));
+    TEST_ASSERT_FALSE(gStream.isActive());
+    TEST_ASSERT_FALSE(gStream.expire(start + 2 * timeoutUs));
+}
+
+void test_full_ring_drops_the_oldest_and_stale_frames_are_skipped()
+{
+    Loopback net;
+    uint8_t packet[PACKET_SIZE];
+
+    // a burst of JITTER_SLOTS + 2 frames within a millisecond
+    for (uint8_t f = 0; f < APP_PIXELNET::JITTER_SLOTS + 2; ++f)
+    {
+        fillFrame(f);
+        const size_t length = buildDdp(packet, f % 15 + 1, 0, gFrame, FRAME_BYTES, true);
+        ddpOver(net, packet, length, f * 100);
+    }
+    TEST_ASSERT_EQUAL_UINT32(2, gStream.stats().overruns);
+    TEST_ASSERT_EQUAL_UINT8(APP_PIXELNET::JITTER_SLOTS, gStream.queued());
+
+    // shown long after: all but the newest are too old
+    TEST_ASSERT_TRUE(gStream.render(gShown, APP_PIXELNET::MAX_AGE_US + 10000));
+    TEST_ASSERT_EQUAL_UINT32(APP_PIXELNET::JITTER_SLOTS - 1, gStream.stats().skipped);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(gFrame, gShown, FRAME_BYTES);
+}
+
+void test_malformed_packets_are_counted()
+{
+    Loopback net;
+    uint8_t packet[PACKET_SIZE];
+
+    fillFrame(80);
+    size_t length = buildDdp(packet, 1, 0, gFrame, FRAME_BYTES, true);
+    TEST_ASSERT_EQUAL_UINT8(EVENT_NONE, ddpOver(net, packet, length - 1, 0));   // shorter than it says
+    length = buildE131(packet, APP_PIXELNET::START_UNIVERSE, 1, 0, gFrame, 30);
+    packet[E131_ID_OFFSET] = 'X';
+    TEST_ASSERT_EQUAL_UINT8(EVENT_NONE, e131Over(net, packet, length, 0));
+    TEST_ASSERT_EQUAL_UINT32(2, gStream.stats().malformed);
+    TEST_ASSERT_FALSE(gStream.isActive());
+}
+
+// Packets/s and send-to-parsed latency through the host's loopback, as NET
+// LOAD reports them on the lamp. Host numbers, not the ESP32's.
+void test_loopback_load()
+{
+    typedef std::chrono::steady_clock Clock;
+    Loopback net;
+    uint8_t packet[PACKET_SIZE];
+
+    const Clock::time_point origin = Clock::now();
+    uint64_t latencySumNs = 0;
+    uint32_t shown = 0;
+
+    for (uint32_t f = 0; f < LOAD_FRAMES; ++f)
+    {
+        gFrame[f % FRAME_BYTES] = static_cast<uint8_t>(f);
+        const size_t length = buildDdp(packet, static_cast<uint8_t>(f % 15 + 1), 0, gFrame, FRAME_BYTES, true);
+
+        const Clock::time_point sent = Clock::now();
+        net.send(packet, length);
+        const size_t received = net.receive(gPacket);
+        const Clock::time_point arrived = Clock::now();
+        latencySumNs += std::chrono::duration_cast<std::chrono::nanoseconds>(arrived - sent).count();
+
+        const uint32_t arrivedUs = static_cast<uint32_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(arrived - origin).count());
+        gStream.ddp(gPacket, received, arrivedUs);
+        shown += gStream.render(gShown, arrivedUs + APP_PIXELNET::JITTER_US) ? 1 : 0;
+    }
+
+    const double seconds = std::chrono::duration<double>(Clock::now() - origin).count();
+    printf("%lu DDP frames of %u px: %.0f packets/s, send to parsed avg %.1f us\n",
+           static_cast<unsigned long>(LOAD_FRAMES), PIXELS, LOAD_FRAMES / seconds,
+           latencySumNs / 1000.0 / LOAD_FRAMES);
+
+    const Stats& s = gStream.stats();
+    TEST_ASSERT_EQUAL_UINT32(LOAD_FRAMES, s.packets);
+    TEST_ASSERT_EQUAL_UINT32(LOAD_FRAMES, s.frames);
+    TEST_ASSERT_EQUAL_UINT32(LOAD_FRAMES, shown);
+    TEST_ASSERT_EQUAL_UINT32(0, s.gaps + s.malformed + s.overruns + s.skipped);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(gFrame, gShown, FRAME_BYTES);
+
+    // the lamp needs 120 frames/s, a host that cannot do far more is broken
+    TEST_ASSERT_GREATER_THAN(1200, static_cast<uint32_t>(LOAD_FRAMES / seconds));
+}
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_ddp_frame_waits_out_the_jitter_delay);
+    RUN_TEST(test_ddp_sequence_gap_keeps_the_missing_pixels);
+    RUN_TEST(test_e131_late_packets_are_dropped_and_gaps_counted);
+    RUN_TEST(test_e131_stream_terminated_ends_the_stream);
+    RUN_TEST(test_stream_times_out_back_to_the_patterns);
+    RUN_TEST(test_full_ring_drops_the_oldest_and_stale_frames_are_skipped);
+    RUN_TEST(test_malformed_packets_are_counted);
+    RUN_TEST(test_loopback_load);
+    return UNITY_END();
+}
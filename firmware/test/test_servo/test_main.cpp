@@ -0,0 +1,173 @@
+/*
+ * File:        test_main.cpp
+ * Author:      Marcus Lechner
+ * Created:     2025-10-18
+ * Description: Host check of the shutter's pulse train, timed and default speed moves, pio test -e native
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#include <unity.h>
+#include "HOST_HAL.hpp"
+#include "APP_SERVO.hpp"
+#include <stdio.h>
+#include <stdlib.h>
+
+namespace
+{
+    // The shutter as configured in APP_SERVO.cpp
+    constexpr int PULSE_CLOSED_US = 500;
+    constexpr int PULSE_OPEN_US = 2400;
+    constexpr uint32_t TICK_MS = 20;            // one servo frame
+    constexpr uint32_t SETTLE_LIMIT_MS = 10000;
+
+    // Ideal pulse width at a position in percent
+    float pulseAt(float percent)
+    {
+        return PULSE_CLOSED_US + (PULSE_OPEN_US - PULSE_CLOSED_US) * percent / 100.0f;
+    }
+
+    // What writePulse() sends at a whole percent
+    int roundedPulseAt(int percent)
+    {
+        return PULSE_CLOSED_US + ((PULSE_OPEN_US - PULSE_CLOSED_US) * percent + 50) / 100;
+    }
+
+    // One loop pass per millisecond, at least one servo frame so a posted move starts
+    void runUntilStill()
+    {
+        for (uint32_t ms = 0; ms < SETTLE_LIMIT_MS; ++ms)
+        {
+            HOST_HAL::gClockMs++;
+            APP_SERVO::process();
+            if (ms >= TICK_MS && !APP_SERVO::isMoving())
+            {
+                return;
+            }
+        }
+        TEST_FAIL_MESSAGE("servo never came to rest");
+    }
+
+    // Posts a move, runs it to the end and leaves its pulses in gPulses
+    void move(int position, uint16_t fadeMs)
+    {
+        HOST_HAL::gPulseCount = 0;
+        APP_SERVO::setPosition(position, fadeMs);
+        runUntilStill();
+        TEST_ASSERT_TRUE(HOST_HAL::gPulseCount >= 2);
+        TEST_ASSERT_TRUE(HOST_HAL::gPulseCount < HOST_HAL::MAX_PULSES);
+    }
+
+    // The writes of the last move, without the release at its end
+    size_t writes()
+    {
+        return HOST_HAL::gPulseCount - 1;
+    }
+
+    // Every write one servo frame after the one before, the release on the last
+    void checkTiming(uint32_t postedMs)
+    {
+        const ServoPulse* p = HOST_HAL::gPulses;
+
+        TEST_ASSERT_TRUE(p[0].ms > postedMs && p[0].ms <= postedMs + TICK_MS);
+        for (size_t i = 1; i < writes(); ++i)
+        {
+            TEST_ASSERT_EQUAL_UINT32(TICK_MS, p[i].ms - p[i - 1].ms);
+        }
+        TEST_ASSERT_EQUAL_INT(0, p[writes()].us);
+        TEST_ASSERT_EQUAL_UINT32(p[writes() - 1].ms, p[writes()].ms);
+    }
+}
+
+void setUp() {}
+void tearDown() {}
+
+// No pot answers (gPotAdc stays put), so the first boot's calibration sweep
+// finds no feedback and the shutter runs open loop from then on
+void test_boot_sweep_finds_no_pot()
+{
+    HOST_HAL::init();
+    APP_SERVO::init();
+    runUntilStill();
+
+    TEST_ASSERT_FALSE(APP_SERVO::hasFeedback());
+    TEST_ASSERT_EQUAL_INT(PULSE_CLOSED_US, HOST_HAL::gPulses[0].us);
+    TEST_ASSERT_EQUAL_INT(0, HOST_HAL::gPulses[HOST_HAL::gPulseCount - 1].us);
+    TEST_ASSERT_EQUAL_INT(50, APP_SERVO::getActualPosition());
+}
+
+// 50% to 80% over one second is 50 servo frames on a straight line, each
+// pulse within a microsecond of it and the last one exactly on the target
+void test_timed_move_follows_a_line()
+{
+    const uint32_t posted = HOST_HAL::gClockMs;
+    move(80, 1000);
+
+    TEST_ASSERT_EQUAL_UINT32(1000 / TICK_MS, writes());
+    checkTiming(posted);
+
+    float worst = 0.0f;
+    for (size_t i = 0; i < writes(); ++i)
+    {
+        const float ideal = pulseAt(50.0f + 30.0f * (i + 1) / writes());
+        const float error = fabsf(HOST_HAL::gPulses[i].us - ideal);
+        worst = error > worst ? error : worst;
+        TEST_ASSERT_TRUE(HOST_HAL::gPulses[i].us >= (i ? HOST_HAL::gPulses[i - 1].us : roundedPulseAt(50)));
+    }
+    printf("%u pulses over %lu ms, %d to %d us, worst %.2f us off the line\n", static_cast<unsigned>(writes()),
+           static_cast<unsigned long>(HOST_HAL::gPulses[writes() - 1].ms - posted),
+           HOST_HAL::gPulses[0].us, HOST_HAL::gPulses[writes() - 1].us, worst);
+
+    TEST_ASSERT_TRUE(worst <= 1.0f);
+    TEST_ASSERT_EQUAL_INT(roundedPulseAt(80), HOST_HAL::gPulses[writes() - 1].us);
+    TEST_ASSERT_EQUAL_INT(80, APP_SERVO::getActualPosition());
+}
+
+// One percent over two seconds moves the pulse 19 us. In 1/100 % it rises a
+// microsecond at a time instead of one 19 us step from whole percents.
+void test_slow_move_steps_a_microsecond_at_a_time()
+{
+    const uint32_t posted = HOST_HAL::gClockMs;
+    move(81, 2000);
+
+    TEST_ASSERT_EQUAL_UINT32(2000 / TICK_MS, writes());
+    checkTiming(posted);
+
+    int previous = roundedPulseAt(80);
+    uint8_t steps = 0;
+    for (size_t i = 0; i < writes(); ++i)
+    {
+        const int step = HOST_HAL::gPulses[i].us - previous;
+        TEST_ASSERT_TRUE(step == 0 || step == 1);
+        steps += step;
+        previous = HOST_HAL::gPulses[i].us;
+    }
+
+    TEST_ASSERT_EQUAL_INT(roundedPulseAt(81) - roundedPulseAt(80), steps);
+    TEST_ASSERT_EQUAL_INT(roundedPulseAt(81), previous);
+}
+
+// Without a fade the shutter moves 1% per frame, the same 19 us every time
+void test_default_speed_is_one_percent_per_frame()
+{
+    const uint32_t posted = HOST_HAL::gClockMs;
+    move(51, 0);
+
+    TEST_ASSERT_EQUAL_UINT32(30, writes());
+    checkTiming(posted);
+
+    for (size_t i = 0; i < writes(); ++i)
+    {
+        TEST_ASSERT_EQUAL_INT(roundedPulseAt(80 - static_cast<int>(i)), HOST_HAL::gPulses[i].us);
+    }
+    TEST_ASSERT_EQUAL_INT(roundedPulseAt(51), HOST_HAL::gPulses[writes() - 1].us);
+}
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_boot_sweep_finds_no_pot);
+    RUN_TEST(test_timed_move_follows_a_line);
+    RUN_TEST(test_slow_move_steps_a_microsecond_at_a_time);
+    RUN_TEST(test_default_speed_is_one_percent_per_frame);
+    return UNITY_END();
+}
@@ -0,0 +1,144 @@
+/*
+ * File:        test_main.cpp
+ * Author:      Marcus Lechner
+ * Created:     2025-10-18
+ * Description: Host check of the settings store's debounced writes and record rotation, pio test -e native
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#include <unity.h>
+#include "HOST_HAL.hpp"
+#include "APP_LED.hpp"
+#include "APP_SETTINGS.hpp"
+#include <Preferences.h>
+#include <stdio.h>
+
+namespace
+{
+    constexpr uint32_t QUIET_MS = 1500;      // as in APP_SETTINGS.cpp
+    constexpr uint32_t MAX_DELAY_MS = 10000;
+
+    uint32_t gChanges = 0;
+    uint32_t gCommits = 0;
+    HOST_NVS::Stats gNvs = {};
+
+    // Moves the clock on in loop-sized steps, the store commits from process()
+    void run(uint32_t ms)
+    {
+        for (uint32_t t = 0; t < ms; t += 10)
+        {
+            HOST_HAL::gClockMs += 10;
+            APP_SETTINGS::process();
+        }
+    }
+
+    uint32_t changesSinceSetUp() { return APP_SETTINGS::changeCount() - gChanges; }
+    uint32_t commitsSinceSetUp() { return APP_SETTINGS::commitCount() - gCommits; }
+
+    // What reached the NVS file, not what APP_SETTINGS says it wrote
+    uint32_t entriesSinceSetUp() { return HOST_NVS::stats().entriesWritten - gNvs.entriesWritten; }
+    size_t bytesSinceSetUp() { return HOST_NVS::stats().bytesWritten - gNvs.bytesWritten; }
+}
+
+void setUp()
+{
+    run(MAX_DELAY_MS); // whatever the last test left pending is written now
+    gChanges = APP_SETTINGS::changeCount();
+    gCommits = APP_SETTINGS::commitCount();
+    gNvs = HOST_NVS::stats();
+}
+
+void tearDown()
+{
+}
+
+// A shutter slider dragged back and forth for 4 s, one write every 20 ms
+void test_slider_drag_is_one_write()
+{
+    for (uint16_t step = 0; step < 200; ++step)
+    {
+        APP_SETTINGS::setShutter(step <= 100 ? step : 200 - step);
+        run(20);
+    }
+    TEST_ASSERT_EQUAL_UINT32(200, changesSinceSetUp());
+    TEST_ASSERT_EQUAL_UINT32(0, commitsSinceSetUp());
+    TEST_ASSERT_EQUAL_UINT32(0, entriesSinceSetUp());
+
+    run(QUIET_MS);
+    TEST_ASSERT_EQUAL_UINT32(1, commitsSinceSetUp());
+    TEST_ASSERT_EQUAL_UINT32(1, entriesSinceSetUp());
+
+    // one record with its entry header, and at most the state byte of the one it replaces
+    const size_t record = sizeof(HOST_NVS::Entry) + strlen("lamp") + strlen("set0") + sizeof(APP_SETTINGS::Settings);
+    printf("200 changes, %u bytes to flash\n", static_cast<unsigned>(bytesSinceSetUp()));
+    TEST_ASSERT_TRUE(bytesSinceSetUp() >= record && bytesSinceSetUp() <= record + 1);
+}
+
+// A colour that never settles is still written every MAX_DELAY_MS
+void test_endless_drag_is_written_every_max_delay()
+{
+    for (uint16_t step = 0; step < 500; ++step)
+    {
+        APP_SETTINGS::setSolidColor(static_cast<uint8_t>(step), 0, 255);
+        run(50);
+    }
+    TEST_ASSERT_EQUAL_UINT32(2, commitsSinceSetUp()); // 25 s of changes
+
+    run(QUIET_MS);
+    TEST_ASSERT_EQUAL_UINT32(3, commitsSinceSetUp());
+    TEST_ASSERT_EQUAL_UINT32(3, entriesSinceSetUp());
+}
+
+void test_change_undone_is_not_written()
+{
+    const APP_SETTINGS::Settings before = APP_SETTINGS::get();
+
+    APP_SETTINGS::setPattern(before.pattern + 1);
+    run(100);
+    APP_SETTINGS::setPattern(before.pattern);
+    run(QUIET_MS);
+
+    TEST_ASSERT_EQUAL_UINT32(2, changesSinceSetUp());
+    TEST_ASSERT_EQUAL_UINT32(0, commitsSinceSetUp());
+    TEST_ASSERT_EQUAL_UINT32(0, bytesSinceSetUp());
+}
+
+// A restart loads the newest record, and the one before it if the newest is broken
+void test_restart_picks_newest_valid_record()
+{
+    APP_SETTINGS::setPattern(3);
+    run(QUIET_MS);
+    APP_SETTINGS::setPattern(5);
+    run(QUIET_MS);
+    TEST_ASSERT_EQUAL_UINT32(2, commitsSinceSetUp());
+
+    APP_SETTINGS::init(); // get() has the loaded record's sequence from here on
+    const uint32_t newest = APP_SETTINGS::get().sequence;
+    TEST_ASSERT_EQUAL_UINT8(5, APP_SETTINGS::get().pattern);
+
+    // a write cut short, as the keys rotate in APP_SETTINGS.cpp
+    char key[] = "set0";
+    key[3] = static_cast<char>('0' + newest % 4);
+    Preferences prefs;
+    prefs.begin("lamp", false);
+    const uint8_t torn[4] = { APP_SETTINGS::LAYOUT_VERSION, 1, 2, 3 };
+    prefs.putBytes(key, torn, sizeof(torn));
+
+    APP_SETTINGS::init();
+    TEST_ASSERT_EQUAL_UINT32(newest - 1, APP_SETTINGS::get().sequence);
+    TEST_ASSERT_EQUAL_UINT8(3, APP_SETTINGS::get().pattern);
+}
+
+int main(int argc, char** argv)
+{
+    HOST_HAL::init();
+    APP_LED::init();
+    APP_SETTINGS::init();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_slider_drag_is_one_write);
+    RUN_TEST(test_endless_drag_is_written_every_max_delay);
+    RUN_TEST(test_change_undone_is_not_written);
+    RUN_TEST(test_restart_picks_newest_valid_record);
+    return UNITY_END();
+}
@@ -0,0 +1,161 @@
+/*
+ * File:        test_main.cpp
+ * Author:      Marcus Lechner
+ * Created:     2025-10-18
+ * Description: Host check of the table RMT encoder against the bit-by-bit reference, pio test -e native
+ * License:     Custom MIT License (Non-Commercial + Beerware)
+ */
+
+#include <unity.h>
+#include "HOST_HAL.hpp"
+#include "APP_WIRE.hpp"
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+
+namespace
+{
+    using namespace APP_WIRE;
+
+    constexpr uint16_t PIXELS = 300;
+    constexpr size_t MAX_BYTES = PIXELS * 4;   // room for RGBW
+    constexpr uint16_t FRAMES = 200;
+    constexpr uint16_t BENCH_FRAMES = 500;
+    constexpr uint8_t BENCH_RUNS = 5;          // best of, the host is not otherwise idle
+
+    Encoder<MAX_BYTES> gWs2812(WS2812_TIMING);
+    Encoder<MAX_BYTES> gSk6812(SK6812_TIMING);
+    uint8_t gBytes[MAX_BYTES];
+    uint32_t gReference[MAX_BYTES * SYMBOLS_PER_BYTE];
+    volatile uint32_t gSink;                   // keeps the benchmark loops from being optimised out
+
+    uint32_t gRandom = 0x2545F491;
+
+    uint8_t nextByte()
+    {
+        gRandom ^= gRandom << 13;
+        gRandom ^= gRandom >> 17;
+        gRandom ^= gRandom << 5;
+        return static_cast<uint8_t>(gRandom);
+    }
+
+    void checkFrames(Encoder<MAX_BYTES>& encoder, const BitTiming& timing, size_t bytesPerPixel)
+    {
+        for (uint16_t frame = 0; frame < FRAMES; ++frame)
+        {
+            // short frames too, the buffer is reused and must not leak the last one
+            const size_t length = (frame % 4 == 0) ? (frame % PIXELS) * bytesPerPixel : PIXELS * bytesPerPixel;
+            for (size_t i = 0; i < length; ++i)
+            {
+                gBytes[i] = nextByte();
+            }
+
+            const size_t expected = encodeReference(timing, gBytes, length, gReference);
+            const size_t count = encoder.encode(gBytes, length);
+
+            TEST_ASSERT_EQUAL_UINT32(expected, count);
+            TEST_ASSERT_EQUAL_HEX8_ARRAY(gReference, encoder.symbols(), count * sizeof(uint32_t));
+        }
+    }
+
+    template <class Fn>
+    std::chrono::steady_clock::duration best(Fn fn)
+    {
+        auto fastest = std::chrono::steady_clock::duration::max();
+        for (uint8_t run = 0; run < BENCH_RUNS; ++run)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            for (uint16_t f = 0; f < BENCH_FRAMES; ++f)
+            {
+                gBytes[f % (PIXELS * 3)] = static_cast<uint8_t>(f);
+                fn();
+            }
+            fastest = std::min(fastest, std::chrono::steady_clock::now() - start);
+        }
+        return fastest;
+    }
+
+    float nsPerPixel(std::chrono::steady_clock::duration elapsed)
+    {
+        return std::chrono::duration<float, std::nano>(elapsed).count() / (static_cast<float>(BENCH_FRAMES) * PIXELS);
+    }
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_symbol_layout()
+{
+    // 800 ns high then 450 ns low at 25 ns a tick
+    TEST_ASSERT_EQUAL_HEX32(0x00128020, symbol(WS2812_TIMING.t1h, WS2812_TIMING.t1l));
+
+    const uint8_t byte = 0xA5;
+    gWs2812.encode(&byte, 1);
+    const uint32_t bit0 = symbol(WS2812_TIMING.t0h, WS2812_TIMING.t0l);
+    const uint32_t bit1 = symbol(WS2812_TIMING.t1h, WS2812_TIMING.t1l);
+    const uint32_t expected[8] = { bit1, bit0, bit1, bit0, bit0, bit1, bit0, bit1 };
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, gWs2812.symbols(), sizeof(expected));
+}
+
+void test_table_matches_reference_ws2812_rgb()
+{
+    checkFrames(gWs2812, WS2812_TIMING, 3);
+}
+
+void test_table_matches_reference_sk6812_rgbw()
+{
+    checkFrames(gSk6812, SK6812_TIMING, 4);
+}
+
+void test_every_byte_value()
+{
+    for (uint16_t i = 0; i < 256; ++i)
+    {
+        gBytes[i] = static_cast<uint8_t>(i);
+    }
+
+    const size_t expected = encodeReference(SK6812_TIMING, gBytes, 256, gReference);
+    TEST_ASSERT_EQUAL_UINT32(expected, gSk6812.encode(gBytes, 256));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(gReference, gSk6812.symbols(), expected * sizeof(uint32_t));
+}
+
+void test_long_frame_is_clipped_to_capacity()
+{
+    TEST_ASSERT_EQUAL_UINT32(MAX_BYTES * SYMBOLS_PER_BYTE, gWs2812.encode(gBytes, MAX_BYTES + 17));
+}
+
+// The table has to beat the bit loop it replaced; the ns/px are the host's,
+// not the ESP32's
+void test_encode_speed()
+{
+    const size_t length = PIXELS * 3;
+    for (size_t i = 0; i < length; ++i)
+    {
+        gBytes[i] = nextByte();
+    }
+
+    const auto table = best([&]()
+    {
+        gSink += static_cast<uint32_t>(gWs2812.encode(gBytes, length)) + gWs2812.symbols()[length];
+    });
+    const auto reference = best([&]()
+    {
+        gSink += static_cast<uint32_t>(encodeReference(WS2812_TIMING, gBytes, length, gReference)) + gReference[length];
+    });
+
+    printf("%u px RGB  table %5.2f ns/px  reference %5.2f ns/px\n",
+           PIXELS, nsPerPixel(table), nsPerPixel(reference));
+    TEST_ASSERT_TRUE(table < reference);
+}
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_symbol_layout);
+    RUN_TEST(test_table_matches_reference_ws2812_rgb);
+    RUN_TEST(test_table_matches_reference_sk6812_rgbw);
+    RUN_TEST(test_every_byte_value);
+    RUN_TEST(test_long_frame_is_clipped_to_capacity);
+    RUN_TEST(test_encode_speed);
+    return UNITY_END();
+}
@@ -220,6 +220,9 @@ class _MyHomePageState extends State<MyHomePage> {
     'Lightning',
     'Color Waves',
     'Noise / Perlin',
+    'Audio Spectrum',
+    'Clouds',
+    'Water',
   ];
 
   final Map<String, int> _animIds = {
@@ -237,6 +240,9 @@ class _MyHomePageState extends State<MyHomePage> {
     'Lightning': 10,
     'Color Waves': 11,
     'Noise / Perlin': 12,
+    'Audio Spectrum': 13,
+    'Clouds': 14,
+    'Water': 15,
   };
 
   int _selectedAnimationIndex = 0;